@@ -0,0 +1,118 @@
+/**
+ *
+ *  Cancellation.cc
+ *
+ */
+
+#include "Cancellation.h"
+#include <algorithm>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+void CancellationToken::cancel()
+{
+    map<uint64_t, function<void()>> callbacks;
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (cancelled_)
+        {
+            return;
+        }
+        cancelled_ = true;
+        callbacks.swap(callbacks_);
+    }
+    for (auto &[id, callback] : callbacks)
+    {
+        callback();
+    }
+}
+
+bool CancellationToken::isCancelled() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return cancelled_;
+}
+
+uint64_t CancellationToken::onCancel(function<void()> &&callback)
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (!cancelled_)
+        {
+            auto id = nextId_++;
+            callbacks_.emplace(id, std::move(callback));
+            return id;
+        }
+    }
+    callback();
+    return 0;
+}
+
+void CancellationToken::removeCallback(uint64_t id)
+{
+    lock_guard<mutex> lock(mutex_);
+    callbacks_.erase(id);
+}
+
+CancellationTokenPtr LatestWins::next(const string &sessionId)
+{
+    auto token = make_shared<CancellationToken>();
+    CancellationTokenPtr previous;
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto &entry = tokens_[sessionId];
+        previous = entry.lock();
+        entry = token;
+        if (tokens_.size() >= pruneThreshold_)
+        {
+            pruneExpired();
+        }
+    }
+    if (previous)
+    {
+        previous->cancel();
+    }
+    return token;
+}
+
+void LatestWins::cancel(const string &sessionId)
+{
+    CancellationTokenPtr previous;
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto it = tokens_.find(sessionId);
+        if (it == tokens_.end())
+        {
+            return;
+        }
+        previous = it->second.lock();
+        tokens_.erase(it);
+    }
+    if (previous)
+    {
+        previous->cancel();
+    }
+}
+
+size_t LatestWins::sessions() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return tokens_.size();
+}
+
+void LatestWins::pruneExpired()
+{
+    for (auto it = tokens_.begin(); it != tokens_.end();)
+    {
+        if (it->second.expired())
+        {
+            it = tokens_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    pruneThreshold_ = max(kMinPruneThreshold, tokens_.size() * 2);
+}
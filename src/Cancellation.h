@@ -0,0 +1,74 @@
+/**
+ *
+ *  Cancellation.h
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace tl::elasticsearch
+{
+
+/// Cancels the requests it is passed to. A request cancelled before it is
+/// sent is dropped; one in flight is detached, its response is neither
+/// decoded nor delivered. In both cases the exception callback is called
+/// once with "request cancelled!".
+class CancellationToken
+{
+  public:
+    void cancel();
+
+    bool isCancelled() const;
+
+    /// Runs the callback on cancel(), right away if already cancelled.
+    /// Returns an id for removeCallback().
+    uint64_t onCancel(std::function<void()> &&callback);
+
+    void removeCallback(uint64_t id);
+
+  private:
+    mutable std::mutex mutex_;
+    bool cancelled_ = false;
+    // 0 is never used, it stands for no callback
+    uint64_t nextId_ = 1;
+    std::map<uint64_t, std::function<void()>> callbacks_;
+};
+
+using CancellationTokenPtr = std::shared_ptr<CancellationToken>;
+
+/// Latest-wins requests per session, e.g. for typeahead: a new token for a
+/// session cancels the previous one.
+class LatestWins
+{
+  public:
+    /// Cancels the last token of the session and returns a new one.
+    CancellationTokenPtr next(const std::string &sessionId);
+
+    /// Cancels the last token of the session and forgets the session.
+    void cancel(const std::string &sessionId);
+
+    size_t sessions() const;
+
+  private:
+    void pruneExpired();
+
+  private:
+    mutable std::mutex mutex_;
+    // tokens are owned by the requests, expired ones are pruned
+    std::unordered_map<std::string, std::weak_ptr<CancellationToken>>
+        tokens_;
+    size_t pruneThreshold_ = kMinPruneThreshold;
+    static constexpr size_t kMinPruneThreshold = 64;
+};
+
+using LatestWinsPtr = std::shared_ptr<LatestWins>;
+
+};  // namespace tl::elasticsearch
@@ -0,0 +1,163 @@
+/**
+ *
+ *  CircuitBreaker.cc
+ *
+ */
+
+#include "CircuitBreaker.h"
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+string tl::elasticsearch::to_string(CircuitState state)
+{
+    switch (state)
+    {
+        case CircuitState::CLOSED:
+            return "closed";
+        case CircuitState::OPEN:
+            return "open";
+        case CircuitState::HALF_OPEN:
+            return "half_open";
+    }
+    return "unknown";
+}
+
+CircuitState CircuitBreaker::state() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return state_;
+}
+
+bool CircuitBreaker::isAvailable() const
+{
+    lock_guard<mutex> lock(mutex_);
+    switch (state_)
+    {
+        case CircuitState::CLOSED:
+            return true;
+        case CircuitState::HALF_OPEN:
+            return halfOpenDispatched_ < config_.halfOpenRequests;
+        default:
+            return false;
+    }
+}
+
+bool CircuitBreaker::tryAcquire()
+{
+    lock_guard<mutex> lock(mutex_);
+    switch (state_)
+    {
+        case CircuitState::CLOSED:
+            return true;
+        case CircuitState::HALF_OPEN:
+            if (halfOpenDispatched_ < config_.halfOpenRequests)
+            {
+                ++halfOpenDispatched_;
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+void CircuitBreaker::onAbandon()
+{
+    lock_guard<mutex> lock(mutex_);
+    if (state_ == CircuitState::HALF_OPEN && halfOpenDispatched_ > 0)
+    {
+        --halfOpenDispatched_;
+    }
+}
+
+bool CircuitBreaker::onFailure()
+{
+    lock_guard<mutex> lock(mutex_);
+    switch (state_)
+    {
+        case CircuitState::CLOSED:
+            ++consecutiveFailures_;
+            record(true);
+            if (consecutiveFailures_ >= config_.consecutiveFailures ||
+                (windowCount_ >= config_.minRequests &&
+                 windowFailures_ >= config_.errorRate * windowCount_))
+            {
+                open();
+                return true;
+            }
+            return false;
+        case CircuitState::HALF_OPEN:
+            open();
+            return true;
+        default:
+            return false;
+    }
+}
+
+void CircuitBreaker::onSuccess()
+{
+    lock_guard<mutex> lock(mutex_);
+    switch (state_)
+    {
+        case CircuitState::CLOSED:
+            consecutiveFailures_ = 0;
+            record(false);
+            break;
+        case CircuitState::HALF_OPEN:
+            if (++halfOpenSucceeded_ >= config_.halfOpenRequests)
+            {
+                reset();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void CircuitBreaker::onProbe(bool succeeded)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (succeeded && state_ == CircuitState::OPEN)
+    {
+        state_ = CircuitState::HALF_OPEN;
+        halfOpenDispatched_ = 0;
+        halfOpenSucceeded_ = 0;
+    }
+}
+
+void CircuitBreaker::record(bool failed)
+{
+    if (windowCount_ == window_.size())
+    {
+        if (window_[windowPos_])
+        {
+            --windowFailures_;
+        }
+    }
+    else
+    {
+        ++windowCount_;
+    }
+    window_[windowPos_] = failed;
+    if (failed)
+    {
+        ++windowFailures_;
+    }
+    windowPos_ = (windowPos_ + 1) % window_.size();
+}
+
+void CircuitBreaker::open()
+{
+    state_ = CircuitState::OPEN;
+}
+
+void CircuitBreaker::reset()
+{
+    state_ = CircuitState::CLOSED;
+    consecutiveFailures_ = 0;
+    windowPos_ = 0;
+    windowCount_ = 0;
+    windowFailures_ = 0;
+    window_.assign(window_.size(), false);
+}
@@ -0,0 +1,100 @@
+/**
+ *
+ *  CircuitBreaker.h
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+enum class CircuitState
+{
+    CLOSED = 0,
+    OPEN,
+    HALF_OPEN
+};
+
+std::string to_string(CircuitState state);
+
+class CircuitBreakerConfig
+{
+  public:
+    /// Opens after this many failures in a row.
+    uint32_t consecutiveFailures = 5;
+    /// Opens when the failure rate of the last windowSize requests reaches
+    /// errorRate, once at least minRequests have been seen.
+    double errorRate = 0.5;
+    uint32_t windowSize = 20;
+    uint32_t minRequests = 10;
+    /// Seconds between two `HEAD /` probes of an open node.
+    double probeInterval = 2;
+    /// Requests let through while half-open, all must succeed to close.
+    uint32_t halfOpenRequests = 3;
+};
+
+/// closed --failures--> open --probe ok--> half-open --trials ok--> closed
+///                        ^                    |
+///                        +----trial failed----+
+class CircuitBreaker
+{
+  public:
+    CircuitBreaker(const CircuitBreakerConfig &config = CircuitBreakerConfig())
+        : config_(config),
+          window_(config.windowSize > 0 ? config.windowSize : 1, false)
+    {
+    }
+
+  public:
+    CircuitState state() const;
+
+    /// Whether the node may be chosen for a request.
+    bool isAvailable() const;
+
+    /// Claims the node for a request if it is available, i.e. one of the
+    /// trials while half-open. Checked and counted under the same lock, so
+    /// that concurrent requests cannot exceed the trials.
+    bool tryAcquire();
+
+    /// A request claimed by tryAcquire() is not sent after all, its trial
+    /// is given back.
+    void onAbandon();
+
+    /// Returns true if this failure opened the circuit.
+    bool onFailure();
+    void onSuccess();
+
+    /// Result of a `HEAD /` probe while open.
+    void onProbe(bool succeeded);
+
+    const CircuitBreakerConfig &config() const
+    {
+        return config_;
+    }
+
+  private:
+    void record(bool failed);
+    void open();
+    void reset();
+
+  private:
+    CircuitBreakerConfig config_;
+    mutable std::mutex mutex_;
+    CircuitState state_ = CircuitState::CLOSED;
+    uint32_t consecutiveFailures_ = 0;
+    // ring buffer of the latest outcomes, true means failed
+    std::vector<bool> window_;
+    uint32_t windowPos_ = 0;
+    uint32_t windowCount_ = 0;
+    uint32_t windowFailures_ = 0;
+    uint32_t halfOpenDispatched_ = 0;
+    uint32_t halfOpenSucceeded_ = 0;
+};
+
+};  // namespace tl::elasticsearch
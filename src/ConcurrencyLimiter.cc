@@ -0,0 +1,221 @@
+/**
+ *
+ *  ConcurrencyLimiter.cc
+ *
+ */
+
+#include "ConcurrencyLimiter.h"
+#include <algorithm>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+bool ConcurrencyLimiter::hasPermit(Priority priority) const
+{
+    double limit = limit_;
+    if (priority != Priority::INTERACTIVE)
+    {
+        limit *= 1 - config_.interactiveReserve;
+    }
+    return inFlight_ < max<uint32_t>(1, static_cast<uint32_t>(limit));
+}
+
+bool ConcurrencyLimiter::tryAcquire(Priority priority)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (hasPermit(priority))
+    {
+        ++inFlight_;
+        return true;
+    }
+    return false;
+}
+
+bool ConcurrencyLimiter::enqueue(Task &&task,
+                                 Priority priority,
+                                 const CancellationTokenPtr &cancellation,
+                                 Task &&onCancel)
+{
+    vector<Task> dropped;
+    bool waiting;
+    bool accepted = true;
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto &queue = queues_[static_cast<size_t>(priority)];
+        // requests of the same class must not overtake the queued ones
+        waiting = !queue.empty() || !hasPermit(priority);
+        if (waiting)
+        {
+            if (queued_ >= config_.maxQueued)
+            {
+                dropCancelled(dropped);
+            }
+            accepted = queued_ < config_.maxQueued;
+            if (accepted)
+            {
+                queue.push_back(
+                    {std::move(task), cancellation, std::move(onCancel)});
+                ++queued_;
+            }
+        }
+        else
+        {
+            ++inFlight_;
+        }
+    }
+    for (auto &callback : dropped)
+    {
+        callback();
+    }
+    if (!waiting)
+    {
+        task();
+    }
+    return accepted;
+}
+
+void ConcurrencyLimiter::dropCancelled(vector<Task> &dropped)
+{
+    for (auto &queue : queues_)
+    {
+        auto kept = queue.begin();
+        for (auto &waiter : queue)
+        {
+            if (!waiter.isCancelled())
+            {
+                *kept++ = std::move(waiter);
+            }
+            else if (waiter.onCancel)
+            {
+                dropped.push_back(std::move(waiter.onCancel));
+            }
+        }
+        queued_ -= queue.end() - kept;
+        queue.erase(kept, queue.end());
+    }
+}
+
+vector<ConcurrencyLimiter::Task> ConcurrencyLimiter::release(
+    Clock::duration latency,
+    LimiterSignal signal,
+    Clock::time_point now)
+{
+    vector<Task> result;
+    lock_guard<mutex> lock(mutex_);
+    onSample(latency, signal, now);
+    --inFlight_;
+    for (auto index = nextClass(); index < kPriorityCount; index = nextClass())
+    {
+        auto waiter = std::move(queues_[index].front());
+        queues_[index].pop_front();
+        --queued_;
+        // a cancelled waiter leaves without the permit
+        if (waiter.isCancelled())
+        {
+            if (waiter.onCancel)
+            {
+                result.push_back(std::move(waiter.onCancel));
+            }
+            continue;
+        }
+        ++inFlight_;
+        result.push_back(std::move(waiter.task));
+    }
+    return result;
+}
+
+size_t ConcurrencyLimiter::nextClass()
+{
+    int64_t totalWeight = 0;
+    size_t chosen = kPriorityCount;
+    for (size_t i = 0; i < kPriorityCount; ++i)
+    {
+        if (queues_[i].empty() || !hasPermit(static_cast<Priority>(i)))
+        {
+            continue;
+        }
+        credits_[i] += config_.weights[i];
+        totalWeight += config_.weights[i];
+        if (chosen == kPriorityCount || credits_[i] > credits_[chosen])
+        {
+            chosen = i;
+        }
+    }
+    if (chosen < kPriorityCount)
+    {
+        credits_[chosen] -= totalWeight;
+    }
+    return chosen;
+}
+
+void ConcurrencyLimiter::onSample(Clock::duration latency,
+                                  LimiterSignal signal,
+                                  Clock::time_point now)
+{
+    if (signal == LimiterSignal::IGNORED)
+    {
+        return;
+    }
+    bool congested = signal == LimiterSignal::DROPPED;
+    if (!congested)
+    {
+        if (now - windowStart_ >= config_.baselineWindow)
+        {
+            previousMinUs_ = now - windowStart_ < 2 * config_.baselineWindow
+                                 ? windowMinUs_
+                                 : 0;
+            windowMinUs_ = 0;
+            windowStart_ = now;
+        }
+        double sample =
+            chrono::duration_cast<chrono::duration<double, micro>>(latency)
+                .count();
+        if (windowMinUs_ == 0 || sample < windowMinUs_)
+        {
+            windowMinUs_ = sample;
+        }
+        auto baselineUs = previousMinUs_ == 0
+                              ? windowMinUs_
+                              : min(windowMinUs_, previousMinUs_);
+        congested = sample > baselineUs * config_.latencyTolerance;
+    }
+    if (congested)
+    {
+        // the requests in flight at the last backoff saw the same overload
+        if (now - latency >= lastBackoff_)
+        {
+            limit_ =
+                max<double>(config_.minLimit, limit_ * config_.backoffRatio);
+            lastBackoff_ = now;
+        }
+    }
+    else if (inFlight_ * 2 >= limit_)
+    {
+        // only grow while the limit is actually used, +1 per round trip
+        limit_ = min<double>(config_.maxLimit, limit_ + 1 / limit_);
+    }
+}
+
+uint32_t ConcurrencyLimiter::limit() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return static_cast<uint32_t>(limit_);
+}
+
+uint32_t ConcurrencyLimiter::inFlight() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return inFlight_;
+}
+
+size_t ConcurrencyLimiter::queued() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return queued_;
+}
+
+size_t ConcurrencyLimiter::queued(Priority priority) const
+{
+    lock_guard<mutex> lock(mutex_);
+    return queues_[static_cast<size_t>(priority)].size();
+}
@@ -0,0 +1,148 @@
+/**
+ *
+ *  ConcurrencyLimiter.h
+ *
+ */
+
+#pragma once
+
+#include "RequestOptions.h"
+#include <array>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+class ConcurrencyLimitConfig
+{
+  public:
+    uint32_t initialLimit = 20;
+    uint32_t minLimit = 1;
+    uint32_t maxLimit = 200;
+    /// The limit is multiplied by this on a rejection or congestion.
+    double backoffRatio = 0.9;
+    /// A latency above this multiple of the baseline (the lowest latency
+    /// seen recently) counts as congestion.
+    double latencyTolerance = 2.0;
+    /// The baseline is the lowest latency of the current and the previous
+    /// window, so that it follows the node when its unloaded latency grows
+    /// (e.g. bigger index).
+    std::chrono::steady_clock::duration baselineWindow =
+        std::chrono::seconds(30);
+    /// Requests above the limit wait in a queue of at most this size,
+    /// 0 means they fail immediately.
+    uint32_t maxQueued = 1000;
+    /// Share of the queued requests dispatched per priority when all
+    /// classes are waiting, indexed by Priority.
+    std::array<uint32_t, kPriorityCount> weights{ 6, 3, 1 };
+    /// Fraction of the limit only interactive requests may use, so that
+    /// they never wait behind a full window of bulk requests.
+    double interactiveReserve = 0.2;
+};
+
+/// Outcome of a request as seen by the limiter.
+enum class LimiterSignal
+{
+    // the node answered, the latency is taken into account
+    SUCCESS = 0,
+    // 429 or timeout, the node is overloaded
+    DROPPED,
+    // failures unrelated to load, only the permit is released
+    IGNORED
+};
+
+/// AIMD limit of the requests in flight to one node: the limit grows by one
+/// per round trip while the node keeps up and shrinks multiplicatively on
+/// rejections or when the latency climbs above its baseline, at most once
+/// per round trip.
+///
+/// Waiting requests are queued per priority and dispatched by smooth
+/// weighted round robin, which guarantees each class its weighted share.
+class ConcurrencyLimiter
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+
+    ConcurrencyLimiter(const ConcurrencyLimitConfig &config)
+        : config_(config), limit_(config.initialLimit)
+    {
+    }
+
+  public:
+    /// Takes a permit if the node is below its limit.
+    bool tryAcquire(Priority priority = Priority::NORMAL);
+
+    /// Runs the task once a permit is available, the task owns that permit.
+    /// Returns false if the queue is full. A task cancelled while it waits
+    /// does not keep its place: it is dropped when the queue is full and
+    /// when its turn comes, and onCancel runs instead, without a permit.
+    bool enqueue(Task &&task,
+                 Priority priority = Priority::NORMAL,
+                 const CancellationTokenPtr &cancellation = nullptr,
+                 Task &&onCancel = nullptr);
+
+    /// Releases a permit. Returns the queued tasks that got a permit and the
+    /// onCancel of the cancelled ones, they must be run by the caller.
+    std::vector<Task> release(Clock::duration latency,
+                              LimiterSignal signal,
+                              Clock::time_point now = Clock::now());
+
+    uint32_t limit() const;
+    uint32_t inFlight() const;
+    size_t queued() const;
+    size_t queued(Priority priority) const;
+
+  private:
+    class Waiter
+    {
+      public:
+        Task task;
+        CancellationTokenPtr cancellation;
+        Task onCancel;
+
+        bool isCancelled() const
+        {
+            return cancellation && cancellation->isCancelled();
+        }
+    };
+
+    /// Removes the cancelled waiters, adds their onCancel to `dropped`.
+    void dropCancelled(std::vector<Task> &dropped);
+
+    void onSample(Clock::duration latency,
+                  LimiterSignal signal,
+                  Clock::time_point now);
+
+    bool hasPermit(Priority priority) const;
+
+    /// The class to dispatch next, or kPriorityCount if none may go.
+    size_t nextClass();
+
+  private:
+    ConcurrencyLimitConfig config_;
+    mutable std::mutex mutex_;
+    double limit_;
+    uint32_t inFlight_ = 0;
+    // lowest latency of the current and the previous window, in
+    // microseconds, 0 if there was none
+    double windowMinUs_ = 0;
+    double previousMinUs_ = 0;
+    Clock::time_point windowStart_;
+    // requests started before it do not shrink the limit again
+    Clock::time_point lastBackoff_;
+    std::array<std::deque<Waiter>, kPriorityCount> queues_;
+    // cancelled waiters included until they are dropped
+    size_t queued_ = 0;
+    // smooth weighted round robin state
+    std::array<int64_t, kPriorityCount> credits_{};
+};
+
+using ConcurrencyLimiterPtr = std::shared_ptr<ConcurrencyLimiter>;
+
+};  // namespace tl::elasticsearch
@@ -1,5 +1,6 @@
 #include "DocumentsClient.h"
 #include "ElasticSearchException.h"
+#include <json/writer.h>
 #include <future>
 
 using namespace std;
@@ -168,28 +169,26 @@ void GetResponse::setByJson(const Json::Value &json)
     }
 }
 
+void CountResponse::setByJson(const Json::Value &json)
+{
+    if (json.isMember("count"))
+    {
+        count_ = json["count"].asUInt64();
+    }
+    if (json.isMember("_shards"))
+    {
+        shards_ = make_shared<Shards>();
+        shards_->setByJson(json["_shards"]);
+    }
+}
+
 IndexResponsePtr DocumentsClient::index(const IndexParam &param,
                                         const Document &doc) const
 {
-    unique_ptr<promise<IndexResponsePtr>> pro(new promise<IndexResponsePtr>);
-    auto f = pro->get_future();
-    this->index(
-        param,
-        doc,
-        [&pro](const IndexResponsePtr &response) {
-            try
-            {
-                pro->set_value(response);
-            }
-            catch (...)
-            {
-                pro->set_exception(current_exception());
-            }
-        },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(make_exception_ptr(err));
+    return httpClient_->waitFor<IndexResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->index(param, doc, resultCallback, exceptionCallback);
         });
-    return f.get();
 }
 
 void DocumentsClient::index(
@@ -197,77 +196,69 @@ void DocumentsClient::index(
     const Document &doc,
     const std::function<void(const IndexResponsePtr &)> &resultCallback,
     const std::function<void(const ElasticSearchException &)>
-        &exceptionCallback) const
+        &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
 {
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
     std::string path = "/";
     path += param.index_;
     path += "/_doc/";
     path += param.id_;
+    auto options = ingestOptions("index", param.index_, 1, cancellation);
+    auto requestBody = timed(options.timing,
+                             &RequestTiming::build,
+                             [&doc]() { return doc.toJson(); });
     httpClient_->sendRequest(
         path,
         drogon::Post,
-        [resultCallback = std::move(resultCallback),
-         exceptionCallback =
-             std::move(exceptionCallback)](const Json::Value &responseBody) {
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
             IndexResponsePtr i_result = make_shared<IndexResponse>();
             i_result->setByJson(responseBody);
+            i_result->setTiming(timing);
             resultCallback(i_result);
         },
-        std::move(exceptionCallback),
-        doc.toJson());
+        onError,
+        requestBody,
+        options);
 }
 
 DeleteResponsePtr DocumentsClient::deleteDocument(
     const DeleteParam &param) const
 {
-    unique_ptr<promise<DeleteResponsePtr>> pro(new promise<DeleteResponsePtr>);
-    auto f = pro->get_future();
-    this->deleteDocument(
-        param,
-        [&pro](const DeleteResponsePtr &response) {
-            try
-            {
-                pro->set_value(response);
-            }
-            catch (...)
-            {
-                pro->set_exception(current_exception());
-            }
-        },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(make_exception_ptr(err));
+    return httpClient_->waitFor<DeleteResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->deleteDocument(param, resultCallback, exceptionCallback);
         });
-    return f.get();
 }
 
 void DocumentsClient::deleteDocument(
     const DeleteParam &param,
     const std::function<void(const DeleteResponsePtr &)> &resultCallback,
     const std::function<void(const ElasticSearchException &)>
-        &exceptionCallback) const
+        &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
 {
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
     std::string path = "/";
     path += param.index_;
     path += "/_doc/";
     path += param.id_;
+    auto options = requestOptions("delete", param.index_, cancellation);
     httpClient_->sendRequest(
         path,
         drogon::Delete,
-        [resultCallback = std::move(resultCallback),
-         exceptionCallback =
-             std::move(exceptionCallback)](const Json::Value &responseBody) {
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
             // index is not exist
             if (responseBody.isMember("error"))
             {
-                auto error = responseBody["error"];
-                auto type = error["type"].asString();
-                auto reason = error["reason"].asString();
-                string errorMessage = "ElasticSearchException [type=";
-                errorMessage += type;
-                errorMessage += ", reason=";
-                errorMessage += reason;
-                errorMessage += "]";
-                exceptionCallback(ElasticSearchException(errorMessage));
+                exceptionCallback(ElasticSearchException(
+                    errorMessage(responseBody["error"])));
             }
             else if (responseBody.isMember("result") &&
                      responseBody["result"].asString() == "not_found")
@@ -281,34 +272,22 @@ void DocumentsClient::deleteDocument(
             {
                 DeleteResponsePtr d_result = make_shared<DeleteResponse>();
                 d_result->setByJson(responseBody);
+                d_result->setTiming(timing);
                 resultCallback(d_result);
             }
         },
-        std::move(exceptionCallback));
+        onError,
+        Json::Value(Json::objectValue),
+        options);
 }
 
 UpdateResponsePtr DocumentsClient::update(const UpdateParam &param,
                                           const Document &doc) const
 {
-    unique_ptr<promise<UpdateResponsePtr>> pro(new promise<UpdateResponsePtr>);
-    auto f = pro->get_future();
-    this->update(
-        param,
-        doc,
-        [&pro](const UpdateResponsePtr &response) {
-            try
-            {
-                pro->set_value(response);
-            }
-            catch (...)
-            {
-                pro->set_exception(current_exception());
-            }
-        },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(make_exception_ptr(err));
+    return httpClient_->waitFor<UpdateResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->update(param, doc, resultCallback, exceptionCallback);
         });
-    return f.get();
 }
 
 void DocumentsClient::update(
@@ -316,95 +295,81 @@ void DocumentsClient::update(
     const Document &doc,
     const std::function<void(const UpdateResponsePtr &)> &resultCallback,
     const std::function<void(const ElasticSearchException &)>
-        &exceptionCallback) const
+        &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
 {
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
     std::string path = "";
     path += param.index_;
     path += "/_doc/";
     path += param.id_;
     path += "/_update";
 
-    Json::Value requestBody;
-    requestBody["doc"] = doc.toJson();
+    auto options = requestOptions("update", param.index_, cancellation);
+    auto requestBody =
+        timed(options.timing, &RequestTiming::build, [&doc]() {
+            Json::Value requestBody;
+            requestBody["doc"] = doc.toJson();
+            return requestBody;
+        });
 
     httpClient_->sendRequest(
         path,
         drogon::Post,
-        [resultCallback = std::move(resultCallback),
-         exceptionCallback =
-             std::move(exceptionCallback)](const Json::Value &responseBody) {
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
             if (responseBody.isMember("error"))
             {
-                auto error = responseBody.get("error", {});
-                auto type = error.get("type", {}).asString();
-                auto reason = error.get("reason", {}).asString();
-                string errorMessage = "ElasticSearchException [type=";
-                errorMessage += type;
-                errorMessage += ", reason=";
-                errorMessage += reason;
-                errorMessage += "]";
-                exceptionCallback(ElasticSearchException(errorMessage));
+                exceptionCallback(ElasticSearchException(
+                    errorMessage(responseBody["error"])));
             }
             else
             {
                 UpdateResponsePtr u_result = make_shared<UpdateResponse>();
                 u_result->setByJson(responseBody);
+                u_result->setTiming(timing);
                 resultCallback(u_result);
             }
         },
-        std::move(exceptionCallback),
-        requestBody);
+        onError,
+        requestBody,
+        options);
 }
 
 GetResponsePtr DocumentsClient::get(const GetParam &param) const
 {
-    unique_ptr<promise<GetResponsePtr>> pro(new promise<GetResponsePtr>);
-    auto f = pro->get_future();
-    this->get(
-        param,
-        [&pro](const GetResponsePtr &response) {
-            try
-            {
-                pro->set_value(response);
-            }
-            catch (...)
-            {
-                pro->set_exception(current_exception());
-            }
-        },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(make_exception_ptr(err));
+    return httpClient_->waitFor<GetResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->get(param, resultCallback, exceptionCallback);
         });
-    return f.get();
 }
 
 void DocumentsClient::get(
     const GetParam &param,
     const std::function<void(const GetResponsePtr &)> &resultCallback,
     const std::function<void(const ElasticSearchException &)>
-        &exceptionCallback) const
+        &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
 {
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
     std::string path = "/";
     path += param.index_;
     path += "/_doc/";
     path += param.id_;
+    auto options = readOnlyOptions("get", param.index_, cancellation);
     httpClient_->sendRequest(
         path,
         drogon::Get,
-        [resultCallback = std::move(resultCallback),
-         exceptionCallback =
-             std::move(exceptionCallback)](const Json::Value &responseBody) {
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
             if (responseBody.isMember("error"))
             {
-                auto error = responseBody.get("error", {});
-                auto type = error.get("type", {}).asString();
-                auto reason = error.get("reason", {}).asString();
-                string errorMessage = "ElasticSearchException [type=";
-                errorMessage += type;
-                errorMessage += ", reason=";
-                errorMessage += reason;
-                errorMessage += "]";
-                exceptionCallback(ElasticSearchException(errorMessage));
+                exceptionCallback(ElasticSearchException(
+                    errorMessage(responseBody["error"])));
             }
             else if (responseBody.isMember("found") &&
                      !responseBody["found"].asBool())
@@ -418,8 +383,271 @@ void DocumentsClient::get(
             {
                 GetResponsePtr d_result = make_shared<GetResponse>();
                 d_result->setByJson(responseBody);
+                d_result->setTiming(timing);
                 resultCallback(d_result);
             }
         },
-        std::move(exceptionCallback));
+        onError,
+        Json::Value(Json::objectValue),
+        options);
+}
+
+CountResponsePtr DocumentsClient::count(const CountParam &param) const
+{
+    return httpClient_->waitFor<CountResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->count(param, resultCallback, exceptionCallback);
+        });
+}
+
+void DocumentsClient::count(
+    const CountParam &param,
+    const std::function<void(const CountResponsePtr &)> &resultCallback,
+    const std::function<void(const ElasticSearchException &)>
+        &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
+{
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
+    std::string path = "/";
+    path += param.index();
+    path += "/_count";
+    auto options = readOnlyOptions("count", param.index(), cancellation);
+    options.searchBody = true;
+    auto requestBody = timed(options.timing,
+                             &RequestTiming::build,
+                             [&param]() { return param.toJson(); });
+    httpClient_->sendRequest(
+        path,
+        drogon::Get,
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
+            if (responseBody.isMember("error"))
+            {
+                exceptionCallback(ElasticSearchException(
+                    errorMessage(responseBody["error"])));
+            }
+            else
+            {
+                CountResponsePtr c_result = make_shared<CountResponse>();
+                c_result->setByJson(responseBody);
+                c_result->setTiming(timing);
+                resultCallback(c_result);
+            }
+        },
+        onError,
+        requestBody,
+        options);
+}
+
+string tl::elasticsearch::errorMessage(const Json::Value &error)
+{
+    string message = "ElasticSearchException [type=";
+    message += error["type"].asString();
+    message += ", reason=";
+    message += error["reason"].asString();
+    message += "]";
+    return message;
+}
+
+Json::Value PutScriptParam::toJson() const
+{
+    Json::Value json;
+    json["script"]["lang"] = "mustache";
+    json["script"]["source"] = source_;
+    return json;
+}
+
+void PutScriptResponse::setByJson(const Json::Value &json)
+{
+    acknowledged_ = json["acknowledged"].asBool();
+}
+
+void GetScriptResponse::setByJson(const Json::Value &json)
+{
+    id_ = json["_id"].asString();
+    found_ = json["found"].asBool();
+    lang_ = json["script"]["lang"].asString();
+    source_ = json["script"]["source"];
+}
+
+void DeleteScriptResponse::setByJson(const Json::Value &json)
+{
+    acknowledged_ = json["acknowledged"].asBool();
+}
+
+Json::Value SearchTemplateParam::toJson() const
+{
+    Json::Value json;
+    if (!id_.empty())
+    {
+        json["id"] = id_;
+    }
+    else if (!source_.isNull())
+    {
+        json["source"] = source_;
+    }
+    else
+    {
+        throw ElasticSearchException(
+            "SearchTemplateParam needs an id or a source.");
+    }
+    json["params"] = params_;
+    return json;
+}
+
+vector<Json::Value> MultiSearchTemplateParam::toLines() const
+{
+    vector<Json::Value> lines;
+    lines.reserve(searches_.size() * 2);
+    for (const auto &search : searches_)
+    {
+        Json::Value header;
+        header["index"] = search.index();
+        lines.push_back(std::move(header));
+        lines.push_back(search.toJson());
+    }
+    return lines;
+}
+
+string MultiSearchTemplateParam::toBody() const
+{
+    static const auto writer = []() {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        return builder;
+    }();
+    string body;
+    for (const auto &line : toLines())
+    {
+        body += Json::writeString(writer, line);
+        body += '\n';
+    }
+    return body;
+}
+
+PutScriptResponsePtr DocumentsClient::putScript(
+    const PutScriptParam &param) const
+{
+    return httpClient_->waitFor<PutScriptResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->putScript(param, resultCallback, exceptionCallback);
+        });
+}
+
+void DocumentsClient::putScript(
+    const PutScriptParam &param,
+    const std::function<void(const PutScriptResponsePtr &)> &resultCallback,
+    const std::function<void(const ElasticSearchException &)>
+        &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
+{
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
+    auto options = requestOptions("put_script", "", cancellation);
+    auto requestBody = timed(options.timing,
+                             &RequestTiming::build,
+                             [&param]() { return param.toJson(); });
+    httpClient_->sendRequest(
+        "/_scripts/" + param.id(),
+        drogon::Put,
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
+            if (responseBody["error"].isObject())
+            {
+                exceptionCallback(ElasticSearchException(
+                    errorMessage(responseBody["error"])));
+                return;
+            }
+            auto result = make_shared<PutScriptResponse>();
+            result->setByJson(responseBody);
+            result->setTiming(timing);
+            resultCallback(result);
+        },
+        onError,
+        requestBody,
+        options);
+}
+
+GetScriptResponsePtr DocumentsClient::getScript(const string &id) const
+{
+    return httpClient_->waitFor<GetScriptResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->getScript(id, resultCallback, exceptionCallback);
+        });
+}
+
+void DocumentsClient::getScript(
+    const string &id,
+    const std::function<void(const GetScriptResponsePtr &)> &resultCallback,
+    const std::function<void(const ElasticSearchException &)>
+        &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
+{
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
+    auto options = readOnlyOptions("get_script", "", cancellation);
+    httpClient_->sendRequest(
+        "/_scripts/" + id,
+        drogon::Get,
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
+            if (responseBody["error"].isObject())
+            {
+                exceptionCallback(ElasticSearchException(
+                    errorMessage(responseBody["error"])));
+                return;
+            }
+            auto result = make_shared<GetScriptResponse>();
+            result->setByJson(responseBody);
+            result->setTiming(timing);
+            resultCallback(result);
+        },
+        onError,
+        Json::Value(Json::objectValue),
+        options);
+}
+
+DeleteScriptResponsePtr DocumentsClient::deleteScript(const string &id) const
+{
+    return httpClient_->waitFor<DeleteScriptResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->deleteScript(id, resultCallback, exceptionCallback);
+        });
+}
+
+void DocumentsClient::deleteScript(
+    const string &id,
+    const std::function<void(const DeleteScriptResponsePtr &)>
+        &resultCallback,
+    const std::function<void(const ElasticSearchException &)>
+        &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
+{
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
+    auto options = requestOptions("delete_script", "", cancellation);
+    httpClient_->sendRequest(
+        "/_scripts/" + id,
+        drogon::Delete,
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
+            if (responseBody["error"].isObject())
+            {
+                exceptionCallback(ElasticSearchException(
+                    errorMessage(responseBody["error"])));
+                return;
+            }
+            auto result = make_shared<DeleteScriptResponse>();
+            result->setByJson(responseBody);
+            result->setTiming(timing);
+            resultCallback(result);
+        },
+        onError,
+        Json::Value(Json::objectValue),
+        options);
 }
@@ -3,10 +3,13 @@
 #include <functional>
 #include <json/value.h>
 #include <memory>
+#include <optional>
 #include "Aggregation.h"
 #include "ElasticSearchException.h"
 #include "HttpClient.h"
+#include "Profile.h"
 #include "Query.h"
+#include "RequestAwaiter.h"
 
 namespace tl::elasticsearch
 {
@@ -49,7 +52,7 @@ class Shards
 
 using ShardsPtr = std::shared_ptr<Shards>;
 
-class IndexResponse
+class IndexResponse : public TimedResponse
 {
   public:
     std::string getId() const
@@ -127,7 +130,7 @@ class IndexParam
     std::string id_;
 };
 
-class DeleteResponse
+class DeleteResponse : public TimedResponse
 {
   public:
     std::string getId() const
@@ -205,7 +208,7 @@ class DeleteParam
     std::string id_;
 };
 
-class UpdateResponse
+class UpdateResponse : public TimedResponse
 {
   public:
     std::string getId() const
@@ -283,7 +286,7 @@ class UpdateParam
     std::string id_;
 };
 
-class GetResponse
+class GetResponse : public TimedResponse
 {
   public:
     std::string getId() const
@@ -430,6 +433,10 @@ class SearchParam
         {
             json["aggs"] = agg_->toJson();
         }
+        if (profile_)
+        {
+            json["profile"] = true;
+        }
         return json;
     }
 
@@ -439,6 +446,11 @@ class SearchParam
         return *this;
     }
 
+    const QueryPtr &query() const
+    {
+        return query_;
+    }
+
     SearchParam &sort(std::string field, SortOrder order = ASC)
     {
         for (auto iter = sort_.cbegin(); iter != sort_.cend(); ++iter)
@@ -453,6 +465,11 @@ class SearchParam
         return *this;
     }
 
+    const std::vector<Sort> &sort() const
+    {
+        return sort_;
+    }
+
     SearchParam &from(int32_t from)
     {
         from_ = std::make_shared<int32_t>(from);
@@ -471,13 +488,43 @@ class SearchParam
         return *this;
     }
 
+    /// Asks for the timing of each part of the search on each shard, see
+    /// SearchResponse::getProfile(). It slows the search down, e.g. to enable
+    /// on sampled searches only.
+    SearchParam &profile(bool profile)
+    {
+        profile_ = profile;
+        return *this;
+    }
+
+    bool profile() const
+    {
+        return profile_;
+    }
+
+    /// A body already serialized, e.g. rendered by a QueryTemplate. It is
+    /// sent as it is, the query, sort, from, size, agg and profile are
+    /// ignored.
+    SearchParam &body(std::string body)
+    {
+        body_ = std::move(body);
+        return *this;
+    }
+
+    const std::optional<std::string> &body() const
+    {
+        return body_;
+    }
+
   private:
     std::string index_;
+    std::optional<std::string> body_;
     QueryPtr query_;
     std::vector<Sort> sort_;
     std::shared_ptr<int32_t> from_;
     std::shared_ptr<int32_t> size_;
     AggPtr agg_;
+    bool profile_ = false;
 };
 
 template <typename Tp>
@@ -540,7 +587,7 @@ class Hit
 
 template <typename Tp>
     requires isDocumentType<Tp>
-class SearchResponse
+class SearchResponse : public TimedResponse
 {
   public:
     void setByJson(const Json::Value &json)
@@ -590,6 +637,11 @@ class SearchResponse
                     AggregationsResponse::newAggregationsResponse(temp);
             }
         }
+        if (json.isMember("profile") && json["profile"].isObject())
+        {
+            profile_ = std::make_shared<ProfileResponse>();
+            profile_->setByJson(json["profile"]);
+        }
     }
 
     auto getTook()
@@ -620,6 +672,11 @@ class SearchResponse
     {
         return aggregations_;
     }
+    /// Set when the search was sent with SearchParam::profile(true).
+    auto getProfile()
+    {
+        return profile_;
+    }
 
   private:
     uint32_t took_;
@@ -630,12 +687,301 @@ class SearchResponse
     std::vector<Hit<Tp>> hits_;
     std::unordered_map<std::string, std::shared_ptr<AggregationsResponse>>
         aggregations_;
+    ProfileResponsePtr profile_;
 };
 
 template <typename Tp>
     requires isDocumentType<Tp>
 using SearchResponsePtr = std::shared_ptr<SearchResponse<Tp>>;
 
+class CountParam
+{
+  public:
+    CountParam(const std::string &index) : index_(index)
+    {
+    }
+
+  public:
+    std::string index() const
+    {
+        return index_;
+    }
+
+    Json::Value toJson() const
+    {
+        Json::Value json(Json::objectValue);
+        if (query_)
+        {
+            json["query"] = query_->toJson();
+        }
+        return json;
+    }
+
+    CountParam &query(QueryPtr query)
+    {
+        query_ = query;
+        return *this;
+    }
+
+  private:
+    std::string index_;
+    QueryPtr query_;
+};
+
+class CountResponse : public TimedResponse
+{
+  public:
+    uint64_t getCount() const
+    {
+        return count_;
+    }
+
+    ShardsPtr getShards() const
+    {
+        return shards_;
+    }
+
+    void setByJson(const Json::Value &json);
+
+  private:
+    uint64_t count_ = 0;
+    ShardsPtr shards_;
+};
+
+using CountResponsePtr = std::shared_ptr<CountResponse>;
+
+/// "ElasticSearchException [type=..., reason=...]" for the error object of a
+/// response.
+std::string errorMessage(const Json::Value &error);
+
+/// A mustache search template stored in the cluster under `id`, see
+/// DocumentsClient::putScript and SearchTemplateParam::id.
+class PutScriptParam
+{
+  public:
+    PutScriptParam(const std::string &id) : id_(id)
+    {
+    }
+
+  public:
+    const std::string &id() const
+    {
+        return id_;
+    }
+
+    /// A search body with {{name}} for the params, as JSON, or as a string
+    /// when the mustache is not valid JSON, e.g. with {{#toJson}}.
+    PutScriptParam &source(const Json::Value &source)
+    {
+        source_ = source;
+        return *this;
+    }
+
+    Json::Value toJson() const;
+
+  private:
+    std::string id_;
+    Json::Value source_;
+};
+
+class PutScriptResponse : public TimedResponse
+{
+  public:
+    void setByJson(const Json::Value &json);
+
+    bool isAcknowledged() const
+    {
+        return acknowledged_;
+    }
+
+  private:
+    bool acknowledged_ = false;
+};
+
+using PutScriptResponsePtr = std::shared_ptr<PutScriptResponse>;
+
+class GetScriptResponse : public TimedResponse
+{
+  public:
+    void setByJson(const Json::Value &json);
+
+    const std::string &getId() const
+    {
+        return id_;
+    }
+
+    bool isFound() const
+    {
+        return found_;
+    }
+
+    const std::string &getLang() const
+    {
+        return lang_;
+    }
+
+    /// As stored: a string, the mustache of the template.
+    const Json::Value &getSource() const
+    {
+        return source_;
+    }
+
+  private:
+    std::string id_;
+    bool found_ = false;
+    std::string lang_;
+    Json::Value source_;
+};
+
+using GetScriptResponsePtr = std::shared_ptr<GetScriptResponse>;
+
+class DeleteScriptResponse : public TimedResponse
+{
+  public:
+    void setByJson(const Json::Value &json);
+
+    bool isAcknowledged() const
+    {
+        return acknowledged_;
+    }
+
+  private:
+    bool acknowledged_ = false;
+};
+
+using DeleteScriptResponsePtr = std::shared_ptr<DeleteScriptResponse>;
+
+/// A search rendered by Elasticsearch from a template and params, so only
+/// the params are sent when the template is stored.
+class SearchTemplateParam
+{
+  public:
+    SearchTemplateParam(const std::string &index) : index_(index)
+    {
+    }
+
+  public:
+    std::string index() const
+    {
+        return index_;
+    }
+
+    /// A template stored by DocumentsClient::putScript.
+    SearchTemplateParam &id(const std::string &id)
+    {
+        id_ = id;
+        return *this;
+    }
+
+    /// An inline template, sent with every request, instead of an id.
+    SearchTemplateParam &source(const Json::Value &source)
+    {
+        source_ = source;
+        return *this;
+    }
+
+    SearchTemplateParam &param(const std::string &name,
+                               const Json::Value &value)
+    {
+        params_[name] = value;
+        return *this;
+    }
+
+    /// Throws ElasticSearchException without an id nor a source.
+    Json::Value toJson() const;
+
+  private:
+    std::string index_;
+    std::string id_;
+    Json::Value source_;
+    Json::Value params_{Json::objectValue};
+};
+
+/// Several template searches in one request, see
+/// DocumentsClient::multiSearchTemplate.
+class MultiSearchTemplateParam
+{
+  public:
+    MultiSearchTemplateParam &add(const SearchTemplateParam &search)
+    {
+        searches_.push_back(search);
+        return *this;
+    }
+
+    size_t size() const
+    {
+        return searches_.size();
+    }
+
+    /// The header and the body line of every search.
+    std::vector<Json::Value> toLines() const;
+
+    /// The lines as newline-delimited JSON, one line each.
+    std::string toBody() const;
+
+  private:
+    std::vector<SearchTemplateParam> searches_;
+};
+
+/// The result of one search of a MultiSearchResponse.
+template <typename Tp>
+    requires isDocumentType<Tp>
+class MultiSearchItem
+{
+  public:
+    /// nullptr if the search failed.
+    SearchResponsePtr<Tp> response;
+    /// Empty unless the search failed.
+    std::string error;
+    uint16_t status = 0;
+};
+
+template <typename Tp>
+    requires isDocumentType<Tp>
+class MultiSearchResponse : public TimedResponse
+{
+  public:
+    void setByJson(const Json::Value &json)
+    {
+        took_ = json["took"].asUInt();
+        responses_.clear();
+        for (const auto &item : json["responses"])
+        {
+            MultiSearchItem<Tp> result;
+            result.status = static_cast<uint16_t>(item["status"].asUInt());
+            if (item["error"].isObject())
+            {
+                result.error = errorMessage(item["error"]);
+            }
+            else
+            {
+                result.response = std::make_shared<SearchResponse<Tp>>();
+                result.response->setByJson(item);
+            }
+            responses_.push_back(std::move(result));
+        }
+    }
+
+    uint32_t getTook() const
+    {
+        return took_;
+    }
+
+    /// In the order of the searches of the param.
+    const std::vector<MultiSearchItem<Tp>> &getResponses() const
+    {
+        return responses_;
+    }
+
+  private:
+    uint32_t took_ = 0;
+    std::vector<MultiSearchItem<Tp>> responses_;
+};
+
+template <typename Tp>
+    requires isDocumentType<Tp>
+using MultiSearchResponsePtr = std::shared_ptr<MultiSearchResponse<Tp>>;
+
 class DocumentsClient
 {
   public:
@@ -650,14 +996,16 @@ class DocumentsClient
         const Document &doc,
         const std::function<void(const IndexResponsePtr &)> &resultCallback,
         const std::function<void(const ElasticSearchException &)>
-            &exceptionCallback) const;
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const;
 
     DeleteResponsePtr deleteDocument(const DeleteParam &param) const;
     void deleteDocument(
         const DeleteParam &param,
         const std::function<void(const DeleteResponsePtr &)> &resultCallback,
         const std::function<void(const ElasticSearchException &)>
-            &exceptionCallback) const;
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const;
 
     UpdateResponsePtr update(const UpdateParam &param,
                              const Document &doc) const;
@@ -666,38 +1014,33 @@ class DocumentsClient
         const Document &doc,
         const std::function<void(const UpdateResponsePtr &)> &resultCallback,
         const std::function<void(const ElasticSearchException &)>
-            &exceptionCallback) const;
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const;
 
     GetResponsePtr get(const GetParam &param) const;
     void get(const GetParam &param,
              const std::function<void(const GetResponsePtr &)> &resultCallback,
              const std::function<void(const ElasticSearchException &)>
-                 &exceptionCallback) const;
+                 &exceptionCallback,
+             const CancellationTokenPtr &cancellation = nullptr) const;
+
+    CountResponsePtr count(const CountParam &param) const;
+    void count(
+        const CountParam &param,
+        const std::function<void(const CountResponsePtr &)> &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const;
 
     // search
     template <typename Tp>
         requires isDocumentType<Tp>
     SearchResponsePtr<Tp> search(const SearchParam &param) const
     {
-        std::unique_ptr<std::promise<SearchResponsePtr<Tp>>> pro(
-            new std::promise<SearchResponsePtr<Tp>>);
-        auto f = pro->get_future();
-        this->search<Tp>(
-            param,
-            [&pro](const SearchResponsePtr<Tp> &response) {
-                try
-                {
-                    pro->set_value(response);
-                }
-                catch (...)
-                {
-                    pro->set_exception(std::current_exception());
-                }
-            },
-            [&pro](const ElasticSearchException &err) {
-                pro->set_exception(std::make_exception_ptr(err));
+        return httpClient_->waitFor<SearchResponsePtr<Tp>>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->search<Tp>(param, resultCallback, exceptionCallback);
             });
-        return f.get();
     }
 
     template <typename Tp>
@@ -706,43 +1049,360 @@ class DocumentsClient
                 const std::function<void(const SearchResponsePtr<Tp> &)>
                     &resultCallback,
                 const std::function<void(const ElasticSearchException &)>
-                    &exceptionCallback) const
+                    &exceptionCallback,
+                const CancellationTokenPtr &cancellation = nullptr) const
     {
+        auto onResult = httpClient_->toCallerLoop(resultCallback);
+        auto onError = httpClient_->toCallerLoop(exceptionCallback);
         std::string path = "/";
         path += param.index();
         path += "/_search";
 
-        Json::Value requestBody = param.toJson();
+        auto options = readOnlyOptions("search", param.index(), cancellation);
+        options.searchBody = true;
+        auto onResponse =
+            searchResponseHandler<Tp>(std::move(onResult), onError, options);
+        if (const auto &body = param.body())
+        {
+            httpClient_->sendRawRequest(
+                path, drogon::Get, onResponse, onError, *body, options);
+            return;
+        }
+
+        auto requestBody = timed(options.timing,
+                                 &RequestTiming::build,
+                                 [&param]() { return param.toJson(); });
+        httpClient_->sendRequest(
+            path, drogon::Get, onResponse, onError, requestBody, options);
+    }
+
+    // search templates
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    SearchResponsePtr<Tp> searchTemplate(const SearchTemplateParam &param) const
+    {
+        return httpClient_->waitFor<SearchResponsePtr<Tp>>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->searchTemplate<Tp>(param,
+                                         resultCallback,
+                                         exceptionCallback);
+            });
+    }
 
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    void searchTemplate(
+        const SearchTemplateParam &param,
+        const std::function<void(const SearchResponsePtr<Tp> &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        auto onResult = httpClient_->toCallerLoop(resultCallback);
+        auto onError = httpClient_->toCallerLoop(exceptionCallback);
+        std::string path = "/";
+        path += param.index();
+        path += "/_search/template";
+
+        auto options =
+            readOnlyOptions("search_template", param.index(), cancellation);
+        options.searchBody = true;
+        auto requestBody = timed(options.timing,
+                                 &RequestTiming::build,
+                                 [&param]() { return param.toJson(); });
         httpClient_->sendRequest(
             path,
             drogon::Get,
-            [resultCallback = std::move(resultCallback),
-             exceptionCallback = std::move(exceptionCallback)](
-                const Json::Value &responseBody) {
-                if (responseBody.isMember("error") &&
-                    responseBody["error"].isObject())
-                {
-                    auto error = responseBody["error"];
-                    auto type = error["type"].asString();
-                    auto reason = error["reason"].asString();
-                    std::string errorMessage = "ElasticSearchException [type=";
-                    errorMessage += type;
-                    errorMessage += ", reason=";
-                    errorMessage += reason;
-                    errorMessage += "]";
-                    exceptionCallback(ElasticSearchException(errorMessage));
-                }
-                else
+            searchResponseHandler<Tp>(std::move(onResult), onError, options),
+            onError,
+            requestBody,
+            options);
+    }
+
+    /// The searches fail one by one, see MultiSearchItem. The exception
+    /// callback is only called when the whole request fails.
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    MultiSearchResponsePtr<Tp> multiSearchTemplate(
+        const MultiSearchTemplateParam &param) const
+    {
+        return httpClient_->waitFor<MultiSearchResponsePtr<Tp>>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->multiSearchTemplate<Tp>(param,
+                                              resultCallback,
+                                              exceptionCallback);
+            });
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    void multiSearchTemplate(
+        const MultiSearchTemplateParam &param,
+        const std::function<void(const MultiSearchResponsePtr<Tp> &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        auto onResult = httpClient_->toCallerLoop(resultCallback);
+        auto onError = httpClient_->toCallerLoop(exceptionCallback);
+        auto options = readOnlyOptions("msearch_template", "", cancellation);
+        auto requestBody = timed(options.timing,
+                                 &RequestTiming::build,
+                                 [&param]() { return param.toBody(); });
+        httpClient_->sendRawRequest(
+            "/_msearch/template",
+            drogon::Get,
+            [resultCallback = std::move(onResult),
+             exceptionCallback = onError,
+             timing = options.timing](const Json::Value &responseBody) {
+                if (responseBody["error"].isObject())
                 {
-                    SearchResponsePtr<Tp> s_result =
-                        std::make_shared<SearchResponse<Tp>>();
-                    s_result->setByJson(responseBody);
-                    resultCallback(s_result);
+                    exceptionCallback(ElasticSearchException(
+                        errorMessage(responseBody["error"])));
+                    return;
                 }
+                auto result = std::make_shared<MultiSearchResponse<Tp>>();
+                result->setByJson(responseBody);
+                result->setTiming(timing);
+                resultCallback(result);
             },
-            std::move(exceptionCallback),
-            requestBody);
+            onError,
+            std::move(requestBody),
+            options);
+    }
+
+    // stored scripts
+    PutScriptResponsePtr putScript(const PutScriptParam &param) const;
+    void putScript(
+        const PutScriptParam &param,
+        const std::function<void(const PutScriptResponsePtr &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const;
+
+    /// A missing script is not an error, its response is not found.
+    GetScriptResponsePtr getScript(const std::string &id) const;
+    void getScript(
+        const std::string &id,
+        const std::function<void(const GetScriptResponsePtr &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const;
+
+    DeleteScriptResponsePtr deleteScript(const std::string &id) const;
+    void deleteScript(
+        const std::string &id,
+        const std::function<void(const DeleteScriptResponsePtr &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const;
+
+  public:
+    // coroutines, the request is sent before the first co_await
+    RequestAwaiter<IndexResponsePtr> indexCoro(
+        const IndexParam &param,
+        const Document &doc,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<IndexResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->index(param,
+                            doc,
+                            resultCallback,
+                            exceptionCallback,
+                            cancellation);
+            });
+    }
+
+    RequestAwaiter<DeleteResponsePtr> deleteDocumentCoro(
+        const DeleteParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<DeleteResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->deleteDocument(
+                    param, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+    RequestAwaiter<UpdateResponsePtr> updateCoro(
+        const UpdateParam &param,
+        const Document &doc,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<UpdateResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->update(param,
+                             doc,
+                             resultCallback,
+                             exceptionCallback,
+                             cancellation);
+            });
+    }
+
+    RequestAwaiter<GetResponsePtr> getCoro(
+        const GetParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<GetResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->get(
+                    param, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+    RequestAwaiter<CountResponsePtr> countCoro(
+        const CountParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<CountResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->count(
+                    param, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    RequestAwaiter<SearchResponsePtr<Tp>> searchCoro(
+        const SearchParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<SearchResponsePtr<Tp>>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->search<Tp>(
+                    param, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    RequestAwaiter<SearchResponsePtr<Tp>> searchTemplateCoro(
+        const SearchTemplateParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<SearchResponsePtr<Tp>>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->searchTemplate<Tp>(
+                    param, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    RequestAwaiter<MultiSearchResponsePtr<Tp>> multiSearchTemplateCoro(
+        const MultiSearchTemplateParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<MultiSearchResponsePtr<Tp>>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->multiSearchTemplate<Tp>(
+                    param, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+    RequestAwaiter<PutScriptResponsePtr> putScriptCoro(
+        const PutScriptParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<PutScriptResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->putScript(
+                    param, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+    RequestAwaiter<GetScriptResponsePtr> getScriptCoro(
+        const std::string &id,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<GetScriptResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->getScript(
+                    id, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+    RequestAwaiter<DeleteScriptResponsePtr> deleteScriptCoro(
+        const std::string &id,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<DeleteScriptResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->deleteScript(
+                    id, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+  private:
+    RequestOptions requestOptions(
+        const std::string &operation,
+        const std::string &index,
+        const CancellationTokenPtr &cancellation) const
+    {
+        RequestOptions options;
+        options.operation = operation;
+        options.index = index;
+        options.cancellation = cancellation;
+        options.timing = httpClient_->newTiming();
+        return options;
+    }
+
+    /// Decodes the body of _search and _search/template.
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    static std::function<void(const Json::Value &)> searchResponseHandler(
+        std::function<void(const SearchResponsePtr<Tp> &)> resultCallback,
+        std::function<void(const ElasticSearchException &)> exceptionCallback,
+        const RequestOptions &options)
+    {
+        return [resultCallback = std::move(resultCallback),
+                exceptionCallback = std::move(exceptionCallback),
+                timing = options.timing](const Json::Value &responseBody) {
+            if (responseBody.isMember("error") &&
+                responseBody["error"].isObject())
+            {
+                exceptionCallback(ElasticSearchException(
+                    errorMessage(responseBody["error"])));
+            }
+            else
+            {
+                SearchResponsePtr<Tp> s_result =
+                    std::make_shared<SearchResponse<Tp>>();
+                s_result->setByJson(responseBody);
+                s_result->setTiming(timing);
+                resultCallback(s_result);
+            }
+        };
+    }
+
+    /// Reads serve users, they are scheduled ahead of writes and bulk.
+    RequestOptions readOnlyOptions(
+        const std::string &operation,
+        const std::string &index,
+        const CancellationTokenPtr &cancellation) const
+    {
+        auto options = requestOptions(operation, index, cancellation);
+        options.priority = Priority::INTERACTIVE;
+        options.readOnly = true;
+        return options;
+    }
+
+    /// Writes of documents count against the rate limit of the client.
+    RequestOptions ingestOptions(
+        const std::string &operation,
+        const std::string &index,
+        size_t documents,
+        const CancellationTokenPtr &cancellation) const
+    {
+        auto options = requestOptions(operation, index, cancellation);
+        options.documents = documents;
+        return options;
     }
 
   private:
@@ -9,34 +9,251 @@
 #include "DocumentsClient.h"
 #include "HttpClient.h"
 #include "IndicesClient.h"
+#include <drogon/HttpAppFramework.h>
 #include <memory>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 using namespace std;
 
 using namespace tl::elasticsearch;
 
+static string toUrl(const string &host, uint16_t port)
+{
+    string url("http://");
+    url += host;
+    if (port != 80)
+    {
+        url += ":";
+        url += std::to_string(port);
+    }
+    return url;
+}
+
+/// Starts the loops, the i-th loop is pinned to the i-th CPU of cpus modulo
+/// its size. Pinning is only supported on Linux.
+static shared_ptr<trantor::EventLoopThreadPool> newLoopPool(
+    size_t count,
+    const vector<int> &cpus)
+{
+    auto pool = make_shared<trantor::EventLoopThreadPool>(count, "es-io");
+    pool->start();
+    if (cpus.empty())
+    {
+        return pool;
+    }
+#ifdef __linux__
+    auto loops = pool->getLoops();
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        auto cpu = cpus[i % cpus.size()];
+        loops[i]->runInLoop([cpu]() {
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            CPU_SET(cpu, &cpuSet);
+            if (pthread_setaffinity_np(pthread_self(),
+                                       sizeof(cpuSet),
+                                       &cpuSet) != 0)
+            {
+                LOG_ERROR << "failed to pin an ES IO thread to cpu " << cpu;
+            }
+        });
+    }
+#else
+    LOG_WARN << "cpu_affinity of io_threads is only supported on Linux";
+#endif
+    return pool;
+}
+
 void ElasticSearchClient::initAndStart(const Json::Value &config)
 {
     /// Initialize and start the plugin
     this->host_ = config.get("host", Json::Value("localhost")).asString();
     this->port_ = config.get("port", Json::Value(9200)).asUInt();
 
-    string url("http://");
-    url += this->host_;
-    if (this->port_ != 80)
+    vector<string> urls;
+    for (const auto &node : config["nodes"])
     {
-        url += ":";
-        url += std::to_string(this->port_);
+        if (node.isString())
+        {
+            auto url = node.asString();
+            if (url.find("://") == string::npos)
+            {
+                url = "http://" + url;
+            }
+            urls.push_back(url);
+        }
+        else
+        {
+            urls.push_back(toUrl(node.get("host", "localhost").asString(),
+                                 node.get("port", 9200).asUInt()));
+        }
+    }
+    if (urls.empty())
+    {
+        urls.push_back(toUrl(this->host_, this->port_));
     }
 
-    this->httpClient_ = std::shared_ptr<HttpClient>(new HttpClient(url));
+    auto selector = newNodeSelector(
+        config.get("node_selector", Json::Value("round_robin")).asString());
+    NodeConfig nodeConfig;
+    if (config.isMember("circuit_breaker"))
+    {
+        auto cbConfig = config["circuit_breaker"];
+        auto &breakerConfig = nodeConfig.circuitBreaker;
+        breakerConfig.consecutiveFailures =
+            cbConfig.get("consecutive_failures", 5).asUInt();
+        breakerConfig.errorRate = cbConfig.get("error_rate", 0.5).asDouble();
+        breakerConfig.windowSize = cbConfig.get("window_size", 20).asUInt();
+        breakerConfig.minRequests = cbConfig.get("min_requests", 10).asUInt();
+        breakerConfig.probeInterval =
+            cbConfig.get("probe_interval", 2).asDouble();
+        breakerConfig.halfOpenRequests =
+            cbConfig.get("half_open_requests", 3).asUInt();
+    }
+    if (config.isMember("concurrency_limit"))
+    {
+        auto limitConfig = config["concurrency_limit"];
+        ConcurrencyLimitConfig concurrencyLimit;
+        concurrencyLimit.initialLimit = limitConfig.get("initial", 20).asUInt();
+        concurrencyLimit.minLimit = limitConfig.get("min", 1).asUInt();
+        concurrencyLimit.maxLimit = limitConfig.get("max", 200).asUInt();
+        concurrencyLimit.backoffRatio =
+            limitConfig.get("backoff_ratio", 0.9).asDouble();
+        concurrencyLimit.latencyTolerance =
+            limitConfig.get("latency_tolerance", 2.0).asDouble();
+        concurrencyLimit.baselineWindow =
+            chrono::duration_cast<chrono::steady_clock::duration>(
+                chrono::duration<double>(
+                    limitConfig.get("baseline_window", 30).asDouble()));
+        concurrencyLimit.maxQueued =
+            limitConfig.get("max_queued", 1000).asUInt();
+        if (limitConfig.isMember("weights"))
+        {
+            auto weights = limitConfig["weights"];
+            concurrencyLimit.weights[0] =
+                weights.get("interactive", 6).asUInt();
+            concurrencyLimit.weights[1] = weights.get("normal", 3).asUInt();
+            concurrencyLimit.weights[2] =
+                weights.get("background", 1).asUInt();
+        }
+        concurrencyLimit.interactiveReserve =
+            limitConfig.get("interactive_reserve", 0.2).asDouble();
+        nodeConfig.concurrencyLimit = concurrencyLimit;
+    }
+    this->httpClient_ = std::shared_ptr<HttpClient>(
+        new HttpClient(urls, selector, nodeConfig));
+    if (config.isMember("hedging"))
+    {
+        auto hedgingConfig = config["hedging"];
+        HedgePolicy policy;
+        policy.delayMs = hedgingConfig.get("delay_ms", 0).asDouble();
+        policy.percentile = hedgingConfig.get("percentile", 0.95).asDouble();
+        policy.minDelayMs = hedgingConfig.get("min_delay_ms", 10).asDouble();
+        policy.budget = hedgingConfig.get("budget", 0.1).asDouble();
+        policy.window = chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(
+                hedgingConfig.get("window", 30).asDouble()));
+        this->httpClient_->setHedgePolicy(policy);
+    }
+    RateLimitConfig rateLimit;
+    if (config.isMember("rate_limit"))
+    {
+        auto rateLimitConfig = config["rate_limit"];
+        auto unit = rateLimitConfig.get("unit", "documents").asString();
+        if (unit == "bytes")
+        {
+            rateLimit.unit = RateLimitUnit::BYTES;
+        }
+        else if (unit != "documents")
+        {
+            throw ElasticSearchException("unknown rate limit unit: " + unit);
+        }
+        rateLimit.rate = rateLimitConfig.get("rate", 0).asDouble();
+        rateLimit.burst = rateLimitConfig.get("burst", 0).asDouble();
+    }
+    // always present, so that the rate can be set at runtime
+    this->httpClient_->setRateLimiter(make_shared<RateLimiter>(rateLimit));
+    if (config.isMember("sync_call"))
+    {
+        auto syncConfig = config["sync_call"];
+        SyncPolicy policy;
+        auto onLoop =
+            syncConfig.get("on_event_loop", "internal_loop").asString();
+        if (onLoop == "fail")
+        {
+            policy.onLoop = SyncOnLoop::FAIL;
+        }
+        else if (onLoop != "internal_loop")
+        {
+            throw ElasticSearchException("unknown on_event_loop: " + onLoop);
+        }
+        policy.maxBlockedThreads =
+            syncConfig.get("max_blocked_threads", 0).asUInt();
+        this->httpClient_->setSyncPolicy(policy);
+    }
+    if (config.isMember("io_threads"))
+    {
+        auto ioConfig = config["io_threads"];
+        vector<int> cpus;
+        for (const auto &cpu : ioConfig["cpu_affinity"])
+        {
+            cpus.push_back(cpu.asInt());
+        }
+        this->loopPool_ =
+            newLoopPool(ioConfig.get("count", 1).asUInt(), cpus);
+        this->httpClient_->setLoopPool(loopPool_);
+    }
+    if (config.isMember("slow_log"))
+    {
+        auto slowLogConfig = config["slow_log"];
+        SlowLogConfig slowLog;
+        slowLog.thresholdMs = slowLogConfig.get("threshold_ms", 0).asDouble();
+        slowLog.sampleRate = slowLogConfig.get("sample_rate", 1.0).asDouble();
+        slowLog.maxPerSecond =
+            slowLogConfig.get("max_per_second", 10).asDouble();
+        slowLog.maxBodyBytes =
+            slowLogConfig.get("max_body_bytes", 1024).asUInt();
+        this->httpClient_->setSlowLog(make_shared<SlowLog>(slowLog));
+    }
+    this->httpClient_->setMetricsEnabled(config.get("metrics", true).asBool());
+    this->httpClient_->setRequestTiming(
+        config.get("request_timing", false).asBool());
     this->indices_ = IndicesClientPtr(new IndicesClient(httpClient_));
     this->documents_ = DocumentsClientPtr(new DocumentsClient(httpClient_));
+
+    if (config.isMember("sniffer"))
+    {
+        auto snifferConfig = config["sniffer"];
+        SniffFilter filter;
+        filter.skipDedicatedMasters =
+            snifferConfig.get("skip_dedicated_masters", true).asBool();
+        for (const auto &role : snifferConfig["roles"])
+        {
+            filter.roles.push_back(role.asString());
+        }
+        this->sniffer_ = std::make_shared<Sniffer>(httpClient_, filter);
+        this->sniffer_->start(drogon::app().getLoop(),
+                              snifferConfig.get("interval", 300).asDouble());
+    }
 }
 
 void ElasticSearchClient::shutdown()
 {
     /// Shutdown the plugin
+    if (this->sniffer_)
+    {
+        this->sniffer_->stop();
+    }
+    if (this->loopPool_)
+    {
+        // new requests stop picking its loops, the requests in flight keep
+        // the pool until they complete, its loops stop after the last one
+        this->httpClient_->setLoopPool(nullptr);
+        this->loopPool_.reset();
+    }
 }
 
 IndicesClientPtr ElasticSearchClient::indices() const
@@ -49,3 +266,33 @@ std::shared_ptr<HttpClient> ElasticSearchClient::httpClient() const
     LOG_DEBUG << httpClient_.get();
     return httpClient_;
 }
+
+std::vector<NodeStats> ElasticSearchClient::nodeStats() const
+{
+    return httpClient_->nodeStats();
+}
+
+SyncStats ElasticSearchClient::syncStats() const
+{
+    return httpClient_->syncStats();
+}
+
+std::vector<MetricSnapshot> ElasticSearchClient::metrics() const
+{
+    return httpClient_->metrics()->snapshot();
+}
+
+std::string ElasticSearchClient::metricsPrometheus() const
+{
+    return httpClient_->metrics()->prometheus();
+}
+
+std::vector<PhaseStats> ElasticSearchClient::timingSummary() const
+{
+    return TimingSummary::instance().snapshot();
+}
+
+void ElasticSearchClient::setRateLimit(double rate, double burst)
+{
+    httpClient_->rateLimiter()->setRate(rate, burst);
+}
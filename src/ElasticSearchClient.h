@@ -8,6 +8,7 @@
 
 #include "DocumentsClient.h"
 #include "IndicesClient.h"
+#include "Sniffer.h"
 #include <drogon/HttpTypes.h>
 #include <drogon/plugins/Plugin.h>
 #include <memory>
@@ -29,6 +30,33 @@ class ElasticSearchClient : public drogon::Plugin<ElasticSearchClient>
   public:
     IndicesClientPtr indices() const;
     std::shared_ptr<HttpClient> httpClient() const;
+    std::vector<NodeStats> nodeStats() const;
+    SyncStats syncStats() const;
+
+    /// Requests, errors, in-flight requests, bytes and latency percentiles
+    /// per operation and index.
+    std::vector<MetricSnapshot> metrics() const;
+
+    /// The same metrics in the Prometheus text format, to be returned by a
+    /// `/metrics` handler.
+    std::string metricsPrometheus() const;
+
+    /// Distribution of the phases of the timed requests of the process,
+    /// empty unless "request_timing" is enabled.
+    std::vector<PhaseStats> timingSummary() const;
+
+    /// Latest-wins cancellation for typeahead: the token cancels the previous
+    /// request of the same session, e.g.
+    /// `es->search<Tp>(param, cb, ecb, es->latest(sessionId))`.
+    CancellationTokenPtr latest(const std::string &sessionId)
+    {
+        return latestWins_.next(sessionId);
+    }
+
+    /// Changes the documents or bytes per second allowed to index and bulk
+    /// requests, the unit is set by the config. A rate of 0 removes the
+    /// limit.
+    void setRateLimit(double rate, double burst = 0);
 
   public:
     // operations of document
@@ -42,12 +70,14 @@ class ElasticSearchClient : public drogon::Plugin<ElasticSearchClient>
         const Document &doc,
         const std::function<void(const IndexResponsePtr &)> &resultCallback,
         const std::function<void(const ElasticSearchException &)>
-            &exceptionCallback) const
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
     {
         this->documents_->index(param,
                                 doc,
                                 std::move(resultCallback),
-                                std::move(exceptionCallback));
+                                std::move(exceptionCallback),
+                                cancellation);
     }
 
     DeleteResponsePtr deleteDocument(const DeleteParam &param) const
@@ -59,11 +89,13 @@ class ElasticSearchClient : public drogon::Plugin<ElasticSearchClient>
         const DeleteParam &param,
         const std::function<void(const DeleteResponsePtr &)> &resultCallback,
         const std::function<void(const ElasticSearchException &)>
-            &exceptionCallback) const
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
     {
         this->documents_->deleteDocument(param,
                                          std::move(resultCallback),
-                                         std::move(exceptionCallback));
+                                         std::move(exceptionCallback),
+                                         cancellation);
     }
 
     UpdateResponsePtr update(const UpdateParam &param,
@@ -77,12 +109,14 @@ class ElasticSearchClient : public drogon::Plugin<ElasticSearchClient>
         const Document &doc,
         const std::function<void(const UpdateResponsePtr &)> &resultCallback,
         const std::function<void(const ElasticSearchException &)>
-            &exceptionCallback) const
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
     {
         this->documents_->update(param,
                                  doc,
                                  std::move(resultCallback),
-                                 std::move(exceptionCallback));
+                                 std::move(exceptionCallback),
+                                 cancellation);
     }
 
     GetResponsePtr get(const GetParam &param) const
@@ -93,11 +127,31 @@ class ElasticSearchClient : public drogon::Plugin<ElasticSearchClient>
     void get(const GetParam &param,
              const std::function<void(const GetResponsePtr &)> &resultCallback,
              const std::function<void(const ElasticSearchException &)>
-                 &exceptionCallback) const
+                 &exceptionCallback,
+             const CancellationTokenPtr &cancellation = nullptr) const
     {
         this->documents_->get(param,
                               std::move(resultCallback),
-                              std::move(exceptionCallback));
+                              std::move(exceptionCallback),
+                              cancellation);
+    }
+
+    CountResponsePtr count(const CountParam &param) const
+    {
+        return this->documents_->count(param);
+    }
+
+    void count(
+        const CountParam &param,
+        const std::function<void(const CountResponsePtr &)> &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        this->documents_->count(param,
+                                std::move(resultCallback),
+                                std::move(exceptionCallback),
+                                cancellation);
     }
 
     // operations of search
@@ -108,14 +162,225 @@ class ElasticSearchClient : public drogon::Plugin<ElasticSearchClient>
         return this->documents_->search<Tp>(param);
     }
 
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    void search(const SearchParam &param,
+                const std::function<void(const SearchResponsePtr<Tp> &)>
+                    &resultCallback,
+                const std::function<void(const ElasticSearchException &)>
+                    &exceptionCallback,
+                const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        this->documents_->search<Tp>(param,
+                                     std::move(resultCallback),
+                                     std::move(exceptionCallback),
+                                     cancellation);
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    SearchResponsePtr<Tp> searchTemplate(const SearchTemplateParam &param) const
+    {
+        return this->documents_->searchTemplate<Tp>(param);
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    void searchTemplate(
+        const SearchTemplateParam &param,
+        const std::function<void(const SearchResponsePtr<Tp> &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        this->documents_->searchTemplate<Tp>(param,
+                                             std::move(resultCallback),
+                                             std::move(exceptionCallback),
+                                             cancellation);
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    MultiSearchResponsePtr<Tp> multiSearchTemplate(
+        const MultiSearchTemplateParam &param) const
+    {
+        return this->documents_->multiSearchTemplate<Tp>(param);
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    void multiSearchTemplate(
+        const MultiSearchTemplateParam &param,
+        const std::function<void(const MultiSearchResponsePtr<Tp> &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        this->documents_->multiSearchTemplate<Tp>(param,
+                                                  std::move(resultCallback),
+                                                  std::move(exceptionCallback),
+                                                  cancellation);
+    }
+
+    // operations of stored scripts
+    PutScriptResponsePtr putScript(const PutScriptParam &param) const
+    {
+        return this->documents_->putScript(param);
+    }
+
+    void putScript(
+        const PutScriptParam &param,
+        const std::function<void(const PutScriptResponsePtr &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        this->documents_->putScript(param,
+                                    std::move(resultCallback),
+                                    std::move(exceptionCallback),
+                                    cancellation);
+    }
+
+    GetScriptResponsePtr getScript(const std::string &id) const
+    {
+        return this->documents_->getScript(id);
+    }
+
+    void getScript(
+        const std::string &id,
+        const std::function<void(const GetScriptResponsePtr &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        this->documents_->getScript(id,
+                                    std::move(resultCallback),
+                                    std::move(exceptionCallback),
+                                    cancellation);
+    }
+
+    DeleteScriptResponsePtr deleteScript(const std::string &id) const
+    {
+        return this->documents_->deleteScript(id);
+    }
+
+    void deleteScript(
+        const std::string &id,
+        const std::function<void(const DeleteScriptResponsePtr &)>
+            &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        this->documents_->deleteScript(id,
+                                       std::move(resultCallback),
+                                       std::move(exceptionCallback),
+                                       cancellation);
+    }
+
+  public:
+    // coroutines, the request is sent before the first co_await
+    RequestAwaiter<IndexResponsePtr> indexCoro(
+        const IndexParam &param,
+        const Document &doc,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->indexCoro(param, doc, cancellation);
+    }
+
+    RequestAwaiter<DeleteResponsePtr> deleteDocumentCoro(
+        const DeleteParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->deleteDocumentCoro(param, cancellation);
+    }
+
+    RequestAwaiter<UpdateResponsePtr> updateCoro(
+        const UpdateParam &param,
+        const Document &doc,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->updateCoro(param, doc, cancellation);
+    }
+
+    RequestAwaiter<GetResponsePtr> getCoro(
+        const GetParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->getCoro(param, cancellation);
+    }
+
+    RequestAwaiter<CountResponsePtr> countCoro(
+        const CountParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->countCoro(param, cancellation);
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    RequestAwaiter<SearchResponsePtr<Tp>> searchCoro(
+        const SearchParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->searchCoro<Tp>(param, cancellation);
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    RequestAwaiter<SearchResponsePtr<Tp>> searchTemplateCoro(
+        const SearchTemplateParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->searchTemplateCoro<Tp>(param, cancellation);
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    RequestAwaiter<MultiSearchResponsePtr<Tp>> multiSearchTemplateCoro(
+        const MultiSearchTemplateParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->multiSearchTemplateCoro<Tp>(param,
+                                                             cancellation);
+    }
+
+    RequestAwaiter<PutScriptResponsePtr> putScriptCoro(
+        const PutScriptParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->putScriptCoro(param, cancellation);
+    }
+
+    RequestAwaiter<GetScriptResponsePtr> getScriptCoro(
+        const std::string &id,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->getScriptCoro(id, cancellation);
+    }
+
+    RequestAwaiter<DeleteScriptResponsePtr> deleteScriptCoro(
+        const std::string &id,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return this->documents_->deleteScriptCoro(id, cancellation);
+    }
+
   private:
     IndicesClientPtr indices_;
     std::shared_ptr<HttpClient> httpClient_;
     DocumentsClientPtr documents_;
+    SnifferPtr sniffer_;
+    std::shared_ptr<trantor::EventLoopThreadPool> loopPool_;
+    LatestWins latestWins_;
 
   private:
     std::string host_;
-    int16_t port_;
+    uint16_t port_;
 };
 
 };  // namespace tl::elasticsearch
@@ -0,0 +1,425 @@
+/**
+ *
+ *  Fingerprint.cc
+ *
+ */
+
+#include "Fingerprint.h"
+#include <json/reader.h>
+#include <cstring>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+// one tag per kind of value, so that e.g. "1" and 1 differ
+static constexpr uint64_t kObjectTag = 1;
+static constexpr uint64_t kArrayTag = 2;
+static constexpr uint64_t kStringTag = 3;
+static constexpr uint64_t kNumberTag = 4;
+static constexpr uint64_t kBoolTag = 5;
+static constexpr uint64_t kNullTag = 6;
+static constexpr uint64_t kValuesTag = 7;
+static constexpr uint64_t kKeyTag = 8;
+
+static constexpr uint64_t kLowSeed = 0x9e3779b97f4a7c15ULL;
+static constexpr uint64_t kHighSeed = 0xc2b2ae3d27d4eb4fULL;
+static constexpr uint64_t kMultiplier = 0x9fb21c651e98df25ULL;
+
+/// The finalizer of splitmix64.
+static constexpr uint64_t mix(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+static constexpr Hash128 hashTag(uint64_t tag)
+{
+    return Hash128{mix(kHighSeed ^ tag), mix(kLowSeed ^ tag)};
+}
+
+static Hash128 hashBytes(string_view bytes, uint64_t tag)
+{
+    auto hash = hashTag(tag);
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8)
+    {
+        uint64_t chunk;
+        memcpy(&chunk, bytes.data() + i, 8);
+        hash.low = mix(hash.low ^ chunk);
+        hash.high = mix(hash.high + chunk * kMultiplier);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, bytes.data() + i, bytes.size() - i);
+    tail ^= static_cast<uint64_t>(bytes.size()) << 56;
+    hash.low = mix(hash.low ^ tail);
+    hash.high = mix(hash.high + tail * kMultiplier);
+    return hash;
+}
+
+/// `value` after `hash`, the order matters.
+static Hash128 combine(const Hash128 &hash, const Hash128 &value)
+{
+    return Hash128{mix(hash.high * kMultiplier + value.high),
+                   mix((hash.low ^ value.low) * kMultiplier + kLowSeed)};
+}
+
+/// Adds `value` to a set: the order does not matter.
+static Hash128 addTo(const Hash128 &set, const Hash128 &value)
+{
+    return Hash128{set.high + mix(value.high), set.low + mix(value.low)};
+}
+
+/// Both hashes of a value, and whether it is a value of the shape.
+class FingerprintHashes
+{
+  public:
+    Hash128 full;
+    Hash128 shape;
+    bool literal = false;
+};
+
+/// The keys whose values are part of the shape.
+static bool isStructuralKey(string_view key)
+{
+    return key == "field" || key == "fields" || key == "type" ||
+           key == "operator" || key == "id" || key == "lang";
+}
+
+/// The clauses of a bool query, their order does not matter.
+static bool isBoolClause(string_view key)
+{
+    return key == "must" || key == "should" || key == "filter" ||
+           key == "must_not" || key == "mustNot";
+}
+
+static FingerprintHashes scalarHashes(const Hash128 &full,
+                                      uint64_t tag,
+                                      bool structural)
+{
+    FingerprintHashes hashes;
+    hashes.full = full;
+    hashes.literal = !structural;
+    hashes.shape = structural ? full : hashTag(tag);
+    return hashes;
+}
+
+static FingerprintHashes stringHashes(string_view value, bool structural)
+{
+    return scalarHashes(hashBytes(value, kStringTag), kStringTag, structural);
+}
+
+static FingerprintHashes numberHashes(double value, bool structural)
+{
+    // 20 and 20.0 are the same number, -0 is 0
+    value = value == 0 ? 0.0 : value;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    auto full = combine(hashTag(kNumberTag), Hash128{bits, bits});
+    return scalarHashes(full, kNumberTag, structural);
+}
+
+static FingerprintHashes boolHashes(bool value, bool structural)
+{
+    auto full = combine(hashTag(kBoolTag), Hash128{value, value});
+    return scalarHashes(full, kBoolTag, structural);
+}
+
+/// The members of an object, in any order.
+class ObjectHasher
+{
+  public:
+    void add(string_view key, const FingerprintHashes &value)
+    {
+        // mustNot is how BoolQuery writes must_not
+        auto keyHash = hashBytes(key == "mustNot" ? "must_not" : key, kKeyTag);
+        hashes_.full = addTo(hashes_.full, combine(keyHash, value.full));
+        hashes_.shape = addTo(hashes_.shape, combine(keyHash, value.shape));
+    }
+
+    FingerprintHashes done() const
+    {
+        FingerprintHashes hashes;
+        hashes.full = combine(hashTag(kObjectTag), hashes_.full);
+        hashes.shape = combine(hashTag(kObjectTag), hashes_.shape);
+        return hashes;
+    }
+
+  private:
+    FingerprintHashes hashes_;
+};
+
+/// The items of an array, in order unless they are the clauses of a bool.
+class ArrayHasher
+{
+  public:
+    ArrayHasher(bool ordered) : ordered_(ordered)
+    {
+    }
+
+    void add(const FingerprintHashes &value)
+    {
+        if (ordered_)
+        {
+            hashes_.full = combine(hashes_.full, value.full);
+            hashes_.shape = combine(hashes_.shape, value.shape);
+        }
+        else
+        {
+            hashes_.full = addTo(hashes_.full, value.full);
+            hashes_.shape = addTo(hashes_.shape, value.shape);
+        }
+        literals_ = literals_ && value.literal;
+        ++size_;
+    }
+
+    FingerprintHashes done() const
+    {
+        FingerprintHashes hashes;
+        hashes.full = combine(hashTag(kArrayTag), hashes_.full);
+        hashes.shape = combine(hashTag(kArrayTag), hashes_.shape);
+        // a list of values, e.g. of a terms query, whatever its length
+        if (size_ > 0 && literals_)
+        {
+            hashes.shape = hashTag(kValuesTag);
+            hashes.literal = true;
+        }
+        return hashes;
+    }
+
+  private:
+    bool ordered_;
+    bool literals_ = true;
+    size_t size_ = 0;
+    FingerprintHashes hashes_;
+};
+
+static string_view memberName(const Json::Value::const_iterator &it)
+{
+    const char *end = nullptr;
+    const char *begin = it.memberName(&end);
+    return string_view(begin, end - begin);
+}
+
+/// `key` is the name of the member holding `json`, `boolBody` says whether
+/// `json` is the body of a bool query.
+static FingerprintHashes jsonHashes(const Json::Value &json,
+                                    string_view key,
+                                    bool clause,
+                                    bool boolBody)
+{
+    bool structural = isStructuralKey(key);
+    switch (json.type())
+    {
+        case Json::nullValue:
+            return scalarHashes(hashTag(kNullTag), kNullTag, true);
+        case Json::intValue:
+        case Json::uintValue:
+        case Json::realValue:
+            return numberHashes(json.asDouble(), structural);
+        case Json::stringValue:
+        {
+            const char *begin = nullptr;
+            const char *end = nullptr;
+            json.getString(&begin, &end);
+            return stringHashes(string_view(begin, end - begin), structural);
+        }
+        case Json::booleanValue:
+            return boolHashes(json.asBool(), structural);
+        case Json::arrayValue:
+        {
+            ArrayHasher array(!clause);
+            for (const auto &item : json)
+            {
+                array.add(jsonHashes(item, key, false, false));
+            }
+            return array.done();
+        }
+        case Json::objectValue:
+            break;
+    }
+    if (clause)
+    {
+        // {"must": {...}} is {"must": [{...}]}
+        ArrayHasher array(false);
+        array.add(jsonHashes(json, key, false, false));
+        return array.done();
+    }
+    ObjectHasher object;
+    for (auto it = json.begin(); it != json.end(); ++it)
+    {
+        auto name = memberName(it);
+        object.add(name,
+                   jsonHashes(*it,
+                              name,
+                              boolBody && isBoolClause(name),
+                              name == "bool"));
+    }
+    return object.done();
+}
+
+static QueryFingerprint toFingerprint(const FingerprintHashes &hashes)
+{
+    return QueryFingerprint{hashes.full, hashes.shape};
+}
+
+/// An object of one member.
+static FingerprintHashes memberHashes(string_view key,
+                                      const FingerprintHashes &value)
+{
+    ObjectHasher object;
+    object.add(key, value);
+    return object.done();
+}
+
+/// Walks the nodes as jsonHashes() walks tree.toJson().
+static FingerprintHashes nodeHashes(const QueryTree &tree,
+                                    QueryTree::NodeId id)
+{
+    const auto &node = tree.node(id);
+    switch (QueryTree::kind(node))
+    {
+        case QueryKind::MATCH_ALL:
+            return memberHashes("match_all", ObjectHasher().done());
+        case QueryKind::MATCH:
+        {
+            const auto &match = get<QueryTree::MatchNode>(node);
+            auto field = tree.text(match.field);
+            auto query = stringHashes(tree.text(match.query),
+                                      isStructuralKey(field));
+            return memberHashes("match", memberHashes(field, query));
+        }
+        case QueryKind::MATCH_PHRASE:
+        {
+            const auto &match = get<QueryTree::MatchPhraseNode>(node);
+            auto field = tree.text(match.field);
+            auto query = stringHashes(tree.text(match.query),
+                                      isStructuralKey(field));
+            return memberHashes("match_phrase", memberHashes(field, query));
+        }
+        case QueryKind::MULTI_MATCH:
+        {
+            const auto &match = get<QueryTree::MultiMatchNode>(node);
+            ObjectHasher body;
+            body.add("query", stringHashes(tree.text(match.query), false));
+            if (match.fields.size > 0)
+            {
+                ArrayHasher fields(true);
+                for (auto field : tree.fields(match.fields))
+                {
+                    fields.add(stringHashes(tree.text(field), true));
+                }
+                body.add("fields", fields.done());
+            }
+            return memberHashes("multi_match", body.done());
+        }
+        case QueryKind::TERM:
+        {
+            const auto &term = get<QueryTree::TermNode>(node);
+            auto value = stringHashes(tree.text(term.value), false);
+            return memberHashes(
+                "term",
+                memberHashes(tree.text(term.field),
+                             memberHashes("value", value)));
+        }
+        case QueryKind::RANGE:
+        {
+            const auto &range = get<QueryTree::RangeNode>(node);
+            const auto &[gt, gte, lt, lte] = range.bounds;
+            ObjectHasher bounds;
+            auto addBound = [&bounds](string_view name,
+                                      const optional<double> &bound) {
+                if (bound)
+                {
+                    bounds.add(name, numberHashes(*bound, false));
+                }
+            };
+            addBound("gt", gt);
+            addBound("gte", gte);
+            addBound("lt", lt);
+            addBound("lte", lte);
+            return memberHashes("range",
+                                memberHashes(tree.text(range.field),
+                                             bounds.done()));
+        }
+        case QueryKind::BOOL:
+        {
+            const auto &clauses = get<QueryTree::BoolNode>(node);
+            ObjectHasher body;
+            auto addClause = [&tree, &body](string_view name,
+                                            QueryTree::Span span) {
+                if (span.size == 0)
+                {
+                    return;
+                }
+                ArrayHasher children(false);
+                for (auto child : tree.children(span))
+                {
+                    children.add(nodeHashes(tree, child));
+                }
+                body.add(name, children.done());
+            };
+            addClause("must", clauses.must);
+            addClause("should", clauses.should);
+            addClause("must_not", clauses.mustNot);
+            addClause("filter", clauses.filter);
+            return memberHashes("bool", body.done());
+        }
+    }
+    return ObjectHasher().done();
+}
+
+string Hash128::toHex() const
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    string hex(32, '0');
+    for (int i = 0; i < 16; ++i)
+    {
+        hex[15 - i] = digits[(high >> (4 * i)) & 0xf];
+        hex[31 - i] = digits[(low >> (4 * i)) & 0xf];
+    }
+    return hex;
+}
+
+QueryFingerprint tl::elasticsearch::fingerprint(const Json::Value &json)
+{
+    return toFingerprint(jsonHashes(json, "", false, false));
+}
+
+QueryFingerprint tl::elasticsearch::fingerprint(const Query &query)
+{
+    return fingerprint(query.toJson());
+}
+
+QueryFingerprint tl::elasticsearch::fingerprint(
+    const Aggregations &aggregations)
+{
+    return fingerprint(aggregations.toJson());
+}
+
+QueryFingerprint tl::elasticsearch::fingerprint(const QueryTree &tree)
+{
+    return toFingerprint(nodeHashes(tree, tree.root()));
+}
+
+QueryFingerprint tl::elasticsearch::fingerprint(const SearchParam &param)
+{
+    if (!param.body())
+    {
+        return fingerprint(param.toJson());
+    }
+    static const Json::CharReaderBuilder builder;
+    unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    const auto &body = *param.body();
+    Json::Value json;
+    string errors;
+    if (!reader->parse(
+            body.data(), body.data() + body.size(), &json, &errors))
+    {
+        throw ElasticSearchException("The body is not JSON: " + errors);
+    }
+    return fingerprint(json);
+}
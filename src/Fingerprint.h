@@ -0,0 +1,77 @@
+/**
+ *
+ *  Fingerprint.h
+ *
+ */
+
+#pragma once
+
+#include "Aggregation.h"
+#include "DocumentsClient.h"
+#include "Query.h"
+#include "QueryTree.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace tl::elasticsearch
+{
+
+/// 128 bits of a fingerprint, `low` alone is a 64-bit hash.
+class Hash128
+{
+  public:
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    bool operator==(const Hash128 &other) const = default;
+
+    /// 32 hex digits, e.g. for logs and cache keys.
+    std::string toHex() const;
+};
+
+/// Identity of a search for caches, single-flight, metrics and the slow
+/// log, see fingerprint(). Both hashes ignore the order of the keys of the
+/// objects and of the clauses of bool queries, and a clause written as one
+/// object is the same as an array of it.
+class QueryFingerprint
+{
+  public:
+    /// Differs as soon as a value differs.
+    Hash128 full;
+    /// The values are replaced by their type, so the searches differing only
+    /// by their values share it, e.g. the same query for two users. The
+    /// values of field, fields, type, operator, id and lang are kept, they
+    /// are part of the shape, and an array of values counts as one value
+    /// whatever its length.
+    Hash128 shape;
+
+    bool operator==(const QueryFingerprint &other) const = default;
+};
+
+/// Walks the JSON as it is, nothing is serialized.
+QueryFingerprint fingerprint(const Json::Value &json);
+
+/// The builders only expose their JSON, it is built then walked.
+QueryFingerprint fingerprint(const Query &query);
+QueryFingerprint fingerprint(const Aggregations &aggregations);
+
+/// Walks the nodes, it allocates nothing. Equal to the fingerprint of
+/// tree.toJson().
+QueryFingerprint fingerprint(const QueryTree &tree);
+
+/// The whole body: query, sort, from, size and aggs, or the body set by
+/// SearchParam::body once parsed. Throws ElasticSearchException if that body
+/// is not JSON.
+QueryFingerprint fingerprint(const SearchParam &param);
+
+};  // namespace tl::elasticsearch
+
+template <>
+struct std::hash<tl::elasticsearch::Hash128>
+{
+    size_t operator()(const tl::elasticsearch::Hash128 &hash) const noexcept
+    {
+        return static_cast<size_t>(hash.low);
+    }
+};
@@ -0,0 +1,120 @@
+/**
+ *
+ *  Hedging.cc
+ *
+ */
+
+#include "Hedging.h"
+#include <algorithm>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+void HedgeController::onRequest()
+{
+    requests_.fetch_add(1, memory_order_relaxed);
+    auto earned = static_cast<int64_t>(policy_.budget * kTokenScale);
+    auto current = tokens_.load(memory_order_relaxed);
+    int64_t next;
+    do
+    {
+        next = min(current + earned, kMaxTokens);
+    } while (!tokens_.compare_exchange_weak(current,
+                                            next,
+                                            memory_order_relaxed));
+}
+
+bool HedgeController::tryAcquire()
+{
+    auto current = tokens_.load(memory_order_relaxed);
+    do
+    {
+        if (current < kTokenScale)
+        {
+            return false;
+        }
+    } while (!tokens_.compare_exchange_weak(current,
+                                            current - kTokenScale,
+                                            memory_order_relaxed));
+    hedgesSent_.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+void HedgeController::rotate(Clock::time_point now)
+{
+    auto start = windowStart_.load(memory_order_relaxed);
+    auto elapsed = now.time_since_epoch().count() - start;
+    auto window = policy_.window.count();
+    if (elapsed < window ||
+        !windowStart_.compare_exchange_strong(start,
+                                              now.time_since_epoch().count(),
+                                              memory_order_relaxed))
+    {
+        return;
+    }
+    // the winner of the race recycles the oldest window
+    auto current = current_.load(memory_order_relaxed);
+    if (elapsed >= 2 * window)
+    {
+        windows_[current].reset();
+    }
+    windows_[1 - current].reset();
+    current_.store(1 - current, memory_order_release);
+}
+
+void HedgeController::onResponse(Clock::duration latency,
+                                 bool byHedge,
+                                 Clock::time_point now)
+{
+    rotate(now);
+    windows_[current_.load(memory_order_acquire)].record(latency);
+    if (byHedge)
+    {
+        hedgesWon_.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+/// Percentile of the values of both windows, in microseconds.
+static uint64_t percentileOf(const array<LatencyHistogram, 2> &windows,
+                             double percentile)
+{
+    auto total = windows[0].count() + windows[1].count();
+    auto target =
+        max<uint64_t>(1, static_cast<uint64_t>(percentile * total + 0.5));
+    auto maxValue = max(windows[0].max(), windows[1].max());
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < LatencyHistogram::kBucketCount; ++i)
+    {
+        seen += windows[0].bucketCount(i) + windows[1].bucketCount(i);
+        if (seen >= target)
+        {
+            return min(LatencyHistogram::bucketUpperBound(i), maxValue);
+        }
+    }
+    return maxValue;
+}
+
+chrono::duration<double, milli> HedgeController::delay() const
+{
+    if (policy_.delayMs > 0)
+    {
+        return chrono::duration<double, milli>(policy_.delayMs);
+    }
+    double delayMs = policy_.minDelayMs;
+    if (windows_[0].count() + windows_[1].count() >= kMinSamples)
+    {
+        delayMs = max(delayMs,
+                      percentileOf(windows_, policy_.percentile) / 1000.0);
+    }
+    return chrono::duration<double, milli>(delayMs);
+}
+
+HedgeStats HedgeController::stats() const
+{
+    HedgeStats result;
+    result.requests = requests_.load(memory_order_relaxed);
+    result.hedgesSent = hedgesSent_.load(memory_order_relaxed);
+    result.hedgesWon = hedgesWon_.load(memory_order_relaxed);
+    result.delayMs = delay().count();
+    return result;
+}
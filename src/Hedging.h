@@ -0,0 +1,99 @@
+/**
+ *
+ *  Hedging.h
+ *
+ */
+
+#pragma once
+
+#include "LatencyHistogram.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace tl::elasticsearch
+{
+
+class HedgePolicy
+{
+  public:
+    /// Fixed delay before the duplicate is sent, in milliseconds. If 0, the
+    /// percentile of the observed latency of read-only requests is used.
+    double delayMs = 0;
+    double percentile = 0.95;
+    /// Lower bound of the delay, also used until enough latencies are seen.
+    double minDelayMs = 10;
+    /// The percentile is taken over the latencies of the current and the
+    /// previous window, so that it follows a change of the cluster.
+    std::chrono::steady_clock::duration window = std::chrono::seconds(30);
+    /// At most this fraction of the read-only requests may be hedged.
+    double budget = 0.1;
+};
+
+class HedgeStats
+{
+  public:
+    uint64_t requests = 0;
+    uint64_t hedgesSent = 0;
+    // the duplicate answered first
+    uint64_t hedgesWon = 0;
+    double delayMs = 0;
+};
+
+/// State shared by all hedged requests of an HttpClient: observed latency,
+/// budget and statistics.
+class HedgeController
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    HedgeController(const HedgePolicy &policy) : policy_(policy)
+    {
+    }
+
+  public:
+    const HedgePolicy &policy() const
+    {
+        return policy_;
+    }
+
+    /// Called for every hedgeable request, earns budget.
+    void onRequest();
+
+    /// Spends budget for one duplicate, false if the budget is exhausted.
+    bool tryAcquire();
+
+    void onResponse(Clock::duration latency,
+                    bool byHedge,
+                    Clock::time_point now = Clock::now());
+
+    std::chrono::duration<double, std::milli> delay() const;
+
+    HedgeStats stats() const;
+
+  private:
+    // below this many samples the percentile is not trusted
+    static constexpr uint64_t kMinSamples = 100;
+    // the budget is counted in thousandths of a request
+    static constexpr int64_t kTokenScale = 1000;
+    // at most this many duplicates in a burst
+    static constexpr int64_t kMaxTokens = 10 * kTokenScale;
+
+    /// Starts a new window once the current one is over.
+    void rotate(Clock::time_point now);
+
+    HedgePolicy policy_;
+    // the current window and the previous one, see HedgePolicy::window
+    std::array<LatencyHistogram, 2> windows_;
+    std::atomic<size_t> current_{0};
+    std::atomic<Clock::rep> windowStart_{0};
+    std::atomic<int64_t> tokens_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> hedgesSent_{0};
+    std::atomic<uint64_t> hedgesWon_{0};
+};
+
+using HedgeControllerPtr = std::shared_ptr<HedgeController>;
+
+};  // namespace tl::elasticsearch
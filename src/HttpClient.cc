@@ -5,6 +5,13 @@
  */
 
 #include "HttpClient.h"
+#include "Fingerprint.h"
+#include <drogon/HttpAppFramework.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <string_view>
+#include <thread>
 
 using namespace std;
 using namespace tl::elasticsearch;
@@ -13,141 +20,1089 @@ Json::Value HttpClient::sendRequest(const std::string &path,
                                     drogon::HttpMethod method,
                                     const Json::Value &requestBody)
 {
-    unique_ptr<promise<Json::Value>> pro(new promise<Json::Value>);
-    auto f = pro->get_future();
-    this->sendRequest(
-        path,
-        method,
-        [&pro](const Json::Value &response) {
-            try
+    return waitFor<Json::Value>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->sendRequest(
+                path, method, resultCallback, exceptionCallback, requestBody);
+        });
+}
+
+void HttpClient::sendRequest(
+    const std::string &path,
+    drogon::HttpMethod method,
+    const std::function<void(const Json::Value &)> &resultCallback,
+    const std::function<void(const ElasticSearchException &)>
+        &exceptionCallback,
+    const Json::Value &requestBody,
+    const RequestOptions &options)
+{
+    doSendRequest(path,
+                  method,
+                  timed(options.timing,
+                        &RequestTiming::serialize,
+                        [&requestBody]() {
+                            return requestBody.toStyledString();
+                        }),
+                  std::move(resultCallback),
+                  std::move(exceptionCallback),
+                  options);
+}
+
+Json::Value HttpClient::sendRequest(const std::string &path,
+                                    drogon::HttpMethod method,
+                                    const std::vector<Json::Value> &requestBody)
+{
+    return waitFor<Json::Value>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->sendRequest(
+                path, method, resultCallback, exceptionCallback, requestBody);
+        });
+}
+
+void HttpClient::sendRequest(
+    const std::string &path,
+    drogon::HttpMethod method,
+    const std::function<void(const Json::Value &)> &resultCallback,
+    const std::function<void(const ElasticSearchException &)>
+        &exceptionCallback,
+    const std::vector<Json::Value> &requestBody,
+    const RequestOptions &options)
+{
+    auto requestBodyStr =
+        timed(options.timing, &RequestTiming::serialize, [&requestBody]() {
+            return bulkBody(requestBody);
+        });
+    auto bulkOptions = options;
+    if (bulkOptions.documents == 0)
+    {
+        bulkOptions.documents = countBulkDocuments(requestBody);
+    }
+    if (bulkOptions.operation.empty())
+    {
+        bulkOptions.operation = "bulk";
+    }
+    doSendRequest(path,
+                  method,
+                  std::move(requestBodyStr),
+                  std::move(resultCallback),
+                  std::move(exceptionCallback),
+                  bulkOptions);
+}
+
+void HttpClient::sendRawRequest(
+    const std::string &path,
+    drogon::HttpMethod method,
+    const std::function<void(const Json::Value &)> &resultCallback,
+    const std::function<void(const ElasticSearchException &)>
+        &exceptionCallback,
+    std::string requestBody,
+    const RequestOptions &options)
+{
+    doSendRequest(path,
+                  method,
+                  std::move(requestBody),
+                  resultCallback,
+                  exceptionCallback,
+                  options);
+}
+
+void HttpClient::registerNodeGauges()
+{
+    // the nodes are read on export, they change with sniffing
+    metrics_->setGaugeCollector([pool = nodePool_]() {
+        vector<GaugeSample> gauges;
+        for (const auto &node : pool->stats())
+        {
+            vector<pair<string, string>> labels{{"node", node.url}};
+            gauges.push_back({"es_client_node_in_flight",
+                              "Requests sent to the node and not answered.",
+                              labels,
+                              static_cast<double>(node.inFlight)});
+            // only the nodes with a concurrency limit queue requests
+            if (node.concurrencyLimit == 0)
             {
-                pro->set_value(response);
+                continue;
             }
-            catch (...)
+            gauges.push_back({"es_client_node_concurrency_limit",
+                              "Adaptive limit of the requests in flight.",
+                              labels,
+                              static_cast<double>(node.concurrencyLimit)});
+            gauges.push_back({"es_client_node_queued",
+                              "Requests waiting for the concurrency limit.",
+                              labels,
+                              static_cast<double>(node.queued)});
+        }
+        return gauges;
+    });
+}
+
+std::string HttpClient::bulkBody(const std::vector<Json::Value> &lines)
+{
+    // _bulk is newline delimited, a value must fit on its line
+    static const auto writer = []() {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        return builder;
+    }();
+    std::string result;
+    for (const auto &item : lines)
+    {
+        result += Json::writeString(writer, item);
+        result += '\n';
+    }
+    return result;
+}
+
+size_t HttpClient::countBulkDocuments(const std::vector<Json::Value> &lines)
+{
+    size_t documents = 0;
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        ++documents;
+        // every action but delete is followed by its source
+        if (!lines[i].isMember("delete"))
+        {
+            ++i;
+        }
+    }
+    return documents;
+}
+
+void HttpClient::setLoopPool(
+    const std::shared_ptr<trantor::EventLoopThreadPool> &loopPool)
+{
+    shared_ptr<trantor::EventLoopThreadPool> shared;
+    if (loopPool)
+    {
+        // the last request may complete on one of the loops, which cannot
+        // join itself: the pool is then released by another thread
+        shared = shared_ptr<trantor::EventLoopThreadPool>(
+            loopPool.get(),
+            [loopPool](trantor::EventLoopThreadPool *) mutable {
+                auto loops = loopPool->getLoops();
+                auto current = find(
+                    loops.begin(),
+                    loops.end(),
+                    trantor::EventLoop::getEventLoopOfCurrentThread());
+                if (current != loops.end())
+                {
+                    thread([loopPool = std::move(loopPool)]() mutable {
+                        loopPool.reset();
+                    }).detach();
+                }
+            });
+    }
+    updateSettings([&shared](HttpClientSettings &settings) {
+        settings.loopPool = std::move(shared);
+    });
+}
+
+void HttpClient::doSendRequest(
+    const std::string &path,
+    drogon::HttpMethod method,
+    std::string &&requestBody,
+    const std::function<void(const Json::Value &)> &resultCallback,
+    const std::function<void(const ElasticSearchException &)>
+        &exceptionCallback,
+    const RequestOptions &options)
+{
+    // requests of a synchronous call made on an event loop run elsewhere,
+    // the others on the loop pool if there is one
+    if (options.timing)
+    {
+        options.timing->enqueued_ = chrono::steady_clock::now();
+    }
+
+    // one snapshot, a setter called meanwhile applies to the next request
+    auto settings = this->settings();
+    auto requestOptions = options;
+    if (!requestOptions.loop)
+    {
+        requestOptions.loop = SyncCaller::transportLoop();
+    }
+    if (!requestOptions.loop && settings->loopPool)
+    {
+        requestOptions.loop = settings->loopPool->getNextLoop();
+        requestOptions.loopPool = settings->loopPool;
+    }
+    if (requestOptions.operation.empty())
+    {
+        requestOptions.operation = "other";
+    }
+
+    recordMetrics(*settings, requestOptions, requestBody.size());
+    auto onResult = resultCallback;
+    auto onError = exceptionCallback;
+    if (const auto &slowLog = settings->slowLog; slowLog && slowLog->enabled())
+    {
+        watchSlowRequest(
+            slowLog, requestOptions, requestBody, onResult, onError);
+    }
+    if (const auto &tracer = settings->tracer)
+    {
+        traceRequest(
+            tracer, requestOptions, requestBody.size(), onResult, onError);
+    }
+    if (const auto &recorder = settings->recorder)
+    {
+        captureTraffic(recorder,
+                       path,
+                       method,
+                       requestBody,
+                       requestOptions,
+                       onResult,
+                       onError);
+    }
+    if (const auto &cancellation = options.cancellation)
+    {
+        bindCancellation(cancellation, onResult, onError);
+        if (cancellation->isCancelled())
+        {
+            recordCompletion(requestOptions, true);
+            return;
+        }
+    }
+
+    const auto &rateLimiter = settings->rateLimiter;
+    if (rateLimiter && options.documents > 0)
+    {
+        auto delay =
+            rateLimiter->reserve(options.documents, requestBody.size());
+        if (delay > chrono::steady_clock::duration::zero())
+        {
+            // the request starts with the state of the client at that time
+            loopOf(requestOptions)->runAfter(
+                chrono::duration<double>(delay),
+                [weakClient = weak_from_this(),
+                 metrics = metrics_,
+                 path,
+                 method,
+                 requestBody = std::move(requestBody),
+                 onResult = std::move(onResult),
+                 onError = std::move(onError),
+                 requestOptions]() mutable {
+                    auto client = weakClient.lock();
+                    if (!client)
+                    {
+                        recordCompletion(requestOptions, true);
+                        onError(ElasticSearchException(
+                            "the client was destroyed before the request "
+                            "was sent!"));
+                        return;
+                    }
+                    client->startRequest(*client->settings(),
+                                         path,
+                                         method,
+                                         std::move(requestBody),
+                                         onResult,
+                                         onError,
+                                         requestOptions);
+                });
+            return;
+        }
+    }
+    startRequest(*settings,
+                 path,
+                 method,
+                 std::move(requestBody),
+                 onResult,
+                 onError,
+                 requestOptions);
+}
+
+void HttpClient::bindCancellation(
+    const CancellationTokenPtr &cancellation,
+    std::function<void(const Json::Value &)> &resultCallback,
+    std::function<void(const ElasticSearchException &)> &exceptionCallback)
+{
+    // whichever comes first of the response and the cancellation wins
+    struct Binding
+    {
+        std::atomic<bool> done{false};
+        std::atomic<uint64_t> callbackId{0};
+    };
+
+    auto binding = make_shared<Binding>();
+    auto onResult = std::move(resultCallback);
+    auto onError = std::move(exceptionCallback);
+    resultCallback = [cancellation, binding, onResult](
+                         const Json::Value &result) {
+        if (!binding->done.exchange(true))
+        {
+            cancellation->removeCallback(binding->callbackId);
+            onResult(result);
+        }
+    };
+    exceptionCallback = [cancellation, binding, onError](
+                            const ElasticSearchException &err) {
+        if (!binding->done.exchange(true))
+        {
+            cancellation->removeCallback(binding->callbackId);
+            onError(err);
+        }
+    };
+    binding->callbackId = cancellation->onCancel([binding, onError]() {
+        if (!binding->done.exchange(true))
+        {
+            onError(ElasticSearchException("request cancelled!"));
+        }
+    });
+}
+
+void HttpClient::recordMetrics(const HttpClientSettings &settings,
+                               RequestOptions &options,
+                               size_t bytesSent) const
+{
+    if (!settings.metrics)
+    {
+        options.series = nullptr;
+        return;
+    }
+    // the registry owns the series, the handlers of the request keep it
+    // alive
+    if (!options.series)
+    {
+        options.series = &metrics_->series(options.operation, options.index);
+    }
+    options.started = chrono::steady_clock::now();
+    auto &series = *options.series;
+    series.requests.fetch_add(1, memory_order_relaxed);
+    series.inFlight.fetch_add(1, memory_order_relaxed);
+    series.bytesSent.fetch_add(bytesSent, memory_order_relaxed);
+}
+
+void HttpClient::recordCompletion(const RequestOptions &options, bool failed)
+{
+    auto series = options.series;
+    if (!series)
+    {
+        return;
+    }
+    series->latency.record(chrono::steady_clock::now() - options.started);
+    series->inFlight.fetch_sub(1, memory_order_relaxed);
+    if (failed)
+    {
+        series->errors.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+// styled JSON without its line breaks and indentation
+static string compactBody(const string &body, size_t maxBytes, bool &truncated)
+{
+    string result;
+    result.reserve(min(body.size(), maxBytes));
+    truncated = false;
+    for (size_t i = 0; i < body.size(); ++i)
+    {
+        if (body[i] == '\n')
+        {
+            while (i + 1 < body.size() &&
+                   (body[i + 1] == ' ' || body[i + 1] == '\t'))
             {
-                pro->set_exception(std::current_exception());
+                ++i;
             }
-        },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(std::make_exception_ptr(err));
-        },
-        requestBody);
-    return f.get();
+            continue;
+        }
+        if (result.size() >= maxBytes)
+        {
+            truncated = true;
+            break;
+        }
+        result += body[i];
+    }
+    return result;
 }
 
-void HttpClient::sendRequest(
+/// Adds the shape of the search to the fingerprint of the record, or its
+/// bytes if it is not JSON.
+static void addSearchFingerprint(SlowLogRecord &record,
+                                 const shared_ptr<const string> &body)
+{
+    if (!body)
+    {
+        return;
+    }
+    static const Json::CharReaderBuilder builder;
+    unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value json;
+    if (!reader->parse(
+            body->data(), body->data() + body->size(), &json, nullptr))
+    {
+        record.fingerprint =
+            record.fingerprint * 31 + hash<string_view>()(*body);
+        return;
+    }
+    record.fingerprint = record.fingerprint * 31 + fingerprint(json).shape.low;
+}
+
+void HttpClient::watchSlowRequest(
+    const SlowLogPtr &slowLog,
+    const RequestOptions &options,
+    const std::string &requestBody,
+    std::function<void(const Json::Value &)> &resultCallback,
+    std::function<void(const ElasticSearchException &)> &exceptionCallback)
+{
+    // filled now, copied into a record only if the request is slow
+    auto request = make_shared<SlowLogRecord>();
+    request->operation = options.operation;
+    request->index = options.index;
+    request->fingerprint = hash<string_view>()(options.operation) * 31 +
+                           hash<string_view>()(options.index);
+    // a search is parsed only if its record is written
+    shared_ptr<const string> searchBody;
+    if (options.searchBody)
+    {
+        searchBody = make_shared<const string>(requestBody);
+    }
+    else
+    {
+        request->fingerprint =
+            request->fingerprint * 31 + hash<string_view>()(requestBody);
+    }
+    request->body = compactBody(requestBody,
+                                slowLog->config().maxBodyBytes,
+                                request->bodyTruncated);
+    request->timing = options.timing;
+
+    auto startTime = chrono::steady_clock::now();
+    auto onResult = std::move(resultCallback);
+    auto onError = std::move(exceptionCallback);
+    // the latency is taken before the callbacks of the user, the record is
+    // written after them so that the timing has its decode phase
+    resultCallback = [slowLog, request, searchBody, startTime, onResult](
+                         const Json::Value &result) {
+        auto latency = chrono::steady_clock::now() - startTime;
+        onResult(result);
+        if (!slowLog->isSlow(latency) || !slowLog->admit())
+        {
+            return;
+        }
+        auto record = *request;
+        record.latency = latency;
+        addSearchFingerprint(record, searchBody);
+        if (result.isObject())
+        {
+            const auto &took = result["took"];
+            record.tookMs = took.isIntegral() ? took.asInt64() : -1;
+            const auto &shards = result["_shards"];
+            if (shards.isObject() && shards["failed"].isIntegral())
+            {
+                record.shardFailures = shards["failed"].asInt64();
+            }
+        }
+        slowLog->write(std::move(record));
+    };
+    exceptionCallback = [slowLog, request, searchBody, startTime, onError](
+                            const ElasticSearchException &err) {
+        auto latency = chrono::steady_clock::now() - startTime;
+        onError(err);
+        if (!slowLog->isSlow(latency) || !slowLog->admit())
+        {
+            return;
+        }
+        auto record = *request;
+        record.latency = latency;
+        addSearchFingerprint(record, searchBody);
+        record.error = err.what();
+        slowLog->write(std::move(record));
+    };
+}
+
+static string methodName(drogon::HttpMethod method)
+{
+    switch (method)
+    {
+        case drogon::Get:
+            return "GET";
+        case drogon::Post:
+            return "POST";
+        case drogon::Head:
+            return "HEAD";
+        case drogon::Put:
+            return "PUT";
+        case drogon::Delete:
+            return "DELETE";
+        case drogon::Options:
+            return "OPTIONS";
+        case drogon::Patch:
+            return "PATCH";
+        default:
+            return "INVALID";
+    }
+}
+
+void HttpClient::captureTraffic(
+    const TrafficRecorderPtr &recorder,
+    const std::string &path,
+    drogon::HttpMethod method,
+    const std::string &requestBody,
+    RequestOptions &options,
+    std::function<void(const Json::Value &)> &resultCallback,
+    std::function<void(const ElasticSearchException &)> &exceptionCallback)
+{
+    auto record = make_shared<TrafficRecord>();
+    record->timestampUs = chrono::duration_cast<chrono::microseconds>(
+                              chrono::system_clock::now().time_since_epoch())
+                              .count();
+    record->method = methodName(method);
+    record->operation = options.operation;
+    record->index = options.index;
+    record->path = path;
+    record->requestBody = requestBody;
+    options.capture = record;
+
+    // the record is written after the callbacks of the user, its latency is
+    // taken before them
+    auto startTime = chrono::steady_clock::now();
+    auto setLatency = [record, startTime]() {
+        auto latency = chrono::duration_cast<chrono::microseconds>(
+                           chrono::steady_clock::now() - startTime)
+                           .count();
+        record->latencyUs =
+            static_cast<uint32_t>(min<int64_t>(latency, UINT32_MAX));
+    };
+    auto onResult = std::move(resultCallback);
+    auto onError = std::move(exceptionCallback);
+    resultCallback = [recorder, record, setLatency, onResult](
+                         const Json::Value &result) {
+        setLatency();
+        onResult(result);
+        recorder->write(*record);
+    };
+    exceptionCallback = [recorder, record, setLatency, onError](
+                            const ElasticSearchException &err) {
+        setLatency();
+        onError(err);
+        recorder->write(*record);
+    };
+}
+
+void HttpClient::recordReceived(const RequestOptions &options,
+                                const drogon::HttpResponsePtr &response)
+{
+    if (response && options.series)
+    {
+        options.series->bytesReceived.fetch_add(response->getBody().size(),
+                                                memory_order_relaxed);
+    }
+}
+
+void HttpClient::markSent(const RequestOptions &options)
+{
+    if (const auto &span = options.span)
+    {
+        span->attempts.fetch_add(1, memory_order_relaxed);
+    }
+    const auto &timing = options.timing;
+    if (!timing)
+    {
+        return;
+    }
+    auto now = chrono::steady_clock::now();
+    RequestTiming::TimePoint::rep unset = 0;
+    if (timing->sent_.compare_exchange_strong(unset,
+                                              now.time_since_epoch().count()))
+    {
+        timing->queue = now - timing->enqueued_;
+    }
+}
+
+void HttpClient::markReceived(const RequestOptions &options,
+                              const NodePtr &node,
+                              const drogon::HttpResponsePtr &response)
+{
+    if (const auto &span = options.span)
+    {
+        span->node = node->url();
+        if (response)
+        {
+            span->status = response->statusCode();
+            span->bytesReceived = response->getBody().size();
+        }
+    }
+    if (const auto &capture = options.capture; capture && response)
+    {
+        capture->status = static_cast<uint16_t>(response->statusCode());
+        capture->responseBody = string(response->getBody());
+    }
+    const auto &timing = options.timing;
+    if (!timing)
+    {
+        return;
+    }
+    timing->received_ = chrono::steady_clock::now();
+    RequestTiming::TimePoint sent(
+        RequestTiming::Duration(timing->sent_.load()));
+    timing->network = timing->received_ -
+                      (sent != RequestTiming::TimePoint() ? sent
+                                                          : timing->enqueued_);
+    // parsing the body belongs to the decode phase
+    const auto &json = response ? response->getJsonObject() : nullptr;
+    if (json && (*json)["took"].isIntegral())
+    {
+        timing->took = chrono::milliseconds((*json)["took"].asInt64());
+    }
+}
+
+void HttpClient::traceRequest(
+    const TracerPtr &tracer,
+    RequestOptions &options,
+    size_t bytesSent,
+    std::function<void(const Json::Value &)> &resultCallback,
+    std::function<void(const ElasticSearchException &)> &exceptionCallback)
+{
+    auto span = tracer->startSpan(options.operation, options.index);
+    if (!span)
+    {
+        return;
+    }
+    span->start = chrono::steady_clock::now();
+    span->bytesSent = bytesSent;
+    options.span = span;
+
+    auto onResult = std::move(resultCallback);
+    auto onError = std::move(exceptionCallback);
+    resultCallback = [tracer, span, onResult](const Json::Value &result) {
+        span->end = chrono::steady_clock::now();
+        tracer->endSpan(span);
+        onResult(result);
+    };
+    exceptionCallback = [tracer, span, onError](
+                            const ElasticSearchException &err) {
+        span->end = chrono::steady_clock::now();
+        span->error = err.what();
+        tracer->endSpan(span);
+        onError(err);
+    };
+}
+
+bool HttpClient::isCancelled(const RequestOptions &options)
+{
+    return options.cancellation && options.cancellation->isCancelled();
+}
+
+void HttpClient::startRequest(
+    const HttpClientSettings &settings,
     const std::string &path,
     drogon::HttpMethod method,
+    std::string &&requestBody,
     const std::function<void(const Json::Value &)> &resultCallback,
     const std::function<void(const ElasticSearchException &)>
         &exceptionCallback,
-    const Json::Value &requestBody)
+    const RequestOptions &options)
+{
+    // dropped, the callbacks have been told by the cancellation
+    if (isCancelled(options))
+    {
+        recordCompletion(options, true);
+        return;
+    }
+
+    auto node = nodePool_->select();
+    if (!node)
+    {
+        recordCompletion(options, true);
+        exceptionCallback(ElasticSearchException(
+            "failed while sending request to server! The circuits of all "
+            "nodes are open."));
+        return;
+    }
+
+    if (settings.hedge && options.readOnly)
+    {
+        sendHedged(settings.hedge,
+                   node,
+                   path,
+                   method,
+                   std::move(requestBody),
+                   std::move(resultCallback),
+                   std::move(exceptionCallback),
+                   options);
+        return;
+    }
+
+    if (!dispatch(node,
+                  newRequest(path, method, requestBody, options),
+                  options,
+                  [resultCallback = std::move(resultCallback),
+                   exceptionCallback = std::move(exceptionCallback),
+                   options,
+                   metrics = metrics_](
+                      const NodePtr &node,
+                      drogon::ReqResult result,
+                      const drogon::HttpResponsePtr &response) {
+                      recordReceived(options, response);
+                      // detached, the response is not even decoded
+                      if (isCancelled(options))
+                      {
+                          recordCompletion(options, true);
+                          return;
+                      }
+                      recordCompletion(options, isFailure(result, response));
+                      markReceived(options, node, response);
+                      handleResponse(node,
+                                     result,
+                                     response,
+                                     resultCallback,
+                                     exceptionCallback);
+                  }))
+    {
+        node->breaker().onAbandon();
+        recordCompletion(options, true);
+        exceptionCallback(rejectedException(node));
+    }
+}
+
+ElasticSearchException HttpClient::rejectedException(const NodePtr &node)
+{
+    string errorMessage = "too many requests queued for node! url: [";
+    errorMessage += node->url();
+    errorMessage += "].";
+    LOG_WARN << errorMessage;
+    return ElasticSearchException(errorMessage);
+}
+
+drogon::HttpRequestPtr HttpClient::newRequest(const std::string &path,
+                                              drogon::HttpMethod method,
+                                              const std::string &requestBody,
+                                              const RequestOptions &options)
 {
     auto req = drogon::HttpRequest::newHttpRequest();
     req->setMethod(method);
     req->setPath(path);
     req->setContentTypeCode(drogon::CT_APPLICATION_JSON);
-    req->setBody(requestBody.toStyledString());
+    req->setBody(requestBody);
+    if (options.span && !options.span->requestId.empty())
+    {
+        req->addHeader("X-Opaque-Id", options.span->requestId);
+    }
+    return req;
+}
 
-    auto client = drogon::HttpClient::newHttpClient(url_);
-    client->sendRequest(
-        req,
-        [this,
-         resultCallback = std::move(resultCallback),
-         exceptionCallback = std::move(exceptionCallback)](
-            drogon::ReqResult result, const drogon::HttpResponsePtr &response) {
-            if (result != drogon::ReqResult::Ok)
-            {
-                string errorMessage =
-                    "failed while sending request to server! url: [";
-                errorMessage += url_;
-                errorMessage += "], result: [";
-                errorMessage += to_string(result);
-                errorMessage += "].";
-
-                LOG_WARN << errorMessage;
-                exceptionCallback(ElasticSearchException(errorMessage));
-            }
-            else
+trantor::EventLoop *HttpClient::loopOf(const RequestOptions &options)
+{
+    return options.loop ? options.loop : drogon::app().getLoop();
+}
+
+bool HttpClient::dispatch(const NodePtr &node,
+                          const drogon::HttpRequestPtr &req,
+                          const RequestOptions &options,
+                          const ResponseHandler &handler)
+{
+    const auto &limiter = node->limiter();
+    if (!limiter)
+    {
+        markSent(options);
+        send(node, req, options.loop, handler);
+        return true;
+    }
+    return limiter->enqueue(
+        [node, req, options, handler]() {
+            // the handler drops it, as it would drop its response
+            if (isCancelled(options))
             {
-                auto responseBody = response->getJsonObject();
-                LOG_TRACE << responseBody->toStyledString();
-                resultCallback(*responseBody);
+                node->breaker().onAbandon();
+                releasePermit(node, {}, LimiterSignal::IGNORED);
+                handler(node, drogon::ReqResult::NetworkFailure, nullptr);
+                return;
             }
+            markSent(options);
+            send(node, req, options.loop, handler);
         },
-        5);
+        options.priority,
+        options.cancellation,
+        [node, handler]() {
+            node->breaker().onAbandon();
+            handler(node, drogon::ReqResult::NetworkFailure, nullptr);
+        });
 }
 
-Json::Value HttpClient::sendRequest(const std::string &path,
-                                    drogon::HttpMethod method,
-                                    const std::vector<Json::Value> &requestBody)
+void HttpClient::send(const NodePtr &node,
+                      const drogon::HttpRequestPtr &req,
+                      trantor::EventLoop *loop,
+                      const ResponseHandler &handler)
 {
-    unique_ptr<promise<Json::Value>> pro(new promise<Json::Value>);
-    auto f = pro->get_future();
-    this->sendRequest(
-        path,
-        method,
-        [&pro](const Json::Value &response) {
-            try
-            {
-                pro->set_value(response);
-            }
-            catch (...)
+    auto startTime = chrono::steady_clock::now();
+    node->onRequestStart();
+
+    auto client = drogon::HttpClient::newHttpClient(node->url(), loop);
+    client->sendRequest(
+        req,
+        [node, startTime, handler](drogon::ReqResult result,
+                                   const drogon::HttpResponsePtr &response) {
+            auto latency = chrono::steady_clock::now() - startTime;
+            if (node->onRequestFinish(latency,
+                                      isNodeHealthy(result, response)))
             {
-                pro->set_exception(std::current_exception());
+                LOG_WARN << "circuit of node [" << node->url() << "] is open";
+                scheduleProbe(node);
             }
+            releasePermit(node, latency, limiterSignal(result, response));
+            handler(node, result, response);
         },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(std::make_exception_ptr(err));
-        },
-        requestBody);
-    return f.get();
+        5);
 }
 
-void HttpClient::sendRequest(
+void HttpClient::releasePermit(const NodePtr &node,
+                               chrono::steady_clock::duration latency,
+                               LimiterSignal signal)
+{
+    if (const auto &limiter = node->limiter())
+    {
+        for (auto &task : limiter->release(latency, signal))
+        {
+            task();
+        }
+    }
+}
+
+LimiterSignal HttpClient::limiterSignal(
+    drogon::ReqResult result,
+    const drogon::HttpResponsePtr &response)
+{
+    if (result == drogon::ReqResult::Timeout)
+    {
+        return LimiterSignal::DROPPED;
+    }
+    if (result != drogon::ReqResult::Ok)
+    {
+        return LimiterSignal::IGNORED;
+    }
+    auto status = response->statusCode();
+    if (status == drogon::k429TooManyRequests ||
+        status == drogon::k503ServiceUnavailable)
+    {
+        return LimiterSignal::DROPPED;
+    }
+    return LimiterSignal::SUCCESS;
+}
+
+void HttpClient::handleResponse(
+    const NodePtr &node,
+    drogon::ReqResult result,
+    const drogon::HttpResponsePtr &response,
+    const std::function<void(const Json::Value &)> &resultCallback,
+    const std::function<void(const ElasticSearchException &)>
+        &exceptionCallback)
+{
+    if (result != drogon::ReqResult::Ok)
+    {
+        string errorMessage = "failed while sending request to server! url: [";
+        errorMessage += node->url();
+        errorMessage += "], result: [";
+        errorMessage += to_string(result);
+        errorMessage += "].";
+
+        LOG_WARN << errorMessage;
+        exceptionCallback(ElasticSearchException(errorMessage));
+    }
+    else if (!response->getJsonObject())
+    {
+        string errorMessage = "invalid response body from server! url: [";
+        errorMessage += node->url();
+        errorMessage += "], status: [";
+        errorMessage += std::to_string(response->statusCode());
+        errorMessage += "].";
+
+        LOG_WARN << errorMessage;
+        exceptionCallback(ElasticSearchException(errorMessage));
+    }
+    else
+    {
+        auto responseBody = response->getJsonObject();
+        LOG_TRACE << responseBody->toStyledString();
+        resultCallback(*responseBody);
+    }
+}
+
+void HttpClient::sendHedged(
+    const HedgeControllerPtr &hedge,
+    const NodePtr &node,
     const std::string &path,
     drogon::HttpMethod method,
+    std::string &&requestBody,
     const std::function<void(const Json::Value &)> &resultCallback,
     const std::function<void(const ElasticSearchException &)>
         &exceptionCallback,
-    const std::vector<Json::Value> &requestBody)
+    const RequestOptions &options)
 {
-    auto req = drogon::HttpRequest::newHttpRequest();
-    req->setMethod(method);
-    req->setPath(path);
-    req->setContentTypeCode(drogon::CT_APPLICATION_JSON);
-    std::string requestBodyStr;
-    for (const auto &item : requestBody)
+    struct HedgeState
+    {
+        std::mutex mutex;
+        bool done = false;
+        int pending = 1;
+    };
+
+    auto state = make_shared<HedgeState>();
+    auto startTime = chrono::steady_clock::now();
+    hedge->onRequest();
+
+    // The first successful answer wins, a failure is only reported once no
+    // other attempt is pending. The loser is ignored.
+    auto onResponse = [state,
+                       hedge,
+                       startTime,
+                       resultCallback = std::move(resultCallback),
+                       exceptionCallback = std::move(exceptionCallback),
+                       options,
+                       metrics = metrics_](
+                          bool byHedge,
+                          const NodePtr &node,
+                          drogon::ReqResult result,
+                          const drogon::HttpResponsePtr &response) {
+        recordReceived(options, response);
+        bool cancelled = isCancelled(options);
+        bool failed = cancelled || isFailure(result, response);
+        {
+            lock_guard<mutex> lock(state->mutex);
+            if (state->done)
+            {
+                return;
+            }
+            --state->pending;
+            if (failed && state->pending > 0)
+            {
+                return;
+            }
+            state->done = true;
+        }
+        recordCompletion(options, failed);
+        if (cancelled)
+        {
+            return;
+        }
+        markReceived(options, node, response);
+        if (!failed)
+        {
+            hedge->onResponse(chrono::steady_clock::now() - startTime,
+                              byHedge);
+        }
+        handleResponse(
+            node, result, response, resultCallback, exceptionCallback);
+    };
+
+    auto body = make_shared<const string>(std::move(requestBody));
+    if (!dispatch(node,
+                  newRequest(path, method, *body, options),
+                  options,
+                  [onResponse](const NodePtr &node,
+                               drogon::ReqResult result,
+                               const drogon::HttpResponsePtr &response) {
+                      onResponse(false, node, result, response);
+                  }))
     {
-        requestBodyStr += item.toStyledString();
+        node->breaker().onAbandon();
+        recordCompletion(options, true);
+        exceptionCallback(rejectedException(node));
+        return;
     }
-    req->setBody(requestBodyStr);
 
-    auto client = drogon::HttpClient::newHttpClient(url_);
-    client->sendRequest(
-        req,
-        [this,
-         resultCallback = std::move(resultCallback),
-         exceptionCallback = std::move(exceptionCallback)](
-            drogon::ReqResult result, const drogon::HttpResponsePtr &response) {
-            if (result != drogon::ReqResult::Ok)
+    auto pool = nodePool_;
+    loopOf(options)->runAfter(
+        hedge->delay(),
+        [state, hedge, pool, node, path, method, body, options, onResponse]() {
+            if (isCancelled(options))
             {
-                string errorMessage =
-                    "failed while sending request to server! url: [";
-                errorMessage += url_;
-                errorMessage += "], result: [";
-                errorMessage += to_string(result);
-                errorMessage += "].";
-
-                LOG_WARN << errorMessage;
-                exceptionCallback(ElasticSearchException(errorMessage));
+                return;
             }
-            else
             {
-                auto responseBody = response->getJsonObject();
-                LOG_TRACE << responseBody->toStyledString();
-                resultCallback(*responseBody);
+                lock_guard<mutex> lock(state->mutex);
+                if (state->done)
+                {
+                    return;
+                }
             }
-        },
-        5);
+            auto other = pool->select(node);
+            if (!other)
+            {
+                return;
+            }
+            // a duplicate is never queued, it needs spare capacity right now
+            const auto &limiter = other->limiter();
+            if (limiter && !limiter->tryAcquire(options.priority))
+            {
+                other->breaker().onAbandon();
+                return;
+            }
+            bool sending = hedge->tryAcquire();
+            if (sending)
+            {
+                lock_guard<mutex> lock(state->mutex);
+                sending = !state->done;
+                if (sending)
+                {
+                    ++state->pending;
+                }
+            }
+            if (!sending)
+            {
+                other->breaker().onAbandon();
+                releasePermit(other, {}, LimiterSignal::IGNORED);
+                return;
+            }
+            markSent(options);
+            send(other,
+                 newRequest(path, method, *body, options),
+                 options.loop,
+                 [onResponse](const NodePtr &node,
+                              drogon::ReqResult result,
+                              const drogon::HttpResponsePtr &response) {
+                     onResponse(true, node, result, response);
+                 });
+        });
+}
+
+bool HttpClient::isFailure(drogon::ReqResult result,
+                           const drogon::HttpResponsePtr &response)
+{
+    return result != drogon::ReqResult::Ok || !response->getJsonObject();
+}
+
+bool HttpClient::isNodeHealthy(drogon::ReqResult result,
+                               const drogon::HttpResponsePtr &response)
+{
+    if (result != drogon::ReqResult::Ok)
+    {
+        return false;
+    }
+    // errors of the request itself (4xx, 500) say nothing about the node
+    auto status = response->statusCode();
+    return status != drogon::k502BadGateway &&
+           status != drogon::k503ServiceUnavailable &&
+           status != drogon::k504GatewayTimeout;
+}
+
+void HttpClient::scheduleProbe(const NodePtr &node)
+{
+    std::weak_ptr<Node> weakNode = node;
+    drogon::app().getLoop()->runAfter(
+        node->breaker().config().probeInterval, [weakNode]() {
+            auto node = weakNode.lock();
+            // the node has been removed by sniffing
+            if (!node || node->breaker().state() != CircuitState::OPEN)
+            {
+                return;
+            }
+            auto req = drogon::HttpRequest::newHttpRequest();
+            req->setMethod(drogon::Head);
+            req->setPath("/");
+            auto client = drogon::HttpClient::newHttpClient(node->url());
+            client->sendRequest(
+                req,
+                [node](drogon::ReqResult result,
+                       const drogon::HttpResponsePtr &response) {
+                    bool healthy = isNodeHealthy(result, response);
+                    node->breaker().onProbe(healthy);
+                    if (healthy)
+                    {
+                        LOG_INFO << "circuit of node [" << node->url()
+                                 << "] is half open";
+                    }
+                    else
+                    {
+                        scheduleProbe(node);
+                    }
+                },
+                node->breaker().config().probeInterval);
+        });
 }
@@ -7,20 +7,69 @@
 #pragma once
 
 #include "ElasticSearchException.h"
+#include "Hedging.h"
+#include "Metrics.h"
+#include "NodePool.h"
+#include "RateLimiter.h"
+#include "RequestOptions.h"
+#include "SlowLog.h"
+#include "SyncCaller.h"
 #include <drogon/HttpClient.h>
 #include <json/json.h>
+#include <trantor/net/EventLoopThreadPool.h>
 #include <memory>
+#include <mutex>
 
 namespace tl::elasticsearch
 {
 
-class HttpClient
+/// Settings of HttpClient read by every request. The setters replace them
+/// as a whole, a request reads them once so that it sees them all from the
+/// same point in time.
+class HttpClientSettings
 {
   public:
-    HttpClient(std::string url) : url_(url)
+    HedgeControllerPtr hedge;
+    RateLimiterPtr rateLimiter;
+    std::shared_ptr<trantor::EventLoopThreadPool> loopPool;
+    bool metrics = true;
+    bool timing = false;
+    SlowLogPtr slowLog;
+    TracerPtr tracer;
+    TrafficRecorderPtr recorder;
+};
+
+using HttpClientSettingsPtr = std::shared_ptr<const HttpClientSettings>;
+
+class HttpClient : public std::enable_shared_from_this<HttpClient>
+{
+  public:
+    HttpClient(std::string url)
+        : nodePool_(std::make_shared<NodePool>(std::vector<std::string>{ url }))
     {
+        registerNodeGauges();
     }
 
+    HttpClient(const std::vector<std::string> &urls,
+               NodeSelectorPtr selector = nullptr,
+               const NodeConfig &nodeConfig = NodeConfig())
+        : nodePool_(std::make_shared<NodePool>(urls, selector, nodeConfig))
+    {
+        registerNodeGauges();
+    }
+
+    /// The copy shares the nodes and the metrics, its settings are its own.
+    HttpClient(const HttpClient &other)
+        : std::enable_shared_from_this<HttpClient>(),
+          nodePool_(other.nodePool_),
+          syncCaller_(other.syncCaller_),
+          metrics_(other.metrics_),
+          settings_(other.settings())
+    {
+    }
+
+    HttpClient &operator=(const HttpClient &) = delete;
+
   public:
     Json::Value sendRequest(
         const std::string &path,
@@ -33,7 +82,8 @@ class HttpClient
         const std::function<void(const Json::Value &)> &resultCallback,
         const std::function<void(const ElasticSearchException &)>
             &exceptionCallback,
-        const Json::Value &requestBody = Json::Value(Json::objectValue));
+        const Json::Value &requestBody = Json::Value(Json::objectValue),
+        const RequestOptions &options = RequestOptions());
 
     // _bulk
     Json::Value sendRequest(const std::string &path,
@@ -46,10 +96,372 @@ class HttpClient
         const std::function<void(const Json::Value &)> &resultCallback,
         const std::function<void(const ElasticSearchException &)>
             &exceptionCallback,
-        const std::vector<Json::Value> &requestBody);
+        const std::vector<Json::Value> &requestBody,
+        const RequestOptions &options = RequestOptions(Priority::BACKGROUND));
+
+    /// Sends a body which is already serialized, e.g. a captured one.
+    void sendRawRequest(
+        const std::string &path,
+        drogon::HttpMethod method,
+        const std::function<void(const Json::Value &)> &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        std::string requestBody,
+        const RequestOptions &options = RequestOptions());
+
+  public:
+    /// Body of a _bulk request made of its action and source lines.
+    static std::string bulkBody(const std::vector<Json::Value> &lines);
+
+  public:
+    NodePoolPtr nodePool() const
+    {
+        return nodePool_;
+    }
+
+    /// Per-node in-flight requests and latency, for checking load spreading.
+    std::vector<NodeStats> nodeStats() const
+    {
+        return nodePool_->stats();
+    }
+
+    /// Enables hedging of read-only requests: if no response arrives within
+    /// the delay, a duplicate is sent to another node and the first answer
+    /// wins.
+    void setHedgePolicy(const HedgePolicy &policy)
+    {
+        auto hedge = std::make_shared<HedgeController>(policy);
+        updateSettings([&hedge](HttpClientSettings &settings) {
+            settings.hedge = std::move(hedge);
+        });
+    }
+
+    /// Zero if hedging is disabled.
+    HedgeStats hedgeStats() const
+    {
+        auto hedge = settings()->hedge;
+        return hedge ? hedge->stats() : HedgeStats();
+    }
+
+    /// Limits the ingestion requests (index and bulk) to a number of
+    /// documents or bytes per second. Requests over the limit are delayed
+    /// on the event loop, no thread is blocked. nullptr removes the limit.
+    /// A delayed request needs the client to be owned by a shared_ptr, it
+    /// fails if the client is gone when the delay ends.
+    void setRateLimiter(const RateLimiterPtr &rateLimiter)
+    {
+        updateSettings([&rateLimiter](HttpClientSettings &settings) {
+            settings.rateLimiter = rateLimiter;
+        });
+    }
+
+    RateLimiterPtr rateLimiter() const
+    {
+        return settings()->rateLimiter;
+    }
+
+    /// Runs the transport and the decoding of the responses on the loops of
+    /// this pool instead of the main loop of drogon. nullptr disables it.
+    /// The requests keep the pool alive until they complete, the caller may
+    /// release it while some are in flight.
+    void setLoopPool(
+        const std::shared_ptr<trantor::EventLoopThreadPool> &loopPool);
+
+    /// Wraps a callback of the user so that it runs on the loop of the
+    /// caller when the request is handled by the loop pool.
+    template <typename Arg>
+    std::function<void(const Arg &)> toCallerLoop(
+        const std::function<void(const Arg &)> &callback) const
+    {
+        auto loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+        // a synchronous caller blocks its loop, it must not get the result
+        if (!settings()->loopPool || !loop || SyncCaller::transportLoop())
+        {
+            return callback;
+        }
+        return [loop, callback](const Arg &arg) {
+            if (loop->isInLoopThread())
+            {
+                callback(arg);
+            }
+            else
+            {
+                loop->queueInLoop([callback, arg]() { callback(arg); });
+            }
+        };
+    }
+
+    /// Runs a synchronous call on top of an asynchronous one, see
+    /// SyncPolicy for calls made on an event loop thread.
+    template <typename Tp>
+    Tp waitFor(const SyncCaller::Start<Tp> &start) const
+    {
+        return syncCaller_->call<Tp>(start);
+    }
+
+    void setSyncPolicy(const SyncPolicy &policy)
+    {
+        syncCaller_->setPolicy(policy);
+    }
+
+    /// Threads blocked in synchronous calls and calls refused.
+    SyncStats syncStats() const
+    {
+        return syncCaller_->stats();
+    }
+
+    /// Logs the requests slower than the threshold of the log, nullptr
+    /// disables it.
+    void setSlowLog(const SlowLogPtr &slowLog)
+    {
+        updateSettings([&slowLog](HttpClientSettings &settings) {
+            settings.slowLog = slowLog;
+        });
+    }
+
+    SlowLogPtr slowLog() const
+    {
+        return settings()->slowLog;
+    }
+
+    /// Opens a span per request and sends its id as X-Opaque-Id. nullptr,
+    /// the default, disables tracing.
+    void setTracer(const TracerPtr &tracer)
+    {
+        updateSettings([&tracer](HttpClientSettings &settings) {
+            settings.tracer = tracer;
+        });
+    }
+
+    TracerPtr tracer() const
+    {
+        return settings()->tracer;
+    }
+
+    /// Writes every request and its response to the recorder, for replaying
+    /// them later (see TrafficReplayer). nullptr, the default, disables the
+    /// capture.
+    void setRecorder(const TrafficRecorderPtr &recorder)
+    {
+        updateSettings([&recorder](HttpClientSettings &settings) {
+            settings.recorder = recorder;
+        });
+    }
+
+    TrafficRecorderPtr recorder() const
+    {
+        return settings()->recorder;
+    }
+
+    /// Attaches a RequestTiming to the responses of the clients, see also
+    /// TimingSummary.
+    void setRequestTiming(bool enabled)
+    {
+        updateSettings([enabled](HttpClientSettings &settings) {
+            settings.timing = enabled;
+        });
+    }
+
+    /// A timing for a new request, nullptr if timing is disabled.
+    RequestTimingPtr newTiming() const
+    {
+        return settings()->timing ? std::make_shared<RequestTiming>()
+                                  : nullptr;
+    }
+
+    /// Requests, errors, bytes and latency per operation and index, and
+    /// the in-flight requests, concurrency limit and queue of each node.
+    MetricsRegistryPtr metrics() const
+    {
+        return metrics_;
+    }
+
+    /// Enabled by default, disabled requests are not recorded in metrics().
+    void setMetricsEnabled(bool enabled)
+    {
+        updateSettings([enabled](HttpClientSettings &settings) {
+            settings.metrics = enabled;
+        });
+    }
+
+    /// The settings as of now, they may be changed at any time.
+    HttpClientSettingsPtr settings() const
+    {
+        std::lock_guard<std::mutex> lock(settingsMutex_);
+        return settings_;
+    }
+
+  private:
+    /// Exports the state of the nodes as gauges of metrics().
+    void registerNodeGauges();
+
+    /// Replaces the settings by a changed copy.
+    template <typename Update>
+    void updateSettings(Update &&update)
+    {
+        std::lock_guard<std::mutex> lock(settingsMutex_);
+        auto settings = std::make_shared<HttpClientSettings>(*settings_);
+        update(*settings);
+        settings_ = std::move(settings);
+    }
+
+    using ResponseHandler =
+        std::function<void(const NodePtr &,
+                            drogon::ReqResult,
+                            const drogon::HttpResponsePtr &)>;
+
+    void doSendRequest(
+        const std::string &path,
+        drogon::HttpMethod method,
+        std::string &&requestBody,
+        const std::function<void(const Json::Value &)> &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const RequestOptions &options);
+
+    /// Makes the callbacks fire once, on the response or on the
+    /// cancellation, whichever comes first.
+    static void bindCancellation(
+        const CancellationTokenPtr &cancellation,
+        std::function<void(const Json::Value &)> &resultCallback,
+        std::function<void(const ElasticSearchException &)>
+            &exceptionCallback);
+
+    static bool isCancelled(const RequestOptions &options);
+
+    /// Resolves the series of the request and counts it.
+    void recordMetrics(const HttpClientSettings &settings,
+                       RequestOptions &options,
+                       size_t bytesSent) const;
+
+    /// The transport is done with the request: its latency and outcome.
+    /// Called once per request, on the response, the rejection or the
+    /// cancellation.
+    static void recordCompletion(const RequestOptions &options, bool failed);
+
+    /// An attempt leaves the queue, the first one ends the queue phase.
+    static void markSent(const RequestOptions &options);
+
+    /// The winning response arrived, decoding starts.
+    static void markReceived(const RequestOptions &options,
+                             const NodePtr &node,
+                             const drogon::HttpResponsePtr &response);
+
+    /// Opens the span of the request and wraps the callbacks so that they
+    /// end it.
+    static void traceRequest(
+        const TracerPtr &tracer,
+        RequestOptions &options,
+        size_t bytesSent,
+        std::function<void(const Json::Value &)> &resultCallback,
+        std::function<void(const ElasticSearchException &)>
+            &exceptionCallback);
+
+    /// Fills the capture of the request and wraps the callbacks so that
+    /// they write it to the recorder.
+    static void captureTraffic(
+        const TrafficRecorderPtr &recorder,
+        const std::string &path,
+        drogon::HttpMethod method,
+        const std::string &requestBody,
+        RequestOptions &options,
+        std::function<void(const Json::Value &)> &resultCallback,
+        std::function<void(const ElasticSearchException &)>
+            &exceptionCallback);
+
+    /// Wraps the callbacks so that a slow request is written to the slow
+    /// log.
+    static void watchSlowRequest(
+        const SlowLogPtr &slowLog,
+        const RequestOptions &options,
+        const std::string &requestBody,
+        std::function<void(const Json::Value &)> &resultCallback,
+        std::function<void(const ElasticSearchException &)>
+            &exceptionCallback);
+
+    static void recordReceived(const RequestOptions &options,
+                               const drogon::HttpResponsePtr &response);
+
+    /// Second half of doSendRequest, once the rate limit allows the request.
+    void startRequest(
+        const HttpClientSettings &settings,
+        const std::string &path,
+        drogon::HttpMethod method,
+        std::string &&requestBody,
+        const std::function<void(const Json::Value &)> &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const RequestOptions &options);
+
+    /// Number of documents in the lines of a _bulk request.
+    static size_t countBulkDocuments(const std::vector<Json::Value> &lines);
+
+    static drogon::HttpRequestPtr newRequest(const std::string &path,
+                                             drogon::HttpMethod method,
+                                             const std::string &requestBody,
+                                             const RequestOptions &options);
+
+    /// Sends the request to the node once the concurrency limit of the node
+    /// allows it. Returns false if the queue of the node is full.
+    static bool dispatch(const NodePtr &node,
+                         const drogon::HttpRequestPtr &req,
+                         const RequestOptions &options,
+                         const ResponseHandler &handler);
+
+    /// Sends the request right now and keeps the statistics of the node.
+    static void send(const NodePtr &node,
+                     const drogon::HttpRequestPtr &req,
+                     trantor::EventLoop *loop,
+                     const ResponseHandler &handler);
+
+    /// The loop of the request, the main loop of drogon by default.
+    static trantor::EventLoop *loopOf(const RequestOptions &options);
+
+    static void releasePermit(const NodePtr &node,
+                              std::chrono::steady_clock::duration latency,
+                              LimiterSignal signal);
+
+    static LimiterSignal limiterSignal(drogon::ReqResult result,
+                                       const drogon::HttpResponsePtr &response);
+
+    static ElasticSearchException rejectedException(const NodePtr &node);
+
+    static void handleResponse(
+        const NodePtr &node,
+        drogon::ReqResult result,
+        const drogon::HttpResponsePtr &response,
+        const std::function<void(const Json::Value &)> &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback);
+
+    void sendHedged(
+        const HedgeControllerPtr &hedge,
+        const NodePtr &node,
+        const std::string &path,
+        drogon::HttpMethod method,
+        std::string &&requestBody,
+        const std::function<void(const Json::Value &)> &resultCallback,
+        const std::function<void(const ElasticSearchException &)>
+            &exceptionCallback,
+        const RequestOptions &options);
+
+    /// No response or a body which is not JSON.
+    static bool isFailure(drogon::ReqResult result,
+                          const drogon::HttpResponsePtr &response);
+
+    /// Transport failures and 502/503/504 count against the node.
+    static bool isNodeHealthy(drogon::ReqResult result,
+                              const drogon::HttpResponsePtr &response);
+
+    /// Probes an open node with `HEAD /` until it answers.
+    static void scheduleProbe(const NodePtr &node);
 
   private:
-    std::string url_;
+    NodePoolPtr nodePool_;
+    SyncCallerPtr syncCaller_ = std::make_shared<SyncCaller>();
+    MetricsRegistryPtr metrics_ = std::make_shared<MetricsRegistry>();
+    mutable std::mutex settingsMutex_;
+    HttpClientSettingsPtr settings_ = std::make_shared<HttpClientSettings>();
 };
 
 using HttpClientPtr = std::shared_ptr<HttpClient>;
@@ -244,43 +244,34 @@ CreateIndexResponsePtr IndicesClient::create(
     const string &indexName,
     const CreateIndexParam &param) const
 {
-    unique_ptr<promise<CreateIndexResponsePtr>> pro(
-        new promise<CreateIndexResponsePtr>);
-    auto f = pro->get_future();
-    this->create(
-        indexName,
-        [&pro](const CreateIndexResponsePtr &response) {
-            try
-            {
-                pro->set_value(response);
-            }
-            catch (...)
-            {
-                pro->set_exception(current_exception());
-            }
-        },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(make_exception_ptr(err));
-        },
-        param);
-    return f.get();
+    return httpClient_->waitFor<CreateIndexResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->create(indexName, resultCallback, exceptionCallback, param);
+        });
 }
 
 void IndicesClient::create(
     const string &indexName,
     const function<void(const CreateIndexResponsePtr &)> &resultCallback,
     const function<void(const ElasticSearchException &)> &exceptionCallback,
-    const CreateIndexParam &param) const
+    const CreateIndexParam &param,
+    const CancellationTokenPtr &cancellation) const
 {
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
     string path("/");
     path += indexName;
 
+    auto options = requestOptions("indices.create", indexName, cancellation);
+    auto requestBody = timed(options.timing,
+                             &RequestTiming::build,
+                             [&param]() { return param.toJson(); });
     httpClient_->sendRequest(
         path,
         drogon::Put,
-        [resultCallback = std::move(resultCallback),
-         exceptionCallback =
-             std::move(exceptionCallback)](const Json::Value &responseBody) {
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
             if (responseBody.isMember("error"))
             {
                 auto error = responseBody["error"];
@@ -298,52 +289,42 @@ void IndicesClient::create(
                 CreateIndexResponsePtr ci_result =
                     make_shared<CreateIndexResponse>();
                 ci_result->setByJson(responseBody);
+                ci_result->setTiming(timing);
                 resultCallback(ci_result);
             }
         },
-        std::move(exceptionCallback),
-        param.toJson());
+        onError,
+        requestBody,
+        options);
 }
 
 GetIndexResponsePtr IndicesClient::get(const string &indexName) const
 {
-    unique_ptr<promise<GetIndexResponsePtr>> pro(
-        new promise<GetIndexResponsePtr>);
-    auto f = pro->get_future();
-    this->get(
-        indexName,
-        [&pro](const GetIndexResponsePtr &response) {
-            try
-            {
-                pro->set_value(response);
-            }
-            catch (...)
-            {
-                pro->set_exception(current_exception());
-            }
-        },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(make_exception_ptr(err));
+    return httpClient_->waitFor<GetIndexResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->get(indexName, resultCallback, exceptionCallback);
         });
-    return f.get();
 }
 
 void IndicesClient::get(
     const string &indexName,
     const function<void(const GetIndexResponsePtr &)> &resultCallback,
-    const function<void(const ElasticSearchException &)> &exceptionCallback)
-    const
+    const function<void(const ElasticSearchException &)> &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
 {
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
     string path("/");
     path += indexName;
 
+    auto options = requestOptions("indices.get", indexName, cancellation);
     httpClient_->sendRequest(
         path,
         drogon::Get,
         [indexName = std::move(indexName),
-         resultCallback = std::move(resultCallback),
-         exceptionCallback =
-             std::move(exceptionCallback)](const Json::Value &responseBody) {
+         resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
             if (responseBody.isMember("error"))
             {
                 auto error = responseBody["error"];
@@ -360,54 +341,50 @@ void IndicesClient::get(
             {
                 GetIndexResponsePtr response = make_shared<GetIndexResponse>();
                 response->setByJson(responseBody[indexName]);
+                response->setTiming(timing);
                 resultCallback(response);
             }
         },
-        std::move(exceptionCallback));
+        onError,
+        Json::Value(Json::objectValue),
+        options);
 }
 
 PutMappingResponsePtr IndicesClient::putMapping(
     const string &indexName,
     const PutMappingParam &param) const
 {
-    unique_ptr<promise<PutMappingResponsePtr>> pro(
-        new promise<PutMappingResponsePtr>);
-    auto f = pro->get_future();
-    this->putMapping(
-        indexName,
-        [&pro](const PutMappingResponsePtr &response) {
-            try
-            {
-                pro->set_value(response);
-            }
-            catch (...)
-            {
-                pro->set_exception(current_exception());
-            }
-        },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(make_exception_ptr(err));
-        },
-        param);
-    return f.get();
+    return httpClient_->waitFor<PutMappingResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->putMapping(
+                indexName, resultCallback, exceptionCallback, param);
+        });
 }
 
 void IndicesClient::putMapping(
     const string &indexName,
     const function<void(const PutMappingResponsePtr &)> &resultCallback,
     const function<void(const ElasticSearchException &)> &exceptionCallback,
-    const PutMappingParam &param) const
+    const PutMappingParam &param,
+    const CancellationTokenPtr &cancellation) const
 {
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
     string path("/");
     path += indexName;
     path += "/_mapping/_doc";
 
+    auto options =
+        requestOptions("indices.put_mapping", indexName, cancellation);
+    auto requestBody = timed(options.timing,
+                             &RequestTiming::build,
+                             [&param]() { return param.toJson(); });
     httpClient_->sendRequest(
         path,
         drogon::Put,
-        [resultCallback = std::move(resultCallback),
-         exceptionCallback =
-             std::move(exceptionCallback)](const Json::Value &responseBody) {
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
             if (responseBody.isMember("error"))
             {
                 auto error = responseBody["error"];
@@ -425,51 +402,41 @@ void IndicesClient::putMapping(
                 PutMappingResponsePtr response =
                     make_shared<PutMappingResponse>();
                 response->setByJson(responseBody);
+                response->setTiming(timing);
                 resultCallback(response);
             }
         },
-        std::move(exceptionCallback),
-        param.toJson());
+        onError,
+        requestBody,
+        options);
 }
 
 DeleteIndexResponsePtr IndicesClient::deleteIndex(const string &indexName) const
 {
-    unique_ptr<promise<DeleteIndexResponsePtr>> pro(
-        new promise<DeleteIndexResponsePtr>);
-    auto f = pro->get_future();
-    this->deleteIndex(
-        indexName,
-        [&pro](const DeleteIndexResponsePtr &response) {
-            try
-            {
-                pro->set_value(response);
-            }
-            catch (...)
-            {
-                pro->set_exception(current_exception());
-            }
-        },
-        [&pro](const ElasticSearchException &err) {
-            pro->set_exception(make_exception_ptr(err));
+    return httpClient_->waitFor<DeleteIndexResponsePtr>(
+        [&](auto &&resultCallback, auto &&exceptionCallback) {
+            this->deleteIndex(indexName, resultCallback, exceptionCallback);
         });
-    return f.get();
 }
 
 void IndicesClient::deleteIndex(
     const string &indexName,
     const function<void(const DeleteIndexResponsePtr &)> &resultCallback,
-    const function<void(const ElasticSearchException &)> &exceptionCallback)
-    const
+    const function<void(const ElasticSearchException &)> &exceptionCallback,
+    const CancellationTokenPtr &cancellation) const
 {
+    auto onResult = httpClient_->toCallerLoop(resultCallback);
+    auto onError = httpClient_->toCallerLoop(exceptionCallback);
     string path("/");
     path += indexName;
 
+    auto options = requestOptions("indices.delete", indexName, cancellation);
     httpClient_->sendRequest(
         path,
         drogon::Delete,
-        [resultCallback = std::move(resultCallback),
-         exceptionCallback =
-             std::move(exceptionCallback)](const Json::Value &responseBody) {
+        [resultCallback = std::move(onResult),
+         exceptionCallback = onError,
+         timing = options.timing](const Json::Value &responseBody) {
             if (responseBody.isMember("error"))
             {
                 auto error = responseBody["error"];
@@ -487,8 +454,11 @@ void IndicesClient::deleteIndex(
                 DeleteIndexResponsePtr response =
                     make_shared<DeleteIndexResponse>();
                 response->setByJson(responseBody);
+                response->setTiming(timing);
                 resultCallback(response);
             }
         },
-        std::move(exceptionCallback));
+        onError,
+        Json::Value(Json::objectValue),
+        options);
 }
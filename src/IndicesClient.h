@@ -8,6 +8,7 @@
 
 #include "HttpClient.h"
 #include "Property.h"
+#include "RequestAwaiter.h"
 #include <json/value.h>
 #include <trantor/utils/Date.h>
 #include <trantor/utils/Logger.h>
@@ -15,7 +16,7 @@
 namespace tl::elasticsearch
 {
 
-class CreateIndexResponse
+class CreateIndexResponse : public TimedResponse
 {
   public:
     void setByJson(const Json::Value &responseBody);
@@ -108,7 +109,7 @@ class Settings
 
 using SettingsPtr = std::shared_ptr<Settings>;
 
-class GetIndexResponse
+class GetIndexResponse : public TimedResponse
 {
   public:
     void setByJson(const Json::Value &responseBody);
@@ -136,7 +137,7 @@ class GetIndexResponse
 
 using GetIndexResponsePtr = std::shared_ptr<GetIndexResponse>;
 
-class PutMappingResponse
+class PutMappingResponse : public TimedResponse
 {
   public:
     void setByJson(const Json::Value &responseBody);
@@ -163,7 +164,7 @@ class PutMappingParam
     std::vector<Property> properties_;
 };
 
-class DeleteIndexResponse
+class DeleteIndexResponse : public TimedResponse
 {
   public:
     void setByJson(const Json::Value &responseBody);
@@ -200,14 +201,16 @@ class IndicesClient
                     &resultCallback,
                 const std::function<void(const ElasticSearchException &)>
                     &exceptionCallback,
-                const CreateIndexParam &param = CreateIndexParam()) const;
+                const CreateIndexParam &param = CreateIndexParam(),
+                const CancellationTokenPtr &cancellation = nullptr) const;
 
     GetIndexResponsePtr get(const std::string &indexName) const;
     void get(
         const std::string &indexName,
         const std::function<void(const GetIndexResponsePtr &)> &resultCallback,
         const std::function<void(const ElasticSearchException &)>
-            &exceptionCallback) const;
+            &exceptionCallback,
+        const CancellationTokenPtr &cancellation = nullptr) const;
 
     PutMappingResponsePtr putMapping(const std::string &indexName,
                                      const PutMappingParam &param) const;
@@ -216,14 +219,84 @@ class IndicesClient
                         &resultCallback,
                     const std::function<void(const ElasticSearchException &)>
                         &exceptionCallback,
-                    const PutMappingParam &param) const;
+                    const PutMappingParam &param,
+                    const CancellationTokenPtr &cancellation = nullptr) const;
 
     DeleteIndexResponsePtr deleteIndex(const std::string &indexName) const;
     void deleteIndex(const std::string &indexName,
                      const std::function<void(const DeleteIndexResponsePtr &)>
                          &resultCallback,
                      const std::function<void(const ElasticSearchException &)>
-                         &exceptionCallback) const;
+                         &exceptionCallback,
+                     const CancellationTokenPtr &cancellation = nullptr) const;
+
+  public:
+    // coroutines, the request is sent before the first co_await
+    RequestAwaiter<CreateIndexResponsePtr> createCoro(
+        const std::string &indexName,
+        const CreateIndexParam &param = CreateIndexParam(),
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<CreateIndexResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->create(indexName,
+                             resultCallback,
+                             exceptionCallback,
+                             param,
+                             cancellation);
+            });
+    }
+
+    RequestAwaiter<GetIndexResponsePtr> getCoro(
+        const std::string &indexName,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<GetIndexResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->get(
+                    indexName, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+    RequestAwaiter<PutMappingResponsePtr> putMappingCoro(
+        const std::string &indexName,
+        const PutMappingParam &param,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<PutMappingResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->putMapping(indexName,
+                                 resultCallback,
+                                 exceptionCallback,
+                                 param,
+                                 cancellation);
+            });
+    }
+
+    RequestAwaiter<DeleteIndexResponsePtr> deleteIndexCoro(
+        const std::string &indexName,
+        const CancellationTokenPtr &cancellation = nullptr) const
+    {
+        return RequestAwaiter<DeleteIndexResponsePtr>(
+            [&](auto &&resultCallback, auto &&exceptionCallback) {
+                this->deleteIndex(
+                    indexName, resultCallback, exceptionCallback, cancellation);
+            });
+    }
+
+  private:
+    RequestOptions requestOptions(
+        const std::string &operation,
+        const std::string &index,
+        const CancellationTokenPtr &cancellation) const
+    {
+        RequestOptions options;
+        options.operation = operation;
+        options.index = index;
+        options.cancellation = cancellation;
+        options.timing = httpClient_->newTiming();
+        return options;
+    }
 
   private:
     HttpClientPtr httpClient_;
@@ -0,0 +1,86 @@
+/**
+ *
+ *  JsonWriter.h
+ *
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace tl::elasticsearch
+{
+
+/// Appends `value` as a quoted and escaped JSON string.
+inline void appendJsonString(std::string &out, std::string_view value)
+{
+    static constexpr char kHex[] = "0123456789abcdef";
+    out += '"';
+    size_t plain = 0;
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        auto c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+        out.append(value.data() + plain, i - plain);
+        plain = i + 1;
+        switch (c)
+        {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                out += "\\u00";
+                out += kHex[c >> 4];
+                out += kHex[c & 0xf];
+        }
+    }
+    out.append(value.data() + plain, value.size() - plain);
+    out += '"';
+}
+
+/// Appends the shortest representation of `value` which reads back the same,
+/// null for NaN and infinities.
+inline void appendJsonNumber(std::string &out, double value)
+{
+    if (!std::isfinite(value))
+    {
+        out += "null";
+        return;
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+inline void appendJsonNumber(std::string &out, int64_t value)
+{
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+inline void appendJsonBool(std::string &out, bool value)
+{
+    out += value ? "true" : "false";
+}
+
+};  // namespace tl::elasticsearch
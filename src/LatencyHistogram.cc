@@ -0,0 +1,93 @@
+/**
+ *
+ *  LatencyHistogram.cc
+ *
+ */
+
+#include "LatencyHistogram.h"
+#include <bit>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+uint32_t LatencyHistogram::bucketIndex(uint64_t micros)
+{
+    if (micros < kSubBuckets)
+    {
+        return static_cast<uint32_t>(micros);
+    }
+    uint32_t exponent = 63 - countl_zero(micros);
+    uint32_t subBucket =
+        (micros >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return (exponent - kSubBucketBits + 1) * kSubBuckets + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(uint32_t index)
+{
+    if (index < kSubBuckets)
+    {
+        return index;
+    }
+    uint32_t exponent = index / kSubBuckets + kSubBucketBits - 1;
+    uint64_t subBucket = index % kSubBuckets;
+    return (kSubBuckets + subBucket) << (exponent - kSubBucketBits);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(uint32_t index)
+{
+    if (index + 1 >= kBucketCount)
+    {
+        return UINT64_MAX;
+    }
+    return bucketLowerBound(index + 1) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros)
+{
+    buckets_[bucketIndex(micros)].fetch_add(1, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+    sum_.fetch_add(micros, memory_order_relaxed);
+    auto current = max_.load(memory_order_relaxed);
+    while (micros > current &&
+           !max_.compare_exchange_weak(current, micros, memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &bucket : buckets_)
+    {
+        bucket.store(0, memory_order_relaxed);
+    }
+    count_.store(0, memory_order_relaxed);
+    sum_.store(0, memory_order_relaxed);
+    max_.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const
+{
+    auto total = count();
+    if (total == 0)
+    {
+        return 0;
+    }
+    auto target = static_cast<uint64_t>(percentile * total + 0.5);
+    if (target == 0)
+    {
+        target = 1;
+    }
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < kBucketCount; ++i)
+    {
+        seen += bucketCount(i);
+        if (seen >= target)
+        {
+            // the bucket's upper bound never underestimates the latency
+            auto upper = bucketUpperBound(i);
+            auto maxValue = max();
+            return upper < maxValue ? upper : maxValue;
+        }
+    }
+    return max();
+}
@@ -0,0 +1,77 @@
+/**
+ *
+ *  LatencyHistogram.h
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace tl::elasticsearch
+{
+
+/// HDR-style histogram of latencies in microseconds. Every power of two is
+/// split into 16 linear sub-buckets, so the relative error stays below 6.25%
+/// from 1us to more than a day. Recording is lock-free.
+class LatencyHistogram
+{
+  public:
+    static constexpr uint32_t kSubBucketBits = 4;
+    static constexpr uint32_t kSubBuckets = 1 << kSubBucketBits;
+    static constexpr uint32_t kBucketCount =
+        (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  public:
+    void record(uint64_t micros);
+
+    /// Forgets the recorded values. Values recorded meanwhile may be lost.
+    void reset();
+
+    void record(std::chrono::steady_clock::duration latency)
+    {
+        auto micros =
+            std::chrono::duration_cast<std::chrono::microseconds>(latency)
+                .count();
+        record(micros > 0 ? static_cast<uint64_t>(micros) : 0);
+    }
+
+    uint64_t count() const
+    {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t sum() const
+    {
+        return sum_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t max() const
+    {
+        return max_.load(std::memory_order_relaxed);
+    }
+
+    /// percentile in [0, 1], returns 0 if nothing is recorded.
+    uint64_t percentile(double percentile) const;
+
+    /// Number of values recorded in the bucket.
+    uint64_t bucketCount(uint32_t index) const
+    {
+        return buckets_[index].load(std::memory_order_relaxed);
+    }
+
+    static uint32_t bucketIndex(uint64_t micros);
+    static uint64_t bucketLowerBound(uint32_t index);
+    static uint64_t bucketUpperBound(uint32_t index);
+
+  private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+};  // namespace tl::elasticsearch
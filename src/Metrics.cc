@@ -0,0 +1,234 @@
+/**
+ *
+ *  Metrics.cc
+ *
+ */
+
+#include "Metrics.h"
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <sstream>
+#include <string_view>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+MetricsRegistry::~MetricsRegistry()
+{
+    for (auto &slot : slots_)
+    {
+        delete slot.load(memory_order_relaxed);
+    }
+}
+
+MetricSeries &MetricsRegistry::series(const string &operation,
+                                      const string &index)
+{
+    auto hash = std::hash<string_view>()(operation) * 31 +
+                std::hash<string_view>()(index);
+    MetricSeries *created = nullptr;
+    for (size_t probe = 0; probe < kMaxProbes; ++probe)
+    {
+        auto &slot = slots_[(hash + probe) % kMaxSeries];
+        auto current = slot.load(memory_order_acquire);
+        if (!current)
+        {
+            if (!created)
+            {
+                created = new MetricSeries(operation, index);
+            }
+            if (slot.compare_exchange_strong(current,
+                                             created,
+                                             memory_order_acq_rel))
+            {
+                return *created;
+            }
+            // another thread took the slot, current is its series
+        }
+        if (current->operation == operation && current->index == index)
+        {
+            delete created;
+            return *current;
+        }
+    }
+    delete created;
+    return overflow_;
+}
+
+static MetricSnapshot snapshotOf(const MetricSeries &series)
+{
+    MetricSnapshot result;
+    result.operation = series.operation;
+    result.index = series.index;
+    result.requests = series.requests.load(memory_order_relaxed);
+    result.errors = series.errors.load(memory_order_relaxed);
+    result.inFlight = series.inFlight.load(memory_order_relaxed);
+    result.bytesSent = series.bytesSent.load(memory_order_relaxed);
+    result.bytesReceived = series.bytesReceived.load(memory_order_relaxed);
+    result.latencyCount = series.latency.count();
+    result.latencySum = series.latency.sum();
+    result.latencyMax = series.latency.max();
+    result.p50 = series.latency.percentile(0.5);
+    result.p90 = series.latency.percentile(0.9);
+    result.p99 = series.latency.percentile(0.99);
+    result.p999 = series.latency.percentile(0.999);
+    return result;
+}
+
+vector<MetricSnapshot> MetricsRegistry::snapshot() const
+{
+    vector<MetricSnapshot> result;
+    for (const auto &slot : slots_)
+    {
+        if (auto series = slot.load(memory_order_acquire))
+        {
+            result.push_back(snapshotOf(*series));
+        }
+    }
+    if (overflow_.requests.load(memory_order_relaxed) > 0)
+    {
+        result.push_back(snapshotOf(overflow_));
+    }
+    return result;
+}
+
+void MetricsRegistry::setGaugeCollector(GaugeCollector &&collector)
+{
+    lock_guard<mutex> lock(gaugeMutex_);
+    gaugeCollector_ = std::move(collector);
+}
+
+vector<GaugeSample> MetricsRegistry::gauges() const
+{
+    GaugeCollector collector;
+    {
+        lock_guard<mutex> lock(gaugeMutex_);
+        collector = gaugeCollector_;
+    }
+    return collector ? collector() : vector<GaugeSample>();
+}
+
+/// Shortest text parsed back to the same value, a stream would round it to
+/// 6 significant digits.
+static string formatValue(double value)
+{
+    char buffer[32];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    return string(buffer, result.ptr);
+}
+
+static string escapeLabel(const string &value)
+{
+    string result;
+    for (auto c : value)
+    {
+        if (c == '\\' || c == '"')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (c == '\n')
+        {
+            result += "\\n";
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    return result;
+}
+
+static string labelsOf(const MetricSnapshot &series)
+{
+    string result = "operation=\"";
+    result += escapeLabel(series.operation);
+    result += "\",index=\"";
+    result += escapeLabel(series.index);
+    result += "\"";
+    return result;
+}
+
+string MetricsRegistry::prometheus() const
+{
+    auto series = snapshot();
+    ostringstream out;
+    auto family = [&out, &series](const char *name,
+                                  const char *type,
+                                  const char *help,
+                                  auto value) {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+        for (const auto &s : series)
+        {
+            out << name << "{" << labelsOf(s) << "} " << value(s) << "\n";
+        }
+    };
+    family("es_client_requests_total",
+           "counter",
+           "Requests sent by the client.",
+           [](const MetricSnapshot &s) { return s.requests; });
+    family("es_client_errors_total",
+           "counter",
+           "Requests which failed.",
+           [](const MetricSnapshot &s) { return s.errors; });
+    family("es_client_in_flight",
+           "gauge",
+           "Requests waiting for their response.",
+           [](const MetricSnapshot &s) { return s.inFlight; });
+    family("es_client_sent_bytes_total",
+           "counter",
+           "Bytes of the request bodies.",
+           [](const MetricSnapshot &s) { return s.bytesSent; });
+    family("es_client_received_bytes_total",
+           "counter",
+           "Bytes of the response bodies.",
+           [](const MetricSnapshot &s) { return s.bytesReceived; });
+
+    const char *latency = "es_client_latency_seconds";
+    out << "# HELP " << latency << " Latency of the requests.\n";
+    out << "# TYPE " << latency << " summary\n";
+    for (const auto &s : series)
+    {
+        auto labels = labelsOf(s);
+        pair<const char *, uint64_t> quantiles[] = {
+            { "0.5", s.p50 }, { "0.9", s.p90 }, { "0.99", s.p99 },
+            { "0.999", s.p999 }
+        };
+        for (const auto &[quantile, micros] : quantiles)
+        {
+            out << latency << "{" << labels << ",quantile=\"" << quantile
+                << "\"} " << formatValue(micros / 1e6) << "\n";
+        }
+        out << latency << "_sum{" << labels << "} "
+            << formatValue(s.latencySum / 1e6) << "\n";
+        out << latency << "_count{" << labels << "} " << s.latencyCount
+            << "\n";
+    }
+
+    // the samples of a gauge must follow its header
+    auto gauges = this->gauges();
+    stable_sort(gauges.begin(),
+                gauges.end(),
+                [](const GaugeSample &a, const GaugeSample &b) {
+                    return a.name < b.name;
+                });
+    for (size_t i = 0; i < gauges.size(); ++i)
+    {
+        const auto &gauge = gauges[i];
+        if (i == 0 || gauge.name != gauges[i - 1].name)
+        {
+            out << "# HELP " << gauge.name << " " << gauge.help << "\n";
+            out << "# TYPE " << gauge.name << " gauge\n";
+        }
+        out << gauge.name << "{";
+        for (size_t j = 0; j < gauge.labels.size(); ++j)
+        {
+            out << (j > 0 ? "," : "") << gauge.labels[j].first << "=\""
+                << escapeLabel(gauge.labels[j].second) << "\"";
+        }
+        out << "} " << formatValue(gauge.value) << "\n";
+    }
+    return out.str();
+}
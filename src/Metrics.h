@@ -0,0 +1,118 @@
+/**
+ *
+ *  Metrics.h
+ *
+ */
+
+#pragma once
+
+#include "LatencyHistogram.h"
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+/// Counters of the requests of one operation on one index.
+class MetricSeries
+{
+  public:
+    MetricSeries(const std::string &operation, const std::string &index)
+        : operation(operation), index(index)
+    {
+    }
+
+  public:
+    const std::string operation;
+    const std::string index;
+    // from the call of the client to the response, queueing included
+    LatencyHistogram latency;
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<int64_t> inFlight{0};
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<uint64_t> bytesReceived{0};
+};
+
+/// Point-in-time copy of a MetricSeries, latencies in microseconds.
+class MetricSnapshot
+{
+  public:
+    std::string operation;
+    std::string index;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    int64_t inFlight = 0;
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t latencyCount = 0;
+    uint64_t latencySum = 0;
+    uint64_t latencyMax = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+};
+
+/// A value read when the metrics are exported, e.g. the concurrency limit
+/// of a node.
+class GaugeSample
+{
+  public:
+    /// Samples of the same gauge share its name and help.
+    std::string name;
+    std::string help;
+    std::vector<std::pair<std::string, std::string>> labels;
+    double value = 0;
+};
+
+/// Metrics of the client labelled by operation and index.
+///
+/// Series live in a fixed-size open-addressing table of atomic pointers, so
+/// both looking up and creating a series are lock-free. Once the table is
+/// full, new label pairs are counted in a single overflow series.
+class MetricsRegistry
+{
+  public:
+    static constexpr size_t kMaxSeries = 1024;
+
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry &) = delete;
+    MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+    ~MetricsRegistry();
+
+  public:
+    MetricSeries &series(const std::string &operation,
+                         const std::string &index);
+
+    std::vector<MetricSnapshot> snapshot() const;
+
+    using GaugeCollector = std::function<std::vector<GaugeSample>()>;
+
+    /// Gauges owned by other parts of the client, collected on export.
+    void setGaugeCollector(GaugeCollector &&collector);
+
+    std::vector<GaugeSample> gauges() const;
+
+    /// Prometheus text exposition format (version 0.0.4).
+    std::string prometheus() const;
+
+  private:
+    // probes before giving up and using the overflow series
+    static constexpr size_t kMaxProbes = 64;
+
+    std::array<std::atomic<MetricSeries *>, kMaxSeries> slots_{};
+    MetricSeries overflow_{"other", "_overflow"};
+    mutable std::mutex gaugeMutex_;
+    GaugeCollector gaugeCollector_;
+};
+
+using MetricsRegistryPtr = std::shared_ptr<MetricsRegistry>;
+
+};  // namespace tl::elasticsearch
@@ -0,0 +1,246 @@
+/**
+ *
+ *  NodePool.cc
+ *
+ */
+
+#include "NodePool.h"
+#include <algorithm>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+// weight of the newest sample in the latency EWMA
+static constexpr double kEwmaAlpha = 0.2;
+
+void Node::onRequestStart()
+{
+    inFlight_.fetch_add(1, memory_order_relaxed);
+}
+
+bool Node::onRequestFinish(chrono::steady_clock::duration latency,
+                           bool succeeded)
+{
+    inFlight_.fetch_sub(1, memory_order_relaxed);
+    auto total = totalRequests_.fetch_add(1, memory_order_relaxed);
+    if (!succeeded)
+    {
+        failedRequests_.fetch_add(1, memory_order_relaxed);
+    }
+
+    double sample =
+        chrono::duration_cast<chrono::duration<double, milli>>(latency).count();
+    double current = ewmaLatencyMs_.load(memory_order_relaxed);
+    double next;
+    do
+    {
+        next = total == 0 ? sample
+                          : kEwmaAlpha * sample + (1 - kEwmaAlpha) * current;
+    } while (!ewmaLatencyMs_.compare_exchange_weak(current,
+                                                   next,
+                                                   memory_order_relaxed));
+
+    if (succeeded)
+    {
+        breaker_.onSuccess();
+        return false;
+    }
+    return breaker_.onFailure();
+}
+
+NodeStats Node::stats() const
+{
+    NodeStats result;
+    result.url = url_;
+    result.inFlight = inFlight();
+    result.totalRequests = totalRequests_.load(memory_order_relaxed);
+    result.failedRequests = failedRequests_.load(memory_order_relaxed);
+    result.ewmaLatencyMs = ewmaLatencyMs();
+    result.circuitState = breaker_.state();
+    if (limiter_)
+    {
+        result.concurrencyLimit = limiter_->limit();
+        result.queued = limiter_->queued();
+    }
+    return result;
+}
+
+NodePtr RoundRobinSelector::select(const vector<NodePtr> &nodes)
+{
+    return nodes[next_.fetch_add(1, memory_order_relaxed) % nodes.size()];
+}
+
+NodePtr LeastOutstandingSelector::select(const vector<NodePtr> &nodes)
+{
+    auto size = nodes.size();
+    auto start = next_.fetch_add(1, memory_order_relaxed);
+    NodePtr result = nodes[start % size];
+    for (size_t i = 1; i < size; ++i)
+    {
+        const auto &node = nodes[(start + i) % size];
+        if (node->inFlight() < result->inFlight())
+        {
+            result = node;
+        }
+    }
+    return result;
+}
+
+NodePtr LatencyEwmaSelector::select(const vector<NodePtr> &nodes)
+{
+    // a node without a response yet (new pool, sniffed node) is assumed as
+    // fast as the others on average, not infinitely fast. Without any
+    // response the nodes are ranked by their outstanding requests.
+    double warmSum = 0;
+    size_t warm = 0;
+    for (const auto &node : nodes)
+    {
+        if (auto ewma = node->ewmaLatencyMs(); ewma > 0)
+        {
+            warmSum += ewma;
+            ++warm;
+        }
+    }
+    double coldLatencyMs = warm > 0 ? warmSum / warm : 1;
+    // the expected wait on a node grows with the requests already queued on
+    // it, so the latency is weighted by the outstanding requests
+    auto score = [coldLatencyMs](const NodePtr &node) {
+        auto ewma = node->ewmaLatencyMs();
+        return (ewma > 0 ? ewma : coldLatencyMs) * (node->inFlight() + 1);
+    };
+    auto size = nodes.size();
+    auto start = next_.fetch_add(1, memory_order_relaxed);
+    NodePtr result = nodes[start % size];
+    double best = score(result);
+    for (size_t i = 1; i < size; ++i)
+    {
+        const auto &node = nodes[(start + i) % size];
+        double current = score(node);
+        if (current < best)
+        {
+            best = current;
+            result = node;
+        }
+    }
+    return result;
+}
+
+NodeSelectorPtr tl::elasticsearch::newNodeSelector(const string &name)
+{
+    if (name == "round_robin")
+    {
+        return make_shared<RoundRobinSelector>();
+    }
+    if (name == "least_outstanding")
+    {
+        return make_shared<LeastOutstandingSelector>();
+    }
+    if (name == "latency_ewma")
+    {
+        return make_shared<LatencyEwmaSelector>();
+    }
+    throw ElasticSearchException("unknown node selector: " + name);
+}
+
+NodePool::NodePool(const vector<string> &urls,
+                   NodeSelectorPtr selector,
+                   const NodeConfig &nodeConfig)
+    : selector_(selector ? selector : make_shared<RoundRobinSelector>()),
+      nodeConfig_(nodeConfig)
+{
+    if (urls.empty())
+    {
+        throw ElasticSearchException("NodePool requires at least one node.");
+    }
+    setNodes(urls);
+}
+
+NodePtr NodePool::select(const NodePtr &exclude) const
+{
+    auto all = nodes();
+    auto isCandidate = [&exclude](const NodePtr &node) {
+        return node != exclude && node->breaker().isAvailable();
+    };
+    size_t available = 0;
+    for (const auto &node : *all)
+    {
+        if (isCandidate(node))
+        {
+            ++available;
+        }
+    }
+    if (available == all->size())
+    {
+        auto node = selector_->select(*all);
+        if (node->breaker().tryAcquire())
+        {
+            return node;
+        }
+    }
+    // the last trials of a half-open node may be taken meanwhile, the
+    // other nodes are tried then
+    vector<NodePtr> candidates;
+    candidates.reserve(available);
+    for (const auto &node : *all)
+    {
+        if (isCandidate(node))
+        {
+            candidates.push_back(node);
+        }
+    }
+    while (!candidates.empty())
+    {
+        auto node = selector_->select(candidates);
+        if (node->breaker().tryAcquire())
+        {
+            return node;
+        }
+        candidates.erase(find(candidates.begin(), candidates.end(), node));
+    }
+    return nullptr;
+}
+
+shared_ptr<const vector<NodePtr>> NodePool::nodes() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return nodes_;
+}
+
+void NodePool::setNodes(const vector<string> &urls)
+{
+    if (urls.empty())
+    {
+        LOG_WARN << "ignore empty node list";
+        return;
+    }
+    lock_guard<mutex> lock(mutex_);
+    auto newNodes = make_shared<vector<NodePtr>>();
+    for (const auto &url : urls)
+    {
+        NodePtr node;
+        if (nodes_)
+        {
+            for (const auto &item : *nodes_)
+            {
+                if (item->url() == url)
+                {
+                    node = item;
+                    break;
+                }
+            }
+        }
+        newNodes->push_back(node ? node
+                                : make_shared<Node>(url, nodeConfig_));
+    }
+    nodes_ = newNodes;
+}
+
+vector<NodeStats> NodePool::stats() const
+{
+    vector<NodeStats> result;
+    for (const auto &node : *nodes())
+    {
+        result.push_back(node->stats());
+    }
+    return result;
+}
@@ -0,0 +1,180 @@
+/**
+ *
+ *  NodePool.h
+ *
+ */
+
+#pragma once
+
+#include "CircuitBreaker.h"
+#include "ConcurrencyLimiter.h"
+#include "ElasticSearchException.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <trantor/utils/Logger.h>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+class NodeConfig
+{
+  public:
+    CircuitBreakerConfig circuitBreaker;
+    /// Adaptive limit of requests in flight, unlimited if not set.
+    std::optional<ConcurrencyLimitConfig> concurrencyLimit;
+};
+
+class NodeStats
+{
+  public:
+    std::string url;
+    int64_t inFlight = 0;
+    uint64_t totalRequests = 0;
+    uint64_t failedRequests = 0;
+    // exponentially weighted moving average, in milliseconds
+    double ewmaLatencyMs = 0;
+    CircuitState circuitState = CircuitState::CLOSED;
+    // current adaptive limit, 0 means unlimited
+    uint32_t concurrencyLimit = 0;
+    size_t queued = 0;
+};
+
+class Node
+{
+  public:
+    Node(const std::string &url, const NodeConfig &config = NodeConfig())
+        : url_(url), breaker_(config.circuitBreaker)
+    {
+        if (config.concurrencyLimit)
+        {
+            limiter_ =
+                std::make_shared<ConcurrencyLimiter>(*config.concurrencyLimit);
+        }
+    }
+
+  public:
+    const std::string &url() const
+    {
+        return url_;
+    }
+
+    int64_t inFlight() const
+    {
+        return inFlight_.load(std::memory_order_relaxed);
+    }
+
+    double ewmaLatencyMs() const
+    {
+        return ewmaLatencyMs_.load(std::memory_order_relaxed);
+    }
+
+    CircuitBreaker &breaker()
+    {
+        return breaker_;
+    }
+
+    /// nullptr if the requests to the node are not limited.
+    const ConcurrencyLimiterPtr &limiter() const
+    {
+        return limiter_;
+    }
+
+    /// Must be paired with exactly one call of onRequestFinish.
+    void onRequestStart();
+    /// Returns true if the failure opened the circuit of the node.
+    bool onRequestFinish(std::chrono::steady_clock::duration latency,
+                         bool succeeded);
+
+    NodeStats stats() const;
+
+  private:
+    std::string url_;
+    std::atomic<int64_t> inFlight_{0};
+    std::atomic<uint64_t> totalRequests_{0};
+    std::atomic<uint64_t> failedRequests_{0};
+    std::atomic<double> ewmaLatencyMs_{0};
+    CircuitBreaker breaker_;
+    ConcurrencyLimiterPtr limiter_;
+};
+
+using NodePtr = std::shared_ptr<Node>;
+
+class NodeSelector
+{
+  public:
+    virtual ~NodeSelector() = default;
+
+    /// nodes is never empty.
+    virtual NodePtr select(const std::vector<NodePtr> &nodes) = 0;
+};
+
+using NodeSelectorPtr = std::shared_ptr<NodeSelector>;
+
+class RoundRobinSelector : public NodeSelector
+{
+  public:
+    NodePtr select(const std::vector<NodePtr> &nodes) override;
+
+  private:
+    std::atomic<size_t> next_{0};
+};
+
+class LeastOutstandingSelector : public NodeSelector
+{
+  public:
+    NodePtr select(const std::vector<NodePtr> &nodes) override;
+
+  private:
+    // rotates the starting point so that ties do not always hit node 0
+    std::atomic<size_t> next_{0};
+};
+
+class LatencyEwmaSelector : public NodeSelector
+{
+  public:
+    NodePtr select(const std::vector<NodePtr> &nodes) override;
+
+  private:
+    std::atomic<size_t> next_{0};
+};
+
+/// name: round_robin, least_outstanding or latency_ewma
+NodeSelectorPtr newNodeSelector(const std::string &name);
+
+class NodePool
+{
+  public:
+    NodePool(const std::vector<std::string> &urls,
+             NodeSelectorPtr selector = nullptr,
+             const NodeConfig &nodeConfig = NodeConfig());
+
+  public:
+    /// Only nodes whose circuit is not open and which are not the excluded
+    /// one are candidates, returns nullptr if there is none. The node is
+    /// claimed by CircuitBreaker::tryAcquire(), a request which is not sent
+    /// to it must call CircuitBreaker::onAbandon().
+    NodePtr select(const NodePtr &exclude = nullptr) const;
+
+    std::shared_ptr<const std::vector<NodePtr>> nodes() const;
+
+    /// Replaces the node list. Nodes whose url is already known are kept
+    /// (together with their statistics), requests in flight are not touched.
+    void setNodes(const std::vector<std::string> &urls);
+
+    std::vector<NodeStats> stats() const;
+
+  private:
+    mutable std::mutex mutex_;
+    std::shared_ptr<const std::vector<NodePtr>> nodes_;
+    NodeSelectorPtr selector_;
+    NodeConfig nodeConfig_;
+};
+
+using NodePoolPtr = std::shared_ptr<NodePool>;
+
+};  // namespace tl::elasticsearch
@@ -0,0 +1,211 @@
+/**
+ *
+ *  Profile.cc
+ *
+ */
+
+#include "Profile.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+static int64_t timeOf(const Json::Value &json, const char *name)
+{
+    const auto &time = json[name];
+    return time.isIntegral() ? time.asInt64() : 0;
+}
+
+/// The children of a query or a collector may overlap their parent a bit.
+template <typename Tp>
+static int64_t selfTime(int64_t time, const vector<Tp> &children)
+{
+    for (const auto &child : children)
+    {
+        time -= child.getTimeInNanos();
+    }
+    return max<int64_t>(time, 0);
+}
+
+int64_t ProfiledComponent::getSelfTimeInNanos() const
+{
+    return selfTime(timeInNanos_, children_);
+}
+
+void ProfiledComponent::setByJson(const Json::Value &json)
+{
+    type_ = json["type"].asString();
+    description_ = json["description"].asString();
+    timeInNanos_ = timeOf(json, "time_in_nanos");
+    const auto &breakdown = json["breakdown"];
+    for (auto it = breakdown.begin(); it != breakdown.end(); ++it)
+    {
+        if (it->isIntegral())
+        {
+            breakdown_[it.name()] = it->asInt64();
+        }
+    }
+    for (const auto &item : json["children"])
+    {
+        children_.emplace_back().setByJson(item);
+    }
+}
+
+void ProfiledCollector::setByJson(const Json::Value &json)
+{
+    name_ = json["name"].asString();
+    reason_ = json["reason"].asString();
+    timeInNanos_ = timeOf(json, "time_in_nanos");
+    for (const auto &item : json["children"])
+    {
+        children_.emplace_back().setByJson(item);
+    }
+}
+
+void SearchProfile::setByJson(const Json::Value &json)
+{
+    for (const auto &item : json["query"])
+    {
+        query_.emplace_back().setByJson(item);
+    }
+    rewriteTime_ = timeOf(json, "rewrite_time");
+    for (const auto &item : json["collector"])
+    {
+        collector_.emplace_back().setByJson(item);
+    }
+}
+
+void ShardProfile::setByJson(const Json::Value &json)
+{
+    id_ = json["id"].asString();
+    for (const auto &item : json["searches"])
+    {
+        searches_.emplace_back().setByJson(item);
+    }
+    for (const auto &item : json["aggregations"])
+    {
+        aggregations_.emplace_back().setByJson(item);
+    }
+}
+
+void ProfileResponse::setByJson(const Json::Value &json)
+{
+    for (const auto &item : json["shards"])
+    {
+        shards_.emplace_back().setByJson(item);
+    }
+}
+
+string tl::elasticsearch::to_string(ProfileSection section)
+{
+    switch (section)
+    {
+        case ProfileSection::QUERY:
+            return "query";
+        case ProfileSection::REWRITE:
+            return "rewrite";
+        case ProfileSection::COLLECTOR:
+            return "collector";
+        case ProfileSection::AGGREGATION:
+            return "aggregation";
+        default:
+            return "unknown";
+    }
+}
+
+static void addHotspots(vector<ProfileHotspot> &hotspots,
+                        const string &shard,
+                        ProfileSection section,
+                        const ProfiledComponent &component)
+{
+    hotspots.push_back({shard,
+                        section,
+                        component.getType(),
+                        component.getDescription(),
+                        component.getSelfTimeInNanos(),
+                        component.getTimeInNanos()});
+    for (const auto &child : component.getChildren())
+    {
+        addHotspots(hotspots, shard, section, child);
+    }
+}
+
+static void addHotspots(vector<ProfileHotspot> &hotspots,
+                        const string &shard,
+                        const ProfiledCollector &collector)
+{
+    hotspots.push_back({shard,
+                        ProfileSection::COLLECTOR,
+                        collector.getName(),
+                        collector.getReason(),
+                        selfTime(collector.getTimeInNanos(),
+                                 collector.getChildren()),
+                        collector.getTimeInNanos()});
+    for (const auto &child : collector.getChildren())
+    {
+        addHotspots(hotspots, shard, child);
+    }
+}
+
+vector<ProfileHotspot> ProfileResponse::getHotspots(size_t count) const
+{
+    vector<ProfileHotspot> hotspots;
+    for (const auto &shard : shards_)
+    {
+        for (const auto &search : shard.getSearches())
+        {
+            for (const auto &query : search.getQuery())
+            {
+                addHotspots(
+                    hotspots, shard.getId(), ProfileSection::QUERY, query);
+            }
+            hotspots.push_back({shard.getId(),
+                                ProfileSection::REWRITE,
+                                "rewrite",
+                                "",
+                                search.getRewriteTime(),
+                                search.getRewriteTime()});
+            for (const auto &collector : search.getCollector())
+            {
+                addHotspots(hotspots, shard.getId(), collector);
+            }
+        }
+        for (const auto &aggregation : shard.getAggregations())
+        {
+            addHotspots(hotspots,
+                        shard.getId(),
+                        ProfileSection::AGGREGATION,
+                        aggregation);
+        }
+    }
+    count = min(count, hotspots.size());
+    partial_sort(hotspots.begin(),
+                 hotspots.begin() + count,
+                 hotspots.end(),
+                 [](const ProfileHotspot &a, const ProfileHotspot &b) {
+                     return a.selfTimeInNanos > b.selfTimeInNanos;
+                 });
+    hotspots.resize(count);
+    return hotspots;
+}
+
+string ProfileResponse::formatHotspots(size_t count) const
+{
+    static constexpr size_t maxDescription = 80;
+    ostringstream out;
+    out << fixed << setprecision(3);
+    for (const auto &hotspot : getHotspots(count))
+    {
+        auto description = hotspot.description.size() > maxDescription
+                               ? hotspot.description.substr(0, maxDescription) +
+                                     "..."
+                               : hotspot.description;
+        out << setw(10) << hotspot.selfTimeInNanos / 1e6 << " ms "
+            << setw(10) << hotspot.timeInNanos / 1e6 << " ms  "
+            << to_string(hotspot.section) << ' ' << hotspot.type << ' '
+            << description << ' ' << hotspot.shard << '\n';
+    }
+    return out.str();
+}
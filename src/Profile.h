@@ -0,0 +1,202 @@
+/**
+ *
+ *  Profile.h
+ *
+ */
+
+#pragma once
+
+#include <json/value.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+/// Timing of one Lucene query or one aggregation, and of its children.
+class ProfiledComponent
+{
+  public:
+    /// e.g. BooleanQuery, TermQuery or GlobalOrdinalsStringTermsAggregator.
+    const std::string &getType() const
+    {
+        return type_;
+    }
+
+    /// The query as Lucene sees it, or the name of the aggregation.
+    const std::string &getDescription() const
+    {
+        return description_;
+    }
+
+    /// Including the time of the children.
+    int64_t getTimeInNanos() const
+    {
+        return timeInNanos_;
+    }
+
+    /// Without the time of the children.
+    int64_t getSelfTimeInNanos() const;
+
+    /// Nanoseconds and counts of the steps, e.g. create_weight, next_doc,
+    /// score and their *_count.
+    const std::map<std::string, int64_t> &getBreakdown() const
+    {
+        return breakdown_;
+    }
+
+    const std::vector<ProfiledComponent> &getChildren() const
+    {
+        return children_;
+    }
+
+    void setByJson(const Json::Value &json);
+
+  private:
+    std::string type_;
+    std::string description_;
+    int64_t timeInNanos_ = 0;
+    std::map<std::string, int64_t> breakdown_;
+    std::vector<ProfiledComponent> children_;
+};
+
+/// Timing of a collector, which gathers the hits, e.g. to sort them.
+class ProfiledCollector
+{
+  public:
+    const std::string &getName() const
+    {
+        return name_;
+    }
+
+    /// e.g. search_top_hits or search_multi.
+    const std::string &getReason() const
+    {
+        return reason_;
+    }
+
+    int64_t getTimeInNanos() const
+    {
+        return timeInNanos_;
+    }
+
+    const std::vector<ProfiledCollector> &getChildren() const
+    {
+        return children_;
+    }
+
+    void setByJson(const Json::Value &json);
+
+  private:
+    std::string name_;
+    std::string reason_;
+    int64_t timeInNanos_ = 0;
+    std::vector<ProfiledCollector> children_;
+};
+
+/// One search run on a shard, a shard usually runs one.
+class SearchProfile
+{
+  public:
+    const std::vector<ProfiledComponent> &getQuery() const
+    {
+        return query_;
+    }
+
+    /// Time spent rewriting the query before running it.
+    int64_t getRewriteTime() const
+    {
+        return rewriteTime_;
+    }
+
+    const std::vector<ProfiledCollector> &getCollector() const
+    {
+        return collector_;
+    }
+
+    void setByJson(const Json::Value &json);
+
+  private:
+    std::vector<ProfiledComponent> query_;
+    int64_t rewriteTime_ = 0;
+    std::vector<ProfiledCollector> collector_;
+};
+
+class ShardProfile
+{
+  public:
+    /// [node id][index][shard number]
+    const std::string &getId() const
+    {
+        return id_;
+    }
+
+    const std::vector<SearchProfile> &getSearches() const
+    {
+        return searches_;
+    }
+
+    const std::vector<ProfiledComponent> &getAggregations() const
+    {
+        return aggregations_;
+    }
+
+    void setByJson(const Json::Value &json);
+
+  private:
+    std::string id_;
+    std::vector<SearchProfile> searches_;
+    std::vector<ProfiledComponent> aggregations_;
+};
+
+enum class ProfileSection
+{
+    QUERY = 0,
+    REWRITE,
+    COLLECTOR,
+    AGGREGATION,
+};
+
+std::string to_string(ProfileSection section);
+
+/// A component of a profile and the time spent in it alone.
+class ProfileHotspot
+{
+  public:
+    std::string shard;
+    ProfileSection section;
+    /// The type of a query or aggregation, the name of a collector.
+    std::string type;
+    std::string description;
+    int64_t selfTimeInNanos = 0;
+    int64_t timeInNanos = 0;
+};
+
+/// The "profile" of a search sent with SearchParam::profile(true).
+class ProfileResponse
+{
+  public:
+    const std::vector<ShardProfile> &getShards() const
+    {
+        return shards_;
+    }
+
+    /// The `count` components with the highest time of their own, of all the
+    /// shards, highest first.
+    std::vector<ProfileHotspot> getHotspots(size_t count = 10) const;
+
+    /// getHotspots() as a table, one line per component, e.g. for the logs.
+    std::string formatHotspots(size_t count = 10) const;
+
+    void setByJson(const Json::Value &json);
+
+  private:
+    std::vector<ShardProfile> shards_;
+};
+
+using ProfileResponsePtr = std::shared_ptr<ProfileResponse>;
+
+};  // namespace tl::elasticsearch
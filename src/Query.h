@@ -314,6 +314,59 @@ class RangeQuery : public Query, public std::enable_shared_from_this<RangeQuery>
     std::shared_ptr<double> lte_;
 };
 
+/// Matches the documents of its filter, each with the same score: the filter
+/// is not scored and can be cached by the nodes.
+class ConstantScoreQuery
+    : public Query,
+      public std::enable_shared_from_this<ConstantScoreQuery>
+{
+  private:
+    ConstantScoreQuery()
+    {
+    }
+
+  public:
+    static auto newConstantScoreQuery()
+    {
+        return std::shared_ptr<ConstantScoreQuery>(new ConstantScoreQuery());
+    }
+    auto filter(QueryPtr filter)
+    {
+        filter_ = filter;
+        return shared_from_this();
+    }
+    auto boost(double boost)
+    {
+        boost_ = std::make_shared<double>(boost);
+        return shared_from_this();
+    }
+
+    const QueryPtr &filter() const
+    {
+        return filter_;
+    }
+
+    Json::Value toJson() const override
+    {
+        if (!filter_)
+        {
+            throw ElasticSearchException(
+                "ConstantScoreQuery must have a filter.");
+        }
+        Json::Value json;
+        json["constant_score"]["filter"] = filter_->toJson();
+        if (boost_)
+        {
+            json["constant_score"]["boost"] = *boost_;
+        }
+        return json;
+    }
+
+  private:
+    QueryPtr filter_;
+    std::shared_ptr<double> boost_;
+};
+
 #if 0  // Lack of test data, still need to be adjusted
 class GeoPoint
 {
@@ -548,6 +601,26 @@ class BoolQuery : public Query, public std::enable_shared_from_this<BoolQuery>
         return shared_from_this();
     }
 
+    const std::vector<QueryPtr> &must() const
+    {
+        return must_;
+    }
+
+    const std::vector<QueryPtr> &should() const
+    {
+        return should_;
+    }
+
+    const std::vector<QueryPtr> &mustNot() const
+    {
+        return mustNot_;
+    }
+
+    const std::vector<QueryPtr> &filter() const
+    {
+        return filter_;
+    }
+
     Json::Value toJson() const override
     {
         Json::Value json;
@@ -0,0 +1,382 @@
+/**
+ *
+ *  QueryOptimizer.cc
+ *
+ */
+
+#include "QueryOptimizer.h"
+#include "Fingerprint.h"
+#include <sstream>
+#include <unordered_set>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+string tl::elasticsearch::to_string(QueryRewrite rewrite)
+{
+    switch (rewrite)
+    {
+        case QueryRewrite::MUST_TO_FILTER:
+            return "must_to_filter";
+        case QueryRewrite::CONSTANT_SCORE:
+            return "constant_score";
+        case QueryRewrite::FLATTEN:
+            return "flatten";
+        case QueryRewrite::DEDUPLICATE:
+            return "deduplicate";
+        default:
+            return "unknown";
+    }
+}
+
+size_t QueryRewriteReport::count(QueryRewrite rewrite) const
+{
+    size_t count = 0;
+    for (const auto &applied : rewrites)
+    {
+        count += applied.rewrite == rewrite ? 1 : 0;
+    }
+    return count;
+}
+
+string QueryRewriteReport::toString() const
+{
+    ostringstream out;
+    for (const auto &applied : rewrites)
+    {
+        out << to_string(applied.rewrite) << ' ' << applied.path << '\n';
+    }
+    return out.str();
+}
+
+class OptimizedBool;
+
+/// A clause and its path in the query given. A nested bool is kept as its
+/// clauses until its parent is done flattening.
+class OptimizedClause
+{
+  public:
+    QueryPtr query;
+    string path;
+    shared_ptr<OptimizedBool> nested;
+};
+
+/// The clauses of a bool being rewritten.
+class OptimizedBool
+{
+  public:
+    vector<OptimizedClause> must;
+    vector<OptimizedClause> should;
+    vector<OptimizedClause> mustNot;
+    vector<OptimizedClause> filter;
+
+    size_t size() const
+    {
+        return must.size() + should.size() + mustNot.size() + filter.size();
+    }
+
+    QueryPtr toQuery() const
+    {
+        auto query = BoolQuery::newBoolQuery();
+        for (const auto &clause : must)
+        {
+            query->must(clause.query);
+        }
+        for (const auto &clause : should)
+        {
+            query->should(clause.query);
+        }
+        for (const auto &clause : mustNot)
+        {
+            query->mustNot(clause.query);
+        }
+        for (const auto &clause : filter)
+        {
+            query->filter(clause.query);
+        }
+        return query;
+    }
+};
+
+/// Clauses matching on exact values, whose score is not worth computing.
+static bool isExactClause(const QueryPtr &query)
+{
+    return dynamic_pointer_cast<TermQuery>(query) ||
+           dynamic_pointer_cast<RangeQuery>(query);
+}
+
+static void append(vector<OptimizedClause> &to, vector<OptimizedClause> &from)
+{
+    for (auto &clause : from)
+    {
+        to.push_back(std::move(clause));
+    }
+}
+
+class QueryOptimizerPass
+{
+  public:
+    QueryOptimizerPass(const QueryOptimizerOptions &options,
+                       QueryRewriteReport *report)
+        : options_(options), report_(report)
+    {
+    }
+
+    /// `scoring` says whether the score of the bool at `path` is used.
+    OptimizedBool rewrite(const BoolQuery &query,
+                          const string &path,
+                          bool scoring)
+    {
+        OptimizedBool result;
+        auto prefix = path.empty() ? string("bool.") : path + ".bool.";
+        auto rewriteClauses = [this, &prefix](const vector<QueryPtr> &clauses,
+                                              const char *name,
+                                              bool scoring,
+                                              vector<OptimizedClause> &to) {
+            for (size_t i = 0; i < clauses.size(); ++i)
+            {
+                OptimizedClause clause{clauses[i],
+                                       prefix + name + '[' +
+                                           std::to_string(i) + ']',
+                                       nullptr};
+                if (auto nested = dynamic_pointer_cast<BoolQuery>(clauses[i]))
+                {
+                    clause.nested = make_shared<OptimizedBool>(
+                        rewrite(*nested, clause.path, scoring));
+                }
+                to.push_back(std::move(clause));
+            }
+        };
+        rewriteClauses(query.must(), "must", scoring, result.must);
+        rewriteClauses(query.should(), "should", scoring, result.should);
+        rewriteClauses(query.mustNot(), "must_not", false, result.mustNot);
+        rewriteClauses(query.filter(), "filter", false, result.filter);
+
+        if (options_.flatten)
+        {
+            flatten(result, scoring);
+        }
+        for (auto *clauses :
+             {&result.must, &result.should, &result.mustNot, &result.filter})
+        {
+            for (auto &clause : *clauses)
+            {
+                if (clause.nested)
+                {
+                    clause.query = clause.nested->toQuery();
+                    clause.nested.reset();
+                }
+            }
+        }
+        if (!scoring)
+        {
+            moveExactClauses(result);
+        }
+        if (options_.deduplicate)
+        {
+            // a clause of must counted twice is scored twice
+            if (!scoring)
+            {
+                deduplicate(result.must);
+            }
+            deduplicate(result.filter);
+            deduplicate(result.mustNot);
+        }
+        return result;
+    }
+
+  private:
+    void record(QueryRewrite rewrite, const string &path)
+    {
+        if (report_)
+        {
+            report_->rewrites.push_back({rewrite, path});
+        }
+    }
+
+    /// Moves the clauses of the nested bools of `clauses` to `result` when
+    /// it changes neither the hits nor the scores. `scoring` says whether
+    /// the scores of `clauses` are used, `anchored` whether the parent keeps
+    /// a must or filter clause whatever is merged, see flatten().
+    void flattenClauses(vector<OptimizedClause> &clauses,
+                        vector<OptimizedClause> &to,
+                        OptimizedBool &result,
+                        bool scoring,
+                        bool conjunction,
+                        bool anchored)
+    {
+        for (auto &clause : clauses)
+        {
+            if (!clause.nested)
+            {
+                to.push_back(std::move(clause));
+                continue;
+            }
+            auto &nested = *clause.nested;
+            auto size = nested.size();
+            // bool{must: [q]} and bool{should: [q]} are q, so is
+            // bool{filter: [q]} when the score is not used
+            if (size == 1 && nested.must.size() + nested.should.size() +
+                                     (scoring ? 0 : nested.filter.size()) ==
+                                 1)
+            {
+                record(QueryRewrite::FLATTEN, clause.path);
+                append(to, nested.must);
+                append(to, nested.should);
+                append(to, nested.filter);
+            }
+            // the clauses of a conjunction without score join the filter of
+            // their parent, unless only must_not would be left of a parent
+            // with should clauses
+            else if (conjunction && !scoring && size > 0 &&
+                     nested.should.empty() &&
+                     (anchored || size > nested.mustNot.size()))
+            {
+                record(QueryRewrite::FLATTEN, clause.path);
+                append(result.filter, nested.must);
+                append(result.filter, nested.filter);
+                append(result.mustNot, nested.mustNot);
+            }
+            // scored ones join must, their scores are summed either way
+            else if (conjunction && size > 0 && size == nested.must.size())
+            {
+                record(QueryRewrite::FLATTEN, clause.path);
+                append(to, nested.must);
+            }
+            else
+            {
+                to.push_back(std::move(clause));
+            }
+        }
+    }
+
+    /// A bool with should clauses but no must nor filter requires one of
+    /// the should to match. So the nested bools of must_not only are merged
+    /// into a parent with should clauses only if another must or filter
+    /// clause stays in it.
+    static bool isAnchored(const OptimizedBool &result, bool scoring)
+    {
+        if (result.should.empty())
+        {
+            return true;
+        }
+        auto isMustNotOnly = [](const OptimizedClause &clause) {
+            return clause.nested && clause.nested->size() > 0 &&
+                   clause.nested->size() == clause.nested->mustNot.size();
+        };
+        for (const auto &clause : result.must)
+        {
+            // scored, it is never merged
+            if (scoring || !isMustNotOnly(clause))
+            {
+                return true;
+            }
+        }
+        for (const auto &clause : result.filter)
+        {
+            if (!isMustNotOnly(clause))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void flatten(OptimizedBool &result, bool scoring)
+    {
+        OptimizedBool flattened;
+        auto anchored = isAnchored(result, scoring);
+        flattenClauses(
+            result.must, flattened.must, flattened, scoring, true, anchored);
+        flattenClauses(result.should,
+                       flattened.should,
+                       flattened,
+                       scoring,
+                       false,
+                       anchored);
+        flattenClauses(
+            result.filter, flattened.filter, flattened, false, true, anchored);
+        flattenClauses(result.mustNot,
+                       flattened.mustNot,
+                       flattened,
+                       false,
+                       false,
+                       anchored);
+        result = std::move(flattened);
+    }
+
+    void moveExactClauses(OptimizedBool &result)
+    {
+        vector<OptimizedClause> must;
+        for (auto &clause : result.must)
+        {
+            if (!isExactClause(clause.query))
+            {
+                must.push_back(std::move(clause));
+            }
+            else if (options_.constantScore)
+            {
+                record(QueryRewrite::CONSTANT_SCORE, clause.path);
+                clause.query =
+                    ConstantScoreQuery::newConstantScoreQuery()->filter(
+                        clause.query);
+                must.push_back(std::move(clause));
+            }
+            else
+            {
+                record(QueryRewrite::MUST_TO_FILTER, clause.path);
+                result.filter.push_back(std::move(clause));
+            }
+        }
+        result.must = std::move(must);
+    }
+
+    void deduplicate(vector<OptimizedClause> &clauses)
+    {
+        unordered_set<Hash128> seen;
+        vector<OptimizedClause> unique;
+        for (auto &clause : clauses)
+        {
+            if (seen.insert(fingerprint(*clause.query).full).second)
+            {
+                unique.push_back(std::move(clause));
+            }
+            else
+            {
+                record(QueryRewrite::DEDUPLICATE, clause.path);
+            }
+        }
+        clauses = std::move(unique);
+    }
+
+  private:
+    const QueryOptimizerOptions &options_;
+    QueryRewriteReport *report_;
+};
+
+QueryPtr tl::elasticsearch::optimizeQuery(const QueryPtr &query,
+                                          const QueryOptimizerOptions &options,
+                                          QueryRewriteReport *report)
+{
+    auto boolQuery = dynamic_pointer_cast<BoolQuery>(query);
+    if (!boolQuery)
+    {
+        return query;
+    }
+    QueryOptimizerPass pass(options, report);
+    return pass.rewrite(*boolQuery, "", options.scoresNeeded).toQuery();
+}
+
+QueryRewriteReport tl::elasticsearch::optimizeQuery(
+    SearchParam &param,
+    QueryOptimizerOptions options)
+{
+    QueryRewriteReport report;
+    const auto &sort = param.sort();
+    if (!sort.empty() && sort.front().field() != "_score")
+    {
+        options.scoresNeeded = false;
+    }
+    param.query(optimizeQuery(param.query(), options, &report));
+    return report;
+}
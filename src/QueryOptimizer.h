@@ -0,0 +1,86 @@
+/**
+ *
+ *  QueryOptimizer.h
+ *
+ */
+
+#pragma once
+
+#include "DocumentsClient.h"
+#include "Query.h"
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+enum class QueryRewrite
+{
+    /// A term or range clause of must moved to filter.
+    MUST_TO_FILTER = 0,
+    /// A term or range clause of must wrapped in constant_score.
+    CONSTANT_SCORE,
+    /// A nested bool replaced by its only clause, or merged into its parent.
+    FLATTEN,
+    /// A clause removed because the same clause is already in its list.
+    DEDUPLICATE,
+};
+
+std::string to_string(QueryRewrite rewrite);
+
+/// One rewrite, at the path of the clause in the query given, e.g.
+/// "bool.must[1]".
+class AppliedRewrite
+{
+  public:
+    QueryRewrite rewrite;
+    std::string path;
+};
+
+class QueryRewriteReport
+{
+  public:
+    std::vector<AppliedRewrite> rewrites;
+
+    bool empty() const
+    {
+        return rewrites.empty();
+    }
+
+    size_t count(QueryRewrite rewrite) const;
+
+    /// One line per rewrite, e.g. for the logs.
+    std::string toString() const;
+};
+
+class QueryOptimizerOptions
+{
+  public:
+    /// False when the hits are sorted by a field or their scores are not
+    /// read: the term and range clauses of must are then rewritten. The
+    /// clauses of filter and must_not are never scored, whatever this says.
+    bool scoresNeeded = true;
+    /// Those clauses are wrapped in constant_score and stay in must instead
+    /// of moving to filter.
+    bool constantScore = false;
+    bool flatten = true;
+    bool deduplicate = true;
+};
+
+/// Rewrites the bool queries of `query` into ones Elasticsearch runs faster
+/// for the same hits: clauses which do not need a score go to the filter
+/// context, where they are not scored and can be cached; nested bools of one
+/// clause are flattened; identical clauses are removed where it changes no
+/// score. The queries given are not modified, the rewritten bools are new
+/// ones and the other queries are shared. Only the builders of Query.h are
+/// rewritten, e.g. a QueryTree is returned as it is.
+QueryPtr optimizeQuery(const QueryPtr &query,
+                       const QueryOptimizerOptions &options = {},
+                       QueryRewriteReport *report = nullptr);
+
+/// Optimizes the query of `param` in place. Scores are not needed when its
+/// first sort is a field other than _score, whatever `options` says.
+QueryRewriteReport optimizeQuery(SearchParam &param,
+                                 QueryOptimizerOptions options = {});
+
+};  // namespace tl::elasticsearch
@@ -0,0 +1,275 @@
+/**
+ *
+ *  QueryTemplate.h
+ *
+ */
+
+#pragma once
+
+#include "JsonWriter.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+/// The JSON text of a QueryTemplate, as a template argument.
+template <size_t N>
+class TemplateText
+{
+  public:
+    constexpr TemplateText(const char (&text)[N])
+    {
+        std::copy_n(text, N, chars);
+    }
+
+    constexpr std::string_view view() const
+    {
+        return std::string_view(chars, N - 1);
+    }
+
+    // public to be a template argument
+    char chars[N];
+};
+
+/// Character types are integral, but a character written as a number is
+/// never what was meant: they are not template parameters.
+template <typename Tp>
+concept TemplateCharacter =
+    std::same_as<Tp, char> || std::same_as<Tp, wchar_t> ||
+    std::same_as<Tp, char8_t> || std::same_as<Tp, char16_t> ||
+    std::same_as<Tp, char32_t>;
+
+/// The values a placeholder can take: strings are escaped and quoted,
+/// numbers and booleans are written as they are, a vector of strings as an
+/// array.
+template <typename Tp>
+concept TemplateParam =
+    std::convertible_to<Tp, std::string_view> ||
+    (std::integral<Tp> && !TemplateCharacter<Tp>) ||
+    std::floating_point<Tp> || std::same_as<Tp, std::vector<std::string>>;
+
+namespace detail
+{
+/// Bytes of the text between two placeholders.
+class TemplateFragment
+{
+  public:
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+/// The text without the whitespace outside of JSON strings.
+template <size_t N>
+class CompactText
+{
+  public:
+    std::array<char, N> chars{};
+    size_t size = 0;
+};
+
+template <size_t N>
+constexpr CompactText<N> compactTemplate(std::string_view text)
+{
+    CompactText<N> result;
+    bool inString = false;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        auto c = text[i];
+        if (inString)
+        {
+            if (c == '\\' && i + 1 < text.size())
+            {
+                result.chars[result.size++] = c;
+                c = text[++i];
+            }
+            else if (c == '"')
+            {
+                inString = false;
+            }
+        }
+        else if (c == '"')
+        {
+            inString = true;
+        }
+        else if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+        {
+            continue;
+        }
+        result.chars[result.size++] = c;
+    }
+    return result;
+}
+
+/// Placeholders are {{name}} outside of JSON strings, where valid JSON never
+/// has "{{". The name only documents the value. Returns the number of
+/// placeholders and writes the fragments around them to `fragments`, when
+/// given, up to `capacity`. A placeholder which is not closed does not
+/// compile.
+constexpr size_t scanTemplate(std::string_view text,
+                              TemplateFragment *fragments,
+                              size_t capacity)
+{
+    size_t count = 0;
+    size_t start = 0;
+    bool inString = false;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (inString)
+        {
+            if (text[i] == '\\')
+            {
+                ++i;
+            }
+            else if (text[i] == '"')
+            {
+                inString = false;
+            }
+            continue;
+        }
+        if (text[i] == '"')
+        {
+            inString = true;
+            continue;
+        }
+        if (text.substr(i, 2) != "{{")
+        {
+            continue;
+        }
+        auto end = text.find("}}", i + 2);
+        if (end == std::string_view::npos)
+        {
+            throw "a placeholder of the template is not closed";
+        }
+        if (fragments && count < capacity)
+        {
+            fragments[count] = TemplateFragment{start, i - start};
+        }
+        ++count;
+        start = end + 2;
+        i = end + 1;
+    }
+    if (fragments && count < capacity)
+    {
+        fragments[count] = TemplateFragment{start, text.size() - start};
+    }
+    return count;
+}
+
+template <typename Tp>
+void appendTemplateValue(std::string &out, const Tp &value)
+{
+    if constexpr (std::same_as<Tp, bool>)
+    {
+        appendJsonBool(out, value);
+    }
+    else if constexpr (std::unsigned_integral<Tp>)
+    {
+        // above INT64_MAX, a cast to int64_t would turn it negative
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+    else if constexpr (std::integral<Tp>)
+    {
+        appendJsonNumber(out, static_cast<int64_t>(value));
+    }
+    else if constexpr (std::floating_point<Tp>)
+    {
+        appendJsonNumber(out, static_cast<double>(value));
+    }
+    else if constexpr (std::same_as<Tp, std::vector<std::string>>)
+    {
+        out += '[';
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            if (i > 0)
+            {
+                out += ',';
+            }
+            appendJsonString(out, value[i]);
+        }
+        out += ']';
+    }
+    else
+    {
+        appendJsonString(out, std::string_view(value));
+    }
+}
+};  // namespace detail
+
+/// A request body whose shape is fixed at compile time, with a typed
+/// placeholder per value. The text is split once by the compiler, so
+/// rendering only copies the fragments and writes the values:
+///
+///     using AccountsByState = QueryTemplate<R"({
+///         "query": {"bool": {"filter": [
+///             {"term": {"state": {"value": {{state}}}}},
+///             {"range": {"age": {"gte": {{min_age}}}}}]}},
+///         "size": {{size}}})",
+///         std::string_view,
+///         int,
+///         int>;
+///
+///     SearchParam param("accounts");
+///     param.body(AccountsByState::render("IL", 30, 10));
+///
+/// The number of types must match the number of placeholders, otherwise the
+/// template does not compile.
+template <TemplateText Text, TemplateParam... Params>
+class QueryTemplate
+{
+  private:
+    static constexpr auto compact_ =
+        detail::compactTemplate<sizeof(Text.chars)>(Text.view());
+    static constexpr std::string_view body_{compact_.chars.data(),
+                                            compact_.size};
+
+  public:
+    static constexpr size_t placeholders = sizeof...(Params);
+
+    static_assert(detail::scanTemplate(body_, nullptr, 0) == placeholders,
+                  "one type is needed per placeholder of the template");
+
+    /// The body sent, without the whitespace of the declaration.
+    static constexpr std::string_view text()
+    {
+        return body_;
+    }
+
+    static std::string render(const Params &...values)
+    {
+        std::string out;
+        render(out, values...);
+        return out;
+    }
+
+    /// Appends to `out`, to reuse its buffer.
+    static void render(std::string &out, const Params &...values)
+    {
+        out.reserve(out.size() + body_.size() + 16 * placeholders);
+        size_t index = 0;
+        auto appendFragment = [&out, &index]() {
+            const auto &fragment = fragments_[index++];
+            out.append(body_.data() + fragment.offset, fragment.size);
+        };
+        ((appendFragment(), detail::appendTemplateValue(out, values)), ...);
+        appendFragment();
+    }
+
+  private:
+    static constexpr auto fragments_ = []() {
+        std::array<detail::TemplateFragment, placeholders + 1> fragments{};
+        detail::scanTemplate(body_, fragments.data(), fragments.size());
+        return fragments;
+    }();
+};
+
+};  // namespace tl::elasticsearch
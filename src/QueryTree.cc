@@ -0,0 +1,575 @@
+/**
+ *
+ *  QueryTree.cc
+ *
+ */
+
+#include "QueryTree.h"
+#include "JsonWriter.h"
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+string tl::elasticsearch::to_string(QueryKind kind)
+{
+    switch (kind)
+    {
+        case QueryKind::MATCH_ALL:
+            return "match_all";
+        case QueryKind::MATCH:
+            return "match";
+        case QueryKind::MATCH_PHRASE:
+            return "match_phrase";
+        case QueryKind::MULTI_MATCH:
+            return "multi_match";
+        case QueryKind::TERM:
+            return "term";
+        case QueryKind::RANGE:
+            return "range";
+        case QueryKind::BOOL:
+            return "bool";
+        default:
+            return "unknown";
+    }
+}
+
+void RangeBounds::check() const
+{
+    if (lt && lte)
+    {
+        throw ElasticSearchException("Cannot set lt and lte at the same time.");
+    }
+    if (gt && gte)
+    {
+        throw ElasticSearchException("Cannot set gt and gte at the same time.");
+    }
+    if (!gt && !gte && !lt && !lte)
+    {
+        throw ElasticSearchException("Please set at least one condition.");
+    }
+    if (gte && lte && *gte > *lte)
+    {
+        throw ElasticSearchException("Gte cannot be greater than lte.");
+    }
+    if (gte && lt && *gte >= *lt)
+    {
+        throw ElasticSearchException(
+            "Gte cannot be greater than or equal to lt.");
+    }
+    if (gt && lte && *gt >= *lte)
+    {
+        throw ElasticSearchException(
+            "Gt cannot be greater than or equal to lte.");
+    }
+    if (gt && lt && *gt >= *lt)
+    {
+        throw ElasticSearchException(
+            "Gt cannot be greater than or equal to lt.");
+    }
+}
+
+QueryTree::QueryTree(pmr::memory_resource *resource)
+    : nodes_(resource), children_(resource), fields_(resource), text_(resource)
+{
+    // enough for a bool of a few clauses without growing
+    nodes_.reserve(8);
+    children_.reserve(8);
+    text_.reserve(128);
+}
+
+QueryTreePtr QueryTree::newQueryTree(pmr::memory_resource *resource)
+{
+    return allocate_shared<QueryTree>(pmr::polymorphic_allocator<QueryTree>(
+                                          resource),
+                                      resource);
+}
+
+QueryTreePtr QueryTree::fromJson(const Json::Value &json,
+                                 pmr::memory_resource *resource)
+{
+    auto tree = newQueryTree(resource);
+    tree->setRoot(tree->addJson(json));
+    return tree;
+}
+
+QueryTree::TextRef QueryTree::addText(string_view value)
+{
+    TextRef ref;
+    ref.offset = static_cast<uint32_t>(text_.size());
+    ref.size = static_cast<uint32_t>(value.size());
+    text_.append(value);
+    return ref;
+}
+
+QueryTree::Span QueryTree::addChildren(span<const NodeId> ids)
+{
+    Span span;
+    span.first = static_cast<uint32_t>(children_.size());
+    span.size = static_cast<uint32_t>(ids.size());
+    for (auto id : ids)
+    {
+        if (id >= nodes_.size())
+        {
+            throw ElasticSearchException("Unknown query node " +
+                                         std::to_string(id));
+        }
+        children_.push_back(id);
+    }
+    return span;
+}
+
+QueryTree::NodeId QueryTree::addNode(Node node)
+{
+    nodes_.push_back(std::move(node));
+    return static_cast<NodeId>(nodes_.size() - 1);
+}
+
+QueryTree::NodeId QueryTree::matchAll()
+{
+    return addNode(MatchAllNode());
+}
+
+QueryTree::NodeId QueryTree::match(string_view field, string_view query)
+{
+    return addNode(MatchNode{addText(field), addText(query)});
+}
+
+QueryTree::NodeId QueryTree::matchPhrase(string_view field, string_view query)
+{
+    return addNode(MatchPhraseNode{addText(field), addText(query)});
+}
+
+QueryTree::NodeId QueryTree::multiMatch(
+    initializer_list<string_view> fields,
+    string_view query)
+{
+    if (fields.size() == 0)
+    {
+        throw ElasticSearchException("MultiMatchQuery must support fields.");
+    }
+    MultiMatchNode node;
+    node.fields.first = static_cast<uint32_t>(fields_.size());
+    node.fields.size = static_cast<uint32_t>(fields.size());
+    for (auto field : fields)
+    {
+        fields_.push_back(addText(field));
+    }
+    node.query = addText(query);
+    return addNode(node);
+}
+
+QueryTree::NodeId QueryTree::multiMatch(span<const string> fields,
+                                        string_view query)
+{
+    if (fields.empty())
+    {
+        throw ElasticSearchException("MultiMatchQuery must support fields.");
+    }
+    MultiMatchNode node;
+    node.fields.first = static_cast<uint32_t>(fields_.size());
+    node.fields.size = static_cast<uint32_t>(fields.size());
+    for (const auto &field : fields)
+    {
+        fields_.push_back(addText(field));
+    }
+    node.query = addText(query);
+    return addNode(node);
+}
+
+QueryTree::NodeId QueryTree::term(string_view field, string_view value)
+{
+    return addNode(TermNode{addText(field), addText(value)});
+}
+
+QueryTree::NodeId QueryTree::range(string_view field,
+                                   const RangeBounds &bounds)
+{
+    bounds.check();
+    return addNode(RangeNode{addText(field), bounds});
+}
+
+QueryTree::NodeId QueryTree::boolQuery(initializer_list<NodeId> must,
+                                       initializer_list<NodeId> should,
+                                       initializer_list<NodeId> mustNot,
+                                       initializer_list<NodeId> filter)
+{
+    return boolQuery(span<const NodeId>(must.begin(), must.size()),
+                     span<const NodeId>(should.begin(), should.size()),
+                     span<const NodeId>(mustNot.begin(), mustNot.size()),
+                     span<const NodeId>(filter.begin(), filter.size()));
+}
+
+QueryTree::NodeId QueryTree::boolQuery(span<const NodeId> must,
+                                       span<const NodeId> should,
+                                       span<const NodeId> mustNot,
+                                       span<const NodeId> filter)
+{
+    BoolNode node;
+    node.must = addChildren(must);
+    node.should = addChildren(should);
+    node.mustNot = addChildren(mustNot);
+    node.filter = addChildren(filter);
+    return addNode(node);
+}
+
+void QueryTree::setRoot(NodeId root)
+{
+    if (root >= nodes_.size())
+    {
+        throw ElasticSearchException("Unknown query node " +
+                                     std::to_string(root));
+    }
+    root_ = root;
+}
+
+QueryTree::NodeId QueryTree::root() const
+{
+    if (nodes_.empty())
+    {
+        throw ElasticSearchException("The query tree is empty.");
+    }
+    return root_ ? *root_ : static_cast<NodeId>(nodes_.size() - 1);
+}
+
+/// The field and the value of {"field": value} or
+/// {"field": {"<key>": value}}.
+static pair<string, string> fieldAndValue(const Json::Value &body,
+                                          const char *key,
+                                          const string &name)
+{
+    if (!body.isObject() || body.size() != 1)
+    {
+        throw ElasticSearchException(name + " must have exactly one field.");
+    }
+    auto field = body.getMemberNames().front();
+    auto value = body[field];
+    if (value.isObject())
+    {
+        value = value[key];
+    }
+    if (value.isNull() || value.isObject() || value.isArray())
+    {
+        throw ElasticSearchException("Unsupported value in " + name + ".");
+    }
+    return {field, value.asString()};
+}
+
+QueryTree::NodeId QueryTree::addJson(const Json::Value &json)
+{
+    if (!json.isObject() || json.size() != 1)
+    {
+        throw ElasticSearchException("A query must be an object of one key.");
+    }
+    auto name = json.getMemberNames().front();
+    const auto &body = json[name];
+    if (name == "match_all")
+    {
+        return matchAll();
+    }
+    if (name == "match")
+    {
+        auto [field, query] = fieldAndValue(body, "query", name);
+        return match(field, query);
+    }
+    if (name == "match_phrase")
+    {
+        auto [field, query] = fieldAndValue(body, "query", name);
+        return matchPhrase(field, query);
+    }
+    if (name == "term")
+    {
+        auto [field, value] = fieldAndValue(body, "value", name);
+        return term(field, value);
+    }
+    if (name == "multi_match")
+    {
+        vector<string> fields;
+        for (const auto &field : body["fields"])
+        {
+            fields.push_back(field.asString());
+        }
+        return multiMatch(fields, body["query"].asString());
+    }
+    if (name == "range")
+    {
+        if (!body.isObject() || body.size() != 1)
+        {
+            throw ElasticSearchException("range must have exactly one field.");
+        }
+        auto field = body.getMemberNames().front();
+        const auto &bounds = body[field];
+        RangeBounds result;
+        for (const auto &key : bounds.getMemberNames())
+        {
+            if (!bounds[key].isNumeric())
+            {
+                throw ElasticSearchException("Unsupported bound " + key +
+                                             " in range.");
+            }
+            auto value = bounds[key].asDouble();
+            if (key == "gt")
+            {
+                result.gt = value;
+            }
+            else if (key == "gte")
+            {
+                result.gte = value;
+            }
+            else if (key == "lt")
+            {
+                result.lt = value;
+            }
+            else if (key == "lte")
+            {
+                result.lte = value;
+            }
+            else
+            {
+                throw ElasticSearchException("Unsupported bound " + key +
+                                             " in range.");
+            }
+        }
+        return range(field, result);
+    }
+    if (name == "bool")
+    {
+        vector<NodeId> clauses[4];
+        for (const auto &key : body.getMemberNames())
+        {
+            // BoolQuery writes must_not as mustNot
+            int clause = key == "must"                         ? 0
+                         : key == "should"                     ? 1
+                         : key == "must_not" || key == "mustNot" ? 2
+                         : key == "filter"                     ? 3
+                                                               : -1;
+            if (clause < 0)
+            {
+                throw ElasticSearchException("Unsupported clause " + key +
+                                             " in bool.");
+            }
+            const auto &children = body[key];
+            if (children.isArray())
+            {
+                for (const auto &child : children)
+                {
+                    clauses[clause].push_back(addJson(child));
+                }
+            }
+            else
+            {
+                clauses[clause].push_back(addJson(children));
+            }
+        }
+        return boolQuery(clauses[0], clauses[1], clauses[2], clauses[3]);
+    }
+    throw ElasticSearchException("Unsupported query " + name + ".");
+}
+
+Json::Value QueryTree::toJson() const
+{
+    return nodeJson(root());
+}
+
+Json::Value QueryTree::nodeJson(NodeId id) const
+{
+    Json::Value json;
+    const auto &node = nodes_[id];
+    switch (kind(node))
+    {
+        case QueryKind::MATCH_ALL:
+            json["match_all"] = Json::Value(Json::objectValue);
+            break;
+        case QueryKind::MATCH:
+        {
+            const auto &match = get<MatchNode>(node);
+            json["match"][string(text(match.field))] = string(
+                text(match.query));
+            break;
+        }
+        case QueryKind::MATCH_PHRASE:
+        {
+            const auto &match = get<MatchPhraseNode>(node);
+            json["match_phrase"][string(text(match.field))] = string(
+                text(match.query));
+            break;
+        }
+        case QueryKind::MULTI_MATCH:
+        {
+            const auto &match = get<MultiMatchNode>(node);
+            auto &body = json["multi_match"];
+            body["query"] = string(text(match.query));
+            for (auto field : fields(match.fields))
+            {
+                body["fields"].append(string(text(field)));
+            }
+            break;
+        }
+        case QueryKind::TERM:
+        {
+            const auto &term = get<TermNode>(node);
+            json["term"][string(text(term.field))]["value"] = string(
+                text(term.value));
+            break;
+        }
+        case QueryKind::RANGE:
+        {
+            const auto &range = get<RangeNode>(node);
+            auto &bounds = json["range"][string(text(range.field))];
+            const auto &[gt, gte, lt, lte] = range.bounds;
+            if (gt)
+            {
+                bounds["gt"] = *gt;
+            }
+            if (gte)
+            {
+                bounds["gte"] = *gte;
+            }
+            if (lt)
+            {
+                bounds["lt"] = *lt;
+            }
+            if (lte)
+            {
+                bounds["lte"] = *lte;
+            }
+            break;
+        }
+        case QueryKind::BOOL:
+        {
+            const auto &clauses = get<BoolNode>(node);
+            auto &body = json["bool"];
+            body = Json::Value(Json::objectValue);
+            auto addClause = [this, &body](const char *name, Span span) {
+                for (auto child : children(span))
+                {
+                    body[name].append(nodeJson(child));
+                }
+            };
+            addClause("must", clauses.must);
+            addClause("should", clauses.should);
+            addClause("must_not", clauses.mustNot);
+            addClause("filter", clauses.filter);
+            break;
+        }
+    }
+    return json;
+}
+
+void QueryTree::writeJson(string &out) const
+{
+    writeNode(out, root());
+}
+
+void QueryTree::writeNode(string &out, NodeId id) const
+{
+    const auto &node = nodes_[id];
+    switch (kind(node))
+    {
+        case QueryKind::MATCH_ALL:
+            out += R"({"match_all":{}})";
+            break;
+        case QueryKind::MATCH:
+        {
+            const auto &match = get<MatchNode>(node);
+            out += R"({"match":{)";
+            appendJsonString(out, text(match.field));
+            out += ':';
+            appendJsonString(out, text(match.query));
+            out += "}}";
+            break;
+        }
+        case QueryKind::MATCH_PHRASE:
+        {
+            const auto &match = get<MatchPhraseNode>(node);
+            out += R"({"match_phrase":{)";
+            appendJsonString(out, text(match.field));
+            out += ':';
+            appendJsonString(out, text(match.query));
+            out += "}}";
+            break;
+        }
+        case QueryKind::MULTI_MATCH:
+        {
+            const auto &match = get<MultiMatchNode>(node);
+            out += R"({"multi_match":{"query":)";
+            appendJsonString(out, text(match.query));
+            out += R"(,"fields":[)";
+            const char *separator = "";
+            for (auto field : fields(match.fields))
+            {
+                out += separator;
+                appendJsonString(out, text(field));
+                separator = ",";
+            }
+            out += "]}}";
+            break;
+        }
+        case QueryKind::TERM:
+        {
+            const auto &term = get<TermNode>(node);
+            out += R"({"term":{)";
+            appendJsonString(out, text(term.field));
+            out += R"(:{"value":)";
+            appendJsonString(out, text(term.value));
+            out += "}}}";
+            break;
+        }
+        case QueryKind::RANGE:
+        {
+            const auto &range = get<RangeNode>(node);
+            out += R"({"range":{)";
+            appendJsonString(out, text(range.field));
+            out += ":{";
+            const char *separator = "";
+            auto addBound = [&out, &separator](const char *name,
+                                               const optional<double> &value) {
+                if (!value)
+                {
+                    return;
+                }
+                out += separator;
+                appendJsonString(out, name);
+                out += ':';
+                appendJsonNumber(out, *value);
+                separator = ",";
+            };
+            addBound("gt", range.bounds.gt);
+            addBound("gte", range.bounds.gte);
+            addBound("lt", range.bounds.lt);
+            addBound("lte", range.bounds.lte);
+            out += "}}}";
+            break;
+        }
+        case QueryKind::BOOL:
+        {
+            const auto &clauses = get<BoolNode>(node);
+            out += R"({"bool":{)";
+            const char *separator = "";
+            auto addClause = [this, &out, &separator](const char *name,
+                                                      Span span) {
+                if (span.size == 0)
+                {
+                    return;
+                }
+                out += separator;
+                appendJsonString(out, name);
+                out += ":[";
+                const char *comma = "";
+                for (auto child : children(span))
+                {
+                    out += comma;
+                    writeNode(out, child);
+                    comma = ",";
+                }
+                out += ']';
+                separator = ",";
+            };
+            addClause("must", clauses.must);
+            addClause("should", clauses.should);
+            addClause("must_not", clauses.mustNot);
+            addClause("filter", clauses.filter);
+            out += "}}";
+            break;
+        }
+    }
+}
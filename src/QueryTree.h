@@ -0,0 +1,273 @@
+/**
+ *
+ *  QueryTree.h
+ *
+ */
+
+#pragma once
+
+#include "ElasticSearchException.h"
+#include "Query.h"
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+/// Memory for the QueryTrees of a request: `Size` bytes inline, e.g. on the
+/// stack, then the heap once they are used up. Nothing is freed before the
+/// arena is destroyed, so it must outlive the trees and the params using
+/// them.
+template <size_t Size = 2048>
+class QueryArena : public std::pmr::monotonic_buffer_resource
+{
+  public:
+    QueryArena() : std::pmr::monotonic_buffer_resource(buffer_, Size)
+    {
+    }
+
+    QueryArena(const QueryArena &) = delete;
+    QueryArena &operator=(const QueryArena &) = delete;
+
+  private:
+    alignas(std::max_align_t) std::byte buffer_[Size];
+};
+
+enum class QueryKind
+{
+    MATCH_ALL = 0,
+    MATCH,
+    MATCH_PHRASE,
+    MULTI_MATCH,
+    TERM,
+    RANGE,
+    BOOL
+};
+
+std::string to_string(QueryKind kind);
+
+/// Bounds of a range node, unset ones are left out.
+class RangeBounds
+{
+  public:
+    std::optional<double> gt;
+    std::optional<double> gte;
+    std::optional<double> lt;
+    std::optional<double> lte;
+
+    /// Throws ElasticSearchException on the bounds RangeQuery rejects.
+    void check() const;
+};
+
+/// A query as one value: its nodes are stored in a flat array, the children
+/// of a bool clause next to each other, the strings in one buffer and the
+/// range bounds inline. With a QueryArena, building a tree allocates nothing
+/// on the heap. It is a Query, so it is given to SearchParam and CountParam
+/// like the builders:
+///
+///     QueryArena<> arena;
+///     auto tree = QueryTree::newQueryTree(&arena);
+///     tree->boolQuery({tree->match("address", "lane")},
+///                     {},
+///                     {},
+///                     {tree->term("gender", "F"),
+///                      tree->range("age", {.gte = 20, .lt = 40})});
+///     param.query(tree);
+///
+/// A node is added after its children, the root is the last node added
+/// unless setRoot() says otherwise.
+class QueryTree : public Query
+{
+  public:
+    using NodeId = uint32_t;
+
+    /// Bytes of text(), the strings of the tree.
+    class TextRef
+    {
+      public:
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    /// Consecutive entries of children() or fields().
+    class Span
+    {
+      public:
+        uint32_t first = 0;
+        uint32_t size = 0;
+    };
+
+    class MatchAllNode
+    {
+    };
+
+    class MatchNode
+    {
+      public:
+        TextRef field;
+        TextRef query;
+    };
+
+    class MatchPhraseNode
+    {
+      public:
+        TextRef field;
+        TextRef query;
+    };
+
+    class MultiMatchNode
+    {
+      public:
+        Span fields;
+        TextRef query;
+    };
+
+    class TermNode
+    {
+      public:
+        TextRef field;
+        TextRef value;
+    };
+
+    class RangeNode
+    {
+      public:
+        TextRef field;
+        RangeBounds bounds;
+    };
+
+    class BoolNode
+    {
+      public:
+        Span must;
+        Span should;
+        Span mustNot;
+        Span filter;
+    };
+
+    /// In the order of QueryKind.
+    using Node = std::variant<MatchAllNode,
+                              MatchNode,
+                              MatchPhraseNode,
+                              MultiMatchNode,
+                              TermNode,
+                              RangeNode,
+                              BoolNode>;
+
+    explicit QueryTree(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    /// The tree and its nodes are both allocated from `resource`.
+    static std::shared_ptr<QueryTree> newQueryTree(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    /// Converts the JSON of a query, e.g. the toJson() of the builders.
+    /// Throws ElasticSearchException on the queries a tree cannot hold.
+    static std::shared_ptr<QueryTree> fromJson(
+        const Json::Value &json,
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    static std::shared_ptr<QueryTree> fromQuery(
+        const QueryPtr &query,
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    {
+        return fromJson(query->toJson(), resource);
+    }
+
+  public:
+    NodeId matchAll();
+    NodeId match(std::string_view field, std::string_view query);
+    NodeId matchPhrase(std::string_view field, std::string_view query);
+    NodeId multiMatch(std::initializer_list<std::string_view> fields,
+                      std::string_view query);
+    NodeId multiMatch(std::span<const std::string> fields,
+                      std::string_view query);
+    NodeId term(std::string_view field, std::string_view value);
+    /// Throws ElasticSearchException if the bounds conflict.
+    NodeId range(std::string_view field, const RangeBounds &bounds);
+    /// Throws ElasticSearchException if a child is not a node of the tree.
+    NodeId boolQuery(std::initializer_list<NodeId> must,
+                     std::initializer_list<NodeId> should = {},
+                     std::initializer_list<NodeId> mustNot = {},
+                     std::initializer_list<NodeId> filter = {});
+    NodeId boolQuery(std::span<const NodeId> must,
+                     std::span<const NodeId> should,
+                     std::span<const NodeId> mustNot,
+                     std::span<const NodeId> filter);
+
+    void setRoot(NodeId root);
+
+    /// Throws ElasticSearchException if the tree is empty.
+    NodeId root() const;
+
+    size_t size() const
+    {
+        return nodes_.size();
+    }
+
+    bool empty() const
+    {
+        return nodes_.empty();
+    }
+
+    const Node &node(NodeId id) const
+    {
+        return nodes_[id];
+    }
+
+    static QueryKind kind(const Node &node)
+    {
+        return static_cast<QueryKind>(node.index());
+    }
+
+    std::string_view text(TextRef ref) const
+    {
+        return std::string_view(text_).substr(ref.offset, ref.size);
+    }
+
+    std::span<const NodeId> children(Span span) const
+    {
+        return std::span<const NodeId>(children_).subspan(span.first,
+                                                          span.size);
+    }
+
+    std::span<const TextRef> fields(Span span) const
+    {
+        return std::span<const TextRef>(fields_).subspan(span.first,
+                                                         span.size);
+    }
+
+    Json::Value toJson() const override;
+
+    /// Appends the compact JSON of the query to `out`, without building a
+    /// Json::Value.
+    void writeJson(std::string &out) const;
+
+  private:
+    TextRef addText(std::string_view value);
+    Span addChildren(std::span<const NodeId> ids);
+    NodeId addNode(Node node);
+    NodeId addJson(const Json::Value &json);
+    Json::Value nodeJson(NodeId id) const;
+    void writeNode(std::string &out, NodeId id) const;
+
+  private:
+    std::pmr::vector<Node> nodes_;
+    std::pmr::vector<NodeId> children_;
+    std::pmr::vector<TextRef> fields_;
+    std::pmr::string text_;
+    std::optional<NodeId> root_;
+};
+
+using QueryTreePtr = std::shared_ptr<QueryTree>;
+
+};  // namespace tl::elasticsearch
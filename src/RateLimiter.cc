@@ -0,0 +1,85 @@
+/**
+ *
+ *  RateLimiter.cc
+ *
+ */
+
+#include "RateLimiter.h"
+#include <algorithm>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+string tl::elasticsearch::to_string(RateLimitUnit unit)
+{
+    switch (unit)
+    {
+        case RateLimitUnit::DOCUMENTS:
+            return "documents";
+        case RateLimitUnit::BYTES:
+            return "bytes";
+    }
+    return "unknown";
+}
+
+RateLimiter::RateLimiter(const RateLimitConfig &config,
+                         Clock::time_point now)
+    : config_(config), lastRefill_(now)
+{
+    tokens_ = burst();
+}
+
+RateLimiter::Clock::duration RateLimiter::reserve(size_t documents,
+                                                  size_t bytes,
+                                                  Clock::time_point now)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (config_.rate <= 0)
+    {
+        return Clock::duration::zero();
+    }
+    refill(now);
+    auto cost = static_cast<double>(
+        config_.unit == RateLimitUnit::DOCUMENTS ? documents : bytes);
+    tokens_ -= cost;
+    if (tokens_ >= 0)
+    {
+        return Clock::duration::zero();
+    }
+    ++delayedRequests_;
+    return chrono::duration_cast<Clock::duration>(
+        chrono::duration<double>(-tokens_ / config_.rate));
+}
+
+void RateLimiter::setRate(double rate, double burst, Clock::time_point now)
+{
+    lock_guard<mutex> lock(mutex_);
+    refill(now);
+    bool wasUnlimited = config_.rate <= 0;
+    config_.rate = rate;
+    config_.burst = burst;
+    tokens_ = wasUnlimited ? this->burst() : min(tokens_, this->burst());
+}
+
+void RateLimiter::refill(Clock::time_point now)
+{
+    if (now <= lastRefill_)
+    {
+        return;
+    }
+    chrono::duration<double> elapsed = now - lastRefill_;
+    lastRefill_ = now;
+    tokens_ = min(burst(), tokens_ + elapsed.count() * config_.rate);
+}
+
+RateLimitConfig RateLimiter::config() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return config_;
+}
+
+uint64_t RateLimiter::delayedRequests() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return delayedRequests_;
+}
@@ -0,0 +1,86 @@
+/**
+ *
+ *  RateLimiter.h
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace tl::elasticsearch
+{
+
+/// What a token of the rate limiter stands for.
+enum class RateLimitUnit
+{
+    DOCUMENTS = 0,
+    BYTES
+};
+
+std::string to_string(RateLimitUnit unit);
+
+class RateLimitConfig
+{
+  public:
+    RateLimitUnit unit = RateLimitUnit::DOCUMENTS;
+    /// Tokens per second, 0 means unlimited.
+    double rate = 0;
+    /// Size of the bucket, i.e. the largest burst. 0 means one second worth
+    /// of tokens.
+    double burst = 0;
+};
+
+/// Token bucket limiting the write traffic (index and bulk requests).
+///
+/// A request never waits for tokens: it reserves its cost right away, the
+/// bucket may go into debt, and the caller delays the dispatch by the
+/// returned duration. This way a request larger than the bucket still goes
+/// through, and the next ones pay for it.
+class RateLimiter
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    RateLimiter(const RateLimitConfig &config,
+                Clock::time_point now = Clock::now());
+
+  public:
+    /// Takes the tokens of a request and returns how long it has to wait.
+    Clock::duration reserve(size_t documents,
+                            size_t bytes,
+                            Clock::time_point now = Clock::now());
+
+    /// Changes the rate at runtime, the tokens already earned are kept.
+    void setRate(double rate,
+                 double burst = 0,
+                 Clock::time_point now = Clock::now());
+
+    RateLimitConfig config() const;
+
+    /// Requests which had to wait so far.
+    uint64_t delayedRequests() const;
+
+  private:
+    void refill(Clock::time_point now);
+
+    double burst() const
+    {
+        return config_.burst > 0 ? config_.burst : config_.rate;
+    }
+
+  private:
+    mutable std::mutex mutex_;
+    RateLimitConfig config_;
+    // negative while in debt
+    double tokens_;
+    Clock::time_point lastRefill_;
+    uint64_t delayedRequests_ = 0;
+};
+
+using RateLimiterPtr = std::shared_ptr<RateLimiter>;
+
+};  // namespace tl::elasticsearch
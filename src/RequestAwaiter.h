@@ -0,0 +1,121 @@
+/**
+ *
+ *  RequestAwaiter.h
+ *
+ */
+
+#pragma once
+
+#include "ElasticSearchException.h"
+#include <trantor/net/EventLoop.h>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace tl::elasticsearch
+{
+
+/// Result of an asynchronous request for `co_await`, e.g. in a
+/// `drogon::Task<>` or `drogon::AsyncTask`.
+///
+/// The request is sent when the awaiter is created, not when it is awaited,
+/// so a coroutine can start several requests and then await them one by one
+/// while they run concurrently. The coroutine resumes on the event loop it
+/// was suspended on; an ElasticSearchException is rethrown by `co_await`.
+template <typename Tp>
+class RequestAwaiter
+{
+  public:
+    using ResultCallback = std::function<void(const Tp &)>;
+    using ExceptionCallback =
+        std::function<void(const ElasticSearchException &)>;
+
+    /// `start` sends the request with the given callbacks.
+    RequestAwaiter(const std::function<void(ResultCallback &&,
+                                            ExceptionCallback &&)> &start)
+        : state_(std::make_shared<State>())
+    {
+        auto state = state_;
+        start(
+            [state](const Tp &result) {
+                state->complete([&result](State &s) { s.result = result; });
+            },
+            [state](const ElasticSearchException &err) {
+                state->complete([&err](State &s) {
+                    s.exception = std::make_exception_ptr(err);
+                });
+            });
+    }
+
+  public:
+    bool await_ready() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->done;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->done)
+        {
+            return false;
+        }
+        state_->handle = handle;
+        state_->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+        return true;
+    }
+
+    Tp await_resume()
+    {
+        if (state_->exception)
+        {
+            std::rethrow_exception(state_->exception);
+        }
+        return std::move(*state_->result);
+    }
+
+  private:
+    // shared with the callbacks, which may outlive the awaiter
+    struct State
+    {
+        std::mutex mutex;
+        bool done = false;
+        std::optional<Tp> result;
+        std::exception_ptr exception;
+        std::coroutine_handle<> handle;
+        trantor::EventLoop *loop = nullptr;
+
+        void complete(const std::function<void(State &)> &setResult)
+        {
+            std::coroutine_handle<> waiting;
+            trantor::EventLoop *waitingLoop;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                setResult(*this);
+                done = true;
+                waiting = handle;
+                waitingLoop = loop;
+            }
+            if (!waiting)
+            {
+                return;
+            }
+            if (waitingLoop && !waitingLoop->isInLoopThread())
+            {
+                waitingLoop->queueInLoop([waiting]() { waiting.resume(); });
+            }
+            else
+            {
+                waiting.resume();
+            }
+        }
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+};  // namespace tl::elasticsearch
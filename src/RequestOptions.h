@@ -0,0 +1,97 @@
+/**
+ *
+ *  RequestOptions.h
+ *
+ */
+
+#pragma once
+
+#include "Cancellation.h"
+#include "RequestTiming.h"
+#include "TrafficCapture.h"
+#include "Tracer.h"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace trantor
+{
+class EventLoop;
+class EventLoopThreadPool;
+}
+
+namespace tl::elasticsearch
+{
+
+class MetricSeries;
+
+/// Scheduling class of a request when the node is at its concurrency limit.
+enum class Priority
+{
+    // user-facing requests, e.g. searches
+    INTERACTIVE = 0,
+    NORMAL,
+    // ingestion and backfills, e.g. bulk
+    BACKGROUND
+};
+
+constexpr size_t kPriorityCount = 3;
+
+inline std::string to_string(Priority priority)
+{
+    switch (priority)
+    {
+        case Priority::INTERACTIVE:
+            return "interactive";
+        case Priority::NORMAL:
+            return "normal";
+        case Priority::BACKGROUND:
+            return "background";
+    }
+    return "unknown";
+}
+
+/// Per-request settings of the transport, filled by the clients.
+class RequestOptions
+{
+  public:
+    RequestOptions(Priority priority = Priority::NORMAL) : priority(priority)
+    {
+    }
+
+  public:
+    /// The request has no side effect, it may be sent to a second node when
+    /// the first one is slow (see HedgePolicy).
+    bool readOnly = false;
+    Priority priority;
+    /// Documents written by the request, 0 if it is not an ingestion
+    /// request. Only ingestion requests are subject to the rate limit.
+    size_t documents = 0;
+    /// Loop running the transport and the callbacks, nullptr means the main
+    /// loop of drogon.
+    trantor::EventLoop *loop = nullptr;
+    /// Set by the transport when the loop belongs to the loop pool of the
+    /// client, so that the loop outlives the request.
+    std::shared_ptr<trantor::EventLoopThreadPool> loopPool;
+    CancellationTokenPtr cancellation;
+    /// Labels of the metrics, e.g. "search" and the name of the index.
+    std::string operation;
+    std::string index;
+    /// Series of the labels, resolved once by the transport. nullptr when
+    /// the metrics are disabled, see HttpClient::setMetricsEnabled.
+    MetricSeries *series = nullptr;
+    /// When the transport got the request, the start of its latency.
+    std::chrono::steady_clock::time_point started;
+    /// The body is one search: the slow log groups it by the shape of its
+    /// query, see fingerprint(), instead of by its bytes.
+    bool searchBody = false;
+    /// Filled by the transport and the clients when timing is enabled.
+    RequestTimingPtr timing;
+    /// Set by the transport when a Tracer is installed.
+    TraceSpanPtr span;
+    /// Set by the transport when a TrafficRecorder is installed.
+    TrafficRecordPtr capture;
+};
+
+};  // namespace tl::elasticsearch
@@ -0,0 +1,72 @@
+/**
+ *
+ *  RequestTiming.cc
+ *
+ */
+
+#include "RequestTiming.h"
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+RequestTiming::Duration RequestTiming::phase(TimingPhase phase) const
+{
+    switch (phase)
+    {
+        case TimingPhase::BUILD:
+            return build;
+        case TimingPhase::SERIALIZE:
+            return serialize;
+        case TimingPhase::QUEUE:
+            return queue;
+        case TimingPhase::NETWORK:
+            return network;
+        case TimingPhase::TOOK:
+            return took;
+        case TimingPhase::DECODE:
+            return decode;
+    }
+    return {};
+}
+
+void RequestTiming::finish()
+{
+    if (received_ != TimePoint())
+    {
+        decode = chrono::steady_clock::now() - received_;
+    }
+    TimingSummary::instance().record(*this);
+}
+
+TimingSummary &TimingSummary::instance()
+{
+    static TimingSummary summary;
+    return summary;
+}
+
+void TimingSummary::record(const RequestTiming &timing)
+{
+    for (size_t i = 0; i < kTimingPhaseCount; ++i)
+    {
+        phases_[i].record(timing.phase(static_cast<TimingPhase>(i)));
+    }
+}
+
+vector<PhaseStats> TimingSummary::snapshot() const
+{
+    vector<PhaseStats> result;
+    for (size_t i = 0; i < kTimingPhaseCount; ++i)
+    {
+        const auto &histogram = phases_[i];
+        PhaseStats stats;
+        stats.phase = static_cast<TimingPhase>(i);
+        stats.count = histogram.count();
+        stats.sum = histogram.sum();
+        stats.max = histogram.max();
+        stats.p50 = histogram.percentile(0.5);
+        stats.p90 = histogram.percentile(0.9);
+        stats.p99 = histogram.percentile(0.99);
+        result.push_back(stats);
+    }
+    return result;
+}
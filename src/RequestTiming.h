@@ -0,0 +1,172 @@
+/**
+ *
+ *  RequestTiming.h
+ *
+ */
+
+#pragma once
+
+#include "LatencyHistogram.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+/// Phases of a request, see RequestTiming.
+enum class TimingPhase
+{
+    BUILD = 0,
+    SERIALIZE,
+    QUEUE,
+    NETWORK,
+    TOOK,
+    DECODE
+};
+
+constexpr size_t kTimingPhaseCount = 6;
+
+inline std::string to_string(TimingPhase phase)
+{
+    switch (phase)
+    {
+        case TimingPhase::BUILD:
+            return "build";
+        case TimingPhase::SERIALIZE:
+            return "serialize";
+        case TimingPhase::QUEUE:
+            return "queue";
+        case TimingPhase::NETWORK:
+            return "network";
+        case TimingPhase::TOOK:
+            return "took";
+        case TimingPhase::DECODE:
+            return "decode";
+    }
+    return "unknown";
+}
+
+/// Where the time of one request went, measured on the monotonic clock.
+/// Phases the request did not go through stay zero.
+class RequestTiming
+{
+    friend class HttpClient;
+
+  public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    RequestTiming() = default;
+    RequestTiming(const RequestTiming &) = delete;
+    RequestTiming &operator=(const RequestTiming &) = delete;
+
+  public:
+    // the body from the param, e.g. SearchParam::toJson
+    Duration build{};
+    // the body to text
+    Duration serialize{};
+    // rate limit delay and wait for a permit of the node
+    Duration queue{};
+    // from sending the request to its response, hedges included
+    Duration network{};
+    // execution in Elasticsearch (`took` of the response), part of network
+    Duration took{};
+    // parsing of the response and e.g. SearchResponse::setByJson
+    Duration decode{};
+
+    Duration phase(TimingPhase phase) const;
+
+    /// Time spent by the client and the network, took included.
+    Duration total() const
+    {
+        return build + serialize + queue + network + decode;
+    }
+
+    /// Ends the decode phase and adds the timing to the TimingSummary.
+    void finish();
+
+  private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    TimePoint enqueued_;
+    // set by the first attempt, a hedge may read it from another loop
+    std::atomic<TimePoint::rep> sent_{0};
+    TimePoint received_;
+};
+
+using RequestTimingPtr = std::shared_ptr<RequestTiming>;
+
+/// Runs `fn` and adds its duration to one phase of the timing, if any.
+template <typename Fn>
+auto timed(const RequestTimingPtr &timing,
+           RequestTiming::Duration RequestTiming::*phase,
+           Fn &&fn)
+{
+    if (!timing)
+    {
+        return fn();
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto result = fn();
+    (*timing).*phase += std::chrono::steady_clock::now() - start;
+    return result;
+}
+
+/// Base of the responses which carry the timing of their request.
+class TimedResponse
+{
+  public:
+    /// nullptr unless timing is enabled, see HttpClient::setRequestTiming.
+    RequestTimingPtr getTiming() const
+    {
+        return timing_;
+    }
+
+    /// Ends the timing of the request and attaches it to the response.
+    void setTiming(const RequestTimingPtr &timing)
+    {
+        if (timing)
+        {
+            timing->finish();
+        }
+        timing_ = timing;
+    }
+
+  private:
+    RequestTimingPtr timing_;
+};
+
+/// Distribution of one phase, in microseconds.
+class PhaseStats
+{
+  public:
+    TimingPhase phase;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+};
+
+/// Process-wide distribution of the phases of all timed requests, to see
+/// which part of the client overhead grows under load. Lock-free.
+class TimingSummary
+{
+  public:
+    static TimingSummary &instance();
+
+  public:
+    void record(const RequestTiming &timing);
+
+    /// One entry per TimingPhase, in order.
+    std::vector<PhaseStats> snapshot() const;
+
+  private:
+    std::array<LatencyHistogram, kTimingPhaseCount> phases_;
+};
+
+};  // namespace tl::elasticsearch
@@ -0,0 +1,128 @@
+/**
+ *
+ *  SlowLog.cc
+ *
+ */
+
+#include "SlowLog.h"
+#include <trantor/utils/Logger.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+SlowLog::SlowLog(const SlowLogConfig &config, Clock::time_point now)
+    : config_(config),
+      tokens_(max(1.0, config.maxPerSecond)),
+      lastRefill_(now)
+{
+}
+
+bool SlowLog::admit(Clock::time_point now)
+{
+    bool sampled = true;
+    if (config_.sampleRate < 1.0)
+    {
+        thread_local minstd_rand random(random_device{}());
+        sampled = uniform_real_distribution<double>(0, 1)(random) <
+                  config_.sampleRate;
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    auto burst = max(1.0, config_.maxPerSecond);
+    auto elapsed = chrono::duration<double>(now - lastRefill_).count();
+    if (elapsed > 0)
+    {
+        tokens_ = min(burst, tokens_ + elapsed * config_.maxPerSecond);
+        lastRefill_ = now;
+    }
+    if (!sampled || tokens_ < 1)
+    {
+        ++suppressed_;
+        ++pendingSuppressed_;
+        return false;
+    }
+    tokens_ -= 1;
+    return true;
+}
+
+void SlowLog::write(SlowLogRecord &&record)
+{
+    Sink sink;
+    {
+        lock_guard<mutex> lock(mutex_);
+        record.suppressed = pendingSuppressed_;
+        pendingSuppressed_ = 0;
+        ++written_;
+        sink = sink_;
+    }
+    if (sink)
+    {
+        sink(record);
+    }
+    else
+    {
+        LOG_WARN << to_string(record);
+    }
+}
+
+void SlowLog::setSink(Sink &&sink)
+{
+    lock_guard<mutex> lock(mutex_);
+    sink_ = std::move(sink);
+}
+
+uint64_t SlowLog::written() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return written_;
+}
+
+uint64_t SlowLog::suppressed() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return suppressed_;
+}
+
+std::string tl::elasticsearch::to_string(const SlowLogRecord &record)
+{
+    using Micros = chrono::microseconds;
+    ostringstream out;
+    out << "slow request: operation=" << record.operation
+        << " index=" << record.index << " fingerprint=" << hex
+        << record.fingerprint << dec << " latency_ms="
+        << chrono::duration<double, milli>(record.latency).count();
+    if (record.tookMs >= 0)
+    {
+        out << " took_ms=" << record.tookMs;
+    }
+    out << " shard_failures=" << record.shardFailures;
+    if (record.timing)
+    {
+        out << " phases_us=[";
+        for (size_t i = 0; i < kTimingPhaseCount; ++i)
+        {
+            auto phase = static_cast<TimingPhase>(i);
+            out << (i > 0 ? " " : "") << to_string(phase) << "="
+                << chrono::duration_cast<Micros>(record.timing->phase(phase))
+                       .count();
+        }
+        out << "]";
+    }
+    if (!record.error.empty())
+    {
+        out << " error=[" << record.error << "]";
+    }
+    if (record.suppressed > 0)
+    {
+        out << " suppressed=" << record.suppressed;
+    }
+    out << " body=" << record.body;
+    if (record.bodyTruncated)
+    {
+        out << "...";
+    }
+    return out.str();
+}
@@ -0,0 +1,119 @@
+/**
+ *
+ *  SlowLog.h
+ *
+ */
+
+#pragma once
+
+#include "RequestTiming.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace tl::elasticsearch
+{
+
+class SlowLogConfig
+{
+  public:
+    /// Requests slower than this are logged, 0 disables the slow log.
+    double thresholdMs = 0;
+    /// Fraction of the slow requests which are logged.
+    double sampleRate = 1.0;
+    /// At most this many records per second, the others are only counted.
+    double maxPerSecond = 10;
+    /// Request bodies are cut at this size.
+    size_t maxBodyBytes = 1024;
+};
+
+/// One slow request, see SlowLog.
+class SlowLogRecord
+{
+  public:
+    std::string operation;
+    std::string index;
+    /// Hash of the operation, the index and the body, so that the records
+    /// of the same request can be grouped. The body of a search counts by
+    /// the shape of its fingerprint(): the same search with other values
+    /// shares it. Other bodies count by their bytes.
+    uint64_t fingerprint = 0;
+    /// Truncated to SlowLogConfig::maxBodyBytes.
+    std::string body;
+    bool bodyTruncated = false;
+    /// From the call of the client to the response.
+    std::chrono::steady_clock::duration latency{};
+    /// `took` of the response in milliseconds, -1 if there is none.
+    int64_t tookMs = -1;
+    /// `_shards.failed` of the response.
+    int64_t shardFailures = 0;
+    /// Empty if the request succeeded.
+    std::string error;
+    /// Phases of the request, nullptr unless request timing is enabled.
+    RequestTimingPtr timing;
+    /// Slow requests dropped by sampling or the rate limit since the
+    /// previous record.
+    uint64_t suppressed = 0;
+};
+
+std::string to_string(const SlowLogRecord &record);
+
+/// Log of the requests slower than a threshold. Records are sampled and
+/// rate limited by a token bucket, so that a bad minute cannot flood the
+/// logs. By default they are written with LOG_WARN.
+class SlowLog
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Sink = std::function<void(const SlowLogRecord &)>;
+
+    SlowLog(const SlowLogConfig &config, Clock::time_point now = Clock::now());
+
+  public:
+    bool enabled() const
+    {
+        return config_.thresholdMs > 0;
+    }
+
+    bool isSlow(Clock::duration latency) const
+    {
+        return enabled() &&
+               std::chrono::duration<double, std::milli>(latency).count() >=
+                   config_.thresholdMs;
+    }
+
+    /// Whether a slow request is written, counts the suppressed ones.
+    bool admit(Clock::time_point now = Clock::now());
+
+    /// Writes a record admitted by admit().
+    void write(SlowLogRecord &&record);
+
+    /// Replaces LOG_WARN, e.g. to send the records elsewhere.
+    void setSink(Sink &&sink);
+
+    const SlowLogConfig &config() const
+    {
+        return config_;
+    }
+
+    /// Records written and suppressed so far.
+    uint64_t written() const;
+    uint64_t suppressed() const;
+
+  private:
+    const SlowLogConfig config_;
+    mutable std::mutex mutex_;
+    Sink sink_;
+    double tokens_;
+    Clock::time_point lastRefill_;
+    uint64_t written_ = 0;
+    uint64_t suppressed_ = 0;
+    // suppressed since the last record
+    uint64_t pendingSuppressed_ = 0;
+};
+
+using SlowLogPtr = std::shared_ptr<SlowLog>;
+
+};  // namespace tl::elasticsearch
@@ -0,0 +1,140 @@
+/**
+ *
+ *  Sniffer.cc
+ *
+ */
+
+#include "Sniffer.h"
+#include <algorithm>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+bool SniffFilter::accept(const vector<string> &nodeRoles) const
+{
+    if (skipDedicatedMasters && nodeRoles.size() == 1 &&
+        nodeRoles[0] == "master")
+    {
+        return false;
+    }
+    if (roles.empty())
+    {
+        return true;
+    }
+    for (const auto &role : nodeRoles)
+    {
+        if (find(roles.begin(), roles.end(), role) != roles.end())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Sniffer::start(trantor::EventLoop *loop, double interval)
+{
+    stop();
+    loop_ = loop;
+    sniff();
+    if (interval > 0)
+    {
+        weak_ptr<Sniffer> weakThis = shared_from_this();
+        timerId_ = loop_->runEvery(interval, [weakThis]() {
+            if (auto thisPtr = weakThis.lock())
+            {
+                thisPtr->sniff();
+            }
+        });
+    }
+}
+
+void Sniffer::stop()
+{
+    if (loop_ && timerId_ != 0)
+    {
+        loop_->invalidateTimer(timerId_);
+    }
+    timerId_ = 0;
+}
+
+/// "https" for "https://host:9200", "http" if the url has no scheme.
+static string schemeOf(const string &url)
+{
+    auto end = url.find("://");
+    return end == string::npos ? "http" : url.substr(0, end);
+}
+
+void Sniffer::sniff(const function<void(bool)> &done)
+{
+    auto pool = httpClient_->nodePool();
+    // the sniffed nodes are reached like the seeds, a cluster behind TLS
+    // stays behind TLS
+    auto nodes = pool->nodes();
+    auto scheme = nodes->empty() ? string("http")
+                                 : schemeOf(nodes->front()->url());
+    httpClient_->sendRequest(
+        "/_nodes/http",
+        drogon::Get,
+        [pool, filter = filter_, scheme, done](
+            const Json::Value &responseBody) {
+            auto urls = parseNodes(responseBody, filter, scheme);
+            if (urls.empty())
+            {
+                LOG_WARN << "sniffing found no usable node, keep the old ones";
+            }
+            else
+            {
+                pool->setNodes(urls);
+            }
+            if (done)
+            {
+                done(!urls.empty());
+            }
+        },
+        [done](const ElasticSearchException &err) {
+            LOG_WARN << "sniffing failed: " << err.what();
+            if (done)
+            {
+                done(false);
+            }
+        });
+}
+
+vector<string> Sniffer::parseNodes(const Json::Value &response,
+                                   const SniffFilter &filter,
+                                   const string &scheme)
+{
+    vector<string> result;
+    const auto &nodes = response["nodes"];
+    if (!nodes.isObject())
+    {
+        return result;
+    }
+    for (const auto &id : nodes.getMemberNames())
+    {
+        const auto &node = nodes[id];
+        vector<string> roles;
+        for (const auto &role : node["roles"])
+        {
+            roles.push_back(role.asString());
+        }
+        if (!filter.accept(roles))
+        {
+            continue;
+        }
+        auto address = node["http"]["publish_address"].asString();
+        if (address.empty())
+        {
+            continue;
+        }
+        // "hostname/ip:port" when the node has a hostname
+        auto slash = address.find('/');
+        if (slash != string::npos)
+        {
+            address = address.substr(slash + 1);
+        }
+        result.push_back(scheme + "://" + address);
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
@@ -0,0 +1,66 @@
+/**
+ *
+ *  Sniffer.h
+ *
+ */
+
+#pragma once
+
+#include "HttpClient.h"
+#include <json/value.h>
+#include <trantor/net/EventLoop.h>
+
+namespace tl::elasticsearch
+{
+
+class SniffFilter
+{
+  public:
+    /// Skip nodes whose only role is master.
+    bool skipDedicatedMasters = true;
+    /// If not empty, a node must have at least one of these roles.
+    std::vector<std::string> roles;
+
+    bool accept(const std::vector<std::string> &nodeRoles) const;
+};
+
+/// Discovers the HTTP endpoints of the cluster through `_nodes/http` and
+/// replaces the node list of the HttpClient with the result.
+class Sniffer : public std::enable_shared_from_this<Sniffer>
+{
+  public:
+    Sniffer(HttpClientPtr httpClient, SniffFilter filter = SniffFilter())
+        : httpClient_(httpClient), filter_(std::move(filter))
+    {
+    }
+
+    ~Sniffer()
+    {
+        stop();
+    }
+
+  public:
+    /// Sniffs once immediately, then every interval seconds if interval > 0.
+    void start(trantor::EventLoop *loop, double interval);
+    void stop();
+
+    /// done receives false if the request failed or no node was accepted,
+    /// the node list is left untouched in that case.
+    void sniff(const std::function<void(bool)> &done = nullptr);
+
+    /// The urls get the scheme of the current nodes, e.g. "https".
+    static std::vector<std::string> parseNodes(
+        const Json::Value &response,
+        const SniffFilter &filter,
+        const std::string &scheme = "http");
+
+  private:
+    HttpClientPtr httpClient_;
+    SniffFilter filter_;
+    trantor::EventLoop *loop_ = nullptr;
+    trantor::TimerId timerId_ = 0;
+};
+
+using SnifferPtr = std::shared_ptr<Sniffer>;
+
+};  // namespace tl::elasticsearch
@@ -0,0 +1,107 @@
+/**
+ *
+ *  SyncCaller.cc
+ *
+ */
+
+#include "SyncCaller.h"
+#include <trantor/utils/Logger.h>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+static thread_local trantor::EventLoop *currentTransportLoop = nullptr;
+
+trantor::EventLoop *SyncCaller::transportLoop()
+{
+    return currentTransportLoop;
+}
+
+void SyncCaller::setPolicy(const SyncPolicy &policy)
+{
+    lock_guard<mutex> lock(mutex_);
+    policy_ = policy;
+}
+
+SyncStats SyncCaller::stats() const
+{
+    SyncStats result;
+    result.calls = calls_.load(memory_order_relaxed);
+    result.callsOnLoop = callsOnLoop_.load(memory_order_relaxed);
+    result.rejected = rejected_.load(memory_order_relaxed);
+    result.blockedThreads = blockedThreads_.load(memory_order_relaxed);
+    result.maxBlockedThreads = maxBlockedThreads_.load(memory_order_relaxed);
+    return result;
+}
+
+trantor::EventLoop *SyncCaller::internalLoop()
+{
+    // callers hold mutex_
+    if (!loopThread_)
+    {
+        loopThread_ = make_unique<trantor::EventLoopThread>("es-sync");
+        loopThread_->run();
+    }
+    return loopThread_->getLoop();
+}
+
+SyncCaller::Blocking::Blocking(SyncCaller &caller) : caller_(caller)
+{
+    caller_.calls_.fetch_add(1, memory_order_relaxed);
+    bool onLoop = trantor::EventLoop::getEventLoopOfCurrentThread() != nullptr;
+    SyncPolicy policy;
+    {
+        lock_guard<mutex> lock(caller_.mutex_);
+        policy = caller_.policy_;
+        if (onLoop && policy.onLoop == SyncOnLoop::INTERNAL_LOOP)
+        {
+            loop_ = caller_.internalLoop();
+        }
+    }
+    if (onLoop)
+    {
+        caller_.callsOnLoop_.fetch_add(1, memory_order_relaxed);
+        // a callback of the internal loop would wait for itself
+        if (policy.onLoop == SyncOnLoop::FAIL ||
+            loop_ == trantor::EventLoop::getEventLoopOfCurrentThread())
+        {
+            caller_.rejected_.fetch_add(1, memory_order_relaxed);
+            throw ElasticSearchException(
+                "synchronous call on an event loop thread! Use the "
+                "asynchronous or the coroutine API instead.");
+        }
+    }
+
+    auto blocked = caller_.blockedThreads_.fetch_add(1) + 1;
+    if (policy.maxBlockedThreads > 0 && blocked > policy.maxBlockedThreads)
+    {
+        caller_.blockedThreads_.fetch_sub(1);
+        caller_.rejected_.fetch_add(1, memory_order_relaxed);
+        LOG_WARN << "too many threads blocked in synchronous calls: "
+                 << blocked - 1;
+        throw ElasticSearchException(
+            "too many threads blocked in synchronous calls!");
+    }
+    auto peak = caller_.maxBlockedThreads_.load(memory_order_relaxed);
+    while (blocked > peak &&
+           !caller_.maxBlockedThreads_.compare_exchange_weak(
+               peak, blocked, memory_order_relaxed))
+    {
+    }
+}
+
+SyncCaller::Blocking::~Blocking()
+{
+    caller_.blockedThreads_.fetch_sub(1);
+}
+
+SyncCaller::LoopScope::LoopScope(trantor::EventLoop *loop)
+    : previous_(currentTransportLoop)
+{
+    currentTransportLoop = loop;
+}
+
+SyncCaller::LoopScope::~LoopScope()
+{
+    currentTransportLoop = previous_;
+}
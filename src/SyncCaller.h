@@ -0,0 +1,138 @@
+/**
+ *
+ *  SyncCaller.h
+ *
+ */
+
+#pragma once
+
+#include "ElasticSearchException.h"
+#include <trantor/net/EventLoop.h>
+#include <trantor/net/EventLoopThread.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+namespace tl::elasticsearch
+{
+
+/// What a synchronous call does when it is made on an event loop thread.
+/// Blocking there deadlocks if the reply is delivered on the same loop.
+enum class SyncOnLoop
+{
+    // throws an ElasticSearchException
+    FAIL = 0,
+    // the request runs on an internal loop of the client while the caller
+    // blocks, the loop of the caller stalls but cannot deadlock
+    INTERNAL_LOOP
+};
+
+class SyncPolicy
+{
+  public:
+    SyncOnLoop onLoop = SyncOnLoop::INTERNAL_LOOP;
+    /// At most this many threads may block in synchronous calls at the same
+    /// time, further calls fail immediately. 0 means no bound.
+    uint32_t maxBlockedThreads = 0;
+};
+
+class SyncStats
+{
+  public:
+    uint64_t calls = 0;
+    // calls made on an event loop thread
+    uint64_t callsOnLoop = 0;
+    // calls refused by the policy
+    uint64_t rejected = 0;
+    uint32_t blockedThreads = 0;
+    uint32_t maxBlockedThreads = 0;
+};
+
+/// Runs the synchronous API on top of the asynchronous one: starts the
+/// request and blocks the calling thread until its callback fires.
+class SyncCaller
+{
+  public:
+    template <typename Tp>
+    using Start =
+        std::function<void(std::function<void(const Tp &)> &&,
+                           std::function<void(const ElasticSearchException &)>
+                               &&)>;
+
+    SyncCaller(const SyncPolicy &policy = SyncPolicy()) : policy_(policy)
+    {
+    }
+
+  public:
+    template <typename Tp>
+    Tp call(const Start<Tp> &start)
+    {
+        Blocking blocking(*this);
+        auto pro = std::make_shared<std::promise<Tp>>();
+        auto f = pro->get_future();
+        {
+            LoopScope scope(blocking.loop());
+            start([pro](const Tp &result) { pro->set_value(result); },
+                  [pro](const ElasticSearchException &err) {
+                      pro->set_exception(std::make_exception_ptr(err));
+                  });
+        }
+        return f.get();
+    }
+
+    /// The loop the requests started by the current thread must run on,
+    /// nullptr for the default one.
+    static trantor::EventLoop *transportLoop();
+
+    void setPolicy(const SyncPolicy &policy);
+
+    SyncStats stats() const;
+
+  private:
+    /// Counts the calling thread as blocked for its lifetime, throws if the
+    /// policy refuses the call.
+    class Blocking
+    {
+      public:
+        Blocking(SyncCaller &caller);
+        ~Blocking();
+
+        trantor::EventLoop *loop() const
+        {
+            return loop_;
+        }
+
+      private:
+        SyncCaller &caller_;
+        trantor::EventLoop *loop_ = nullptr;
+    };
+
+    /// Sets the transport loop of the current thread for its lifetime.
+    class LoopScope
+    {
+      public:
+        LoopScope(trantor::EventLoop *loop);
+        ~LoopScope();
+
+      private:
+        trantor::EventLoop *previous_;
+    };
+
+    trantor::EventLoop *internalLoop();
+
+  private:
+    mutable std::mutex mutex_;
+    SyncPolicy policy_;
+    std::unique_ptr<trantor::EventLoopThread> loopThread_;
+    std::atomic<uint64_t> calls_{0};
+    std::atomic<uint64_t> callsOnLoop_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint32_t> blockedThreads_{0};
+    std::atomic<uint32_t> maxBlockedThreads_{0};
+};
+
+using SyncCallerPtr = std::shared_ptr<SyncCaller>;
+
+};  // namespace tl::elasticsearch
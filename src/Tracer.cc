@@ -0,0 +1,66 @@
+/**
+ *
+ *  Tracer.cc
+ *
+ */
+
+#include "Tracer.h"
+#include <cstdio>
+#include <random>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+string TraceSpan::newRequestId()
+{
+    // the prefix tells apart the processes writing to the same cluster
+    static const uint32_t prefix = random_device{}();
+    static atomic<uint64_t> counter{0};
+    char buffer[32];
+    snprintf(buffer,
+             sizeof(buffer),
+             "es-%08x-%llx",
+             prefix,
+             static_cast<unsigned long long>(
+                 counter.fetch_add(1, memory_order_relaxed)));
+    return buffer;
+}
+
+TraceSpanPtr RingBufferTracer::startSpan(const string &operation,
+                                         const string &index)
+{
+    return make_shared<TraceSpan>(operation, index, TraceSpan::newRequestId());
+}
+
+void RingBufferTracer::endSpan(const TraceSpanPtr &span)
+{
+    lock_guard<mutex> lock(mutex_);
+    ++finished_;
+    if (capacity_ == 0)
+    {
+        return;
+    }
+    if (spans_.size() >= capacity_)
+    {
+        spans_.pop_front();
+    }
+    spans_.push_back(span);
+}
+
+vector<TraceSpanPtr> RingBufferTracer::spans() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return vector<TraceSpanPtr>(spans_.begin(), spans_.end());
+}
+
+uint64_t RingBufferTracer::finished() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return finished_;
+}
+
+void RingBufferTracer::clear()
+{
+    lock_guard<mutex> lock(mutex_);
+    spans_.clear();
+}
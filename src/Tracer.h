@@ -0,0 +1,114 @@
+/**
+ *
+ *  Tracer.h
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+/// One request as seen by a Tracer, from the call of the client to its
+/// outcome. The fields are filled by the transport.
+class TraceSpan
+{
+  public:
+    TraceSpan(const std::string &operation,
+              const std::string &index,
+              const std::string &requestId)
+        : operation(operation), index(index), requestId(requestId)
+    {
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+  public:
+    const std::string operation;
+    const std::string index;
+    /// Sent as the X-Opaque-Id header, which Elasticsearch writes to its
+    /// slow logs and tasks. Empty means no header.
+    const std::string requestId;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+    /// Url of the node which answered.
+    std::string node;
+    size_t bytesSent = 0;
+    size_t bytesReceived = 0;
+    /// HTTP status, 0 if there was no response.
+    int status = 0;
+    /// Requests sent to the nodes, more than one when hedged.
+    std::atomic<uint32_t> attempts{0};
+    /// Empty if the request succeeded.
+    std::string error;
+
+    std::chrono::steady_clock::duration duration() const
+    {
+        return end - start;
+    }
+
+    /// A request id unique in the process, e.g. "es-5f3a9c1e-2a".
+    static std::string newRequestId();
+};
+
+using TraceSpanPtr = std::shared_ptr<TraceSpan>;
+
+/// Receives a span per request of the HttpClient, e.g. to forward them to
+/// OpenTelemetry. Without a tracer nothing is allocated.
+class Tracer
+{
+  public:
+    virtual ~Tracer() = default;
+
+    /// Called before the request is queued, nullptr skips the request.
+    virtual TraceSpanPtr startSpan(const std::string &operation,
+                                   const std::string &index) = 0;
+
+    /// Called once with the outcome of the request, on its event loop.
+    virtual void endSpan(const TraceSpanPtr &span) = 0;
+};
+
+using TracerPtr = std::shared_ptr<Tracer>;
+
+/// Keeps the last finished spans in memory, for tests and benchmarks.
+class RingBufferTracer : public Tracer
+{
+  public:
+    RingBufferTracer(size_t capacity = 1024) : capacity_(capacity)
+    {
+    }
+
+  public:
+    TraceSpanPtr startSpan(const std::string &operation,
+                           const std::string &index) override;
+
+    void endSpan(const TraceSpanPtr &span) override;
+
+    /// The finished spans, oldest first.
+    std::vector<TraceSpanPtr> spans() const;
+
+    /// Spans finished so far, including those dropped from the buffer.
+    uint64_t finished() const;
+
+    void clear();
+
+  private:
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::deque<TraceSpanPtr> spans_;
+    uint64_t finished_ = 0;
+};
+
+using RingBufferTracerPtr = std::shared_ptr<RingBufferTracer>;
+
+};  // namespace tl::elasticsearch
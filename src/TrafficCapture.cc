@@ -0,0 +1,257 @@
+/**
+ *
+ *  TrafficCapture.cc
+ *
+ */
+
+#include "TrafficCapture.h"
+#include "ElasticSearchException.h"
+#include <filesystem>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+static const char kMagic[] = "ESCAP01\n";
+static constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+
+static void putFixed(string &out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+static void putString(string &out, const string &value)
+{
+    uint64_t size = value.size();
+    while (size >= 0x80)
+    {
+        out += static_cast<char>((size & 0x7f) | 0x80);
+        size >>= 7;
+    }
+    out += static_cast<char>(size);
+    out += value;
+}
+
+static bool getFixed(const string &in,
+                     size_t &offset,
+                     size_t bytes,
+                     uint64_t &value)
+{
+    if (offset + bytes > in.size())
+    {
+        return false;
+    }
+    value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(
+                     in[offset + i]))
+                 << (8 * i);
+    }
+    offset += bytes;
+    return true;
+}
+
+static bool getString(const string &in, size_t &offset, string &value)
+{
+    uint64_t size = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (offset >= in.size())
+        {
+            return false;
+        }
+        auto byte = static_cast<unsigned char>(in[offset++]);
+        size |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            if (offset + size > in.size())
+            {
+                return false;
+            }
+            value.assign(in, offset, size);
+            offset += size;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Size of the file up to the end of its last complete record, the header
+/// included. 0 if the header itself is incomplete.
+static uint64_t completeSize(const string &path, uint64_t fileSize)
+{
+    ifstream file(path, ios::binary);
+    char magic[kMagicSize];
+    if (!file.read(magic, kMagicSize))
+    {
+        return 0;
+    }
+    if (string(magic, kMagicSize) != string(kMagic, kMagicSize))
+    {
+        throw ElasticSearchException(path + " is not a capture file");
+    }
+    uint64_t end = kMagicSize;
+    char prefix[4];
+    while (file.read(prefix, sizeof(prefix)))
+    {
+        string sizeBytes(prefix, sizeof(prefix));
+        size_t offset = 0;
+        uint64_t size = 0;
+        getFixed(sizeBytes, offset, 4, size);
+        if (end + sizeof(prefix) + size > fileSize)
+        {
+            break;
+        }
+        end += sizeof(prefix) + size;
+        file.seekg(static_cast<streamoff>(end));
+    }
+    return end;
+}
+
+TrafficRecorder::TrafficRecorder(const string &path)
+{
+    // a record torn by a crash is cut, the records appended after it would
+    // not be readable
+    error_code error;
+    auto size = filesystem::file_size(path, error);
+    if (!error && size > 0)
+    {
+        auto end = completeSize(path, size);
+        if (end < size)
+        {
+            filesystem::resize_file(path, end, error);
+            if (error)
+            {
+                throw ElasticSearchException(
+                    "cannot truncate the capture file " + path + ": " +
+                    error.message());
+            }
+        }
+    }
+    file_.open(path, ios::binary | ios::app);
+    if (!file_)
+    {
+        throw ElasticSearchException("cannot open the capture file " + path);
+    }
+    // a new file gets its header
+    file_.seekp(0, ios::end);
+    if (file_.tellp() == 0)
+    {
+        file_.write(kMagic, kMagicSize);
+    }
+}
+
+TrafficRecorder::~TrafficRecorder()
+{
+    flush();
+}
+
+string TrafficRecorder::encode(const TrafficRecord &record)
+{
+    string payload;
+    payload.reserve(64 + record.path.size() + record.requestBody.size() +
+                    record.responseBody.size());
+    putFixed(payload, record.timestampUs, 8);
+    putFixed(payload, record.latencyUs, 4);
+    putFixed(payload, record.status, 2);
+    putString(payload, record.method);
+    putString(payload, record.operation);
+    putString(payload, record.index);
+    putString(payload, record.path);
+    putString(payload, record.requestBody);
+    putString(payload, record.responseBody);
+
+    string result;
+    result.reserve(4 + payload.size());
+    putFixed(result, payload.size(), 4);
+    result += payload;
+    return result;
+}
+
+void TrafficRecorder::write(const TrafficRecord &record)
+{
+    auto encoded = encode(record);
+    lock_guard<mutex> lock(mutex_);
+    file_.write(encoded.data(), static_cast<streamsize>(encoded.size()));
+    ++written_;
+}
+
+void TrafficRecorder::flush()
+{
+    lock_guard<mutex> lock(mutex_);
+    file_.flush();
+}
+
+uint64_t TrafficRecorder::written() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return written_;
+}
+
+TrafficReader::TrafficReader(const string &path)
+    : file_(path, ios::binary)
+{
+    if (!file_)
+    {
+        throw ElasticSearchException("cannot open the capture file " + path);
+    }
+    char magic[kMagicSize];
+    if (!file_.read(magic, kMagicSize) ||
+        string(magic, kMagicSize) != string(kMagic, kMagicSize))
+    {
+        throw ElasticSearchException(path + " is not a capture file");
+    }
+}
+
+bool TrafficReader::next(TrafficRecord &record)
+{
+    char prefix[4];
+    if (!file_.read(prefix, sizeof(prefix)))
+    {
+        return false;
+    }
+    string sizeBytes(prefix, sizeof(prefix));
+    size_t offset = 0;
+    uint64_t size = 0;
+    getFixed(sizeBytes, offset, 4, size);
+    buffer_.resize(size);
+    if (!file_.read(buffer_.data(), static_cast<streamsize>(size)))
+    {
+        return false;
+    }
+
+    offset = 0;
+    uint64_t timestamp, latency, status;
+    if (!getFixed(buffer_, offset, 8, timestamp) ||
+        !getFixed(buffer_, offset, 4, latency) ||
+        !getFixed(buffer_, offset, 2, status) ||
+        !getString(buffer_, offset, record.method) ||
+        !getString(buffer_, offset, record.operation) ||
+        !getString(buffer_, offset, record.index) ||
+        !getString(buffer_, offset, record.path) ||
+        !getString(buffer_, offset, record.requestBody) ||
+        !getString(buffer_, offset, record.responseBody))
+    {
+        return false;
+    }
+    record.timestampUs = timestamp;
+    record.latencyUs = static_cast<uint32_t>(latency);
+    record.status = static_cast<uint16_t>(status);
+    return true;
+}
+
+vector<TrafficRecord> TrafficReader::readAll(const string &path)
+{
+    TrafficReader reader(path);
+    vector<TrafficRecord> records;
+    TrafficRecord record;
+    while (reader.next(record))
+    {
+        records.push_back(std::move(record));
+        record = TrafficRecord();
+    }
+    return records;
+}
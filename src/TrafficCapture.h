@@ -0,0 +1,95 @@
+/**
+ *
+ *  TrafficCapture.h
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+/// One request of the client and its response, see TrafficRecorder.
+class TrafficRecord
+{
+  public:
+    /// When the client was called, microseconds since the epoch.
+    uint64_t timestampUs = 0;
+    /// From the call of the client to the response.
+    uint32_t latencyUs = 0;
+    /// 0 if no response arrived.
+    uint16_t status = 0;
+    /// "GET", "POST"...
+    std::string method;
+    std::string operation;
+    std::string index;
+    std::string path;
+    std::string requestBody;
+    std::string responseBody;
+};
+
+using TrafficRecordPtr = std::shared_ptr<TrafficRecord>;
+
+/// Writes the traffic of the client to an append-only file, see
+/// HttpClient::setRecorder.
+///
+/// The file starts with the 8 bytes "ESCAP01\n". Each record follows as its
+/// size (4 bytes, little endian) and its fields: timestamp (8 bytes),
+/// latency (4), status (2), then method, operation, index, path, request
+/// and response body, each a varint length and its bytes. A record cut by a
+/// crash ends the file, the records before it stay readable, and it is
+/// truncated when a recorder opens the file again.
+class TrafficRecorder
+{
+  public:
+    /// Appends to the file, creates it if needed. Throws
+    /// ElasticSearchException if the file cannot be opened or is not a
+    /// capture file.
+    TrafficRecorder(const std::string &path);
+    ~TrafficRecorder();
+
+  public:
+    void write(const TrafficRecord &record);
+    /// Records are buffered, this writes them to the file.
+    void flush();
+
+    uint64_t written() const;
+
+    /// The record as stored in the file, size prefix included.
+    static std::string encode(const TrafficRecord &record);
+
+  private:
+    mutable std::mutex mutex_;
+    std::ofstream file_;
+    uint64_t written_ = 0;
+};
+
+using TrafficRecorderPtr = std::shared_ptr<TrafficRecorder>;
+
+/// Reads the records of a capture file in order.
+class TrafficReader
+{
+  public:
+    /// Throws ElasticSearchException if the file cannot be opened or is not
+    /// a capture file.
+    TrafficReader(const std::string &path);
+
+  public:
+    /// false at the end of the file or of its last complete record.
+    bool next(TrafficRecord &record);
+
+    static std::vector<TrafficRecord> readAll(const std::string &path);
+
+  private:
+    std::ifstream file_;
+    std::string buffer_;
+};
+
+};  // namespace tl::elasticsearch
@@ -0,0 +1,126 @@
+/**
+ *
+ *  TrafficReplay.cc
+ *
+ */
+
+#include "TrafficReplay.h"
+#include <drogon/HttpAppFramework.h>
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+using namespace tl::elasticsearch;
+
+TrafficReplayer::TrafficReplayer(vector<TrafficRecord> records)
+    : records_(make_shared<const vector<TrafficRecord>>(std::move(records)))
+{
+}
+
+TrafficReplayer TrafficReplayer::fromFile(const string &path)
+{
+    return TrafficReplayer(TrafficReader::readAll(path));
+}
+
+bool TrafficReplayer::parseResponse(const TrafficRecord &record,
+                                    Json::Value &json)
+{
+    if (record.status == 0 || record.responseBody.empty())
+    {
+        return false;
+    }
+    static const Json::CharReaderBuilder builder;
+    unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    const auto &body = record.responseBody;
+    return reader->parse(
+        body.data(), body.data() + body.size(), &json, nullptr);
+}
+
+static drogon::HttpMethod parseMethod(const string &name)
+{
+    static const pair<const char *, drogon::HttpMethod> methods[] = {
+        { "GET", drogon::Get },       { "POST", drogon::Post },
+        { "HEAD", drogon::Head },     { "PUT", drogon::Put },
+        { "DELETE", drogon::Delete }, { "OPTIONS", drogon::Options },
+        { "PATCH", drogon::Patch },
+    };
+    for (const auto &[text, method] : methods)
+    {
+        if (name == text)
+        {
+            return method;
+        }
+    }
+    return drogon::Invalid;
+}
+
+void TrafficReplayer::resend(
+    const HttpClientPtr &client,
+    double speed,
+    const function<void(const ReplayStats &)> &done) const
+{
+    struct State
+    {
+        atomic<uint64_t> succeeded{0};
+        atomic<uint64_t> failed{0};
+        atomic<size_t> pending{0};
+        chrono::steady_clock::time_point start;
+        function<void(const ReplayStats &)> done;
+    };
+
+    auto state = make_shared<State>();
+    state->pending = records_->size();
+    state->start = chrono::steady_clock::now();
+    state->done = done;
+    auto finish = [state, sent = records_->size()](bool succeeded) {
+        ++(succeeded ? state->succeeded : state->failed);
+        if (--state->pending > 0)
+        {
+            return;
+        }
+        ReplayStats stats;
+        stats.sent = sent;
+        stats.succeeded = state->succeeded;
+        stats.failed = state->failed;
+        stats.elapsed = chrono::steady_clock::now() - state->start;
+        state->done(stats);
+    };
+    if (records_->empty())
+    {
+        done(ReplayStats());
+        return;
+    }
+
+    auto loop = drogon::app().getLoop();
+    // concurrent requests are recorded as they complete, the earliest start
+    // is not always the first record
+    auto first = min_element(records_->begin(),
+                             records_->end(),
+                             [](const auto &a, const auto &b) {
+                                 return a.timestampUs < b.timestampUs;
+                             })
+                     ->timestampUs;
+    for (size_t i = 0; i < records_->size(); ++i)
+    {
+        const auto &record = (*records_)[i];
+        auto offset = record.timestampUs > first
+                          ? static_cast<double>(record.timestampUs - first)
+                          : 0.0;
+        auto delay = speed > 0 ? offset / 1e6 / speed : 0.0;
+        loop->runAfter(delay, [client, records = records_, i, finish]() {
+            const auto &record = (*records)[i];
+            RequestOptions options;
+            options.operation = record.operation;
+            options.index = record.index;
+            options.readOnly = record.method == "GET" ||
+                               record.method == "HEAD";
+            client->sendRawRequest(
+                record.path,
+                parseMethod(record.method),
+                [finish](const Json::Value &) { finish(true); },
+                [finish](const ElasticSearchException &) { finish(false); },
+                record.requestBody,
+                options);
+        });
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ *
+ *  TrafficReplay.h
+ *
+ */
+
+#pragma once
+
+#include "DocumentsClient.h"
+#include "HttpClient.h"
+#include "IndicesClient.h"
+#include "TrafficCapture.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch
+{
+
+/// Outcome of TrafficReplayer::resend.
+class ReplayStats
+{
+  public:
+    uint64_t sent = 0;
+    uint64_t succeeded = 0;
+    uint64_t failed = 0;
+    /// From the first request to the last response.
+    std::chrono::steady_clock::duration elapsed{};
+};
+
+/// Plays back a capture of TrafficRecorder, offline or against a node.
+class TrafficReplayer
+{
+  public:
+    TrafficReplayer(std::vector<TrafficRecord> records);
+
+    /// Throws ElasticSearchException if the file is not a capture file.
+    static TrafficReplayer fromFile(const std::string &path);
+
+  public:
+    const std::vector<TrafficRecord> &records() const
+    {
+        return *records_;
+    }
+
+    /// Decodes every captured response the way the clients do, with the
+    /// documents of the searches as Tp. Needs no node. Returns the number of
+    /// responses decoded, the others are not valid JSON or are errors.
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    size_t decode() const
+    {
+        size_t decoded = 0;
+        for (const auto &record : *records_)
+        {
+            decoded += decode<Tp>(record) ? 1 : 0;
+        }
+        return decoded;
+    }
+
+    template <typename Tp>
+        requires isDocumentType<Tp>
+    static bool decode(const TrafficRecord &record)
+    {
+        Json::Value json;
+        if (!parseResponse(record, json))
+        {
+            return false;
+        }
+        const auto &operation = record.operation;
+        if (operation == "search")
+        {
+            // an error is given to the exception callback, not decoded
+            if (json["error"].isObject())
+            {
+                return false;
+            }
+            SearchResponse<Tp>().setByJson(json);
+        }
+        else if (operation == "get")
+        {
+            GetResponse().setByJson(json);
+        }
+        else if (operation == "index")
+        {
+            IndexResponse().setByJson(json);
+        }
+        else if (operation == "update")
+        {
+            UpdateResponse().setByJson(json);
+        }
+        else if (operation == "delete")
+        {
+            DeleteResponse().setByJson(json);
+        }
+        else if (operation == "count")
+        {
+            CountResponse().setByJson(json);
+        }
+        else if (operation == "indices.create")
+        {
+            CreateIndexResponse().setByJson(json);
+        }
+        else if (operation == "indices.get")
+        {
+            GetIndexResponse().setByJson(json[record.index]);
+        }
+        else if (operation == "indices.put_mapping")
+        {
+            PutMappingResponse().setByJson(json);
+        }
+        else if (operation == "indices.delete")
+        {
+            DeleteIndexResponse().setByJson(json);
+        }
+        // the other operations are only parsed
+        return true;
+    }
+
+    /// Sends the captured requests again through the client, with their
+    /// original spacing divided by `speed`: 1 replays at the captured rate,
+    /// 2 twice as fast, 0 sends everything at once. The requests are
+    /// scheduled on the main loop of drogon, `done` is called once every
+    /// request is answered.
+    void resend(const HttpClientPtr &client,
+                double speed,
+                const std::function<void(const ReplayStats &)> &done) const;
+
+  private:
+    /// false if no response arrived or its body is not JSON.
+    static bool parseResponse(const TrafficRecord &record, Json::Value &json);
+
+  private:
+    std::shared_ptr<const std::vector<TrafficRecord>> records_;
+};
+
+};  // namespace tl::elasticsearch
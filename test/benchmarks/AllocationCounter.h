@@ -0,0 +1,40 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdint>
+
+// incremented by the global operator new of main.cc
+inline std::atomic<uint64_t> gAllocations{0};
+inline std::atomic<uint64_t> gAllocatedBytes{0};
+
+/// Reports the heap allocations made while it is alive as allocs/op and
+/// bytes/op. Create it right before the benchmark loop.
+class AllocationCounter
+{
+  public:
+    AllocationCounter(benchmark::State &state)
+        : state_(state),
+          allocations_(gAllocations.load(std::memory_order_relaxed)),
+          bytes_(gAllocatedBytes.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~AllocationCounter()
+    {
+        auto allocations =
+            gAllocations.load(std::memory_order_relaxed) - allocations_;
+        auto bytes = gAllocatedBytes.load(std::memory_order_relaxed) - bytes_;
+        state_.counters["allocs/op"] =
+            benchmark::Counter(static_cast<double>(allocations),
+                               benchmark::Counter::kAvgIterations);
+        state_.counters["bytes/op"] =
+            benchmark::Counter(static_cast<double>(bytes),
+                               benchmark::Counter::kAvgIterations);
+    }
+
+  private:
+    benchmark::State &state_;
+    uint64_t allocations_;
+    uint64_t bytes_;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "../../src/DocumentsClient.h"
+#include "AllocationCounter.h"
+#include "TestData.h"
+#include <benchmark/benchmark.h>
+
+class BenchmarkAccount : public tl::elasticsearch::Document
+{
+  public:
+    virtual Json::Value toJson() const override
+    {
+        return json_;
+    }
+
+    virtual void setByJson(const Json::Value &json) override
+    {
+        json_ = json;
+    }
+
+  private:
+    Json::Value json_;
+};
+
+/// Body of a _search response with the first `count` accounts as hits.
+inline Json::Value searchResponseJson(size_t count)
+{
+    Json::Value json;
+    json["took"] = 12;
+    json["timed_out"] = false;
+    json["_shards"]["total"] = 5;
+    json["_shards"]["successful"] = 5;
+    json["_shards"]["skipped"] = 0;
+    json["_shards"]["failed"] = 0;
+    json["hits"]["total"] = 1000;
+    json["hits"]["max_score"] = 1.0;
+    auto &hits = json["hits"]["hits"];
+    hits = Json::Value(Json::arrayValue);
+    for (const auto &account : testdataAccounts(count))
+    {
+        Json::Value hit;
+        hit["_index"] = "accounts";
+        hit["_type"] = "_doc";
+        hit["_id"] = account["account_number"].asString();
+        hit["_score"] = 1.0;
+        hit["_source"] = account;
+        hits.append(hit);
+    }
+    return json;
+}
+
+/// Output of a terms aggregation by state with a terms sub-aggregation by
+/// gender, each gender bucket holding an avg of the balance.
+inline Json::Value aggregationsJson(size_t buckets)
+{
+    Json::Value byState;
+    byState["doc_count_error_upper_bound"] = 0;
+    byState["sum_other_doc_count"] = 0;
+    byState["buckets"] = Json::Value(Json::arrayValue);
+    for (size_t i = 0; i < buckets; ++i)
+    {
+        Json::Value byGender;
+        byGender["doc_count_error_upper_bound"] = 0;
+        byGender["sum_other_doc_count"] = 0;
+        byGender["buckets"] = Json::Value(Json::arrayValue);
+        for (auto gender : { "F", "M" })
+        {
+            Json::Value bucket;
+            bucket["key"] = gender;
+            bucket["doc_count"] = 10;
+            bucket["avg_balance"]["value"] = 25000.5 + i;
+            byGender["buckets"].append(bucket);
+        }
+        Json::Value bucket;
+        bucket["key"] = "state" + std::to_string(i);
+        bucket["doc_count"] = 20;
+        bucket["by_gender"] = byGender;
+        byState["buckets"].append(bucket);
+    }
+    Json::Value json;
+    json["by_state"] = byState;
+    return json;
+}
+
+static void BM_SearchResponseSetByJson(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    auto json = searchResponseJson(state.range(0));
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        SearchResponse<BenchmarkAccount> response;
+        response.setByJson(json);
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_SearchResponseSetByJson)->Arg(10)->Arg(100)->Arg(1000);
+
+// text to response, as the transport does it
+static void BM_SearchResponseParse(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    auto body = Json::writeString(writer, searchResponseJson(state.range(0)));
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        Json::Value json;
+        std::string errors;
+        reader->parse(body.data(), body.data() + body.size(), &json, &errors);
+        SearchResponse<BenchmarkAccount> response;
+        response.setByJson(json);
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetBytesProcessed(state.iterations() * body.size());
+}
+
+BENCHMARK(BM_SearchResponseParse)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_AggregationsResponse(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    auto json = aggregationsJson(state.range(0));
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+            AggregationsResponse::newAggregationsResponse(json));
+    }
+}
+
+BENCHMARK(BM_AggregationsResponse)->Arg(10)->Arg(50);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../../src/Metrics.h"
+#include "AllocationCounter.h"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <string>
+
+/// What a request costs the metrics once its series is resolved: the
+/// counters when it is sent and the latency when it is done.
+static void BM_MetricsRecord(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    MetricsRegistry metrics;
+    auto &series = metrics.series("search", "accounts");
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        auto started = std::chrono::steady_clock::now();
+        series.requests.fetch_add(1, std::memory_order_relaxed);
+        series.inFlight.fetch_add(1, std::memory_order_relaxed);
+        series.bytesSent.fetch_add(512, std::memory_order_relaxed);
+        series.latency.record(std::chrono::steady_clock::now() - started);
+        series.inFlight.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+BENCHMARK(BM_MetricsRecord);
+
+/// Resolving the series of the labels, done once per request. The argument
+/// is the number of other series in the registry.
+static void BM_MetricsLookup(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    MetricsRegistry metrics;
+    for (int64_t i = 0; i < state.range(0); ++i)
+    {
+        metrics.series("search", "index-" + std::to_string(i));
+    }
+    const std::string operation = "search";
+    const std::string index = "accounts";
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(&metrics.series(operation, index));
+    }
+}
+
+BENCHMARK(BM_MetricsLookup)->Arg(0)->Arg(100)->Arg(500);
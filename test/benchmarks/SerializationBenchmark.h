@@ -0,0 +1,205 @@
+#pragma once
+
+#include "../../src/DocumentsClient.h"
+#include "../../src/Fingerprint.h"
+#include "../../src/IndicesClient.h"
+#include "../../src/QueryTemplate.h"
+#include "../../src/QueryTree.h"
+#include "AllocationCounter.h"
+#include "TestData.h"
+#include <benchmark/benchmark.h>
+
+/// A bool query with a term, a range and a match clause per level and the
+/// next level as must_not.
+inline tl::elasticsearch::QueryPtr nestedBoolQuery(int depth)
+{
+    using namespace tl::elasticsearch;
+    auto query = BoolQuery::newBoolQuery();
+    query->must(TermQuery::newTermQuery()->field("gender")->query("F"));
+    query->filter(RangeQuery::newRangeQuery()->field("age")->gte(20)->lt(40));
+    query->should(MatchQuery::newMatchQuery()->field("address")->query("lane"));
+    if (depth > 1)
+    {
+        query->mustNot(nestedBoolQuery(depth - 1));
+    }
+    return query;
+}
+
+static void BM_SearchParamToJson(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    SearchParam param("accounts");
+    param.query(nestedBoolQuery(static_cast<int>(state.range(0))))
+        .sort("balance", DESC)
+        .from(0)
+        .size(20)
+        .agg(TermsAggregations::newTermsAgg()
+                 ->name("by_state")
+                 ->field("state.keyword")
+                 ->addSubAggregations(AvgAggregations::newAvgAgg()
+                                          ->name("avg_balance")
+                                          ->field("balance")));
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(param.toJson());
+    }
+}
+
+BENCHMARK(BM_SearchParamToJson)->Arg(1)->Arg(4)->Arg(16);
+
+/// The query of nestedBoolQuery(1), built with the builders.
+static void BM_BoolQueryBuild(benchmark::State &state)
+{
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(nestedBoolQuery(1));
+    }
+}
+
+BENCHMARK(BM_BoolQueryBuild);
+
+/// The same query as a QueryTree in a QueryArena.
+static void BM_QueryTreeBuild(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        QueryArena<> arena;
+        auto tree = QueryTree::newQueryTree(&arena);
+        tree->boolQuery({tree->term("gender", "F")},
+                        {tree->match("address", "lane")},
+                        {},
+                        {tree->range("age", {.gte = 20, .lt = 40})});
+        benchmark::DoNotOptimize(tree);
+    }
+}
+
+BENCHMARK(BM_QueryTreeBuild);
+
+static void BM_QueryTreeWriteJson(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    auto tree = QueryTree::fromQuery(
+        nestedBoolQuery(static_cast<int>(state.range(0))));
+    std::string body;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        body.clear();
+        tree->writeJson(body);
+        benchmark::DoNotOptimize(body.data());
+    }
+}
+
+BENCHMARK(BM_QueryTreeWriteJson)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_QueryTreeFingerprint(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    auto tree = QueryTree::fromQuery(
+        nestedBoolQuery(static_cast<int>(state.range(0))));
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(fingerprint(*tree));
+    }
+}
+
+BENCHMARK(BM_QueryTreeFingerprint)->Arg(1)->Arg(4)->Arg(16);
+
+/// The same query as a builder, walked through its toJson().
+static void BM_BoolQueryFingerprint(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    auto query = nestedBoolQuery(static_cast<int>(state.range(0)));
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(fingerprint(*query));
+    }
+}
+
+BENCHMARK(BM_BoolQueryFingerprint)->Arg(1)->Arg(4)->Arg(16);
+
+/// The body of BM_SearchParamToJson(1), without its aggregation, rendered
+/// from a QueryTemplate into a reused buffer.
+static void BM_QueryTemplateRender(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    using Template = QueryTemplate<R"({
+        "query": {"bool": {
+            "must": [{"term": {"gender": {"value": {{gender}}}}}],
+            "filter": [{"range": {"age": {"gte": {{min}}, "lt": {{max}}}}}],
+            "should": [{"match": {"address": {{address}}}}]}},
+        "sort": [{"balance": "desc"}],
+        "from": {{from}},
+        "size": {{size}}})",
+                                   std::string_view,
+                                   int,
+                                   int,
+                                   std::string_view,
+                                   int,
+                                   int>;
+    std::string body;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        body.clear();
+        Template::render(body, "F", 20, 40, "lane", 0, 20);
+        benchmark::DoNotOptimize(body.data());
+    }
+}
+
+BENCHMARK(BM_QueryTemplateRender);
+
+static void BM_CreateIndexParamToJson(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    CreateIndexParam param(3, 1);
+    param.addProperty(Property("account_number", LONG))
+        .addProperty(Property("balance", LONG))
+        .addProperty(Property("firstname", KEYWORD))
+        .addProperty(Property("lastname", KEYWORD))
+        .addProperty(Property("age", INTEGER))
+        .addProperty(Property("gender", KEYWORD))
+        .addProperty(Property("address", TEXT))
+        .addProperty(Property("employer", KEYWORD))
+        .addProperty(Property("email", KEYWORD, false))
+        .addProperty(Property("city", KEYWORD))
+        .addProperty(Property("state", KEYWORD))
+        .addProperty(Property("location")
+                         .addSubProperty(Property("lat", DOUBLE))
+                         .addSubProperty(Property("lon", DOUBLE)));
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(param.toJson());
+    }
+}
+
+BENCHMARK(BM_CreateIndexParamToJson);
+
+static void BM_BulkBody(benchmark::State &state)
+{
+    using namespace tl::elasticsearch;
+    std::vector<Json::Value> lines;
+    for (const auto &account : testdataAccounts(state.range(0)))
+    {
+        Json::Value action;
+        action["index"]["_index"] = "accounts";
+        action["index"]["_id"] = account["account_number"].asString();
+        lines.push_back(action);
+        lines.push_back(account);
+    }
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(HttpClient::bulkBody(lines));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_BulkBody)->Arg(10)->Arg(100)->Arg(1000);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <json/json.h>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef ES_TESTDATA
+#define ES_TESTDATA "../unittests/testdata.json"
+#endif
+
+/// The lines of testdata.json (1000 accounts as _bulk action and source
+/// lines), parsed once.
+inline const std::vector<Json::Value> &testdataLines()
+{
+    static const std::vector<Json::Value> lines = []() {
+        std::ifstream file(ES_TESTDATA);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("cannot open " ES_TESTDATA);
+        }
+        std::vector<Json::Value> result;
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        std::string line;
+        while (std::getline(file, line))
+        {
+            Json::Value json;
+            std::string errors;
+            if (!line.empty() &&
+                reader->parse(
+                    line.data(), line.data() + line.size(), &json, &errors))
+            {
+                result.push_back(std::move(json));
+            }
+        }
+        return result;
+    }();
+    return lines;
+}
+
+/// The sources of the first `count` accounts.
+inline std::vector<Json::Value> testdataAccounts(size_t count)
+{
+    const auto &lines = testdataLines();
+    std::vector<Json::Value> result;
+    for (size_t i = 1; i < lines.size() && result.size() < count; i += 2)
+    {
+        result.push_back(lines[i]);
+    }
+    return result;
+}
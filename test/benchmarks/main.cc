@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+#include "SerializationBenchmark.h"
+#include "DecodingBenchmark.h"
+#include "MetricsBenchmark.h"
+
+// counts the allocations reported by AllocationCounter
+
+void *operator new(std::size_t size)
+{
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    gAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size > 0 ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,301 @@
+/**
+ *
+ *  LoadGenerator.cc
+ *
+ */
+
+#include "LoadGenerator.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace tl::elasticsearch;
+using namespace tl::elasticsearch::load;
+
+using Clock = chrono::steady_clock;
+
+string tl::elasticsearch::load::to_string(LoadMode mode)
+{
+    switch (mode)
+    {
+        case LoadMode::CLOSED:
+            return "closed";
+        case LoadMode::OPEN:
+            return "open";
+    }
+    return "unknown";
+}
+
+class LoadGenerator::State
+{
+  public:
+    State(size_t operations) : latencies(operations), errors(operations)
+    {
+        for (auto &latency : latencies)
+        {
+            latency = make_unique<LatencyHistogram>();
+        }
+    }
+
+  public:
+    Clock::time_point measureStart;
+    Clock::time_point end;
+
+    mutex inFlightMutex;
+    condition_variable completed;
+    size_t inFlight = 0;
+
+    LatencyHistogram total;
+    vector<unique_ptr<LatencyHistogram>> latencies;
+    vector<atomic<uint64_t>> errors;
+    atomic<uint64_t> totalErrors{0};
+    uint64_t dropped = 0;
+};
+
+static Clock::duration seconds(double value)
+{
+    return chrono::duration_cast<Clock::duration>(
+        chrono::duration<double>(value));
+}
+
+static LatencyReport latencyReport(const string &name,
+                                   const LatencyHistogram &histogram,
+                                   uint64_t errors)
+{
+    LatencyReport report;
+    report.name = name;
+    report.completed = histogram.count();
+    report.errors = errors;
+    report.p50 = histogram.percentile(0.5);
+    report.p90 = histogram.percentile(0.9);
+    report.p99 = histogram.percentile(0.99);
+    report.p999 = histogram.percentile(0.999);
+    report.max = histogram.max();
+    report.mean = report.completed > 0
+                      ? static_cast<double>(histogram.sum()) /
+                            static_cast<double>(report.completed)
+                      : 0;
+    return report;
+}
+
+LoadGenerator::LoadGenerator(const Workload &workload,
+                             const LoadConfig &config,
+                             const Executor &executor)
+    : workload_(workload),
+      config_(config),
+      executor_(executor),
+      random_(config.seed != 0 ? config.seed : random_device{}())
+{
+}
+
+LoadReport LoadGenerator::run()
+{
+    auto state = make_shared<State>(workload_.operations().size());
+    auto start = Clock::now();
+    state->measureStart = start + seconds(config_.warmupSeconds);
+    state->end = state->measureStart + seconds(config_.durationSeconds);
+
+    if (config_.mode == LoadMode::OPEN)
+    {
+        runOpen(state);
+    }
+    else
+    {
+        runClosed(state);
+    }
+
+    LoadReport report;
+    {
+        unique_lock<mutex> lock(state->inFlightMutex);
+        state->completed.wait_until(lock,
+                                    Clock::now() +
+                                        seconds(config_.drainSeconds),
+                                    [&state]() {
+                                        return state->inFlight == 0;
+                                    });
+        report.unfinished = state->inFlight;
+        report.dropped = state->dropped;
+    }
+    report.mode = config_.mode;
+    report.seconds = config_.durationSeconds;
+    report.total = latencyReport("all", state->total, state->totalErrors);
+    report.throughput =
+        report.seconds > 0
+            ? static_cast<double>(report.total.completed) / report.seconds
+            : 0;
+    const auto &operations = workload_.operations();
+    for (size_t i = 0; i < operations.size(); ++i)
+    {
+        report.operations.push_back(latencyReport(operations[i].name,
+                                                  *state->latencies[i],
+                                                  state->errors[i]));
+    }
+    return report;
+}
+
+void LoadGenerator::runClosed(const shared_ptr<State> &state)
+{
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(state->inFlightMutex);
+            state->completed.wait_until(lock, state->end, [this, &state]() {
+                return state->inFlight < config_.concurrency;
+            });
+        }
+        auto now = Clock::now();
+        if (now >= state->end)
+        {
+            return;
+        }
+        issue(state, now);
+    }
+}
+
+void LoadGenerator::runOpen(const shared_ptr<State> &state)
+{
+    exponential_distribution<double> interval(config_.rate);
+    auto next = Clock::now();
+    while (next < state->end)
+    {
+        // behind schedule, the arrivals are sent back to back
+        this_thread::sleep_until(next);
+        bool full;
+        {
+            lock_guard<mutex> lock(state->inFlightMutex);
+            full = state->inFlight >= config_.maxInFlight;
+            if (full && next >= state->measureStart)
+            {
+                ++state->dropped;
+            }
+        }
+        if (!full)
+        {
+            issue(state, next);
+        }
+        next += seconds(config_.poisson ? interval(random_)
+                                        : 1 / config_.rate);
+    }
+}
+
+void LoadGenerator::issue(const shared_ptr<State> &state,
+                          Clock::time_point scheduled)
+{
+    auto index = workload_.pick(random_);
+    {
+        lock_guard<mutex> lock(state->inFlightMutex);
+        ++state->inFlight;
+    }
+    bool measured = scheduled >= state->measureStart;
+    auto done = [state, index, scheduled, measured](bool succeeded) {
+        if (measured)
+        {
+            auto latency = Clock::now() - scheduled;
+            state->latencies[index]->record(latency);
+            state->total.record(latency);
+            if (!succeeded)
+            {
+                ++state->errors[index];
+                ++state->totalErrors;
+            }
+        }
+        lock_guard<mutex> lock(state->inFlightMutex);
+        --state->inFlight;
+        state->completed.notify_all();
+    };
+    try
+    {
+        executor_(workload_.operations()[index], done);
+    }
+    catch (const exception &)
+    {
+        done(false);
+    }
+}
+
+static Json::Value toJson(const LatencyReport &report)
+{
+    Json::Value json;
+    json["name"] = report.name;
+    json["completed"] = Json::UInt64(report.completed);
+    json["errors"] = Json::UInt64(report.errors);
+    json["mean_us"] = report.mean;
+    json["p50_us"] = Json::UInt64(report.p50);
+    json["p90_us"] = Json::UInt64(report.p90);
+    json["p99_us"] = Json::UInt64(report.p99);
+    json["p999_us"] = Json::UInt64(report.p999);
+    json["max_us"] = Json::UInt64(report.max);
+    return json;
+}
+
+Json::Value LoadReport::toJson() const
+{
+    Json::Value json;
+    json["mode"] = to_string(mode);
+    json["seconds"] = seconds;
+    json["throughput"] = throughput;
+    json["dropped"] = Json::UInt64(dropped);
+    json["unfinished"] = Json::UInt64(unfinished);
+    json["total"] = ::toJson(total);
+    json["operations"] = Json::Value(Json::arrayValue);
+    for (const auto &operation : operations)
+    {
+        json["operations"].append(::toJson(operation));
+    }
+    return json;
+}
+
+static string row(const LatencyReport &report)
+{
+    auto ms = [](double micros) { return micros / 1000; };
+    char buffer[256];
+    snprintf(buffer,
+             sizeof(buffer),
+             "%-24s %9llu %7llu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+             report.name.c_str(),
+             static_cast<unsigned long long>(report.completed),
+             static_cast<unsigned long long>(report.errors),
+             ms(report.mean),
+             ms(static_cast<double>(report.p50)),
+             ms(static_cast<double>(report.p90)),
+             ms(static_cast<double>(report.p99)),
+             ms(static_cast<double>(report.p999)),
+             ms(static_cast<double>(report.max)));
+    return buffer;
+}
+
+string tl::elasticsearch::load::to_string(const LoadReport &report)
+{
+    char buffer[256];
+    snprintf(buffer,
+             sizeof(buffer),
+             "%s loop, %.1f s, %.1f req/s, %llu dropped, %llu unfinished\n",
+             to_string(report.mode).c_str(),
+             report.seconds,
+             report.throughput,
+             static_cast<unsigned long long>(report.dropped),
+             static_cast<unsigned long long>(report.unfinished));
+    string result = buffer;
+    snprintf(buffer,
+             sizeof(buffer),
+             "%-24s %9s %7s %9s %9s %9s %9s %9s %9s\n",
+             "operation (ms)",
+             "count",
+             "errors",
+             "mean",
+             "p50",
+             "p90",
+             "p99",
+             "p999",
+             "max");
+    result += buffer;
+    for (const auto &operation : report.operations)
+    {
+        result += row(operation);
+    }
+    result += row(report.total);
+    return result;
+}
@@ -0,0 +1,128 @@
+/**
+ *
+ *  LoadGenerator.h
+ *
+ */
+
+#pragma once
+
+#include "../../src/LatencyHistogram.h"
+#include "Workload.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch::load
+{
+
+enum class LoadMode
+{
+    /// A fixed number of requests in flight, the next one is sent when one
+    /// completes. Measures the throughput the target sustains.
+    CLOSED = 0,
+    /// Requests arrive at a fixed rate whatever the latency. Measures the
+    /// latency at a given throughput.
+    OPEN
+};
+
+std::string to_string(LoadMode mode);
+
+class LoadConfig
+{
+  public:
+    LoadMode mode = LoadMode::CLOSED;
+    /// CLOSED: requests in flight.
+    size_t concurrency = 8;
+    /// OPEN: requests per second.
+    double rate = 100;
+    /// OPEN: exponential inter-arrival times instead of a fixed interval.
+    bool poisson = true;
+    /// OPEN: arrivals over this number of requests in flight are dropped
+    /// and counted, so that a stalled target cannot exhaust the memory.
+    size_t maxInFlight = 10000;
+    /// Requests started during the warmup are not measured.
+    double warmupSeconds = 5;
+    double durationSeconds = 30;
+    /// After the run, how long to wait for the requests in flight.
+    double drainSeconds = 30;
+    /// 0 means a random seed.
+    uint64_t seed = 0;
+};
+
+/// Latencies in microseconds.
+class LatencyReport
+{
+  public:
+    std::string name;
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+    double mean = 0;
+};
+
+class LoadReport
+{
+  public:
+    LoadMode mode = LoadMode::CLOSED;
+    /// Of the measured window, warmup excluded.
+    double seconds = 0;
+    /// Measured requests completed per second, errors included.
+    double throughput = 0;
+    LatencyReport total;
+    std::vector<LatencyReport> operations;
+    /// OPEN: arrivals dropped because of maxInFlight.
+    uint64_t dropped = 0;
+    /// Requests still in flight after the drain.
+    uint64_t unfinished = 0;
+
+    Json::Value toJson() const;
+};
+
+/// Human-readable table of the report.
+std::string to_string(const LoadReport &report);
+
+/// Drives a Workload against a target.
+///
+/// The generator draws the operations and paces them, the Executor sends
+/// them and calls `done` once, from any thread, with whether the request
+/// succeeded. In the OPEN mode the latency is counted from the scheduled
+/// arrival time, so a target falling behind is not hidden by the generator
+/// waiting for it (coordinated omission).
+class LoadGenerator
+{
+  public:
+    using Done = std::function<void(bool)>;
+    using Executor =
+        std::function<void(const WorkloadOperation &, const Done &)>;
+
+    LoadGenerator(const Workload &workload,
+                  const LoadConfig &config,
+                  const Executor &executor);
+
+  public:
+    /// Blocks the calling thread for warmup, duration and drain.
+    LoadReport run();
+
+  private:
+    class State;
+
+    void runClosed(const std::shared_ptr<State> &state);
+    void runOpen(const std::shared_ptr<State> &state);
+    void issue(const std::shared_ptr<State> &state,
+               std::chrono::steady_clock::time_point scheduled);
+
+  private:
+    Workload workload_;
+    LoadConfig config_;
+    Executor executor_;
+    std::mt19937_64 random_;
+};
+
+};  // namespace tl::elasticsearch::load
@@ -0,0 +1,173 @@
+/**
+ *
+ *  Workload.cc
+ *
+ */
+
+#include "Workload.h"
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+using namespace tl::elasticsearch;
+using namespace tl::elasticsearch::load;
+
+string tl::elasticsearch::load::to_string(OperationKind kind)
+{
+    switch (kind)
+    {
+        case OperationKind::SEARCH:
+            return "search";
+        case OperationKind::GET:
+            return "get";
+        case OperationKind::INDEX:
+            return "index";
+        case OperationKind::BULK:
+            return "bulk";
+    }
+    return "unknown";
+}
+
+SearchParam WorkloadOperation::searchParam() const
+{
+    SearchParam param(index);
+    if (search.isMember("query"))
+    {
+        param.query(make_shared<RawQuery>(search["query"]));
+    }
+    // [{"field": "asc"}], [{"field": {"order": "desc"}}] or ["field"]
+    for (const auto &item : search["sort"])
+    {
+        if (item.isString())
+        {
+            param.sort(item.asString());
+            continue;
+        }
+        auto field = item.getMemberNames()[0];
+        const auto &order =
+            item[field].isObject() ? item[field]["order"] : item[field];
+        param.sort(field, order.asString() == "desc" ? DESC : ASC);
+    }
+    if (search.isMember("from"))
+    {
+        param.from(search["from"].asInt());
+    }
+    if (search.isMember("size"))
+    {
+        param.size(search["size"].asInt());
+    }
+    if (search.isMember("aggs"))
+    {
+        param.agg(make_shared<RawAggregations>(search["aggs"]));
+    }
+    return param;
+}
+
+vector<Json::Value> WorkloadOperation::bulkLines() const
+{
+    Json::Value action;
+    action["index"]["_index"] = index;
+    action["index"]["_type"] = "_doc";
+    vector<Json::Value> lines;
+    lines.reserve(bulkSize * 2);
+    for (size_t i = 0; i < bulkSize; ++i)
+    {
+        lines.push_back(action);
+        lines.push_back(document);
+    }
+    return lines;
+}
+
+static OperationKind parseKind(const string &type)
+{
+    for (auto kind : { OperationKind::SEARCH,
+                       OperationKind::GET,
+                       OperationKind::INDEX,
+                       OperationKind::BULK })
+    {
+        if (to_string(kind) == type)
+        {
+            return kind;
+        }
+    }
+    throw invalid_argument("unknown operation type \"" + type + "\"");
+}
+
+Workload Workload::fromJson(const Json::Value &json)
+{
+    const auto &items = json.isArray() ? json : json["operations"];
+    if (!items.isArray() || items.empty())
+    {
+        throw invalid_argument("the workload has no operation");
+    }
+    Workload workload;
+    vector<double> weights;
+    for (const auto &item : items)
+    {
+        WorkloadOperation operation;
+        operation.kind = parseKind(item.get("type", "search").asString());
+        operation.index = item["index"].asString();
+        operation.weight = item.get("weight", 1).asDouble();
+        operation.name = item.get("name", to_string(operation.kind) + ":" +
+                                              operation.index)
+                             .asString();
+        operation.search = item["search"];
+        for (const auto &id : item["ids"])
+        {
+            operation.ids.push_back(id.asString());
+        }
+        operation.document = item["document"];
+        operation.bulkSize = item.get("bulk_size", 100).asUInt();
+
+        if (operation.index.empty())
+        {
+            throw invalid_argument(operation.name + ": index is missing");
+        }
+        if (operation.weight < 0)
+        {
+            throw invalid_argument(operation.name + ": negative weight");
+        }
+        if (operation.kind == OperationKind::GET && operation.ids.empty())
+        {
+            throw invalid_argument(operation.name + ": ids are missing");
+        }
+        if ((operation.kind == OperationKind::INDEX ||
+             operation.kind == OperationKind::BULK) &&
+            !operation.document.isObject())
+        {
+            throw invalid_argument(operation.name + ": document is missing");
+        }
+        weights.push_back(operation.weight);
+        workload.operations_.push_back(std::move(operation));
+    }
+    if (accumulate(weights.begin(), weights.end(), 0.0) <= 0)
+    {
+        throw invalid_argument("the weights of the workload are all 0");
+    }
+    workload.distribution_ =
+        discrete_distribution<size_t>(weights.begin(), weights.end());
+    return workload;
+}
+
+Workload Workload::fromFile(const string &path)
+{
+    ifstream file(path);
+    if (!file)
+    {
+        throw invalid_argument("cannot read " + path);
+    }
+    Json::Value json;
+    Json::CharReaderBuilder builder;
+    string errors;
+    if (!Json::parseFromStream(builder, file, &json, &errors))
+    {
+        throw invalid_argument(path + ": " + errors);
+    }
+    return fromJson(json);
+}
+
+size_t Workload::pick(mt19937_64 &random) const
+{
+    return distribution_(random);
+}
@@ -0,0 +1,144 @@
+/**
+ *
+ *  Workload.h
+ *
+ */
+
+#pragma once
+
+#include "../../src/Aggregation.h"
+#include "../../src/DocumentsClient.h"
+#include "../../src/Query.h"
+#include <json/json.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch::load
+{
+
+enum class OperationKind
+{
+    SEARCH = 0,
+    GET,
+    INDEX,
+    BULK
+};
+
+std::string to_string(OperationKind kind);
+
+/// A query given as JSON, sent as is.
+class RawQuery : public Query
+{
+  public:
+    RawQuery(const Json::Value &json) : json_(json)
+    {
+    }
+
+    Json::Value toJson() const override
+    {
+        return json_;
+    }
+
+  private:
+    Json::Value json_;
+};
+
+/// The "aggs" of a search given as JSON, sent as is.
+class RawAggregations : public Aggregations
+{
+  public:
+    RawAggregations(const Json::Value &json) : json_(json)
+    {
+    }
+
+    Json::Value toJson() const override
+    {
+        return json_;
+    }
+
+  private:
+    Json::Value json_;
+};
+
+/// Any document, as its JSON source.
+class JsonDocument : public Document
+{
+  public:
+    JsonDocument() = default;
+
+    JsonDocument(const Json::Value &source) : source(source)
+    {
+    }
+
+    Json::Value toJson() const override
+    {
+        return source;
+    }
+
+    void setByJson(const Json::Value &json) override
+    {
+        source = json;
+    }
+
+  public:
+    Json::Value source;
+};
+
+/// One kind of request of the mix.
+class WorkloadOperation
+{
+  public:
+    /// Label in the report, "<kind>:<index>" by default.
+    std::string name;
+    OperationKind kind = OperationKind::SEARCH;
+    /// Relative frequency in the mix.
+    double weight = 1;
+    std::string index;
+    /// SEARCH: body of the search, with query, sort, from, size and aggs.
+    Json::Value search;
+    /// GET: one of them at random.
+    std::vector<std::string> ids;
+    /// INDEX and BULK: source of the documents.
+    Json::Value document;
+    /// BULK: documents per request.
+    size_t bulkSize = 100;
+
+    SearchParam searchParam() const;
+    /// Action and source lines of a BULK request.
+    std::vector<Json::Value> bulkLines() const;
+};
+
+/// The mix of requests of a load run, read from a file like:
+///
+/// {"operations": [
+///   {"type": "search", "weight": 8, "index": "accounts",
+///    "search": {"query": {"match": {"address": "street"}}, "size": 10}},
+///   {"type": "get", "weight": 1, "index": "accounts", "ids": ["1", "6"]},
+///   {"type": "index", "weight": 1, "index": "accounts",
+///    "document": {"age": 30}},
+///   {"type": "bulk", "weight": 0.1, "index": "accounts", "bulk_size": 500,
+///    "document": {"age": 30}}
+/// ]}
+class Workload
+{
+  public:
+    /// Throws std::invalid_argument on an invalid mix.
+    static Workload fromJson(const Json::Value &json);
+    static Workload fromFile(const std::string &path);
+
+  public:
+    const std::vector<WorkloadOperation> &operations() const
+    {
+        return operations_;
+    }
+
+    /// Index of an operation drawn by weight.
+    size_t pick(std::mt19937_64 &random) const;
+
+  private:
+    std::vector<WorkloadOperation> operations_;
+    mutable std::discrete_distribution<size_t> distribution_;
+};
+
+};  // namespace tl::elasticsearch::load
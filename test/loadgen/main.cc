@@ -0,0 +1,197 @@
+/**
+ *
+ *  main.cc
+ *
+ *  Load generator driving the client against a real or a mock node:
+ *
+ *  ESLoadGenerator -w workload.json [-u http://127.0.0.1:9200[,...]]
+ *                  [-m closed|open] [-c concurrency] [-r rate] [-f]
+ *                  [-W warmup] [-d duration] [-s seed] [-j]
+ *
+ *  -f uses a fixed interval between arrivals instead of a Poisson process,
+ *  -j prints the report as JSON.
+ *
+ */
+
+#include "LoadGenerator.h"
+#include "../../src/DocumentsClient.h"
+#include "../../src/HttpClient.h"
+#include <drogon/drogon.h>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace tl::elasticsearch;
+using namespace tl::elasticsearch::load;
+
+static vector<string> splitUrls(const string &urls)
+{
+    vector<string> result;
+    size_t begin = 0;
+    while (begin <= urls.size())
+    {
+        auto end = urls.find(',', begin);
+        if (end == string::npos)
+        {
+            end = urls.size();
+        }
+        if (end > begin)
+        {
+            result.push_back(urls.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return result;
+}
+
+static LoadGenerator::Executor executor(const HttpClientPtr &httpClient)
+{
+    auto documents = make_shared<DocumentsClient>(httpClient);
+    auto nextId = make_shared<atomic<uint64_t>>(0);
+    return [httpClient, documents, nextId](const WorkloadOperation &operation,
+                                           const LoadGenerator::Done &done) {
+        auto onError = [done](const ElasticSearchException &) {
+            done(false);
+        };
+        switch (operation.kind)
+        {
+            case OperationKind::SEARCH:
+                documents->search<JsonDocument>(
+                    operation.searchParam(),
+                    [done](const SearchResponsePtr<JsonDocument> &) {
+                        done(true);
+                    },
+                    onError);
+                break;
+            case OperationKind::GET:
+            {
+                GetParam param(operation.index);
+                param.setId(operation.ids[(*nextId)++ % operation.ids.size()]);
+                documents->get(
+                    param,
+                    [done](const GetResponsePtr &) { done(true); },
+                    onError);
+                break;
+            }
+            case OperationKind::INDEX:
+                documents->index(
+                    IndexParam(operation.index),
+                    JsonDocument(operation.document),
+                    [done](const IndexResponsePtr &) { done(true); },
+                    onError);
+                break;
+            case OperationKind::BULK:
+                httpClient->sendRequest(
+                    "/_bulk",
+                    drogon::Post,
+                    [done](const Json::Value &response) {
+                        done(!response["errors"].asBool());
+                    },
+                    onError,
+                    operation.bulkLines());
+                break;
+        }
+    };
+}
+
+static void usage(const char *program)
+{
+    cerr << "usage: " << program
+         << " -w workload.json [-u url[,url...]] [-m closed|open]"
+            " [-c concurrency] [-r rate] [-f] [-W warmup] [-d duration]"
+            " [-s seed] [-j]"
+         << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    LoadConfig config;
+    string urls = "http://127.0.0.1:9200";
+    string workloadFile;
+    bool json = false;
+    int option;
+    while ((option = getopt(argc, argv, "w:u:m:c:r:fW:d:s:jh")) != -1)
+    {
+        switch (option)
+        {
+            case 'w':
+                workloadFile = optarg;
+                break;
+            case 'u':
+                urls = optarg;
+                break;
+            case 'm':
+                config.mode = string(optarg) == "open" ? LoadMode::OPEN
+                                                       : LoadMode::CLOSED;
+                break;
+            case 'c':
+                config.concurrency = stoul(optarg);
+                break;
+            case 'r':
+                config.rate = stod(optarg);
+                break;
+            case 'f':
+                config.poisson = false;
+                break;
+            case 'W':
+                config.warmupSeconds = stod(optarg);
+                break;
+            case 'd':
+                config.durationSeconds = stod(optarg);
+                break;
+            case 's':
+                config.seed = stoull(optarg);
+                break;
+            case 'j':
+                json = true;
+                break;
+            default:
+                usage(argv[0]);
+                return option == 'h' ? 0 : 1;
+        }
+    }
+    if (workloadFile.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Workload workload;
+    try
+    {
+        workload = Workload::fromFile(workloadFile);
+    }
+    catch (const exception &e)
+    {
+        cerr << "invalid workload: " << e.what() << endl;
+        return 1;
+    }
+
+    // the client sends its requests on the main loop of drogon
+    promise<void> started;
+    thread loop([&started]() {
+        drogon::app().getLoop()->queueInLoop(
+            [&started]() { started.set_value(); });
+        drogon::app().run();
+    });
+    started.get_future().get();
+
+    auto httpClient = make_shared<HttpClient>(splitUrls(urls));
+    LoadGenerator generator(workload, config, executor(httpClient));
+    auto report = generator.run();
+
+    drogon::app().getLoop()->queueInLoop([]() { drogon::app().quit(); });
+    loop.join();
+
+    if (json)
+    {
+        cout << report.toJson().toStyledString();
+    }
+    else
+    {
+        cout << to_string(report);
+    }
+    return report.unfinished > 0 ? 2 : 0;
+}
@@ -7,6 +7,27 @@
 #include "unittests/IndicesClientTest.h"
 #include "unittests/DocumentsClientTest.h"
 #include "unittests/SearchTest.h"
+#include "unittests/NodePoolTest.h"
+#include "unittests/SnifferTest.h"
+#include "unittests/CircuitBreakerTest.h"
+#include "unittests/HedgingTest.h"
+#include "unittests/ConcurrencyLimiterTest.h"
+#include "unittests/RateLimiterTest.h"
+#include "unittests/RequestAwaiterTest.h"
+#include "unittests/SyncCallerTest.h"
+#include "unittests/CancellationTest.h"
+#include "unittests/MetricsTest.h"
+#include "unittests/RequestTimingTest.h"
+#include "unittests/SlowLogTest.h"
+#include "unittests/TracerTest.h"
+#include "unittests/MockServerTest.h"
+#include "unittests/LoadGeneratorTest.h"
+#include "unittests/TrafficCaptureTest.h"
+#include "unittests/QueryTreeTest.h"
+#include "unittests/QueryTemplateTest.h"
+#include "unittests/FingerprintTest.h"
+#include "unittests/QueryOptimizerTest.h"
+#include "unittests/ProfileTest.h"
 
 using namespace drogon;
 
@@ -15,6 +36,8 @@ int main(int argc, char *argv[])
     std::promise<void> p1;
     std::future<void> f1 = p1.get_future();
 
+    registerSnifferStandIn();
+
     // Start the main loop on another thread
     std::thread thr([&]() {
         // Queues the promise to be fulfilled after starting the loop
@@ -0,0 +1,129 @@
+/**
+ *
+ *  FaultInjector.cc
+ *
+ */
+
+#include "FaultInjector.h"
+#include <cmath>
+
+using namespace std;
+using namespace tl::elasticsearch::mock;
+
+// z-score of the 99th percentile of a normal distribution
+static constexpr double kZ99 = 2.3263;
+
+FaultConfig FaultConfig::fromJson(const Json::Value &json)
+{
+    FaultConfig config;
+    config.latencyMedianMs = json["latency"].get("median_ms", 0).asDouble();
+    config.latencyP99Ms = json["latency"].get("p99_ms", 0).asDouble();
+    config.errorRate = json.get("error_rate", 0).asDouble();
+    config.rejectRate = json.get("reject_rate", 0).asDouble();
+    config.stallRate = json.get("stall_rate", 0).asDouble();
+    config.stallMs = json.get("stall_ms", 30000).asDouble();
+    config.seed = json.get("seed", 0).asUInt64();
+    return config;
+}
+
+Json::Value FaultConfig::toJson() const
+{
+    Json::Value json;
+    json["latency"]["median_ms"] = latencyMedianMs;
+    json["latency"]["p99_ms"] = latencyP99Ms;
+    json["error_rate"] = errorRate;
+    json["reject_rate"] = rejectRate;
+    json["stall_rate"] = stallRate;
+    json["stall_ms"] = stallMs;
+    json["seed"] = Json::UInt64(seed);
+    return json;
+}
+
+string tl::elasticsearch::mock::to_string(FaultKind kind)
+{
+    switch (kind)
+    {
+        case FaultKind::NONE:
+            return "none";
+        case FaultKind::ERROR:
+            return "error";
+        case FaultKind::REJECT:
+            return "reject";
+        case FaultKind::STALL:
+            return "stall";
+    }
+    return "unknown";
+}
+
+FaultInjector::FaultInjector(const FaultConfig &config) : config_(config)
+{
+    seed();
+}
+
+void FaultInjector::seed()
+{
+    random_.seed(config_.seed != 0 ? config_.seed : random_device{}());
+}
+
+Fault FaultInjector::next()
+{
+    lock_guard<mutex> lock(mutex_);
+    ++stats_.requests;
+    Fault fault;
+    fault.delayMs = latencyMs();
+    // one draw, so that the rates are exclusive
+    auto draw = uniform_real_distribution<double>(0, 1)(random_);
+    if (draw < config_.rejectRate)
+    {
+        fault.kind = FaultKind::REJECT;
+        ++stats_.rejected;
+    }
+    else if ((draw -= config_.rejectRate) < config_.errorRate)
+    {
+        fault.kind = FaultKind::ERROR;
+        ++stats_.errors;
+    }
+    else if ((draw -= config_.errorRate) < config_.stallRate)
+    {
+        fault.kind = FaultKind::STALL;
+        fault.delayMs += config_.stallMs;
+        ++stats_.stalled;
+    }
+    return fault;
+}
+
+double FaultInjector::latencyMs()
+{
+    if (config_.latencyMedianMs <= 0)
+    {
+        return 0;
+    }
+    auto mu = log(config_.latencyMedianMs);
+    auto sigma = config_.latencyP99Ms > config_.latencyMedianMs
+                     ? (log(config_.latencyP99Ms) - mu) / kZ99
+                     : 0.0;
+    if (sigma == 0)
+    {
+        return config_.latencyMedianMs;
+    }
+    return lognormal_distribution<double>(mu, sigma)(random_);
+}
+
+void FaultInjector::setConfig(const FaultConfig &config)
+{
+    lock_guard<mutex> lock(mutex_);
+    config_ = config;
+    seed();
+}
+
+FaultConfig FaultInjector::config() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return config_;
+}
+
+FaultStats FaultInjector::stats() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,95 @@
+/**
+ *
+ *  FaultInjector.h
+ *
+ */
+
+#pragma once
+
+#include <json/json.h>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+
+namespace tl::elasticsearch::mock
+{
+
+class FaultConfig
+{
+  public:
+    /// Latency added to every response, log-normal with this median and
+    /// 99th percentile. 0 means none.
+    double latencyMedianMs = 0;
+    double latencyP99Ms = 0;
+    /// Fraction of the requests answered with a 500.
+    double errorRate = 0;
+    /// Fraction of the requests answered with a 429
+    /// es_rejected_execution_exception.
+    double rejectRate = 0;
+    /// Fraction of the requests held for stallMs before their response,
+    /// longer than the timeout of the client by default.
+    double stallRate = 0;
+    double stallMs = 30000;
+    /// Seed of the random generator, 0 means a random seed. With a seed the
+    /// sequence of faults is reproducible.
+    uint64_t seed = 0;
+
+    static FaultConfig fromJson(const Json::Value &json);
+    Json::Value toJson() const;
+};
+
+enum class FaultKind
+{
+    NONE = 0,
+    ERROR,
+    REJECT,
+    STALL
+};
+
+std::string to_string(FaultKind kind);
+
+/// What happens to one request.
+class Fault
+{
+  public:
+    FaultKind kind = FaultKind::NONE;
+    /// Before the response is sent.
+    double delayMs = 0;
+};
+
+class FaultStats
+{
+  public:
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t rejected = 0;
+    uint64_t stalled = 0;
+};
+
+/// Draws the fault of each request of the mock server.
+class FaultInjector
+{
+  public:
+    FaultInjector(const FaultConfig &config = FaultConfig());
+
+  public:
+    Fault next();
+
+    /// Replaces the config and reseeds the generator.
+    void setConfig(const FaultConfig &config);
+    FaultConfig config() const;
+    FaultStats stats() const;
+
+  private:
+    void seed();
+    double latencyMs();
+
+  private:
+    mutable std::mutex mutex_;
+    FaultConfig config_;
+    std::mt19937_64 random_;
+    FaultStats stats_;
+};
+
+};  // namespace tl::elasticsearch::mock
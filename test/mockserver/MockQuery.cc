@@ -0,0 +1,531 @@
+/**
+ *
+ *  MockQuery.cc
+ *
+ */
+
+#include "MockQuery.h"
+#include <algorithm>
+#include <cctype>
+#include <map>
+
+using namespace std;
+using namespace tl::elasticsearch::mock;
+
+const Json::Value *MockQuery::field(const Json::Value &source,
+                                    const string &path)
+{
+    const Json::Value *current = &source;
+    size_t begin = 0;
+    while (begin <= path.size())
+    {
+        auto end = path.find('.', begin);
+        if (end == string::npos)
+        {
+            end = path.size();
+        }
+        auto name = path.substr(begin, end - begin);
+        if (!current->isObject() || !current->isMember(name))
+        {
+            // keyword sub-field of a text field
+            if (name == "keyword" && end == path.size() && begin > 0)
+            {
+                return current;
+            }
+            return nullptr;
+        }
+        current = &(*current)[name];
+        begin = end + 1;
+    }
+    return current;
+}
+
+vector<string> MockQuery::tokens(const Json::Value &value)
+{
+    vector<string> result;
+    if (value.isArray())
+    {
+        for (const auto &item : value)
+        {
+            auto itemTokens = tokens(item);
+            result.insert(result.end(), itemTokens.begin(), itemTokens.end());
+        }
+        return result;
+    }
+    if (!value.isString() && !value.isNumeric() && !value.isBool())
+    {
+        return result;
+    }
+    string token;
+    for (auto c : value.asString())
+    {
+        if (isalnum(static_cast<unsigned char>(c)))
+        {
+            token += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        }
+        else if (!token.empty())
+        {
+            result.push_back(std::move(token));
+            token.clear();
+        }
+    }
+    if (!token.empty())
+    {
+        result.push_back(std::move(token));
+    }
+    return result;
+}
+
+// {"field": value} or {"field": {"<key>": value}}
+static pair<string, Json::Value> fieldAndValue(const Json::Value &body,
+                                               const char *key,
+                                               const char *queryName)
+{
+    if (!body.isObject() || body.size() != 1)
+    {
+        throw QueryError(string("[") + queryName +
+                         "] query malformed, no field or more than one");
+    }
+    auto name = body.getMemberNames()[0];
+    const auto &value = body[name];
+    if (value.isObject())
+    {
+        return { name, value[key] };
+    }
+    return { name, value };
+}
+
+static bool sameValue(const Json::Value &a, const Json::Value &b)
+{
+    if (a.isNumeric() && b.isNumeric())
+    {
+        return a.asDouble() == b.asDouble();
+    }
+    if (a.isNumeric() || b.isNumeric())
+    {
+        return a.asString() == b.asString();
+    }
+    return a == b;
+}
+
+static bool termMatches(const Json::Value *value, const Json::Value &term)
+{
+    if (!value)
+    {
+        return false;
+    }
+    if (value->isArray())
+    {
+        for (const auto &item : *value)
+        {
+            if (termMatches(&item, term))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (sameValue(*value, term))
+    {
+        return true;
+    }
+    // a text field is indexed as its tokens
+    auto tokens = MockQuery::tokens(*value);
+    return term.isString() &&
+           find(tokens.begin(), tokens.end(), term.asString()) != tokens.end();
+}
+
+static size_t matchedTokens(const Json::Value *value, const Json::Value &query)
+{
+    if (!value)
+    {
+        return 0;
+    }
+    auto fieldTokens = MockQuery::tokens(*value);
+    size_t matched = 0;
+    for (const auto &token : MockQuery::tokens(query))
+    {
+        if (find(fieldTokens.begin(), fieldTokens.end(), token) !=
+            fieldTokens.end())
+        {
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+static bool phraseMatches(const Json::Value *value, const Json::Value &query)
+{
+    if (!value)
+    {
+        return false;
+    }
+    auto fieldTokens = MockQuery::tokens(*value);
+    auto phrase = MockQuery::tokens(query);
+    return !phrase.empty() &&
+           search(fieldTokens.begin(),
+                  fieldTokens.end(),
+                  phrase.begin(),
+                  phrase.end()) != fieldTokens.end();
+}
+
+static bool rangeMatches(const Json::Value *value, const Json::Value &range)
+{
+    if (!value || !value->isNumeric())
+    {
+        return false;
+    }
+    auto number = value->asDouble();
+    for (const auto &name : range.getMemberNames())
+    {
+        const auto &bound = range[name];
+        if (!bound.isNumeric())
+        {
+            continue;
+        }
+        auto limit = bound.asDouble();
+        if ((name == "gt" && !(number > limit)) ||
+            (name == "gte" && !(number >= limit)) ||
+            (name == "lt" && !(number < limit)) ||
+            (name == "lte" && !(number <= limit)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// a clause of a bool query is a query or an array of queries
+static vector<Json::Value> clauses(const Json::Value &value)
+{
+    vector<Json::Value> result;
+    if (value.isArray())
+    {
+        for (const auto &item : value)
+        {
+            result.push_back(item);
+        }
+    }
+    else if (!value.isNull())
+    {
+        result.push_back(value);
+    }
+    return result;
+}
+
+static bool boolMatches(const Json::Value &body,
+                        const Json::Value &source,
+                        double &score)
+{
+    static const vector<string> known{
+        "must", "filter", "should", "must_not", "minimum_should_match", "boost"
+    };
+    for (const auto &name : body.getMemberNames())
+    {
+        if (find(known.begin(), known.end(), name) == known.end())
+        {
+            throw QueryError("[bool] query does not support [" + name + "]");
+        }
+    }
+    double boolScore = 0;
+    for (const auto &clause : clauses(body["must"]))
+    {
+        if (!MockQuery::matches(clause, source, boolScore))
+        {
+            return false;
+        }
+    }
+    for (const auto &clause : clauses(body["filter"]))
+    {
+        double ignored = 0;
+        if (!MockQuery::matches(clause, source, ignored))
+        {
+            return false;
+        }
+    }
+    for (const auto &clause : clauses(body["must_not"]))
+    {
+        double ignored = 0;
+        if (MockQuery::matches(clause, source, ignored))
+        {
+            return false;
+        }
+    }
+    auto should = clauses(body["should"]);
+    int minimumShould = body.isMember("minimum_should_match")
+                            ? body["minimum_should_match"].asInt()
+                        : body.isMember("must") || body.isMember("filter")
+                            ? 0
+                            : 1;
+    int matchedShould = 0;
+    for (const auto &clause : should)
+    {
+        if (MockQuery::matches(clause, source, boolScore))
+        {
+            ++matchedShould;
+        }
+    }
+    if (!should.empty() && matchedShould < minimumShould)
+    {
+        return false;
+    }
+    score += boolScore > 0 ? boolScore : 1;
+    return true;
+}
+
+bool MockQuery::matches(const Json::Value &query,
+                        const Json::Value &source,
+                        double &score)
+{
+    if (!query.isObject() || query.size() != 1)
+    {
+        throw QueryError("query malformed, must start with start_object");
+    }
+    auto type = query.getMemberNames()[0];
+    const auto &body = query[type];
+    if (type == "match_all")
+    {
+        score += 1;
+        return true;
+    }
+    if (type == "match")
+    {
+        auto [name, value] = fieldAndValue(body, "query", "match");
+        auto matched = matchedTokens(field(source, name), value);
+        score += static_cast<double>(matched);
+        return matched > 0;
+    }
+    if (type == "match_phrase")
+    {
+        auto [name, value] = fieldAndValue(body, "query", "match_phrase");
+        bool matched = phraseMatches(field(source, name), value);
+        score += matched ? 1 : 0;
+        return matched;
+    }
+    if (type == "multi_match")
+    {
+        size_t best = 0;
+        for (const auto &name : body["fields"])
+        {
+            best = max(best,
+                       matchedTokens(field(source, name.asString()),
+                                     body["query"]));
+        }
+        score += static_cast<double>(best);
+        return best > 0;
+    }
+    if (type == "term")
+    {
+        auto [name, value] = fieldAndValue(body, "value", "term");
+        bool matched = termMatches(field(source, name), value);
+        score += matched ? 1 : 0;
+        return matched;
+    }
+    if (type == "terms")
+    {
+        auto [name, values] = fieldAndValue(body, "value", "terms");
+        for (const auto &value : values)
+        {
+            if (termMatches(field(source, name), value))
+            {
+                score += 1;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (type == "range")
+    {
+        if (!body.isObject() || body.size() != 1)
+        {
+            throw QueryError("[range] query malformed");
+        }
+        auto name = body.getMemberNames()[0];
+        score += 1;
+        return rangeMatches(field(source, name), body[name]);
+    }
+    if (type == "exists")
+    {
+        score += 1;
+        return field(source, body["field"].asString()) != nullptr;
+    }
+    if (type == "bool")
+    {
+        return boolMatches(body, source, score);
+    }
+    throw QueryError("no [query] registered for [" + type + "]");
+}
+
+// value of a metric aggregation, null without values
+static Json::Value metric(const string &type,
+                          const string &fieldName,
+                          const vector<const Json::Value *> &hits)
+{
+    double result = 0;
+    size_t count = 0;
+    for (auto hit : hits)
+    {
+        auto value = MockQuery::field(*hit, fieldName);
+        if (!value || !value->isNumeric())
+        {
+            continue;
+        }
+        auto number = value->asDouble();
+        if (count == 0)
+        {
+            result = type == "sum" || type == "avg" ? 0 : number;
+        }
+        if (type == "sum" || type == "avg")
+        {
+            result += number;
+        }
+        else if (type == "min")
+        {
+            result = min(result, number);
+        }
+        else if (type == "max")
+        {
+            result = max(result, number);
+        }
+        ++count;
+    }
+    if (type == "value_count")
+    {
+        return Json::UInt64(count);
+    }
+    if (count == 0)
+    {
+        return Json::Value();
+    }
+    return type == "avg" ? result / static_cast<double>(count) : result;
+}
+
+static Json::Value termsAggregation(const Json::Value &terms,
+                                    const Json::Value &subAggs,
+                                    const vector<const Json::Value *> &hits)
+{
+    auto fieldName = terms["field"].asString();
+    auto size = terms.get("size", 10).asUInt();
+
+    // key as text -> (key, documents)
+    map<string, pair<Json::Value, vector<const Json::Value *>>> groups;
+    for (auto hit : hits)
+    {
+        auto value = MockQuery::field(*hit, fieldName);
+        if (!value)
+        {
+            continue;
+        }
+        vector<Json::Value> keys;
+        if (value->isArray())
+        {
+            keys.assign(value->begin(), value->end());
+        }
+        else
+        {
+            keys.push_back(*value);
+        }
+        for (const auto &key : keys)
+        {
+            auto &group = groups[key.asString()];
+            group.first = key;
+            group.second.push_back(hit);
+        }
+    }
+
+    vector<Json::Value> buckets;
+    for (auto &[text, group] : groups)
+    {
+        Json::Value bucket = MockQuery::aggregate(subAggs, group.second);
+        if (bucket.isNull())
+        {
+            bucket = Json::Value(Json::objectValue);
+        }
+        bucket["key"] = group.first;
+        bucket["doc_count"] = Json::UInt64(group.second.size());
+        buckets.push_back(std::move(bucket));
+    }
+
+    // {"_count": "desc"} by default, or {"_key"|"<metric>": "asc"|"desc"}
+    string orderBy = "_count";
+    bool ascending = false;
+    if (terms["order"].isObject() && terms["order"].size() == 1)
+    {
+        orderBy = terms["order"].getMemberNames()[0];
+        ascending = terms["order"][orderBy].asString() == "asc";
+    }
+    auto sortValue = [&orderBy](const Json::Value &bucket) {
+        if (orderBy == "_count")
+        {
+            return bucket["doc_count"];
+        }
+        if (orderBy == "_key")
+        {
+            return bucket["key"];
+        }
+        return bucket[orderBy]["value"];
+    };
+    stable_sort(buckets.begin(),
+                buckets.end(),
+                [&sortValue, ascending](const Json::Value &a,
+                                        const Json::Value &b) {
+                    return ascending ? sortValue(a) < sortValue(b)
+                                     : sortValue(b) < sortValue(a);
+                });
+
+    Json::Value result;
+    result["doc_count_error_upper_bound"] = 0;
+    uint64_t other = 0;
+    result["buckets"] = Json::Value(Json::arrayValue);
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        if (i < size)
+        {
+            result["buckets"].append(buckets[i]);
+        }
+        else
+        {
+            other += buckets[i]["doc_count"].asUInt64();
+        }
+    }
+    result["sum_other_doc_count"] = Json::UInt64(other);
+    return result;
+}
+
+Json::Value MockQuery::aggregate(const Json::Value &aggs,
+                                 const vector<const Json::Value *> &hits)
+{
+    Json::Value result;
+    if (!aggs.isObject())
+    {
+        return result;
+    }
+    for (const auto &name : aggs.getMemberNames())
+    {
+        const auto &agg = aggs[name];
+        for (const auto &type : agg.getMemberNames())
+        {
+            if (type == "aggs" || type == "aggregations")
+            {
+                continue;
+            }
+            if (type == "terms")
+            {
+                auto subAggs =
+                    agg.isMember("aggs") ? agg["aggs"] : agg["aggregations"];
+                result[name] = termsAggregation(agg[type], subAggs, hits);
+            }
+            else if (type == "avg" || type == "sum" || type == "min" ||
+                     type == "max" || type == "value_count")
+            {
+                result[name]["value"] =
+                    metric(type, agg[type]["field"].asString(), hits);
+            }
+            else
+            {
+                throw QueryError("unknown aggregation type [" + type + "]");
+            }
+        }
+    }
+    return result;
+}
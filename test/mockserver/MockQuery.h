@@ -0,0 +1,50 @@
+/**
+ *
+ *  MockQuery.h
+ *
+ */
+
+#pragma once
+
+#include <json/json.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch::mock
+{
+
+/// A query or an aggregation the mock does not understand, answered with a
+/// 400 parsing_exception like Elasticsearch does.
+class QueryError : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/// Evaluates the queries and aggregations of a _search on the sources of
+/// the stored documents.
+///
+/// Text is split into lowercase alphanumeric tokens, which is close enough
+/// to the standard analyzer for the test data. `field.keyword` reads the
+/// raw value of `field`.
+class MockQuery
+{
+  public:
+    /// Whether the source matches the query, adds its relevance to `score`.
+    static bool matches(const Json::Value &query,
+                        const Json::Value &source,
+                        double &score);
+
+    /// The "aggregations" of a response for the "aggs" of a request.
+    static Json::Value aggregate(const Json::Value &aggs,
+                                 const std::vector<const Json::Value *> &hits);
+
+    /// Value of a dotted path, nullptr if absent.
+    static const Json::Value *field(const Json::Value &source,
+                                    const std::string &path);
+
+    static std::vector<std::string> tokens(const Json::Value &value);
+};
+
+};  // namespace tl::elasticsearch::mock
@@ -0,0 +1,286 @@
+/**
+ *
+ *  MockServer.cc
+ *
+ */
+
+#include "MockServer.h"
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace tl::elasticsearch::mock;
+
+MockServer::MockServer(const string &publishAddress, const FaultConfig &faults)
+    : publishAddress_(publishAddress), faults_(faults)
+{
+}
+
+static vector<string> splitPath(const string &path)
+{
+    vector<string> segments;
+    auto end = path.find('?');
+    if (end == string::npos)
+    {
+        end = path.size();
+    }
+    size_t begin = 0;
+    while (begin < end)
+    {
+        auto slash = path.find('/', begin);
+        if (slash == string::npos || slash > end)
+        {
+            slash = end;
+        }
+        if (slash > begin)
+        {
+            segments.push_back(path.substr(begin, slash - begin));
+        }
+        begin = slash + 1;
+    }
+    return segments;
+}
+
+static MockResult noHandler(const string &method, const string &path)
+{
+    return errorResult(400,
+                       "illegal_argument_exception",
+                       "no handler found for uri [" + path +
+                           "] and method [" + method + "]");
+}
+
+static MockResult acknowledged()
+{
+    MockResult result;
+    result.body["acknowledged"] = true;
+    return result;
+}
+
+MockResult MockServer::handle(const string &method,
+                              const string &path,
+                              const string &body)
+{
+    auto segments = splitPath(path);
+    auto size = segments.size();
+    auto route = [&](size_t expected, const char *name, size_t at) {
+        return size == expected && segments[at] == name;
+    };
+
+    if (route(2, "_bulk", 1) || route(1, "_bulk", 0))
+    {
+        if (method != "POST" && method != "PUT")
+        {
+            return noHandler(method, path);
+        }
+        return store_.bulk(size == 2 ? segments[0] : "", body);
+    }
+
+    Json::Value json;
+    if (!body.empty())
+    {
+        Json::CharReaderBuilder builder;
+        unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        string errors;
+        if (!reader->parse(body.data(),
+                           body.data() + body.size(),
+                           &json,
+                           &errors))
+        {
+            return errorResult(400, "parse_exception", errors);
+        }
+    }
+
+    if (size == 0)
+    {
+        return method == "GET" || method == "HEAD" ? info()
+                                                   : noHandler(method, path);
+    }
+    if (segments[0] == "_mock")
+    {
+        if (route(2, "faults", 1) && method == "GET")
+        {
+            MockResult result;
+            result.body = faults_.config().toJson();
+            return result;
+        }
+        if (route(2, "faults", 1) && (method == "PUT" || method == "POST"))
+        {
+            faults_.setConfig(FaultConfig::fromJson(json));
+            return acknowledged();
+        }
+        if (route(2, "stats", 1) && method == "GET")
+        {
+            return stats();
+        }
+        if (route(2, "reset", 1) && method == "POST")
+        {
+            store_.clear();
+            return acknowledged();
+        }
+        return noHandler(method, path);
+    }
+    if (route(2, "_nodes", 0) && segments[1] == "http" && method == "GET")
+    {
+        return nodes();
+    }
+
+    // /_search and /_count are over every index
+    const auto &index = segments[0];
+    bool global = index[0] == '_' && index != "_all";
+    auto indices = global ? string() : index;
+    auto api = global ? index : size > 1 ? segments[1] : "";
+    if (size <= 2 && api == "_search" && (method == "GET" || method == "POST"))
+    {
+        return store_.search(indices, json);
+    }
+    if (size <= 2 && api == "_count" && (method == "GET" || method == "POST"))
+    {
+        return store_.count(indices, json);
+    }
+    if (index[0] == '_')
+    {
+        return noHandler(method, path);
+    }
+
+    if (size == 1)
+    {
+        if (method == "PUT")
+        {
+            return store_.createIndex(index, json);
+        }
+        if (method == "GET" || method == "HEAD")
+        {
+            return store_.getIndex(index);
+        }
+        if (method == "DELETE")
+        {
+            return store_.deleteIndex(index);
+        }
+    }
+    else if (segments[1] == "_mapping" && size <= 3)
+    {
+        if (method == "PUT" || method == "POST")
+        {
+            return store_.putMapping(index, json);
+        }
+        if (method == "GET")
+        {
+            auto result = store_.getIndex(index);
+            if (result.status == 200)
+            {
+                result.body[index].removeMember("settings");
+                result.body[index].removeMember("aliases");
+            }
+            return result;
+        }
+    }
+    else if (segments[1] == "_doc" && size == 2 && method == "POST")
+    {
+        return store_.indexDocument(index, "", json);
+    }
+    else if (segments[1] == "_doc" && size == 3)
+    {
+        const auto &id = segments[2];
+        if (method == "PUT" || method == "POST")
+        {
+            return store_.indexDocument(index, id, json);
+        }
+        if (method == "GET" || method == "HEAD")
+        {
+            return store_.getDocument(index, id);
+        }
+        if (method == "DELETE")
+        {
+            return store_.deleteDocument(index, id);
+        }
+    }
+    else if (segments[1] == "_doc" && size == 4 && segments[3] == "_create" &&
+             (method == "PUT" || method == "POST"))
+    {
+        return store_.indexDocument(index, segments[2], json, true);
+    }
+    else if (method == "POST" &&
+             ((size == 4 && segments[1] == "_doc" &&
+               segments[3] == "_update") ||
+              (size == 3 && segments[1] == "_update")))
+    {
+        return store_.updateDocument(index, segments[2], json);
+    }
+    return noHandler(method, path);
+}
+
+MockResult MockServer::faultResult(const Fault &fault)
+{
+    switch (fault.kind)
+    {
+        case FaultKind::REJECT:
+            return errorResult(429,
+                               "es_rejected_execution_exception",
+                               "rejected execution, queue capacity reached "
+                               "(injected by the mock server)");
+        case FaultKind::ERROR:
+            return errorResult(500,
+                               "exception",
+                               "internal error (injected by the mock server)");
+        case FaultKind::NONE:
+        case FaultKind::STALL:
+            break;
+    }
+    return MockResult();
+}
+
+size_t MockServer::load(const string &index, const string &bulkBody)
+{
+    auto result = store_.bulk(index, bulkBody);
+    if (result.status != 200)
+    {
+        throw runtime_error(result.body["error"]["reason"].asString());
+    }
+    size_t loaded = 0;
+    for (const auto &item : result.body["items"])
+    {
+        const auto &action = item[item.getMemberNames()[0]];
+        if (!action.isMember("error"))
+        {
+            ++loaded;
+        }
+    }
+    return loaded;
+}
+
+MockResult MockServer::info() const
+{
+    MockResult result;
+    result.body["name"] = "mock";
+    result.body["cluster_name"] = "elasticsearch-mock";
+    result.body["version"]["number"] = "6.8.0";
+    result.body["version"]["lucene_version"] = "7.7.0";
+    result.body["tagline"] = "You Know, for Search";
+    return result;
+}
+
+MockResult MockServer::nodes() const
+{
+    MockResult result;
+    auto &node = result.body["nodes"]["mock"];
+    node["name"] = "mock";
+    node["roles"].append("master");
+    node["roles"].append("data");
+    node["roles"].append("ingest");
+    node["http"]["publish_address"] = publishAddress_;
+    result.body["cluster_name"] = "elasticsearch-mock";
+    return result;
+}
+
+MockResult MockServer::stats() const
+{
+    auto faults = faults_.stats();
+    MockResult result;
+    result.body["requests"] = Json::UInt64(faults.requests);
+    result.body["errors"] = Json::UInt64(faults.errors);
+    result.body["rejected"] = Json::UInt64(faults.rejected);
+    result.body["stalled"] = Json::UInt64(faults.stalled);
+    result.body["documents"] = Json::UInt64(store_.documents());
+    return result;
+}
@@ -0,0 +1,64 @@
+/**
+ *
+ *  MockServer.h
+ *
+ */
+
+#pragma once
+
+#include "FaultInjector.h"
+#include "MockStore.h"
+#include <string>
+
+namespace tl::elasticsearch::mock
+{
+
+/// The REST API of the mock Elasticsearch node, independent of the HTTP
+/// server so that it can be tested without a socket.
+///
+/// Besides the APIs used by the client it serves `/_mock/faults` (GET and
+/// PUT the FaultConfig), `/_mock/stats` and `/_mock/reset` to drive a test
+/// run.
+class MockServer
+{
+  public:
+    /// `publishAddress` is the "host:port" answered to /_nodes/http.
+    MockServer(const std::string &publishAddress,
+               const FaultConfig &faults = FaultConfig());
+
+  public:
+    /// Response to a request, without the injected faults. The path may
+    /// have a query string, which is ignored.
+    MockResult handle(const std::string &method,
+                      const std::string &path,
+                      const std::string &body);
+
+    /// Response replacing the regular one for a fault, or a null body when
+    /// the regular response should be sent.
+    static MockResult faultResult(const Fault &fault);
+
+    /// Loads the lines of a _bulk body, returns the number of documents.
+    size_t load(const std::string &index, const std::string &bulkBody);
+
+    MockStore &store()
+    {
+        return store_;
+    }
+
+    FaultInjector &faults()
+    {
+        return faults_;
+    }
+
+  private:
+    MockResult info() const;
+    MockResult nodes() const;
+    MockResult stats() const;
+
+  private:
+    std::string publishAddress_;
+    MockStore store_;
+    FaultInjector faults_;
+};
+
+};  // namespace tl::elasticsearch::mock
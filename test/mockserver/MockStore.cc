@@ -0,0 +1,715 @@
+/**
+ *
+ *  MockStore.cc
+ *
+ */
+
+#include "MockStore.h"
+#include "MockQuery.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace std;
+using namespace tl::elasticsearch::mock;
+
+MockResult tl::elasticsearch::mock::errorResult(int status,
+                                                const string &type,
+                                                const string &reason,
+                                                const string &index)
+{
+    Json::Value error;
+    error["type"] = type;
+    error["reason"] = reason;
+    if (!index.empty())
+    {
+        error["index"] = index;
+    }
+    error["root_cause"].append(error);
+    MockResult result;
+    result.status = status;
+    result.body["error"] = error;
+    result.body["status"] = status;
+    return result;
+}
+
+static MockResult indexNotFound(const string &index)
+{
+    return errorResult(404,
+                       "index_not_found_exception",
+                       "no such index",
+                       index);
+}
+
+static Json::Value shards(int total = 2, int successful = 1)
+{
+    Json::Value result;
+    result["total"] = total;
+    result["successful"] = successful;
+    result["failed"] = 0;
+    return result;
+}
+
+static Json::Value tookSince(chrono::steady_clock::time_point start)
+{
+    auto took = chrono::steady_clock::now() - start;
+    return Json::Int64(
+        chrono::duration_cast<chrono::milliseconds>(took).count());
+}
+
+static string randomUuid()
+{
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    thread_local mt19937 random(random_device{}());
+    string uuid;
+    for (int i = 0; i < 22; ++i)
+    {
+        uuid += alphabet[random() % (sizeof(alphabet) - 1)];
+    }
+    return uuid;
+}
+
+MockResult MockStore::createIndex(const string &index, const Json::Value &body)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (indices_.count(index) > 0)
+    {
+        return errorResult(400,
+                           "resource_already_exists_exception",
+                           "index [" + index + "] already exists",
+                           index);
+    }
+    auto &created = createIfMissing(index);
+    const auto &settings = body["settings"].isMember("index")
+                               ? body["settings"]["index"]
+                               : body["settings"];
+    for (const auto &name : { "number_of_shards", "number_of_replicas" })
+    {
+        if (settings.isMember(name))
+        {
+            created.settings[name] = settings[name].asString();
+        }
+    }
+    created.properties = body["mappings"]["_doc"].get(
+        "properties", Json::Value(Json::objectValue));
+    MockResult result;
+    result.body["acknowledged"] = true;
+    result.body["shards_acknowledged"] = true;
+    result.body["index"] = index;
+    return result;
+}
+
+MockResult MockStore::getIndex(const string &index) const
+{
+    lock_guard<mutex> lock(mutex_);
+    auto found = indices_.find(index);
+    if (found == indices_.end())
+    {
+        return indexNotFound(index);
+    }
+    const auto &stored = found->second;
+    Json::Value settings = stored.settings;
+    settings["creation_date"] = std::to_string(stored.creationDate);
+    settings["uuid"] = stored.uuid;
+    settings["version"]["created"] = "6080099";
+    settings["provided_name"] = index;
+
+    MockResult result;
+    auto &body = result.body[index];
+    body["aliases"] = Json::Value(Json::objectValue);
+    body["mappings"]["_doc"]["properties"] = stored.properties;
+    body["settings"]["index"] = settings;
+    return result;
+}
+
+MockResult MockStore::putMapping(const string &index, const Json::Value &body)
+{
+    lock_guard<mutex> lock(mutex_);
+    auto found = indices_.find(index);
+    if (found == indices_.end())
+    {
+        return indexNotFound(index);
+    }
+    const auto &properties = body["properties"];
+    for (const auto &name : properties.getMemberNames())
+    {
+        found->second.properties[name] = properties[name];
+    }
+    MockResult result;
+    result.body["acknowledged"] = true;
+    return result;
+}
+
+MockResult MockStore::deleteIndex(const string &index)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (indices_.erase(index) == 0)
+    {
+        return indexNotFound(index);
+    }
+    MockResult result;
+    result.body["acknowledged"] = true;
+    return result;
+}
+
+MockResult MockStore::indexDocument(const string &index,
+                                    const string &id,
+                                    const Json::Value &source,
+                                    bool createOnly)
+{
+    lock_guard<mutex> lock(mutex_);
+    return doIndexDocument(index, id, source, createOnly);
+}
+
+MockResult MockStore::getDocument(const string &index, const string &id) const
+{
+    lock_guard<mutex> lock(mutex_);
+    auto found = indices_.find(index);
+    if (found == indices_.end())
+    {
+        return indexNotFound(index);
+    }
+    MockResult result;
+    result.body["_index"] = index;
+    result.body["_type"] = "_doc";
+    result.body["_id"] = id;
+    auto document = found->second.documents.find(id);
+    if (document == found->second.documents.end())
+    {
+        result.status = 404;
+        result.body["found"] = false;
+        return result;
+    }
+    result.body["_version"] = Json::Int64(document->second.version);
+    result.body["_seq_no"] = Json::Int64(document->second.seqNo);
+    result.body["_primary_term"] = 1;
+    result.body["found"] = true;
+    result.body["_source"] = document->second.source;
+    return result;
+}
+
+MockResult MockStore::deleteDocument(const string &index, const string &id)
+{
+    lock_guard<mutex> lock(mutex_);
+    return doDeleteDocument(index, id);
+}
+
+MockResult MockStore::updateDocument(const string &index,
+                                     const string &id,
+                                     const Json::Value &body)
+{
+    lock_guard<mutex> lock(mutex_);
+    return doUpdateDocument(index, id, body);
+}
+
+MockResult MockStore::count(const string &index, const Json::Value &body) const
+{
+    lock_guard<mutex> lock(mutex_);
+    auto missing = missingIndex(index);
+    if (!missing.empty())
+    {
+        return indexNotFound(missing);
+    }
+    MockResult result;
+    try
+    {
+        auto hits = matching(index, body["query"]);
+        result.body["count"] = Json::UInt64(hits.size());
+    }
+    catch (const QueryError &e)
+    {
+        return errorResult(400, "parsing_exception", e.what());
+    }
+    result.body["_shards"] = shards(5, 5);
+    result.body["_shards"]["skipped"] = 0;
+    return result;
+}
+
+// the value a hit is sorted by, null sorts last
+static Json::Value sortValue(const Json::Value &source, const string &field)
+{
+    auto value = MockQuery::field(source, field);
+    return value ? *value : Json::Value();
+}
+
+MockResult MockStore::search(const string &index, const Json::Value &body) const
+{
+    auto start = chrono::steady_clock::now();
+    lock_guard<mutex> lock(mutex_);
+    auto missing = missingIndex(index);
+    if (!missing.empty())
+    {
+        return indexNotFound(missing);
+    }
+    vector<Hit> hits;
+    Json::Value aggregations;
+    try
+    {
+        hits = matching(index, body["query"]);
+        if (body.isMember("aggs") || body.isMember("aggregations"))
+        {
+            vector<const Json::Value *> sources;
+            for (const auto &hit : hits)
+            {
+                sources.push_back(&hit.document->source);
+            }
+            aggregations = MockQuery::aggregate(
+                body.isMember("aggs") ? body["aggs"] : body["aggregations"],
+                sources);
+        }
+    }
+    catch (const QueryError &e)
+    {
+        return errorResult(400, "parsing_exception", e.what());
+    }
+
+    // [{"field": "asc"}], [{"field": {"order": "desc"}}] or ["field"]
+    vector<pair<string, bool>> sort;
+    for (const auto &item : body["sort"])
+    {
+        if (item.isString())
+        {
+            sort.emplace_back(item.asString(), true);
+            continue;
+        }
+        auto field = item.getMemberNames()[0];
+        const auto &order = item[field].isObject() ? item[field]["order"]
+                                                   : item[field];
+        sort.emplace_back(field, order.asString() != "desc");
+    }
+    if (sort.empty())
+    {
+        stable_sort(hits.begin(), hits.end(), [](const Hit &a, const Hit &b) {
+            return a.score > b.score;
+        });
+    }
+    else
+    {
+        stable_sort(hits.begin(),
+                    hits.end(),
+                    [&sort](const Hit &a, const Hit &b) {
+                        for (const auto &[field, ascending] : sort)
+                        {
+                            auto left = sortValue(a.document->source, field);
+                            auto right = sortValue(b.document->source, field);
+                            if (left == right)
+                            {
+                                continue;
+                            }
+                            if (left.isNull() || right.isNull())
+                            {
+                                return right.isNull();
+                            }
+                            return ascending ? left < right : right < left;
+                        }
+                        return false;
+                    });
+    }
+
+    auto from = body.get("from", 0).asUInt();
+    auto size = body.get("size", 10).asUInt();
+    MockResult result;
+    result.body["timed_out"] = false;
+    result.body["_shards"] = shards(5, 5);
+    result.body["_shards"]["skipped"] = 0;
+    result.body["hits"]["total"] = Json::UInt64(hits.size());
+    result.body["hits"]["max_score"] = Json::Value();
+    result.body["hits"]["hits"] = Json::Value(Json::arrayValue);
+    double maxScore = 0;
+    for (size_t i = from; i < hits.size() && i < from + size; ++i)
+    {
+        Json::Value hit;
+        hit["_index"] = *hits[i].index;
+        hit["_type"] = "_doc";
+        hit["_id"] = *hits[i].id;
+        hit["_source"] = hits[i].document->source;
+        if (sort.empty())
+        {
+            hit["_score"] = hits[i].score;
+            maxScore = max(maxScore, hits[i].score);
+        }
+        else
+        {
+            hit["_score"] = Json::Value();
+            for (const auto &item : sort)
+            {
+                hit["sort"].append(
+                    sortValue(hits[i].document->source, item.first));
+            }
+        }
+        result.body["hits"]["hits"].append(hit);
+    }
+    if (sort.empty() && !hits.empty())
+    {
+        result.body["hits"]["max_score"] = maxScore;
+    }
+    if (!aggregations.isNull())
+    {
+        result.body["aggregations"] = aggregations;
+    }
+    result.body["took"] = tookSince(start);
+    return result;
+}
+
+MockResult MockStore::bulk(const string &index, const string &body)
+{
+    auto start = chrono::steady_clock::now();
+    vector<Json::Value> lines;
+    try
+    {
+        lines = parseValues(body);
+    }
+    catch (const runtime_error &e)
+    {
+        return errorResult(400, "json_parse_exception", e.what());
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    MockResult result;
+    result.body["errors"] = false;
+    result.body["items"] = Json::Value(Json::arrayValue);
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        const auto &line = lines[i];
+        if (!line.isObject() || line.size() != 1)
+        {
+            return errorResult(400,
+                               "illegal_argument_exception",
+                               "Malformed action/metadata line [" +
+                                   std::to_string(i + 1) + "]");
+        }
+        auto action = line.getMemberNames()[0];
+        const auto &metadata = line[action];
+        auto target = metadata.get("_index", index).asString();
+        auto id = metadata["_id"].asString();
+        if (target.empty())
+        {
+            return errorResult(400,
+                               "action_request_validation_exception",
+                               "Validation Failed: 1: index is missing;");
+        }
+
+        MockResult item;
+        if (action == "delete")
+        {
+            item = doDeleteDocument(target, id);
+        }
+        else if (i + 1 >= lines.size())
+        {
+            return errorResult(400,
+                               "illegal_argument_exception",
+                               "The bulk request must be terminated by a "
+                               "newline [\n]");
+        }
+        else if (action == "index" || action == "create")
+        {
+            item = doIndexDocument(target, id, lines[++i], action == "create");
+        }
+        else if (action == "update")
+        {
+            item = doUpdateDocument(target, id, lines[++i]);
+        }
+        else
+        {
+            return errorResult(400,
+                               "illegal_argument_exception",
+                               "Unknown action [" + action + "]");
+        }
+        item.body["status"] = item.status;
+        if (item.body.isMember("error"))
+        {
+            result.body["errors"] = true;
+            auto error = item.body["error"];
+            error.removeMember("root_cause");
+            item.body = Json::Value();
+            item.body["_index"] = target;
+            item.body["_type"] = "_doc";
+            item.body["_id"] = id;
+            item.body["status"] = item.status;
+            item.body["error"] = error;
+        }
+        Json::Value entry;
+        entry[action] = item.body;
+        result.body["items"].append(entry);
+    }
+    result.body["took"] = tookSince(start);
+    return result;
+}
+
+size_t MockStore::documents(const string &index) const
+{
+    lock_guard<mutex> lock(mutex_);
+    size_t result = 0;
+    for (const auto &[name, stored] : indices_)
+    {
+        if (index.empty() || index == name)
+        {
+            result += stored.documents.size();
+        }
+    }
+    return result;
+}
+
+void MockStore::clear()
+{
+    lock_guard<mutex> lock(mutex_);
+    indices_.clear();
+}
+
+vector<Json::Value> MockStore::parseValues(const string &body)
+{
+    // like Elasticsearch, one value per line and the last line terminated
+    vector<Json::Value> values;
+    if (!body.empty() && body.back() != '\n')
+    {
+        throw runtime_error(
+            "The bulk request must be terminated by a newline [\\n]");
+    }
+    static const auto builder = []() {
+        Json::CharReaderBuilder builder;
+        builder["failIfExtra"] = true;
+        return builder;
+    }();
+    unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    size_t line = 0;
+    for (size_t begin = 0; begin < body.size(); ++line)
+    {
+        auto end = body.find('\n', begin);
+        Json::Value value;
+        string errors;
+        if (!reader->parse(
+                body.data() + begin, body.data() + end, &value, &errors))
+        {
+            throw runtime_error("line [" + std::to_string(line + 1) +
+                                "]: " + errors);
+        }
+        values.push_back(std::move(value));
+        begin = end + 1;
+    }
+    return values;
+}
+
+MockStore::Index &MockStore::createIfMissing(const string &index)
+{
+    auto [found, created] = indices_.try_emplace(index);
+    if (created)
+    {
+        auto &stored = found->second;
+        stored.uuid = randomUuid();
+        stored.creationDate =
+            chrono::duration_cast<chrono::milliseconds>(
+                chrono::system_clock::now().time_since_epoch())
+                .count();
+        stored.settings["number_of_shards"] = "5";
+        stored.settings["number_of_replicas"] = "1";
+    }
+    return found->second;
+}
+
+MockResult MockStore::doIndexDocument(const string &index,
+                                      const string &id,
+                                      const Json::Value &source,
+                                      bool createOnly)
+{
+    if (!source.isObject())
+    {
+        return errorResult(400,
+                           "mapper_parsing_exception",
+                           "failed to parse",
+                           index);
+    }
+    auto &stored = createIfMissing(index);
+    auto documentId = id.empty() ? newId() : id;
+    auto [document, created] = stored.documents.try_emplace(documentId);
+    if (!created && createOnly)
+    {
+        return errorResult(409,
+                           "version_conflict_engine_exception",
+                           "[_doc][" + documentId +
+                               "]: version conflict, document already exists",
+                           index);
+    }
+    if (!created)
+    {
+        ++document->second.version;
+    }
+    document->second.source = source;
+    document->second.seqNo = stored.seqNo++;
+
+    MockResult result;
+    result.status = created ? 201 : 200;
+    result.body["_index"] = index;
+    result.body["_type"] = "_doc";
+    result.body["_id"] = documentId;
+    result.body["_version"] = Json::Int64(document->second.version);
+    result.body["result"] = created ? "created" : "updated";
+    result.body["_shards"] = shards();
+    result.body["_seq_no"] = Json::Int64(document->second.seqNo);
+    result.body["_primary_term"] = 1;
+    return result;
+}
+
+MockResult MockStore::doDeleteDocument(const string &index, const string &id)
+{
+    auto found = indices_.find(index);
+    if (found == indices_.end())
+    {
+        return indexNotFound(index);
+    }
+    auto &stored = found->second;
+    auto document = stored.documents.find(id);
+    MockResult result;
+    result.body["_index"] = index;
+    result.body["_type"] = "_doc";
+    result.body["_id"] = id;
+    if (document == stored.documents.end())
+    {
+        result.status = 404;
+        result.body["_version"] = 1;
+        result.body["result"] = "not_found";
+    }
+    else
+    {
+        result.body["_version"] = Json::Int64(document->second.version + 1);
+        result.body["result"] = "deleted";
+        stored.documents.erase(document);
+    }
+    result.body["_shards"] = shards();
+    result.body["_seq_no"] = Json::Int64(stored.seqNo++);
+    result.body["_primary_term"] = 1;
+    return result;
+}
+
+MockResult MockStore::doUpdateDocument(const string &index,
+                                       const string &id,
+                                       const Json::Value &body)
+{
+    auto found = indices_.find(index);
+    auto document = found == indices_.end()
+                        ? decltype(found->second.documents.end())()
+                        : found->second.documents.find(id);
+    if (found == indices_.end() || document == found->second.documents.end())
+    {
+        return errorResult(404,
+                           "document_missing_exception",
+                           "[_doc][" + id + "]: document missing",
+                           index);
+    }
+    if (!body["doc"].isObject())
+    {
+        return errorResult(400,
+                           "action_request_validation_exception",
+                           "Validation Failed: 1: script or doc is missing;");
+    }
+    auto &source = document->second.source;
+    auto merged = source;
+    const auto &doc = body["doc"];
+    for (const auto &name : doc.getMemberNames())
+    {
+        merged[name] = doc[name];
+    }
+
+    MockResult result;
+    result.body["_index"] = index;
+    result.body["_type"] = "_doc";
+    result.body["_id"] = id;
+    if (merged == source)
+    {
+        result.body["result"] = "noop";
+        result.body["_shards"] = shards(0, 0);
+    }
+    else
+    {
+        source = std::move(merged);
+        ++document->second.version;
+        document->second.seqNo = found->second.seqNo++;
+        result.body["result"] = "updated";
+        result.body["_shards"] = shards();
+    }
+    result.body["_version"] = Json::Int64(document->second.version);
+    result.body["_seq_no"] = Json::Int64(document->second.seqNo);
+    result.body["_primary_term"] = 1;
+    return result;
+}
+
+static vector<string> splitIndices(const string &indices)
+{
+    vector<string> names;
+    size_t begin = 0;
+    while (begin <= indices.size())
+    {
+        auto end = indices.find(',', begin);
+        if (end == string::npos)
+        {
+            end = indices.size();
+        }
+        names.push_back(indices.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return names;
+}
+
+string MockStore::missingIndex(const string &indices) const
+{
+    for (const auto &name : splitIndices(indices))
+    {
+        if (!name.empty() && name != "_all" && name.back() != '*' &&
+            indices_.count(name) == 0)
+        {
+            return name;
+        }
+    }
+    return "";
+}
+
+vector<MockStore::Hit> MockStore::matching(const string &indices,
+                                           const Json::Value &query) const
+{
+    auto patterns = splitIndices(indices);
+    auto selected = [&patterns](const string &name) {
+        for (const auto &pattern : patterns)
+        {
+            if (pattern == "_all" || pattern.empty() || pattern == name ||
+                (pattern.back() == '*' &&
+                 name.compare(0, pattern.size() - 1, pattern, 0,
+                              pattern.size() - 1) == 0))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    Json::Value matchAll;
+    matchAll["match_all"] = Json::Value(Json::objectValue);
+    const auto &effective = query.isNull() ? matchAll : query;
+    vector<Hit> hits;
+    for (const auto &[name, stored] : indices_)
+    {
+        if (!selected(name))
+        {
+            continue;
+        }
+        for (const auto &[id, document] : stored.documents)
+        {
+            double score = 0;
+            if (MockQuery::matches(effective, document.source, score))
+            {
+                hits.push_back(Hit{ &name, &id, &document, score });
+            }
+        }
+    }
+    return hits;
+}
+
+string MockStore::newId()
+{
+    char buffer[24];
+    snprintf(buffer,
+             sizeof(buffer),
+             "mock%016llx",
+             static_cast<unsigned long long>(nextId_++));
+    return buffer;
+}
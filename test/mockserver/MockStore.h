@@ -0,0 +1,128 @@
+/**
+ *
+ *  MockStore.h
+ *
+ */
+
+#pragma once
+
+#include <json/json.h>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tl::elasticsearch::mock
+{
+
+/// Status and body of a response of the mock server.
+class MockResult
+{
+  public:
+    int status = 200;
+    Json::Value body;
+};
+
+/// Body of an Elasticsearch error response.
+MockResult errorResult(int status,
+                       const std::string &type,
+                       const std::string &reason,
+                       const std::string &index = "");
+
+/// The indices and documents of the mock server, in memory.
+///
+/// Every method answers like an Elasticsearch 6.x node does for the same
+/// request, including the errors the client handles. All methods are thread
+/// safe.
+class MockStore
+{
+  public:
+    MockResult createIndex(const std::string &index, const Json::Value &body);
+    MockResult getIndex(const std::string &index) const;
+    MockResult putMapping(const std::string &index, const Json::Value &body);
+    MockResult deleteIndex(const std::string &index);
+
+    /// With an empty id the document gets a generated one. The index is
+    /// created if it does not exist.
+    MockResult indexDocument(const std::string &index,
+                             const std::string &id,
+                             const Json::Value &source,
+                             bool createOnly = false);
+    MockResult getDocument(const std::string &index,
+                           const std::string &id) const;
+    MockResult deleteDocument(const std::string &index, const std::string &id);
+    /// Merges the "doc" of the body into the document.
+    MockResult updateDocument(const std::string &index,
+                              const std::string &id,
+                              const Json::Value &body);
+
+    MockResult count(const std::string &index, const Json::Value &body) const;
+    /// Supports query, from, size, sort and aggs.
+    MockResult search(const std::string &index, const Json::Value &body) const;
+    /// Actions without an _index go to `index`.
+    MockResult bulk(const std::string &index, const std::string &body);
+
+    /// Number of documents, in every index if empty.
+    size_t documents(const std::string &index = "") const;
+    void clear();
+
+    /// The lines of a _bulk request: one JSON value per line, each line
+    /// terminated by a newline.
+    static std::vector<Json::Value> parseValues(const std::string &body);
+
+  private:
+    class Document
+    {
+      public:
+        Json::Value source;
+        int64_t version = 1;
+        int64_t seqNo = 0;
+    };
+
+    class Index
+    {
+      public:
+        Json::Value properties{Json::objectValue};
+        Json::Value settings{Json::objectValue};
+        std::string uuid;
+        int64_t creationDate = 0;
+        int64_t seqNo = 0;
+        std::map<std::string, Document> documents;
+    };
+
+    class Hit
+    {
+      public:
+        const std::string *index;
+        const std::string *id;
+        const Document *document;
+        double score;
+    };
+
+    Index &createIfMissing(const std::string &index);
+    MockResult doIndexDocument(const std::string &index,
+                               const std::string &id,
+                               const Json::Value &source,
+                               bool createOnly);
+    MockResult doDeleteDocument(const std::string &index,
+                                const std::string &id);
+    MockResult doUpdateDocument(const std::string &index,
+                                const std::string &id,
+                                const Json::Value &body);
+    /// Matches of the query in the indices named by a comma separated list
+    /// of names, `_all` or trailing `*` wildcards.
+    std::vector<Hit> matching(const std::string &indices,
+                              const Json::Value &query) const;
+    /// The first name of the list that is not a pattern and does not
+    /// exist, empty if none.
+    std::string missingIndex(const std::string &indices) const;
+    std::string newId();
+
+  private:
+    mutable std::mutex mutex_;
+    std::map<std::string, Index> indices_;
+    uint64_t nextId_ = 0;
+};
+
+};  // namespace tl::elasticsearch::mock
@@ -0,0 +1,151 @@
+/**
+ *
+ *  main.cc
+ *
+ *  A local Elasticsearch node for tests and load runs:
+ *
+ *  ESMockServer [-p port] [-t threads] [-i index] [-d bulk.json]
+ *               [-f faults.json]
+ *
+ *  -d loads the lines of a _bulk body into the index given by -i, -f sets
+ *  the FaultConfig, which can also be changed at runtime with
+ *  PUT /_mock/faults.
+ *
+ */
+
+#include "MockServer.h"
+#include <drogon/drogon.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace drogon;
+using namespace tl::elasticsearch::mock;
+
+static string readFile(const string &path)
+{
+    ifstream file(path);
+    if (!file)
+    {
+        throw runtime_error("cannot read " + path);
+    }
+    stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+static HttpResponsePtr toResponse(const MockResult &result)
+{
+    auto response = HttpResponse::newHttpJsonResponse(result.body);
+    response->setStatusCode(static_cast<HttpStatusCode>(result.status));
+    return response;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t port = 9200;
+    size_t threads = 1;
+    string index = "test";
+    string dataFile;
+    string faultsFile;
+    int option;
+    while ((option = getopt(argc, argv, "p:t:i:d:f:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'p':
+                port = static_cast<uint16_t>(stoi(optarg));
+                break;
+            case 't':
+                threads = stoul(optarg);
+                break;
+            case 'i':
+                index = optarg;
+                break;
+            case 'd':
+                dataFile = optarg;
+                break;
+            case 'f':
+                faultsFile = optarg;
+                break;
+            default:
+                cerr << "usage: " << argv[0]
+                     << " [-p port] [-t threads] [-i index] [-d bulk.json]"
+                        " [-f faults.json]"
+                     << endl;
+                return option == 'h' ? 0 : 1;
+        }
+    }
+
+    FaultConfig faults;
+    try
+    {
+        if (!faultsFile.empty())
+        {
+            Json::Value json;
+            stringstream(readFile(faultsFile)) >> json;
+            faults = FaultConfig::fromJson(json);
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "invalid fault config: " << e.what() << endl;
+        return 1;
+    }
+
+    auto server = make_shared<MockServer>("127.0.0.1:" + std::to_string(port),
+                                          faults);
+    if (!dataFile.empty())
+    {
+        try
+        {
+            auto loaded = server->load(index, readFile(dataFile));
+            LOG_INFO << "loaded " << loaded << " documents into " << index;
+        }
+        catch (const exception &e)
+        {
+            cerr << "cannot load " << dataFile << ": " << e.what() << endl;
+            return 1;
+        }
+    }
+
+    app().registerHandlerViaRegex(
+        "/.*",
+        [server](const HttpRequestPtr &request,
+                 function<void(const HttpResponsePtr &)> &&callback) {
+            // the control API is never faulty
+            auto fault = request->path().rfind("/_mock", 0) == 0
+                             ? Fault()
+                             : server->faults().next();
+            auto result = MockServer::faultResult(fault);
+            if (result.body.isNull())
+            {
+                result = server->handle(request->methodString(),
+                                        request->path(),
+                                        string(request->body()));
+            }
+            auto response = toResponse(result);
+            if (fault.delayMs <= 0)
+            {
+                callback(response);
+                return;
+            }
+            // a stalled response keeps its connection busy, the loop is not
+            trantor::EventLoop::getEventLoopOfCurrentThread()->runAfter(
+                fault.delayMs / 1000,
+                [callback = std::move(callback), response]() {
+                    callback(response);
+                });
+        },
+        { Get, Post, Put, Delete, Head });
+
+    LOG_INFO << "mock Elasticsearch listening on port " << port;
+    app()
+        .setThreadNum(threads)
+        .setClientMaxBodySize(1024 * 1024 * 1024)
+        .addListener("0.0.0.0", port)
+        .run();
+    return 0;
+}
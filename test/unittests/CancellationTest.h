@@ -0,0 +1,68 @@
+#include "../../src/Cancellation.h"
+#include "../../src/HttpClient.h"
+#include <gtest/gtest.h>
+
+TEST(CancellationTest, Token)
+{
+    using namespace tl::elasticsearch;
+    CancellationToken token;
+    int called = 0;
+    token.onCancel([&called]() { ++called; });
+    auto removed = token.onCancel([&called]() { called += 10; });
+    token.removeCallback(removed);
+    EXPECT_FALSE(token.isCancelled());
+    token.cancel();
+    token.cancel();
+    EXPECT_TRUE(token.isCancelled());
+    EXPECT_EQ(1, called);
+    // registered after the fact, runs right away
+    token.onCancel([&called]() { ++called; });
+    EXPECT_EQ(2, called);
+}
+
+TEST(CancellationTest, LatestWins)
+{
+    using namespace tl::elasticsearch;
+    LatestWins latestWins;
+    auto first = latestWins.next("alice");
+    auto other = latestWins.next("bob");
+    auto second = latestWins.next("alice");
+    EXPECT_TRUE(first->isCancelled());
+    EXPECT_FALSE(second->isCancelled());
+    EXPECT_FALSE(other->isCancelled());
+
+    latestWins.cancel("bob");
+    EXPECT_TRUE(other->isCancelled());
+    EXPECT_EQ(1, latestWins.sessions());
+
+    // finished requests release their tokens, the sessions are forgotten
+    second.reset();
+    for (int i = 0; i < 100; ++i)
+    {
+        latestWins.next(std::to_string(i));
+    }
+    EXPECT_LT(latestWins.sessions(), 100);
+}
+
+TEST(CancellationTest, CancelledBeforeSending)
+{
+    using namespace tl::elasticsearch;
+    HttpClient client("http://localhost:9200");
+    RequestOptions options;
+    options.cancellation = std::make_shared<CancellationToken>();
+    options.cancellation->cancel();
+    int results = 0;
+    std::vector<std::string> errors;
+    client.sendRequest(
+        "/",
+        drogon::Get,
+        [&results](const Json::Value &) { ++results; },
+        [&errors](const ElasticSearchException &err) {
+            errors.push_back(err.what());
+        },
+        Json::Value(Json::objectValue),
+        options);
+    EXPECT_EQ(0, results);
+    ASSERT_EQ(1, errors.size());
+    EXPECT_EQ("request cancelled!", errors[0]);
+}
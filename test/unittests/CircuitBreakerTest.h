@@ -0,0 +1,127 @@
+#include "../../src/CircuitBreaker.h"
+#include "../../src/NodePool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(CircuitBreakerTest, ConsecutiveFailures)
+{
+    using namespace tl::elasticsearch;
+    CircuitBreakerConfig config;
+    config.consecutiveFailures = 3;
+    CircuitBreaker breaker(config);
+    EXPECT_FALSE(breaker.onFailure());
+    EXPECT_FALSE(breaker.onFailure());
+    breaker.onSuccess();
+    EXPECT_FALSE(breaker.onFailure());
+    EXPECT_FALSE(breaker.onFailure());
+    EXPECT_TRUE(breaker.onFailure());
+    EXPECT_EQ(CircuitState::OPEN, breaker.state());
+    EXPECT_FALSE(breaker.isAvailable());
+}
+
+TEST(CircuitBreakerTest, ErrorRate)
+{
+    using namespace tl::elasticsearch;
+    CircuitBreakerConfig config;
+    config.consecutiveFailures = 100;
+    config.windowSize = 10;
+    config.minRequests = 10;
+    config.errorRate = 0.5;
+    CircuitBreaker breaker(config);
+    for (int i = 0; i < 4; ++i)
+    {
+        breaker.onSuccess();
+        EXPECT_FALSE(breaker.onFailure());
+    }
+    breaker.onSuccess();
+    EXPECT_TRUE(breaker.onFailure());
+}
+
+TEST(CircuitBreakerTest, HalfOpen)
+{
+    using namespace tl::elasticsearch;
+    CircuitBreakerConfig config;
+    config.consecutiveFailures = 1;
+    config.halfOpenRequests = 2;
+    CircuitBreaker breaker(config);
+    breaker.onFailure();
+    breaker.onProbe(false);
+    EXPECT_EQ(CircuitState::OPEN, breaker.state());
+    breaker.onProbe(true);
+    EXPECT_EQ(CircuitState::HALF_OPEN, breaker.state());
+
+    // a failed trial opens the circuit again
+    EXPECT_TRUE(breaker.tryAcquire());
+    EXPECT_TRUE(breaker.onFailure());
+    breaker.onProbe(true);
+
+    EXPECT_TRUE(breaker.tryAcquire());
+    EXPECT_TRUE(breaker.tryAcquire());
+    EXPECT_FALSE(breaker.isAvailable());
+    EXPECT_FALSE(breaker.tryAcquire());
+    // a trial which is not sent is given back
+    breaker.onAbandon();
+    EXPECT_TRUE(breaker.tryAcquire());
+    breaker.onSuccess();
+    breaker.onSuccess();
+    EXPECT_EQ(CircuitState::CLOSED, breaker.state());
+    EXPECT_TRUE(breaker.isAvailable());
+}
+
+TEST(CircuitBreakerTest, OpenNodeOutOfRotation)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    NodeConfig config;
+    config.circuitBreaker.consecutiveFailures = 1;
+    NodePool pool({ "http://a:9200", "http://b:9200" }, nullptr, config);
+    auto broken = (*pool.nodes())[0];
+    broken->onRequestStart();
+    EXPECT_TRUE(broken->onRequestFinish(1ms, false));
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ("http://b:9200", pool.select()->url());
+    }
+    auto other = (*pool.nodes())[1];
+    other->onRequestStart();
+    other->onRequestFinish(1ms, false);
+    EXPECT_EQ(nullptr, pool.select());
+    EXPECT_EQ(CircuitState::OPEN, pool.stats()[1].circuitState);
+}
+
+TEST(CircuitBreakerTest, ConcurrentTrials)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    NodeConfig config;
+    config.circuitBreaker.consecutiveFailures = 1;
+    config.circuitBreaker.halfOpenRequests = 3;
+    NodePool pool({ "http://a:9200" }, nullptr, config);
+    auto node = (*pool.nodes())[0];
+    node->onRequestStart();
+    node->onRequestFinish(1ms, false);
+    node->breaker().onProbe(true);
+
+    // select() checks and claims a trial at once
+    std::atomic<int> selected{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 100; ++j)
+            {
+                if (pool.select())
+                {
+                    ++selected;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(3, selected.load());
+}
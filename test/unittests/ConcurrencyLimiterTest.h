@@ -0,0 +1,256 @@
+#include "../../src/ConcurrencyLimiter.h"
+#include "../../src/NodePool.h"
+#include <gtest/gtest.h>
+
+TEST(ConcurrencyLimiterTest, QueueAndFastFail)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    ConcurrencyLimitConfig config;
+    config.initialLimit = 2;
+    config.maxQueued = 1;
+    config.interactiveReserve = 0;
+    ConcurrencyLimiter limiter(config);
+    int ran = 0;
+    EXPECT_TRUE(limiter.enqueue([&ran]() { ++ran; }));
+    EXPECT_TRUE(limiter.enqueue([&ran]() { ++ran; }));
+    EXPECT_EQ(2, ran);
+    EXPECT_TRUE(limiter.enqueue([&ran]() { ++ran; }));
+    EXPECT_FALSE(limiter.enqueue([&ran]() { ++ran; }));
+    EXPECT_EQ(1, limiter.queued());
+    EXPECT_FALSE(limiter.tryAcquire());
+
+    auto tasks = limiter.release(1ms, LimiterSignal::IGNORED);
+    ASSERT_EQ(1, tasks.size());
+    tasks[0]();
+    EXPECT_EQ(3, ran);
+    EXPECT_EQ(2, limiter.inFlight());
+    EXPECT_EQ(0, limiter.queued());
+}
+
+TEST(ConcurrencyLimiterTest, Aimd)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    ConcurrencyLimitConfig config;
+    config.initialLimit = 10;
+    config.minLimit = 2;
+    config.maxLimit = 12;
+    config.backoffRatio = 0.5;
+    config.interactiveReserve = 0;
+    ConcurrencyLimiter limiter(config);
+
+    // grows by about one per round trip of a full window
+    for (int round = 0; round < 5; ++round)
+    {
+        while (limiter.tryAcquire())
+        {
+        }
+        auto limit = limiter.limit();
+        for (uint32_t i = 0; i < limit; ++i)
+        {
+            limiter.release(1ms, LimiterSignal::SUCCESS);
+        }
+    }
+    EXPECT_EQ(12, limiter.limit());
+
+    // each backoff comes from a request started after the previous one
+    auto now = ConcurrencyLimiter::Clock::now() + 1s;
+    ASSERT_TRUE(limiter.tryAcquire());
+    limiter.release(1ms, LimiterSignal::DROPPED, now);
+    EXPECT_EQ(6, limiter.limit());
+
+    // latency far above the baseline counts as congestion
+    now += 1s;
+    ASSERT_TRUE(limiter.tryAcquire());
+    limiter.release(10ms, LimiterSignal::SUCCESS, now);
+    EXPECT_EQ(3, limiter.limit());
+
+    for (int i = 0; i < 5; ++i)
+    {
+        now += 1s;
+        ASSERT_TRUE(limiter.tryAcquire());
+        limiter.release(1ms, LimiterSignal::DROPPED, now);
+    }
+    EXPECT_EQ(2, limiter.limit());
+}
+
+TEST(ConcurrencyLimiterTest, BackoffOncePerRoundTrip)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    ConcurrencyLimitConfig config;
+    config.initialLimit = 100;
+    config.interactiveReserve = 0;
+    ConcurrencyLimiter limiter(config);
+    for (int i = 0; i < 50; ++i)
+    {
+        ASSERT_TRUE(limiter.tryAcquire());
+    }
+
+    // 50 timeouts of one overload episode, all sent before the first one
+    auto now = ConcurrencyLimiter::Clock::now() + 10s;
+    for (int i = 0; i < 50; ++i)
+    {
+        limiter.release(5s, LimiterSignal::DROPPED, now + i * 1ms);
+    }
+    EXPECT_EQ(90, limiter.limit());
+
+    // a request sent after the backoff may shrink it again
+    ASSERT_TRUE(limiter.tryAcquire());
+    limiter.release(1s, LimiterSignal::DROPPED, now + 2s);
+    EXPECT_EQ(81, limiter.limit());
+}
+
+TEST(ConcurrencyLimiterTest, BaselineWindow)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    ConcurrencyLimitConfig config;
+    config.initialLimit = 100;
+    config.baselineWindow = 10s;
+    config.interactiveReserve = 0;
+    ConcurrencyLimiter limiter(config);
+    auto now = ConcurrencyLimiter::Clock::now() + 1s;
+    auto sample = [&](std::chrono::milliseconds latency,
+                      ConcurrencyLimiter::Clock::duration step) {
+        now += step;
+        EXPECT_TRUE(limiter.tryAcquire());
+        limiter.release(latency, LimiterSignal::SUCCESS, now);
+        return limiter.limit();
+    };
+    sample(10ms, 1ms);
+    // many samples within the window do not raise the baseline
+    for (int i = 0; i < 500; ++i)
+    {
+        sample(19ms, 1ms);
+    }
+    EXPECT_EQ(90, sample(25ms, 1ms));
+
+    // the node got slower for good: the baseline follows it after at most
+    // two windows
+    for (int i = 0; i < 30; ++i)
+    {
+        sample(40ms, 1s);
+    }
+    auto limit = limiter.limit();
+    EXPECT_EQ(limit, sample(60ms, 1s));
+}
+
+TEST(ConcurrencyLimiterTest, InteractiveReserve)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    ConcurrencyLimitConfig config;
+    config.initialLimit = 10;
+    config.maxLimit = 10;
+    ConcurrencyLimiter limiter(config);
+    for (int i = 0; i < 8; ++i)
+    {
+        ASSERT_TRUE(limiter.tryAcquire(Priority::BACKGROUND));
+    }
+    EXPECT_FALSE(limiter.tryAcquire(Priority::BACKGROUND));
+    EXPECT_FALSE(limiter.tryAcquire(Priority::NORMAL));
+    EXPECT_TRUE(limiter.tryAcquire(Priority::INTERACTIVE));
+
+    // the reserved permit goes to the interactive request although the
+    // background one waits longer
+    std::vector<Priority> ran;
+    limiter.enqueue([&ran]() { ran.push_back(Priority::BACKGROUND); },
+                    Priority::BACKGROUND);
+    limiter.enqueue([&ran]() { ran.push_back(Priority::INTERACTIVE); },
+                    Priority::INTERACTIVE);
+    ASSERT_EQ(std::vector<Priority>{ Priority::INTERACTIVE }, ran);
+    EXPECT_EQ(1, limiter.queued(Priority::BACKGROUND));
+    EXPECT_EQ(10, limiter.inFlight());
+}
+
+TEST(ConcurrencyLimiterTest, WeightedShare)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    ConcurrencyLimitConfig config;
+    config.initialLimit = 1;
+    config.maxLimit = 1;
+    config.interactiveReserve = 0;
+    ConcurrencyLimiter limiter(config);
+    ASSERT_TRUE(limiter.tryAcquire());
+
+    std::array<int, kPriorityCount> ran{};
+    for (size_t i = 0; i < kPriorityCount; ++i)
+    {
+        for (int j = 0; j < 20; ++j)
+        {
+            limiter.enqueue([&ran, i]() { ++ran[i]; },
+                            static_cast<Priority>(i));
+        }
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        auto tasks = limiter.release(1ms, LimiterSignal::SUCCESS);
+        ASSERT_EQ(1, tasks.size());
+        tasks[0]();
+    }
+    EXPECT_EQ(6, ran[0]);
+    EXPECT_EQ(3, ran[1]);
+    EXPECT_EQ(1, ran[2]);
+}
+
+TEST(ConcurrencyLimiterTest, NodeStats)
+{
+    using namespace tl::elasticsearch;
+    NodeConfig config;
+    NodePool unlimited({ "http://a:9200" });
+    EXPECT_EQ(nullptr, unlimited.select()->limiter());
+    EXPECT_EQ(0, unlimited.stats()[0].concurrencyLimit);
+
+    config.concurrencyLimit = ConcurrencyLimitConfig();
+    config.concurrencyLimit->initialLimit = 7;
+    NodePool limited({ "http://a:9200" }, nullptr, config);
+    EXPECT_EQ(7, limited.stats()[0].concurrencyLimit);
+}
+
+TEST(ConcurrencyLimiterTest, CancelledWaiters)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    ConcurrencyLimitConfig config;
+    config.initialLimit = 1;
+    config.maxQueued = 2;
+    config.interactiveReserve = 0;
+    ConcurrencyLimiter limiter(config);
+    ASSERT_TRUE(limiter.tryAcquire());
+
+    int ran = 0;
+    int dropped = 0;
+    auto first = std::make_shared<CancellationToken>();
+    auto second = std::make_shared<CancellationToken>();
+    auto queue = [&](const CancellationTokenPtr &cancellation) {
+        return limiter.enqueue([&ran]() { ++ran; },
+                               Priority::NORMAL,
+                               cancellation,
+                               [&dropped]() { ++dropped; });
+    };
+    EXPECT_TRUE(queue(first));
+    EXPECT_TRUE(queue(second));
+    EXPECT_FALSE(queue(nullptr));
+
+    // a cancelled waiter gives its place to a new one
+    first->cancel();
+    EXPECT_TRUE(queue(nullptr));
+    EXPECT_EQ(1, dropped);
+    EXPECT_EQ(2, limiter.queued());
+
+    // and does not take the permit when its turn comes
+    second->cancel();
+    auto tasks = limiter.release(1ms, LimiterSignal::IGNORED);
+    ASSERT_EQ(2, tasks.size());
+    for (auto &task : tasks)
+    {
+        task();
+    }
+    EXPECT_EQ(2, dropped);
+    EXPECT_EQ(1, ran);
+    EXPECT_EQ(1, limiter.inFlight());
+    EXPECT_EQ(0, limiter.queued());
+}
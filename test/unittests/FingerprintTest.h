@@ -0,0 +1,93 @@
+#include "../../src/Fingerprint.h"
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+TEST(FingerprintTest, Json)
+{
+    using namespace tl::elasticsearch;
+    auto parse = [](const std::string &text) {
+        Json::Value json;
+        std::stringstream(text) >> json;
+        return json;
+    };
+    auto query = fingerprint(parse(R"({"bool": {
+        "must": [{"match": {"address": "lane"}}],
+        "filter": [{"term": {"state": {"value": "IL"}}},
+                   {"range": {"age": {"gte": 20, "lt": 40}}}]}})"));
+
+    // the order of the keys and of the clauses does not matter, nor the short
+    // form of a clause, nor 20 written as 20.0
+    auto reordered = fingerprint(parse(R"({"bool": {
+        "filter": [{"range": {"age": {"lt": 40, "gte": 20.0}}},
+                   {"term": {"state": {"value": "IL"}}}],
+        "must": {"match": {"address": "lane"}}}})"));
+    EXPECT_EQ(query, reordered);
+
+    // another value changes the full hash only
+    auto otherState = fingerprint(parse(R"({"bool": {
+        "must": [{"match": {"address": "lane"}}],
+        "filter": [{"term": {"state": {"value": "TX"}}},
+                   {"range": {"age": {"gte": 30, "lt": 40}}}]}})"));
+    EXPECT_NE(query.full, otherState.full);
+    EXPECT_EQ(query.shape, otherState.shape);
+
+    // another field changes both
+    auto otherField = fingerprint(parse(R"({"bool": {
+        "must": [{"match": {"city": "lane"}}],
+        "filter": [{"term": {"state": {"value": "IL"}}},
+                   {"range": {"age": {"gte": 20, "lt": 40}}}]}})"));
+    EXPECT_NE(query.full, otherField.full);
+    EXPECT_NE(query.shape, otherField.shape);
+
+    // outside of bool queries the order of arrays is kept
+    auto sorted = fingerprint(parse(R"({"sort": ["age", "balance"]})"));
+    auto reversed = fingerprint(parse(R"({"sort": ["balance", "age"]})"));
+    EXPECT_NE(sorted.full, reversed.full);
+    // values of terms queries are one value whatever their number
+    EXPECT_EQ(fingerprint(parse(R"({"terms": {"gender": ["F"]}})")).shape,
+              fingerprint(parse(R"({"terms": {"gender": ["F", "M"]}})")).shape);
+    // but the fields of a multi_match are the shape
+    auto fieldsA = parse(R"({"multi_match": {"fields": ["a"], "query": "x"}})");
+    auto fieldsB = parse(R"({"multi_match": {"fields": ["b"], "query": "x"}})");
+    EXPECT_NE(fingerprint(fieldsA).shape, fingerprint(fieldsB).shape);
+    EXPECT_NE(fingerprint(parse(R"({"term": {"age": {"value": "30"}}})")).full,
+              fingerprint(parse(R"({"term": {"age": {"value": 30}}})")).full);
+
+    EXPECT_EQ(32, query.full.toHex().size());
+    EXPECT_NE(query.full.toHex(), query.shape.toHex());
+}
+
+TEST(FingerprintTest, QueryTree)
+{
+    using namespace tl::elasticsearch;
+    QueryArena<> arena;
+    auto tree = QueryTree::newQueryTree(&arena);
+    tree->boolQuery({tree->match("address", "lane"), tree->matchAll()},
+                    {tree->matchPhrase("employer", "Quility")},
+                    {tree->multiMatch({"city", "state"}, "IL")},
+                    {tree->term("gender", "F"),
+                     tree->range("age", {.gte = 20, .lt = 40}),
+                     tree->boolQuery({})});
+    EXPECT_EQ(fingerprint(tree->toJson()), fingerprint(*tree));
+
+    // the builders write must_not as mustNot
+    auto builder = BoolQuery::newBoolQuery()
+                       ->mustNot(TermQuery::newTermQuery()
+                                     ->field("gender")
+                                     ->query("F"))
+                       ->filter(RangeQuery::newRangeQuery()
+                                    ->field("age")
+                                    ->gte(20)
+                                    ->lt(40));
+    auto fromBuilder = QueryTree::fromQuery(builder, &arena);
+    EXPECT_EQ(fingerprint(*builder), fingerprint(*fromBuilder));
+
+    SearchParam param("accounts");
+    param.query(builder).size(10);
+    auto search = fingerprint(param);
+    param.body(R"({"size": 10, "query": )" +
+               fromBuilder->toJson().toStyledString() + "}");
+    EXPECT_EQ(search, fingerprint(param));
+    param.body("{");
+    EXPECT_THROW(fingerprint(param), ElasticSearchException);
+}
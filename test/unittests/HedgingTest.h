@@ -0,0 +1,106 @@
+#include "../../src/Hedging.h"
+#include "../../src/LatencyHistogram.h"
+#include <gtest/gtest.h>
+
+TEST(HedgingTest, LatencyHistogram)
+{
+    using namespace tl::elasticsearch;
+    LatencyHistogram histogram;
+    EXPECT_EQ(0, histogram.percentile(0.5));
+    for (uint64_t i = 1; i <= 1000; ++i)
+    {
+        histogram.record(i * 1000);
+    }
+    EXPECT_EQ(1000, histogram.count());
+    EXPECT_EQ(1000000, histogram.max());
+    // never below the real value, at most 6.25% above
+    auto p95 = histogram.percentile(0.95);
+    EXPECT_GE(p95, 950000);
+    EXPECT_LE(p95, 950000 * 1.0625);
+    EXPECT_EQ(1000000, histogram.percentile(1));
+    for (uint32_t i = 0; i + 1 < LatencyHistogram::kBucketCount; ++i)
+    {
+        ASSERT_EQ(i, LatencyHistogram::bucketIndex(
+                         LatencyHistogram::bucketLowerBound(i)));
+        ASSERT_EQ(i, LatencyHistogram::bucketIndex(
+                         LatencyHistogram::bucketUpperBound(i)));
+    }
+    EXPECT_EQ(LatencyHistogram::kBucketCount - 1,
+              LatencyHistogram::bucketIndex(UINT64_MAX));
+}
+
+TEST(HedgingTest, Budget)
+{
+    using namespace tl::elasticsearch;
+    HedgePolicy policy;
+    policy.budget = 0.1;
+    HedgeController controller(policy);
+    EXPECT_FALSE(controller.tryAcquire());
+    for (int i = 0; i < 20; ++i)
+    {
+        controller.onRequest();
+    }
+    EXPECT_TRUE(controller.tryAcquire());
+    EXPECT_TRUE(controller.tryAcquire());
+    EXPECT_FALSE(controller.tryAcquire());
+    EXPECT_EQ(2, controller.stats().hedgesSent);
+    EXPECT_EQ(20, controller.stats().requests);
+}
+
+TEST(HedgingTest, Delay)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    HedgePolicy policy;
+    policy.minDelayMs = 5;
+    HedgeController controller(policy);
+    EXPECT_DOUBLE_EQ(5, controller.delay().count());
+    for (int i = 0; i < 100; ++i)
+    {
+        controller.onResponse(i < 90 ? 1ms : 100ms, false);
+    }
+    EXPECT_GE(controller.delay().count(), 100);
+
+    policy.delayMs = 20;
+    EXPECT_DOUBLE_EQ(20, HedgeController(policy).delay().count());
+}
+
+TEST(HedgingTest, DelayFollowsLatency)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    HedgePolicy policy;
+    policy.minDelayMs = 5;
+    policy.window = 10s;
+    HedgeController controller(policy);
+    auto now = HedgeController::Clock::now();
+    for (int i = 0; i < 1000; ++i)
+    {
+        controller.onResponse(100ms, false, now);
+    }
+    EXPECT_GE(controller.delay().count(), 100);
+
+    // the cluster got faster: the slow window is kept for one more window
+    for (int i = 0; i < 200; ++i)
+    {
+        controller.onResponse(1ms, false, now + 11s);
+    }
+    EXPECT_GE(controller.delay().count(), 100);
+    for (int i = 0; i < 200; ++i)
+    {
+        controller.onResponse(1ms, false, now + 22s);
+    }
+    EXPECT_DOUBLE_EQ(5, controller.delay().count());
+
+    // and is forgotten at once after a long pause
+    for (int i = 0; i < 200; ++i)
+    {
+        controller.onResponse(100ms, false, now + 100s);
+    }
+    EXPECT_GE(controller.delay().count(), 100);
+    for (int i = 0; i < 200; ++i)
+    {
+        controller.onResponse(1ms, false, now + 200s);
+    }
+    EXPECT_DOUBLE_EQ(5, controller.delay().count());
+}
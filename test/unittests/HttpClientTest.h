@@ -1,8 +1,11 @@
 #include "../../src/HttpClient.h"
+#include <algorithm>
+#include <condition_variable>
 #include <cstring>
 #include <drogon/drogon.h>
 #include <drogon/HttpTypes.h>
 #include <gtest/gtest.h>
+#include <mutex>
 
 TEST(HttpClientTest, Test1)
 {
@@ -47,3 +50,206 @@ TEST(HttpClientTest, Test5)
                                     std::vector<Json::Value>()),
                  tl::elasticsearch::ElasticSearchException);
 }
+
+TEST(HttpClientTest, LoopPool)
+{
+    tl::elasticsearch::HttpClient client("http://localhost:9200");
+    auto pool = std::make_shared<trantor::EventLoopThreadPool>(1);
+    pool->start();
+    client.setLoopPool(pool);
+    // synchronous calls do not depend on the loops of drogon
+    ASSERT_NO_THROW(client.sendRequest("/", drogon::Get));
+
+    trantor::EventLoopThread caller;
+    caller.run();
+    std::promise<bool> onCallerLoop;
+    caller.getLoop()->runInLoop([&]() {
+        client.sendRequest(
+            "/",
+            drogon::Get,
+            client.toCallerLoop<Json::Value>([&](const Json::Value &) {
+                onCallerLoop.set_value(caller.getLoop()->isInLoopThread());
+            }),
+            [&](const tl::elasticsearch::ElasticSearchException &) {
+                onCallerLoop.set_value(false);
+            });
+    });
+    EXPECT_TRUE(onCallerLoop.get_future().get());
+}
+
+TEST(HttpClientTest, SlowSearchFingerprint)
+{
+    using namespace tl::elasticsearch;
+    HttpClient client("http://localhost:9201");
+    auto pool = std::make_shared<trantor::EventLoopThreadPool>(1);
+    pool->start();
+    client.setLoopPool(pool);
+    SlowLogConfig config;
+    config.thresholdMs = 1e-6;
+    auto slowLog = std::make_shared<SlowLog>(config);
+    std::mutex mutex;
+    std::condition_variable written;
+    std::vector<SlowLogRecord> records;
+    slowLog->setSink([&](const SlowLogRecord &record) {
+        std::lock_guard<std::mutex> lock(mutex);
+        records.push_back(record);
+        written.notify_one();
+    });
+    client.setSlowLog(slowLog);
+
+    RequestOptions options;
+    options.operation = "search";
+    options.index = "accounts";
+    options.searchBody = true;
+    for (const auto *body : {R"({"query": {"term": {"state": "IL"}}})",
+                             R"({"query": {"term": {"state": "TX"}}})",
+                             R"({"query": {"term": {"city": "IL"}}})"})
+    {
+        client.sendRawRequest(
+            "/accounts/_search",
+            drogon::Get,
+            [](const Json::Value &) {},
+            [](const ElasticSearchException &) {},
+            body,
+            options);
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(written.wait_for(lock, std::chrono::seconds(5), [&]() {
+        return records.size() == 3;
+    }));
+    std::sort(records.begin(), records.end(), [](const auto &a, const auto &b) {
+        return a.body < b.body;
+    });
+    // city, IL, TX: the same search with another value shares its record
+    EXPECT_NE(records[0].fingerprint, records[1].fingerprint);
+    EXPECT_EQ(records[1].fingerprint, records[2].fingerprint);
+}
+
+TEST(HttpClientTest, Metrics)
+{
+    using namespace tl::elasticsearch;
+    HttpClient client("http://localhost:9201");
+    ASSERT_THROW(client.sendRequest("/", drogon::Get), ElasticSearchException);
+    auto snapshot = client.metrics()->snapshot();
+    ASSERT_EQ(1, snapshot.size());
+    EXPECT_EQ("other", snapshot[0].operation);
+    EXPECT_EQ(1, snapshot[0].requests);
+    EXPECT_EQ(1, snapshot[0].errors);
+    EXPECT_EQ(0, snapshot[0].inFlight);
+    EXPECT_EQ(1, snapshot[0].latencyCount);
+
+    client.setMetricsEnabled(false);
+    ASSERT_THROW(client.sendRequest("/", drogon::Get), ElasticSearchException);
+    EXPECT_EQ(1, client.metrics()->snapshot()[0].requests);
+}
+
+TEST(HttpClientTest, RateLimitedAfterDestroy)
+{
+    using namespace tl::elasticsearch;
+    auto client = std::make_shared<HttpClient>("http://localhost:9201");
+    auto pool = std::make_shared<trantor::EventLoopThreadPool>(1);
+    pool->start();
+    client->setLoopPool(pool);
+    RateLimitConfig config;
+    config.rate = 10;
+    config.burst = 1;
+    client->setRateLimiter(std::make_shared<RateLimiter>(config));
+
+    RequestOptions options;
+    options.documents = 1;
+    std::promise<std::string> error;
+    client->sendRequest(
+        "/accounts/_doc",
+        drogon::Post,
+        [](const Json::Value &) {},
+        [](const ElasticSearchException &) {},
+        Json::Value(Json::objectValue),
+        options);
+    // over the limit, delayed by 100ms
+    client->sendRequest(
+        "/accounts/_doc",
+        drogon::Post,
+        [&](const Json::Value &) { error.set_value(""); },
+        [&](const ElasticSearchException &err) {
+            error.set_value(err.what());
+        },
+        Json::Value(Json::objectValue),
+        options);
+    client.reset();
+    auto message = error.get_future().get();
+    EXPECT_NE(std::string::npos, message.find("destroyed"));
+}
+
+TEST(HttpClientTest, Settings)
+{
+    using namespace tl::elasticsearch;
+    HttpClient client("http://localhost:9201");
+    auto before = client.settings();
+    client.setTracer(std::make_shared<RingBufferTracer>());
+    client.setRequestTiming(true);
+    // a request holding the snapshot is not affected
+    EXPECT_EQ(nullptr, before->tracer);
+    EXPECT_FALSE(before->timing);
+    EXPECT_NE(nullptr, client.settings()->tracer);
+    EXPECT_NE(nullptr, client.newTiming());
+
+    HttpClient copy(client);
+    copy.setTracer(nullptr);
+    EXPECT_NE(nullptr, client.tracer());
+    EXPECT_EQ(client.metrics(), copy.metrics());
+}
+
+TEST(HttpClientTest, NodeGauges)
+{
+    using namespace tl::elasticsearch;
+    NodeConfig config;
+    config.concurrencyLimit = ConcurrencyLimitConfig();
+    HttpClient client({"http://localhost:9201"}, nullptr, config);
+    auto text = client.metrics()->prometheus();
+    EXPECT_NE(std::string::npos,
+              text.find("es_client_node_concurrency_limit"
+                        "{node=\"http://localhost:9201\"} 20\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("es_client_node_queued"
+                        "{node=\"http://localhost:9201\"} 0\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("es_client_node_in_flight"
+                        "{node=\"http://localhost:9201\"} 0\n"));
+}
+
+TEST(HttpClientTest, ReleaseLoopPool)
+{
+    using namespace tl::elasticsearch;
+    HttpClient client("http://localhost:9201");
+    auto pool = std::make_shared<trantor::EventLoopThreadPool>(1);
+    pool->start();
+    client.setLoopPool(pool);
+    RateLimitConfig config;
+    config.rate = 10;
+    config.burst = 1;
+    client.setRateLimiter(std::make_shared<RateLimiter>(config));
+
+    RequestOptions options;
+    options.documents = 1;
+    client.sendRequest(
+        "/accounts/_doc",
+        drogon::Post,
+        [](const Json::Value &) {},
+        [](const ElasticSearchException &) {},
+        Json::Value(Json::objectValue),
+        options);
+    // over the limit, delayed by 100ms on a loop of the pool
+    std::promise<void> done;
+    client.sendRequest(
+        "/accounts/_doc",
+        drogon::Post,
+        [&](const Json::Value &) { done.set_value(); },
+        [&](const ElasticSearchException &) { done.set_value(); },
+        Json::Value(Json::objectValue),
+        options);
+    // as ElasticSearchClient::shutdown does
+    client.setLoopPool(nullptr);
+    pool.reset();
+    EXPECT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(10)));
+}
@@ -0,0 +1,122 @@
+#include "../loadgen/LoadGenerator.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+
+static tl::elasticsearch::load::Workload loadWorkload(const std::string &text)
+{
+    Json::Value json;
+    std::stringstream(text) >> json;
+    return tl::elasticsearch::load::Workload::fromJson(json);
+}
+
+TEST(LoadGeneratorTest, Workload)
+{
+    using namespace tl::elasticsearch::load;
+    auto workload = loadWorkload(R"({"operations": [
+        {"type": "search", "weight": 3, "index": "accounts",
+         "search": {"query": {"match": {"address": "street"}},
+                    "sort": [{"age": "desc"}], "size": 5,
+                    "aggs": {"states": {"terms": {"field": "state"}}}}},
+        {"name": "lookup", "type": "get", "weight": 1, "index": "accounts",
+         "ids": ["1"]}]})");
+    ASSERT_EQ(2, workload.operations().size());
+    const auto &search = workload.operations()[0];
+    EXPECT_EQ("search:accounts", search.name);
+    EXPECT_EQ("lookup", workload.operations()[1].name);
+
+    auto json = search.searchParam().toJson();
+    EXPECT_EQ("street", json["query"]["match"]["address"].asString());
+    EXPECT_EQ("desc", json["sort"][0]["age"].asString());
+    EXPECT_EQ(5, json["size"].asInt());
+    EXPECT_EQ("state", json["aggs"]["states"]["terms"]["field"].asString());
+
+    std::mt19937_64 random(1);
+    int searches = 0;
+    for (int i = 0; i < 4000; ++i)
+    {
+        searches += workload.pick(random) == 0 ? 1 : 0;
+    }
+    EXPECT_NEAR(3000, searches, 150);
+
+    EXPECT_THROW(loadWorkload(R"([{"type": "scroll", "index": "a"}])"),
+                 std::invalid_argument);
+    EXPECT_THROW(loadWorkload(R"([{"type": "get", "index": "a"}])"),
+                 std::invalid_argument);
+    EXPECT_THROW(loadWorkload(R"([{"type": "search"}])"),
+                 std::invalid_argument);
+}
+
+TEST(LoadGeneratorTest, ClosedLoop)
+{
+    using namespace tl::elasticsearch::load;
+    auto workload = loadWorkload(R"([{"index": "accounts"}])");
+    LoadConfig config;
+    config.concurrency = 4;
+    config.warmupSeconds = 0.05;
+    config.durationSeconds = 0.2;
+
+    std::atomic<int> inFlight{0};
+    std::atomic<int> maxInFlight{0};
+    std::atomic<int> calls{0};
+    LoadGenerator generator(
+        workload,
+        config,
+        [&](const WorkloadOperation &, const LoadGenerator::Done &done) {
+            auto current = ++inFlight;
+            auto seen = maxInFlight.load();
+            while (current > seen &&
+                   !maxInFlight.compare_exchange_weak(seen, current))
+            {
+            }
+            bool failed = ++calls % 10 == 0;
+            std::thread([&inFlight, done, failed]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                --inFlight;
+                done(!failed);
+            }).detach();
+        });
+    auto report = generator.run();
+    EXPECT_EQ(4, maxInFlight.load());
+    EXPECT_EQ(0, report.unfinished);
+    EXPECT_GT(report.total.completed, 100);
+    // the warmup is not measured
+    EXPECT_LT(report.total.completed, calls.load());
+    EXPECT_NEAR(report.total.completed / 10, report.total.errors, 5);
+    EXPECT_GE(report.total.p50, 2000);
+    EXPECT_LE(report.total.p50, report.total.p999);
+    EXPECT_EQ(report.total.completed, report.operations[0].completed);
+}
+
+TEST(LoadGeneratorTest, OpenLoop)
+{
+    using namespace tl::elasticsearch::load;
+    auto workload = loadWorkload(R"([{"index": "accounts"}])");
+    LoadConfig config;
+    config.mode = LoadMode::OPEN;
+    config.rate = 500;
+    config.poisson = false;
+    config.warmupSeconds = 0;
+    config.durationSeconds = 0.2;
+    LoadGenerator fast(workload,
+                       config,
+                       [](const WorkloadOperation &,
+                          const LoadGenerator::Done &done) { done(true); });
+    auto report = fast.run();
+    EXPECT_NEAR(100, report.total.completed, 2);
+    EXPECT_NEAR(500, report.throughput, 10);
+
+    // a target slower than the arrival rate: the latency is counted from the
+    // scheduled arrival, so it grows with the backlog
+    LoadGenerator slow(workload,
+                       config,
+                       [](const WorkloadOperation &,
+                          const LoadGenerator::Done &done) {
+                           std::this_thread::sleep_for(
+                               std::chrono::milliseconds(4));
+                           done(true);
+                       });
+    report = slow.run();
+    EXPECT_NEAR(100, report.total.completed, 2);
+    EXPECT_GT(report.total.max, 100000);
+}
@@ -0,0 +1,127 @@
+#include "../../src/Metrics.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(MetricsTest, Series)
+{
+    using namespace tl::elasticsearch;
+    MetricsRegistry registry;
+    auto &search = registry.series("search", "accounts");
+    EXPECT_EQ(&search, &registry.series("search", "accounts"));
+    EXPECT_NE(&search, &registry.series("search", "orders"));
+    EXPECT_NE(&search, &registry.series("index", "accounts"));
+
+    search.requests += 2;
+    search.errors += 1;
+    search.bytesSent += 100;
+    search.latency.record(uint64_t(1000));
+    search.latency.record(uint64_t(3000));
+    auto snapshot = registry.snapshot();
+    EXPECT_EQ(3, snapshot.size());
+    for (const auto &series : snapshot)
+    {
+        if (series.operation == "search" && series.index == "accounts")
+        {
+            EXPECT_EQ(2, series.requests);
+            EXPECT_EQ(1, series.errors);
+            EXPECT_EQ(100, series.bytesSent);
+            EXPECT_EQ(2, series.latencyCount);
+            EXPECT_EQ(4000, series.latencySum);
+            EXPECT_NEAR(3000, series.p99, 3000 * 0.0625);
+        }
+    }
+}
+
+TEST(MetricsTest, Concurrent)
+{
+    using namespace tl::elasticsearch;
+    MetricsRegistry registry;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&registry]() {
+            for (int i = 0; i < 1000; ++i)
+            {
+                auto &series =
+                    registry.series("get", "index" + std::to_string(i % 10));
+                series.requests.fetch_add(1);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    auto snapshot = registry.snapshot();
+    EXPECT_EQ(10, snapshot.size());
+    for (const auto &series : snapshot)
+    {
+        EXPECT_EQ(400, series.requests);
+    }
+}
+
+TEST(MetricsTest, Overflow)
+{
+    using namespace tl::elasticsearch;
+    MetricsRegistry registry;
+    for (size_t i = 0; i < MetricsRegistry::kMaxSeries + 10; ++i)
+    {
+        registry.series("index", std::to_string(i)).requests += 1;
+    }
+    uint64_t requests = 0;
+    bool overflow = false;
+    for (const auto &series : registry.snapshot())
+    {
+        requests += series.requests;
+        overflow = overflow || series.index == "_overflow";
+    }
+    EXPECT_EQ(MetricsRegistry::kMaxSeries + 10, requests);
+    EXPECT_TRUE(overflow);
+}
+
+TEST(MetricsTest, Prometheus)
+{
+    using namespace tl::elasticsearch;
+    MetricsRegistry registry;
+    auto &series = registry.series("search", "acc\"ounts");
+    series.requests += 3;
+    series.latency.record(uint64_t(2000));
+    auto text = registry.prometheus();
+    EXPECT_NE(std::string::npos,
+              text.find("# TYPE es_client_requests_total counter\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("es_client_requests_total{operation=\"search\","
+                        "index=\"acc\\\"ounts\"} 3\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("es_client_latency_seconds_count{operation=\"search\","
+                        "index=\"acc\\\"ounts\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("quantile=\"0.99\""));
+
+    // sums of a long uptime keep their microseconds
+    registry.series("count", "big").latency.record(uint64_t(123456789012));
+    text = registry.prometheus();
+    EXPECT_NE(std::string::npos,
+              text.find("es_client_latency_seconds_sum{operation=\"count\","
+                        "index=\"big\"} 123456.789012\n"));
+}
+
+TEST(MetricsTest, Gauges)
+{
+    using namespace tl::elasticsearch;
+    MetricsRegistry registry;
+    registry.setGaugeCollector([]() {
+        std::vector<GaugeSample> gauges;
+        gauges.push_back({"queued", "Queued.", {{"node", "a"}}, 2});
+        gauges.push_back({"limit", "Limit.", {{"node", "a"}}, 20});
+        gauges.push_back({"queued", "Queued.", {{"node", "b"}}, 0});
+        return gauges;
+    });
+    EXPECT_EQ(3, registry.gauges().size());
+    auto text = registry.prometheus();
+    EXPECT_NE(std::string::npos,
+              text.find("# TYPE queued gauge\n"
+                        "queued{node=\"a\"} 2\n"
+                        "queued{node=\"b\"} 0\n"));
+    EXPECT_NE(std::string::npos, text.find("limit{node=\"a\"} 20\n"));
+}
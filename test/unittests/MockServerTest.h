@@ -0,0 +1,224 @@
+#include "../../src/HttpClient.h"
+#include "../mockserver/MockServer.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+
+static const char *kMockAccounts =
+    R"({"index":{"_id":"1"}}
+{"balance":39225,"age":32,"state":"IL","address":"880 Holmes Lane"}
+{"index":{"_id":"6"}}
+{"balance":5686,"age":36,"state":"TN","address":"671 Bristol Street"}
+{"index":{"_id":"13"}}
+{"balance":32838,"age":28,"state":"VA","address":"789 Madison Street"}
+{"index":{"_id":"18"}}
+{"balance":4180,"age":33,"state":"IL","address":"467 Hutchinson Court"}
+)";
+
+TEST(MockServerTest, Indices)
+{
+    using namespace tl::elasticsearch::mock;
+    MockServer server("127.0.0.1:9200");
+    auto created = server.handle(
+        "PUT",
+        "/accounts",
+        R"({"settings":{"number_of_shards":3},
+            "mappings":{"_doc":{"properties":{"age":{"type":"integer"}}}}})");
+    EXPECT_EQ(200, created.status);
+    EXPECT_EQ("accounts", created.body["index"].asString());
+    EXPECT_EQ(400, server.handle("PUT", "/accounts", "").status);
+
+    server.handle("PUT",
+                  "/accounts/_mapping/_doc",
+                  R"({"properties":{"state":{"type":"keyword"}}})");
+    auto index = server.handle("GET", "/accounts", "").body["accounts"];
+    EXPECT_EQ("3", index["settings"]["index"]["number_of_shards"].asString());
+    EXPECT_TRUE(index["mappings"]["_doc"]["properties"].isMember("age"));
+    EXPECT_TRUE(index["mappings"]["_doc"]["properties"].isMember("state"));
+
+    EXPECT_EQ(200, server.handle("DELETE", "/accounts", "").status);
+    auto missing = server.handle("GET", "/accounts", "");
+    EXPECT_EQ(404, missing.status);
+    EXPECT_EQ("index_not_found_exception",
+              missing.body["error"]["type"].asString());
+}
+
+TEST(MockServerTest, Documents)
+{
+    using namespace tl::elasticsearch::mock;
+    MockServer server("127.0.0.1:9200");
+    auto created = server.handle("PUT", "/accounts/_doc/1", R"({"age":32})");
+    EXPECT_EQ(201, created.status);
+    EXPECT_EQ("created", created.body["result"].asString());
+    auto updated = server.handle("PUT", "/accounts/_doc/1", R"({"age":33})");
+    EXPECT_EQ("updated", updated.body["result"].asString());
+    EXPECT_EQ(2, updated.body["_version"].asInt());
+
+    // the client sends updates without the leading slash
+    server.handle("POST",
+                  "accounts/_doc/1/_update",
+                  R"({"doc":{"state":"IL"}})");
+    auto found = server.handle("GET", "/accounts/_doc/1", "");
+    EXPECT_TRUE(found.body["found"].asBool());
+    EXPECT_EQ(33, found.body["_source"]["age"].asInt());
+    EXPECT_EQ("IL", found.body["_source"]["state"].asString());
+
+    EXPECT_EQ("deleted",
+              server.handle("DELETE", "/accounts/_doc/1", "")
+                  .body["result"]
+                  .asString());
+    auto deleted = server.handle("GET", "/accounts/_doc/1", "");
+    EXPECT_EQ(404, deleted.status);
+    EXPECT_FALSE(deleted.body["found"].asBool());
+}
+
+TEST(MockServerTest, Bulk)
+{
+    using namespace tl::elasticsearch::mock;
+    MockServer server("127.0.0.1:9200");
+    EXPECT_EQ(4, server.load("accounts", kMockAccounts));
+
+    // one value per line, as Elasticsearch reads it
+    auto styled = server.handle("POST",
+                                "/_bulk",
+                                "{\n  \"delete\" : {\"_index\" : \"accounts\","
+                                " \"_id\" : \"6\"}\n}\n");
+    EXPECT_EQ(400, styled.status);
+    EXPECT_EQ(400,
+              server.handle("POST", "/_bulk", "{\"delete\":{}} {}\n").status);
+    auto unterminated = server.handle(
+        "POST", "/_bulk", "{\"delete\":{\"_index\":\"accounts\"}}");
+    EXPECT_EQ(400, unterminated.status);
+    EXPECT_EQ(4, server.store().documents("accounts"));
+
+    auto result = server.handle("POST",
+                                "/_bulk",
+                                "{\"delete\":{\"_index\":\"accounts\","
+                                "\"_id\":\"6\"}}\n"
+                                "{\"create\":{\"_index\":\"accounts\","
+                                "\"_id\":\"1\"}}\n{\"age\":1}\n");
+    EXPECT_EQ(200, result.status);
+    EXPECT_TRUE(result.body["errors"].asBool());
+    EXPECT_EQ(200, result.body["items"][0]["delete"]["status"].asInt());
+    EXPECT_EQ(409, result.body["items"][1]["create"]["status"].asInt());
+    EXPECT_EQ(3, server.store().documents("accounts"));
+}
+
+TEST(MockServerTest, ClientBulkBody)
+{
+    using namespace tl::elasticsearch;
+    Json::Value action;
+    action["index"]["_id"] = "1";
+    Json::Value source;
+    source["address"]["street"] = "880 Holmes Lane";
+    source["tags"].append("a");
+    auto body = HttpClient::bulkBody({action, source});
+    EXPECT_EQ(2, std::count(body.begin(), body.end(), '\n'));
+
+    mock::MockServer server("127.0.0.1:9200");
+    EXPECT_EQ(1, server.load("accounts", body));
+}
+
+TEST(MockServerTest, Search)
+{
+    using namespace tl::elasticsearch::mock;
+    MockServer server("127.0.0.1:9200");
+    server.load("accounts", kMockAccounts);
+
+    auto result = server.handle(
+        "GET",
+        "/accounts/_search",
+        R"({"query":{"bool":{"must":{"match":{"address":"street"}},
+                             "filter":{"range":{"age":{"gte":30}}}}}})");
+    EXPECT_EQ(1, result.body["hits"]["total"].asInt());
+    EXPECT_EQ("6", result.body["hits"]["hits"][0]["_id"].asString());
+
+    result = server.handle("GET",
+                           "/accounts/_search",
+                           R"({"sort":[{"balance":"desc"}],"size":2,"from":1,
+                               "query":{"term":{"state.keyword":"IL"}}})");
+    EXPECT_EQ(2, result.body["hits"]["total"].asInt());
+    ASSERT_EQ(1, result.body["hits"]["hits"].size());
+    EXPECT_EQ("18", result.body["hits"]["hits"][0]["_id"].asString());
+
+    result = server.handle("GET",
+                           "/accounts/_count",
+                           R"({"query":{"match_phrase":
+                                 {"address":"madison street"}}})");
+    EXPECT_EQ(1, result.body["count"].asInt());
+
+    result = server.handle("GET",
+                           "/accounts/_search",
+                           R"({"query":{"bool":{"mustNot":{}}}})");
+    EXPECT_EQ(400, result.status);
+    EXPECT_EQ("parsing_exception", result.body["error"]["type"].asString());
+}
+
+TEST(MockServerTest, Aggregations)
+{
+    using namespace tl::elasticsearch::mock;
+    MockServer server("127.0.0.1:9200");
+    server.load("accounts", kMockAccounts);
+    auto result = server.handle(
+        "GET",
+        "/accounts/_search",
+        R"({"size":0,"aggs":{"states":{"terms":{"field":"state.keyword"},
+              "aggs":{"balance":{"avg":{"field":"balance"}}}}}})");
+    const auto &buckets = result.body["aggregations"]["states"]["buckets"];
+    ASSERT_EQ(3, buckets.size());
+    EXPECT_EQ("IL", buckets[0]["key"].asString());
+    EXPECT_EQ(2, buckets[0]["doc_count"].asInt());
+    EXPECT_DOUBLE_EQ((39225 + 4180) / 2.0,
+                     buckets[0]["balance"]["value"].asDouble());
+    EXPECT_EQ(0, result.body["hits"]["hits"].size());
+}
+
+TEST(MockServerTest, Faults)
+{
+    using namespace tl::elasticsearch::mock;
+    FaultConfig config;
+    config.rejectRate = 0.2;
+    config.errorRate = 0.1;
+    config.stallRate = 0.1;
+    config.stallMs = 5000;
+    config.latencyMedianMs = 10;
+    config.latencyP99Ms = 100;
+    config.seed = 42;
+    FaultInjector faults(config);
+    int rejected = 0;
+    std::vector<double> latencies;
+    for (int i = 0; i < 10000; ++i)
+    {
+        auto fault = faults.next();
+        if (fault.kind == FaultKind::REJECT)
+        {
+            ++rejected;
+            EXPECT_EQ(429, MockServer::faultResult(fault).status);
+        }
+        if (fault.kind == FaultKind::STALL)
+        {
+            EXPECT_GE(fault.delayMs, 5000);
+        }
+        else
+        {
+            latencies.push_back(fault.delayMs);
+        }
+    }
+    EXPECT_NEAR(2000, rejected, 200);
+    EXPECT_EQ(10000, faults.stats().requests);
+    EXPECT_NEAR(1000, faults.stats().stalled, 150);
+    std::sort(latencies.begin(), latencies.end());
+    EXPECT_NEAR(10, latencies[latencies.size() / 2], 1);
+    EXPECT_NEAR(100, latencies[latencies.size() * 99 / 100], 20);
+
+    // the same seed gives the same faults
+    FaultInjector first(config), second(config);
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(first.next().delayMs, second.next().delayMs);
+    }
+
+    MockServer server("127.0.0.1:9200");
+    server.handle("PUT", "/_mock/faults", R"({"reject_rate":1})");
+    EXPECT_EQ(1, server.faults().config().rejectRate);
+    EXPECT_EQ(FaultKind::REJECT, server.faults().next().kind);
+}
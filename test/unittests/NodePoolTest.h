@@ -0,0 +1,101 @@
+#include "../../src/NodePool.h"
+#include <gtest/gtest.h>
+#include <map>
+
+TEST(NodePoolTest, RoundRobin)
+{
+    using namespace tl::elasticsearch;
+    NodePool pool({ "http://a:9200", "http://b:9200", "http://c:9200" });
+    std::map<std::string, int> counts;
+    for (int i = 0; i < 30; ++i)
+    {
+        ++counts[pool.select()->url()];
+    }
+    ASSERT_EQ(3, counts.size());
+    for (const auto &[url, count] : counts)
+    {
+        EXPECT_EQ(10, count);
+    }
+}
+
+TEST(NodePoolTest, LeastOutstanding)
+{
+    using namespace tl::elasticsearch;
+    NodePool pool({ "http://a:9200", "http://b:9200" },
+                  newNodeSelector("least_outstanding"));
+    auto busy = (*pool.nodes())[0];
+    busy->onRequestStart();
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ("http://b:9200", pool.select()->url());
+    }
+}
+
+TEST(NodePoolTest, LatencyEwma)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    NodePool pool({ "http://a:9200", "http://b:9200" },
+                  newNodeSelector("latency_ewma"));
+    auto slow = (*pool.nodes())[0];
+    auto fast = (*pool.nodes())[1];
+    slow->onRequestStart();
+    slow->onRequestFinish(100ms, true);
+    fast->onRequestStart();
+    fast->onRequestFinish(10ms, true);
+    EXPECT_DOUBLE_EQ(100, slow->ewmaLatencyMs());
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(fast, pool.select());
+    }
+    EXPECT_EQ(1, fast->stats().totalRequests);
+    EXPECT_EQ(0, fast->stats().inFlight);
+}
+
+TEST(NodePoolTest, LatencyEwmaColdNode)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    NodePool pool({ "http://a:9200", "http://b:9200" },
+                  newNodeSelector("latency_ewma"));
+    auto warm = (*pool.nodes())[0];
+    auto cold = (*pool.nodes())[1];
+    warm->onRequestStart();
+    warm->onRequestFinish(10ms, true);
+
+    // the cold node counts as fast as the mean, not as a free node
+    for (int i = 0; i < 3; ++i)
+    {
+        cold->onRequestStart();
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(warm, pool.select());
+    }
+    EXPECT_EQ(3, cold->inFlight());
+
+    // without any response, the outstanding requests decide
+    NodePool fresh({ "http://a:9200", "http://b:9200" },
+                   newNodeSelector("latency_ewma"));
+    (*fresh.nodes())[0]->onRequestStart();
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ((*fresh.nodes())[1], fresh.select());
+    }
+}
+
+TEST(NodePoolTest, SetNodesKeepsStats)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    NodePool pool({ "http://a:9200" });
+    auto node = pool.select();
+    node->onRequestStart();
+    pool.setNodes({ "http://a:9200", "http://b:9200" });
+    EXPECT_EQ(node, (*pool.nodes())[0]);
+    EXPECT_EQ(1, pool.stats()[0].inFlight);
+    node->onRequestFinish(1ms, false);
+    EXPECT_EQ(1, pool.stats()[0].failedRequests);
+    ASSERT_THROW(newNodeSelector("random"),
+                 tl::elasticsearch::ElasticSearchException);
+}
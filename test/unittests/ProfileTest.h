@@ -0,0 +1,68 @@
+#include "../../src/DocumentsClient.h"
+#include "../../src/Profile.h"
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+TEST(ProfileTest, SetByJson)
+{
+    using namespace tl::elasticsearch;
+    Json::Value json;
+    std::stringstream(R"({"shards": [{
+        "id": "[node][accounts][0]",
+        "searches": [{
+            "query": [{
+                "type": "BooleanQuery",
+                "description": "+address:lane #state:IL",
+                "time_in_nanos": 9000,
+                "breakdown": {"score": 1000, "score_count": 10,
+                              "create_weight": 500},
+                "children": [
+                    {"type": "TermQuery", "description": "address:lane",
+                     "time_in_nanos": 2000, "breakdown": {}},
+                    {"type": "TermQuery", "description": "state:IL",
+                     "time_in_nanos": 6000, "breakdown": {}}]}],
+            "rewrite_time": 3000,
+            "collector": [{
+                "name": "SimpleTopScoreDocCollector",
+                "reason": "search_top_hits",
+                "time_in_nanos": 4000}]}],
+        "aggregations": [{
+            "type": "NumericTermsAggregator",
+            "description": "ages",
+            "time_in_nanos": 7000,
+            "breakdown": {"collect": 6000}}]}]})") >>
+        json;
+    ProfileResponse profile;
+    profile.setByJson(json);
+    ASSERT_EQ(1, profile.getShards().size());
+    const auto &shard = profile.getShards()[0];
+    EXPECT_EQ("[node][accounts][0]", shard.getId());
+    const auto &search = shard.getSearches().at(0);
+    EXPECT_EQ(3000, search.getRewriteTime());
+    const auto &boolQuery = search.getQuery().at(0);
+    EXPECT_EQ("BooleanQuery", boolQuery.getType());
+    EXPECT_EQ(10, boolQuery.getBreakdown().at("score_count"));
+    EXPECT_EQ(2, boolQuery.getChildren().size());
+    EXPECT_EQ(1000, boolQuery.getSelfTimeInNanos());
+    EXPECT_EQ("search_top_hits", search.getCollector().at(0).getReason());
+    EXPECT_EQ(6000,
+              shard.getAggregations().at(0).getBreakdown().at("collect"));
+
+    // by the time spent in each component alone
+    auto hotspots = profile.getHotspots(3);
+    ASSERT_EQ(3, hotspots.size());
+    EXPECT_EQ("ages", hotspots[0].description);
+    EXPECT_EQ(ProfileSection::AGGREGATION, hotspots[0].section);
+    EXPECT_EQ("state:IL", hotspots[1].description);
+    EXPECT_EQ(ProfileSection::COLLECTOR, hotspots[2].section);
+    EXPECT_EQ(6, profile.getHotspots(100).size());
+
+    auto table = profile.formatHotspots(1);
+    EXPECT_EQ(1, std::count(table.begin(), table.end(), '\n'));
+    EXPECT_NE(std::string::npos, table.find("0.007 ms"));
+    EXPECT_NE(std::string::npos, table.find("aggregation"));
+
+    SearchParam param("accounts");
+    EXPECT_FALSE(param.toJson().isMember("profile"));
+    EXPECT_TRUE(param.profile(true).toJson()["profile"].asBool());
+}
@@ -0,0 +1,142 @@
+#include "../../src/QueryOptimizer.h"
+#include <gtest/gtest.h>
+
+TEST(QueryOptimizerTest, MustToFilter)
+{
+    using namespace tl::elasticsearch;
+    auto gender = TermQuery::newTermQuery()->field("gender")->query("F");
+    auto query =
+        BoolQuery::newBoolQuery()
+            ->must(MatchQuery::newMatchQuery()->field("address")->query("lane"))
+            ->must(gender)
+            ->must(RangeQuery::newRangeQuery()->field("age")->gte(20))
+            ->filter(gender);
+
+    // scored by default: only the duplicate filter goes
+    QueryRewriteReport report;
+    auto optimized = optimizeQuery(query, {}, &report);
+    EXPECT_EQ(3, optimized->toJson()["bool"]["must"].size());
+    EXPECT_EQ(1, optimized->toJson()["bool"]["filter"].size());
+    EXPECT_TRUE(report.empty());
+
+    // sorted by a field
+    SearchParam param("accounts");
+    param.query(query).sort("balance", DESC);
+    report = optimizeQuery(param);
+    auto json = param.query()->toJson()["bool"];
+    EXPECT_EQ(1, json["must"].size());
+    EXPECT_EQ("lane", json["must"][0]["match"]["address"].asString());
+    // the term moved to filter is the same as the filter already there
+    EXPECT_EQ(2, json["filter"].size());
+    EXPECT_EQ(20, json["filter"][1]["range"]["age"]["gte"].asDouble());
+    EXPECT_EQ(2, report.count(QueryRewrite::MUST_TO_FILTER));
+    EXPECT_EQ(1, report.count(QueryRewrite::DEDUPLICATE));
+    EXPECT_EQ("must_to_filter bool.must[1]\n"
+              "must_to_filter bool.must[2]\n"
+              "deduplicate bool.must[1]\n",
+              report.toString());
+    // the query given is left as it is
+    EXPECT_EQ(3, query->must().size());
+
+    QueryOptimizerOptions options;
+    options.scoresNeeded = false;
+    options.constantScore = true;
+    json = optimizeQuery(query, options)->toJson()["bool"];
+    EXPECT_EQ(3, json["must"].size());
+    EXPECT_EQ("F",
+              json["must"][1]["constant_score"]["filter"]["term"]["gender"]
+                  ["value"]
+                      .asString());
+}
+
+TEST(QueryOptimizerTest, Flatten)
+{
+    using namespace tl::elasticsearch;
+    auto match = MatchQuery::newMatchQuery()->field("address")->query("lane");
+    auto state = TermQuery::newTermQuery()->field("state")->query("IL");
+    auto age = RangeQuery::newRangeQuery()->field("age")->lt(40);
+    auto query =
+        BoolQuery::newBoolQuery()
+            ->must(BoolQuery::newBoolQuery()->must(match))
+            ->should(BoolQuery::newBoolQuery()->filter(state))
+            ->filter(BoolQuery::newBoolQuery()
+                         ->must(age)
+                         ->filter(state)
+                         ->mustNot(BoolQuery::newBoolQuery()->should(age)));
+
+    QueryRewriteReport report;
+    auto json = optimizeQuery(query, {}, &report)->toJson()["bool"];
+    // bool{must: [q]} is q
+    EXPECT_EQ(match->toJson(), json["must"][0]);
+    // bool{filter: [q]} scores 0, q does not
+    EXPECT_TRUE(json["should"][0]["bool"]["filter"].isArray());
+    // the nested conjunction joins the filter of its parent
+    EXPECT_EQ(2, json["filter"].size());
+    EXPECT_EQ(state->toJson(), json["filter"][0]);
+    EXPECT_EQ(age->toJson(), json["filter"][1]);
+    EXPECT_EQ(age->toJson(), json["mustNot"][0]);
+    EXPECT_EQ(3, report.count(QueryRewrite::FLATTEN));
+
+    QueryOptimizerOptions options;
+    options.flatten = false;
+    options.deduplicate = false;
+    report = QueryRewriteReport();
+    json = optimizeQuery(query, options, &report)->toJson()["bool"];
+    EXPECT_EQ(query->toJson()["bool"]["must"], json["must"]);
+    // a bool in filter is not scored, its must still moves to its filter
+    EXPECT_FALSE(json["filter"][0]["bool"].isMember("must"));
+    EXPECT_EQ(2, json["filter"][0]["bool"]["filter"].size());
+    ASSERT_EQ(1, report.rewrites.size());
+    EXPECT_EQ("bool.filter[0].bool.must[0]", report.rewrites[0].path);
+
+    auto term = TermQuery::newTermQuery()->field("state")->query("IL");
+    EXPECT_EQ(term, optimizeQuery(term));
+    EXPECT_EQ(nullptr, optimizeQuery(QueryPtr()));
+}
+
+TEST(QueryOptimizerTest, MinimumShouldMatch)
+{
+    using namespace tl::elasticsearch;
+    auto x = MatchQuery::newMatchQuery()->field("address")->query("lane");
+    auto y = TermQuery::newTermQuery()->field("state")->query("IL");
+    auto z = TermQuery::newTermQuery()->field("gender")->query("F");
+    QueryOptimizerOptions unscored;
+    unscored.scoresNeeded = false;
+
+    // merged, the parent would be bool{should: [x], must_not: [y]}, where x
+    // is required
+    auto query = BoolQuery::newBoolQuery()->should(x)->must(
+        BoolQuery::newBoolQuery()->mustNot(y));
+    QueryRewriteReport report;
+    auto json = optimizeQuery(query, unscored, &report)->toJson()["bool"];
+    EXPECT_EQ(y->toJson(), json["must"][0]["bool"]["mustNot"][0]);
+    EXPECT_FALSE(json.isMember("mustNot"));
+    EXPECT_TRUE(report.empty());
+
+    // the same in filter, scored or not
+    query = BoolQuery::newBoolQuery()->should(x)->filter(
+        BoolQuery::newBoolQuery()->mustNot(y));
+    json = optimizeQuery(query, {}, &report)->toJson()["bool"];
+    EXPECT_EQ(y->toJson(), json["filter"][0]["bool"]["mustNot"][0]);
+    EXPECT_FALSE(json.isMember("mustNot"));
+    EXPECT_TRUE(report.empty());
+
+    // another filter keeps should optional
+    query = BoolQuery::newBoolQuery()
+                ->should(x)
+                ->filter(BoolQuery::newBoolQuery()->mustNot(y))
+                ->filter(z);
+    json = optimizeQuery(query, {}, &report)->toJson()["bool"];
+    EXPECT_EQ(y->toJson(), json["mustNot"][0]);
+    EXPECT_EQ(1, json["filter"].size());
+    EXPECT_EQ(1, report.count(QueryRewrite::FLATTEN));
+
+    // as does the lack of should
+    report = QueryRewriteReport();
+    query = BoolQuery::newBoolQuery()->must(x)->must(
+        BoolQuery::newBoolQuery()->mustNot(y));
+    json = optimizeQuery(query, unscored, &report)->toJson()["bool"];
+    EXPECT_EQ(y->toJson(), json["mustNot"][0]);
+    EXPECT_EQ(x->toJson(), json["must"][0]);
+    EXPECT_EQ(1, report.count(QueryRewrite::FLATTEN));
+}
@@ -0,0 +1,83 @@
+#include "../../src/DocumentsClient.h"
+#include "../../src/QueryTemplate.h"
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+using AccountsTemplate = tl::elasticsearch::QueryTemplate<
+    R"({
+    "query": {"bool": {
+        "must": [{"match": {"address": {"query": {{address}}}}}],
+        "filter": [
+            {"term": {"state": {"value": {{state}}}}},
+            {"terms": {"gender": {{genders}}}},
+            {"range": {"balance": {"gte": {{min_balance}}}}}]}},
+    "_source": {{source}},
+    "size": {{size}}})",
+    std::string_view,
+    std::string_view,
+    std::vector<std::string>,
+    double,
+    bool,
+    int>;
+
+TEST(QueryTemplateTest, Render)
+{
+    using namespace tl::elasticsearch;
+    static_assert(AccountsTemplate::placeholders == 6);
+    // the whitespace of the declaration is not sent
+    EXPECT_EQ(std::string_view::npos, AccountsTemplate::text().find(' '));
+    EXPECT_EQ(std::string_view::npos, AccountsTemplate::text().find('\n'));
+
+    auto body = AccountsTemplate::render(
+        "mill \"lane\"\n", "IL", {"F", "M"}, 1000.5, false, 10);
+    Json::Value json;
+    std::stringstream(body) >> json;
+    const auto &boolQuery = json["query"]["bool"];
+    EXPECT_EQ("mill \"lane\"\n",
+              boolQuery["must"][0]["match"]["address"]["query"].asString());
+    EXPECT_EQ("IL", boolQuery["filter"][0]["term"]["state"]["value"]);
+    EXPECT_EQ("M", boolQuery["filter"][1]["terms"]["gender"][1]);
+    EXPECT_EQ(1000.5,
+              boolQuery["filter"][2]["range"]["balance"]["gte"].asDouble());
+    EXPECT_FALSE(json["_source"].asBool());
+    EXPECT_EQ(10, json["size"].asInt());
+
+    // appends to the buffer given
+    std::string buffer = "previous";
+    AccountsTemplate::render(buffer, "lane", "TX", {}, 0, true, 0);
+    EXPECT_EQ(0, buffer.find("previous{"));
+    EXPECT_NE(std::string::npos, buffer.find(R"("gender":[])"));
+}
+
+TEST(QueryTemplateTest, Integers)
+{
+    using namespace tl::elasticsearch;
+    static_assert(TemplateParam<uint64_t> && TemplateParam<int8_t>);
+    static_assert(!TemplateParam<char> && !TemplateParam<char8_t>);
+    using Template = QueryTemplate<R"({"a": {{a}}, "b": {{b}}})",
+                                   uint64_t,
+                                   int16_t>;
+    EXPECT_EQ(R"({"a":18446744073709551615,"b":-3})",
+              Template::render(UINT64_MAX, int16_t(-3)));
+}
+
+TEST(QueryTemplateTest, Literals)
+{
+    using namespace tl::elasticsearch;
+    // braces and spaces inside of strings are not placeholders nor dropped
+    using Literal = QueryTemplate<R"({"query": {"match": {
+        "note": "{{ not a placeholder }}"}}, "size": {{size}}})",
+                                  int64_t>;
+    static_assert(Literal::placeholders == 1);
+    EXPECT_EQ(R"({"query":{"match":{"note":"{{ not a placeholder }}"}},)"
+              R"("size":-3})",
+              Literal::render(-3));
+
+    using Empty = QueryTemplate<R"({"query": {"match_all": {}}})">;
+    EXPECT_EQ(R"({"query":{"match_all":{}}})", Empty::render());
+
+    SearchParam param("accounts");
+    EXPECT_FALSE(param.body());
+    param.body(Empty::render());
+    EXPECT_EQ(Empty::text(), *param.body());
+}
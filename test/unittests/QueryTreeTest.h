@@ -0,0 +1,92 @@
+#include "../../src/QueryTree.h"
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+TEST(QueryTreeTest, Build)
+{
+    using namespace tl::elasticsearch;
+    // the upstream refuses to allocate: the tree fits in the buffer or throws
+    std::byte buffer[2048];
+    std::pmr::monotonic_buffer_resource arena(buffer,
+                                              sizeof(buffer),
+                                              std::pmr::null_memory_resource());
+    auto tree = QueryTree::newQueryTree(&arena);
+    tree->boolQuery({tree->match("address", "lane")},
+                    {tree->matchPhrase("employer", "Quility \"Inc\"")},
+                    {tree->multiMatch({"city", "state"}, "IL")},
+                    {tree->term("gender", "F"),
+                     tree->range("age", {.gte = 20.5, .lt = 40.5})});
+    EXPECT_EQ(6, tree->size());
+    EXPECT_EQ(QueryKind::BOOL, QueryTree::kind(tree->node(tree->root())));
+
+    auto builder = BoolQuery::newBoolQuery()
+                       ->must(MatchQuery::newMatchQuery()
+                                  ->field("address")
+                                  ->query("lane"))
+                       ->should(MatchPhraseQuery::newMatchPhraseQuery()
+                                    ->field("employer")
+                                    ->query("Quility \"Inc\""))
+                       ->filter(TermQuery::newTermQuery()
+                                    ->field("gender")
+                                    ->query("F"))
+                       ->filter(RangeQuery::newRangeQuery()
+                                    ->field("age")
+                                    ->gte(20.5)
+                                    ->lt(40.5));
+    auto json = tree->toJson();
+    Json::Value mustNot;
+    json["bool"].removeMember("must_not", &mustNot);
+    EXPECT_EQ(builder->toJson(), json);
+    EXPECT_EQ("IL", mustNot[0]["multi_match"]["query"].asString());
+    EXPECT_EQ("state", mustNot[0]["multi_match"]["fields"][1].asString());
+
+    std::string compact;
+    tree->writeJson(compact);
+    Json::Value parsed;
+    std::stringstream(compact) >> parsed;
+    EXPECT_EQ(tree->toJson(), parsed);
+
+    EXPECT_THROW(tree->range("age", {.gt = 1, .gte = 2}),
+                 ElasticSearchException);
+    EXPECT_THROW(tree->range("age", {.gte = 2, .lt = 2}),
+                 ElasticSearchException);
+    EXPECT_THROW(tree->range("age", {}), ElasticSearchException);
+    EXPECT_THROW(tree->boolQuery({100}), ElasticSearchException);
+    EXPECT_THROW(QueryTree().toJson(), ElasticSearchException);
+}
+
+TEST(QueryTreeTest, FromQuery)
+{
+    using namespace tl::elasticsearch;
+    auto builder =
+        BoolQuery::newBoolQuery()
+            ->must(MatchAllQuery::newMatchAllQuery())
+            ->mustNot(BoolQuery::newBoolQuery()->filter(
+                RangeQuery::newRangeQuery()->field("balance")->gt(100)))
+            ->should(MultiMatchQuery::newMultiMatchQuery()
+                         ->fields({"firstname", "lastname"})
+                         ->query("Amber"));
+    auto tree = QueryTree::fromQuery(builder);
+    EXPECT_EQ(5, tree->size());
+    auto json = tree->toJson();
+    EXPECT_TRUE(json["bool"]["must"][0]["match_all"].isObject());
+    EXPECT_EQ(100,
+              json["bool"]["must_not"][0]["bool"]["filter"][0]["range"]
+                  ["balance"]["gt"]
+                      .asDouble());
+    EXPECT_EQ(builder->toJson()["bool"]["should"], json["bool"]["should"]);
+
+    // the short forms of Elasticsearch are accepted too
+    Json::Value term;
+    std::stringstream(R"({"bool": {"filter": {"term": {"age": 30}},
+        "must": {"match": {"address": "lane"}}}})") >>
+        term;
+    tree = QueryTree::fromJson(term);
+    json = tree->toJson();
+    EXPECT_EQ("30", json["bool"]["filter"][0]["term"]["age"]["value"]);
+    EXPECT_EQ("lane", json["bool"]["must"][0]["match"]["address"]);
+
+    Json::Value unsupported;
+    unsupported["wildcard"]["state"] = "I*";
+    EXPECT_THROW(QueryTree::fromJson(unsupported), ElasticSearchException);
+}
@@ -0,0 +1,62 @@
+#include "../../src/RateLimiter.h"
+#include <gtest/gtest.h>
+
+TEST(RateLimiterTest, Burst)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    auto now = RateLimiter::Clock::now();
+    RateLimitConfig config;
+    config.rate = 100;
+    config.burst = 50;
+    RateLimiter limiter(config, now);
+
+    EXPECT_EQ(0s, limiter.reserve(50, 1000, now));
+    // in debt for 10 documents, i.e. 100ms
+    EXPECT_EQ(100ms, limiter.reserve(10, 1000, now));
+    EXPECT_EQ(1, limiter.delayedRequests());
+
+    // the bucket refills, but never above the burst
+    now += 10s;
+    EXPECT_EQ(0s, limiter.reserve(50, 1000, now));
+    EXPECT_EQ(10ms, limiter.reserve(1, 1000, now));
+}
+
+TEST(RateLimiterTest, Bytes)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    auto now = RateLimiter::Clock::now();
+    RateLimitConfig config;
+    config.unit = RateLimitUnit::BYTES;
+    config.rate = 1000;
+    RateLimiter limiter(config, now);
+
+    // larger than the bucket, goes through and the next request pays
+    EXPECT_EQ(0s, limiter.reserve(1, 500, now));
+    EXPECT_EQ(1s, limiter.reserve(1, 1500, now));
+}
+
+TEST(RateLimiterTest, SetRate)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    auto now = RateLimiter::Clock::now();
+    RateLimiter limiter(RateLimitConfig(), now);
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(0s, limiter.reserve(1000, 0, now));
+    }
+
+    limiter.setRate(10, 0, now);
+    EXPECT_EQ(10, limiter.config().rate);
+    EXPECT_EQ(0s, limiter.reserve(10, 0, now));
+    EXPECT_EQ(1s, limiter.reserve(10, 0, now));
+
+    // the debt is kept, the new rate pays it back faster
+    limiter.setRate(20, 0, now);
+    EXPECT_EQ(1s, limiter.reserve(10, 0, now));
+
+    limiter.setRate(0, 0, now);
+    EXPECT_EQ(0s, limiter.reserve(1000, 0, now));
+}
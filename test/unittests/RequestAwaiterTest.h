@@ -0,0 +1,49 @@
+#include "../../src/RequestAwaiter.h"
+#include <drogon/utils/coroutine.h>
+#include <gtest/gtest.h>
+
+TEST(RequestAwaiterTest, ConcurrentRequests)
+{
+    using namespace tl::elasticsearch;
+    std::vector<RequestAwaiter<int>::ResultCallback> pending;
+    auto start = [&pending](auto &&resultCallback, auto &&) {
+        pending.push_back(resultCallback);
+    };
+    int sum = 0;
+    bool finished = false;
+    [&]() -> drogon::AsyncTask {
+        // both requests are sent before the first co_await
+        RequestAwaiter<int> first(start);
+        RequestAwaiter<int> second(start);
+        EXPECT_EQ(2, pending.size());
+        sum += co_await first;
+        sum += co_await second;
+        finished = true;
+    }();
+    ASSERT_EQ(2, pending.size());
+    EXPECT_FALSE(finished);
+    pending[1](2);
+    EXPECT_FALSE(finished);
+    pending[0](1);
+    EXPECT_TRUE(finished);
+    EXPECT_EQ(3, sum);
+}
+
+TEST(RequestAwaiterTest, Exception)
+{
+    using namespace tl::elasticsearch;
+    std::string message;
+    [&]() -> drogon::AsyncTask {
+        try
+        {
+            co_await RequestAwaiter<int>([](auto &&, auto &&exceptionCallback) {
+                exceptionCallback(ElasticSearchException("failed"));
+            });
+        }
+        catch (const ElasticSearchException &e)
+        {
+            message = e.what();
+        }
+    }();
+    EXPECT_EQ("failed", message);
+}
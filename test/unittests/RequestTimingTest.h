@@ -0,0 +1,54 @@
+#include "../../src/RequestTiming.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(RequestTimingTest, Timed)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    auto timing = std::make_shared<RequestTiming>();
+    auto result = timed(timing, &RequestTiming::build, []() {
+        std::this_thread::sleep_for(2ms);
+        return 42;
+    });
+    EXPECT_EQ(42, result);
+    EXPECT_GE(timing->build, 2ms);
+    EXPECT_EQ(RequestTiming::Duration::zero(), timing->serialize);
+
+    // disabled, the function still runs
+    EXPECT_EQ(1, timed(nullptr, &RequestTiming::build, []() { return 1; }));
+
+    timing->network = 10ms;
+    timing->took = 8ms;
+    EXPECT_EQ(timing->build + 10ms, timing->total());
+    EXPECT_EQ(8ms, timing->phase(TimingPhase::TOOK));
+}
+
+TEST(RequestTimingTest, Summary)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    auto before = TimingSummary::instance().snapshot();
+    ASSERT_EQ(kTimingPhaseCount, before.size());
+
+    class Response : public TimedResponse
+    {
+    };
+
+    Response response;
+    EXPECT_EQ(nullptr, response.getTiming());
+    auto timing = std::make_shared<RequestTiming>();
+    timing->queue = 3ms;
+    response.setTiming(timing);
+    EXPECT_EQ(timing, response.getTiming());
+
+    auto after = TimingSummary::instance().snapshot();
+    for (size_t i = 0; i < kTimingPhaseCount; ++i)
+    {
+        EXPECT_EQ(static_cast<TimingPhase>(i), after[i].phase);
+        EXPECT_EQ(before[i].count + 1, after[i].count);
+    }
+    auto queue = static_cast<size_t>(TimingPhase::QUEUE);
+    EXPECT_EQ(before[queue].sum + 3000, after[queue].sum);
+    EXPECT_EQ("queue", to_string(TimingPhase::QUEUE));
+}
@@ -443,3 +443,138 @@ TEST_F(SearchTest, TermAggWithAvgAggTestAndOrder)
         std::dynamic_pointer_cast<MetricsAggregationsResponse>(subAgg);
     EXPECT_EQ(41418.166666666664, avgAgg->value());
 }
+
+TEST_F(SearchTest, CountTest)
+{
+    using namespace tl::elasticsearch;
+    DocumentsClient dClient(
+        std::make_shared<HttpClient>("http://localhost:9200"));
+
+    // mainTest
+    CountParam param("ds_index_name");
+    param.query(MatchQuery::newMatchQuery()->field("age")->query("28"));
+    auto resp = dClient.count(param);
+    EXPECT_EQ(51, resp->getCount());
+    EXPECT_EQ(0, resp->getShards()->getFailed());
+
+    EXPECT_EQ(1000, dClient.count(CountParam("ds_index_name"))->getCount());
+}
+
+TEST_F(SearchTest, SearchTemplateTest)
+{
+    using namespace tl::elasticsearch;
+    DocumentsClient dClient(
+        std::make_shared<HttpClient>("http://localhost:9200"));
+
+    PutScriptParam script("ds_accounts_by_age");
+    script.source(
+        R"({"query": {"match": {"age": "{{age}}"}}, "size": {{size}}})");
+    EXPECT_TRUE(dClient.putScript(script)->isAcknowledged());
+    auto stored = dClient.getScript("ds_accounts_by_age");
+    EXPECT_TRUE(stored->isFound());
+    EXPECT_EQ("mustache", stored->getLang());
+
+    // mainTest
+    SearchTemplateParam param("ds_index_name");
+    param.id("ds_accounts_by_age").param("age", 28).param("size", 5);
+    auto resp = dClient.searchTemplate<Account>(param);
+    EXPECT_EQ(51, resp->getHitsTotal());
+    EXPECT_EQ(5, resp->getHits().size());
+
+    // an inline template
+    SearchTemplateParam inlineParam("ds_index_name");
+    inlineParam.source(Json::Value(R"({"query": {"match_all": {}}})"));
+    EXPECT_EQ(1000,
+              dClient.searchTemplate<Account>(inlineParam)->getHitsTotal());
+
+    EXPECT_TRUE(dClient.deleteScript("ds_accounts_by_age")->isAcknowledged());
+    EXPECT_FALSE(dClient.getScript("ds_accounts_by_age")->isFound());
+    EXPECT_THROW(dClient.searchTemplate<Account>(param),
+                 ElasticSearchException);
+}
+
+TEST_F(SearchTest, MultiSearchTemplateTest)
+{
+    using namespace tl::elasticsearch;
+    DocumentsClient dClient(
+        std::make_shared<HttpClient>("http://localhost:9200"));
+    PutScriptParam script("ds_accounts_by_age");
+    script.source(R"({"query": {"match": {"age": "{{age}}"}}})");
+    dClient.putScript(script);
+
+    MultiSearchTemplateParam param;
+    param.add(SearchTemplateParam("ds_index_name")
+                  .id("ds_accounts_by_age")
+                  .param("age", 28))
+        .add(SearchTemplateParam("ds_index_name")
+                 .id("ds_missing_script")
+                 .param("age", 28));
+    auto resp = dClient.multiSearchTemplate<Account>(param);
+    ASSERT_EQ(2, resp->getResponses().size());
+    const auto &found = resp->getResponses()[0];
+    ASSERT_TRUE(found.response);
+    EXPECT_EQ(51, found.response->getHitsTotal());
+    EXPECT_TRUE(found.error.empty());
+    // the searches fail one by one
+    const auto &missing = resp->getResponses()[1];
+    EXPECT_FALSE(missing.response);
+    EXPECT_FALSE(missing.error.empty());
+
+    dClient.deleteScript("ds_accounts_by_age");
+}
+
+TEST_F(SearchTest, ProfileTest)
+{
+    using namespace tl::elasticsearch;
+    DocumentsClient dClient(
+        std::make_shared<HttpClient>("http://localhost:9200"));
+
+    SearchParam param("ds_index_name");
+    param.query(MatchQuery::newMatchQuery()->field("address")->query("lane"));
+    EXPECT_FALSE(dClient.search<Account>(param)->getProfile());
+
+    param.profile(true);
+    auto profile = dClient.search<Account>(param)->getProfile();
+    ASSERT_TRUE(profile);
+    ASSERT_FALSE(profile->getShards().empty());
+    const auto &search = profile->getShards()[0].getSearches().at(0);
+    EXPECT_FALSE(search.getQuery().empty());
+    EXPECT_FALSE(search.getCollector().empty());
+    EXPECT_GT(search.getQuery()[0].getTimeInNanos(), 0);
+    EXPECT_FALSE(profile->getHotspots(3).empty());
+}
+
+TEST(SearchTemplateParamTest, ToJson)
+{
+    using namespace tl::elasticsearch;
+    SearchTemplateParam param("ds_index_name");
+    EXPECT_THROW(param.toJson(), ElasticSearchException);
+    param.id("by_age").param("age", 28);
+    auto json = param.toJson();
+    EXPECT_EQ("by_age", json["id"].asString());
+    EXPECT_EQ(28, json["params"]["age"].asInt());
+
+    MultiSearchTemplateParam multi;
+    multi.add(param).add(param);
+    auto body = multi.toBody();
+    EXPECT_EQ(4, std::count(body.begin(), body.end(), '\n'));
+    EXPECT_EQ('\n', body.back());
+    EXPECT_EQ("ds_index_name", multi.toLines()[2]["index"].asString());
+
+    Json::Value responses;
+    std::stringstream(R"({"took": 3, "responses": [
+        {"took": 1, "timed_out": false, "status": 200,
+         "hits": {"total": 1, "max_score": 1.0, "hits": []}},
+        {"status": 404, "error": {"type": "resource_not_found_exception",
+                                  "reason": "unable to find script"}}]})") >>
+        responses;
+    MultiSearchResponse<Account> resp;
+    resp.setByJson(responses);
+    ASSERT_EQ(2, resp.getResponses().size());
+    EXPECT_EQ(1, resp.getResponses()[0].response->getHitsTotal());
+    EXPECT_EQ(404, resp.getResponses()[1].status);
+    EXPECT_EQ(
+        "ElasticSearchException [type=resource_not_found_exception, "
+        "reason=unable to find script]",
+        resp.getResponses()[1].error);
+}
@@ -0,0 +1,86 @@
+#include "../../src/SlowLog.h"
+#include <gtest/gtest.h>
+
+TEST(SlowLogTest, Threshold)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    EXPECT_FALSE(SlowLog(SlowLogConfig()).isSlow(10s));
+
+    SlowLogConfig config;
+    config.thresholdMs = 100;
+    SlowLog slowLog(config);
+    EXPECT_FALSE(slowLog.isSlow(99ms));
+    EXPECT_TRUE(slowLog.isSlow(100ms));
+}
+
+TEST(SlowLogTest, RateLimit)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    SlowLogConfig config;
+    config.thresholdMs = 100;
+    config.maxPerSecond = 2;
+    auto now = SlowLog::Clock::now();
+    SlowLog slowLog(config, now);
+    std::vector<SlowLogRecord> records;
+    slowLog.setSink(
+        [&records](const SlowLogRecord &record) { records.push_back(record); });
+
+    int admitted = 0;
+    for (int i = 0; i < 10; ++i)
+    {
+        if (slowLog.admit(now))
+        {
+            ++admitted;
+            slowLog.write(SlowLogRecord());
+        }
+    }
+    EXPECT_EQ(2, admitted);
+    EXPECT_EQ(8, slowLog.suppressed());
+
+    // one token per half second, the record reports what was dropped
+    EXPECT_FALSE(slowLog.admit(now + 100ms));
+    ASSERT_TRUE(slowLog.admit(now + 600ms));
+    slowLog.write(SlowLogRecord());
+    ASSERT_EQ(3, records.size());
+    EXPECT_EQ(0, records[1].suppressed);
+    EXPECT_EQ(9, records[2].suppressed);
+    EXPECT_EQ(3, slowLog.written());
+}
+
+TEST(SlowLogTest, Sampling)
+{
+    using namespace tl::elasticsearch;
+    SlowLogConfig config;
+    config.thresholdMs = 100;
+    config.sampleRate = 0;
+    SlowLog slowLog(config);
+    EXPECT_FALSE(slowLog.admit());
+    EXPECT_EQ(1, slowLog.suppressed());
+}
+
+TEST(SlowLogTest, Format)
+{
+    using namespace tl::elasticsearch;
+    using namespace std::chrono_literals;
+    SlowLogRecord record;
+    record.operation = "search";
+    record.index = "accounts";
+    record.fingerprint = 0xabc;
+    record.body = "{\"query\": {";
+    record.bodyTruncated = true;
+    record.latency = 1500ms;
+    record.tookMs = 1200;
+    record.shardFailures = 1;
+    record.timing = std::make_shared<RequestTiming>();
+    record.timing->network = 1400ms;
+    auto text = to_string(record);
+    EXPECT_NE(std::string::npos, text.find("operation=search index=accounts"));
+    EXPECT_NE(std::string::npos, text.find("fingerprint=abc"));
+    EXPECT_NE(std::string::npos, text.find("latency_ms=1500"));
+    EXPECT_NE(std::string::npos, text.find("took_ms=1200"));
+    EXPECT_NE(std::string::npos, text.find("shard_failures=1"));
+    EXPECT_NE(std::string::npos, text.find("network=1400000"));
+    EXPECT_NE(std::string::npos, text.find("body={\"query\": {..."));
+}
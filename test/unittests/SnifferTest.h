@@ -0,0 +1,73 @@
+#include "../../src/Sniffer.h"
+#include <drogon/drogon.h>
+#include <gtest/gtest.h>
+
+// Canned `_nodes/http` response of a cluster with a dedicated master, a data
+// node and a coordinating node.
+inline Json::Value snifferTestNodes()
+{
+    Json::Value nodes;
+    nodes["m1"]["roles"].append("master");
+    nodes["m1"]["http"]["publish_address"] = "127.0.0.1:9301";
+    nodes["d1"]["roles"].append("master");
+    nodes["d1"]["roles"].append("data");
+    nodes["d1"]["http"]["publish_address"] = "es-data/127.0.0.1:9302";
+    nodes["c1"]["roles"] = Json::Value(Json::arrayValue);
+    nodes["c1"]["http"]["publish_address"] = "127.0.0.1:9303";
+    Json::Value result;
+    result["nodes"] = nodes;
+    return result;
+}
+
+// Stand-in for ElasticSearch, must be called before app().run()
+inline void registerSnifferStandIn()
+{
+    drogon::app().addListener("127.0.0.1", 9280);
+    drogon::app().registerHandler(
+        "/_nodes/http",
+        [](const drogon::HttpRequestPtr &,
+           std::function<void(const drogon::HttpResponsePtr &)> &&callback) {
+            callback(drogon::HttpResponse::newHttpJsonResponse(
+                snifferTestNodes()));
+        },
+        { drogon::Get });
+}
+
+TEST(SnifferTest, ParseNodes)
+{
+    using namespace tl::elasticsearch;
+    auto urls = Sniffer::parseNodes(snifferTestNodes(), SniffFilter());
+    ASSERT_EQ(2, urls.size());
+    EXPECT_EQ("http://127.0.0.1:9302", urls[0]);
+    EXPECT_EQ("http://127.0.0.1:9303", urls[1]);
+
+    SniffFilter dataOnly;
+    dataOnly.roles.push_back("data");
+    urls = Sniffer::parseNodes(snifferTestNodes(), dataOnly);
+    ASSERT_EQ(1, urls.size());
+    EXPECT_EQ("http://127.0.0.1:9302", urls[0]);
+
+    SniffFilter all;
+    all.skipDedicatedMasters = false;
+    EXPECT_EQ(3, Sniffer::parseNodes(snifferTestNodes(), all).size());
+    EXPECT_TRUE(Sniffer::parseNodes(Json::Value(), all).empty());
+
+    urls = Sniffer::parseNodes(snifferTestNodes(), SniffFilter(), "https");
+    ASSERT_EQ(2, urls.size());
+    EXPECT_EQ("https://127.0.0.1:9302", urls[0]);
+}
+
+TEST(SnifferTest, Sniff)
+{
+    using namespace tl::elasticsearch;
+    auto httpClient = std::make_shared<HttpClient>("http://127.0.0.1:9280");
+    auto sniffer = std::make_shared<Sniffer>(httpClient);
+    std::promise<bool> pro;
+    auto f = pro.get_future();
+    sniffer->sniff([&pro](bool succeeded) { pro.set_value(succeeded); });
+    ASSERT_TRUE(f.get());
+    auto stats = httpClient->nodeStats();
+    ASSERT_EQ(2, stats.size());
+    EXPECT_EQ("http://127.0.0.1:9302", stats[0].url);
+    EXPECT_EQ("http://127.0.0.1:9303", stats[1].url);
+}
@@ -0,0 +1,80 @@
+#include "../../src/SyncCaller.h"
+#include <trantor/net/EventLoopThread.h>
+#include <gtest/gtest.h>
+
+TEST(SyncCallerTest, BlockedThreads)
+{
+    using namespace tl::elasticsearch;
+    SyncPolicy policy;
+    policy.maxBlockedThreads = 1;
+    SyncCaller caller(policy);
+    bool rejected = false;
+    auto result =
+        caller.call<int>([&](auto &&resultCallback, auto &&) {
+            EXPECT_EQ(1, caller.stats().blockedThreads);
+            try
+            {
+                caller.call<int>([](auto &&resultCallback, auto &&) {
+                    resultCallback(2);
+                });
+            }
+            catch (const ElasticSearchException &)
+            {
+                rejected = true;
+            }
+            resultCallback(1);
+        });
+    EXPECT_EQ(1, result);
+    EXPECT_TRUE(rejected);
+    auto stats = caller.stats();
+    EXPECT_EQ(2, stats.calls);
+    EXPECT_EQ(1, stats.rejected);
+    EXPECT_EQ(0, stats.blockedThreads);
+    EXPECT_EQ(1, stats.maxBlockedThreads);
+
+    EXPECT_THROW(
+        caller.call<int>([](auto &&, auto &&exceptionCallback) {
+            exceptionCallback(ElasticSearchException("failed"));
+        }),
+        ElasticSearchException);
+}
+
+TEST(SyncCallerTest, OnEventLoop)
+{
+    using namespace tl::elasticsearch;
+    trantor::EventLoopThread loopThread;
+    loopThread.run();
+
+    SyncCaller internal;
+    std::promise<bool> movedOff;
+    loopThread.getLoop()->runInLoop([&]() {
+        trantor::EventLoop *transportLoop = nullptr;
+        internal.call<int>([&](auto &&resultCallback, auto &&) {
+            transportLoop = SyncCaller::transportLoop();
+            resultCallback(1);
+        });
+        movedOff.set_value(transportLoop &&
+                           transportLoop != loopThread.getLoop());
+    });
+    EXPECT_TRUE(movedOff.get_future().get());
+    EXPECT_EQ(1, internal.stats().callsOnLoop);
+
+    SyncPolicy policy;
+    policy.onLoop = SyncOnLoop::FAIL;
+    SyncCaller failing(policy);
+    std::promise<bool> thrown;
+    loopThread.getLoop()->runInLoop([&]() {
+        try
+        {
+            failing.call<int>(
+                [](auto &&resultCallback, auto &&) { resultCallback(1); });
+            thrown.set_value(false);
+        }
+        catch (const ElasticSearchException &)
+        {
+            thrown.set_value(true);
+        }
+    });
+    EXPECT_TRUE(thrown.get_future().get());
+    EXPECT_EQ(1, failing.stats().rejected);
+}
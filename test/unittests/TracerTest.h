@@ -0,0 +1,62 @@
+#include "../../src/HttpClient.h"
+#include "../../src/Tracer.h"
+#include <gtest/gtest.h>
+#include <set>
+
+TEST(TracerTest, RequestId)
+{
+    using namespace tl::elasticsearch;
+    std::set<std::string> ids;
+    for (int i = 0; i < 100; ++i)
+    {
+        ids.insert(TraceSpan::newRequestId());
+    }
+    EXPECT_EQ(100, ids.size());
+    EXPECT_EQ(0, ids.begin()->find("es-"));
+}
+
+TEST(TracerTest, RingBuffer)
+{
+    using namespace tl::elasticsearch;
+    RingBufferTracer tracer(2);
+    for (auto index : { "a", "b", "c" })
+    {
+        auto span = tracer.startSpan("get", index);
+        EXPECT_FALSE(span->requestId.empty());
+        tracer.endSpan(span);
+    }
+    auto spans = tracer.spans();
+    ASSERT_EQ(2, spans.size());
+    EXPECT_EQ("b", spans[0]->index);
+    EXPECT_EQ("c", spans[1]->index);
+    EXPECT_EQ(3, tracer.finished());
+    tracer.clear();
+    EXPECT_TRUE(tracer.spans().empty());
+}
+
+TEST(TracerTest, SpanOfCancelledRequest)
+{
+    using namespace tl::elasticsearch;
+    HttpClient client("http://localhost:9200");
+    auto tracer = std::make_shared<RingBufferTracer>();
+    client.setTracer(tracer);
+    RequestOptions options;
+    options.operation = "search";
+    options.index = "accounts";
+    options.cancellation = std::make_shared<CancellationToken>();
+    options.cancellation->cancel();
+    client.sendRequest(
+        "/accounts/_search",
+        drogon::Get,
+        [](const Json::Value &) {},
+        [](const ElasticSearchException &) {},
+        Json::Value(Json::objectValue),
+        options);
+    auto spans = tracer->spans();
+    ASSERT_EQ(1, spans.size());
+    EXPECT_EQ("search", spans[0]->operation);
+    EXPECT_EQ("accounts", spans[0]->index);
+    EXPECT_EQ("request cancelled!", spans[0]->error);
+    EXPECT_EQ(0, spans[0]->attempts);
+    EXPECT_GT(spans[0]->bytesSent, 0);
+}
@@ -0,0 +1,142 @@
+#include "../../src/TrafficReplay.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+
+class CapturedDocument : public tl::elasticsearch::Document
+{
+  public:
+    virtual Json::Value toJson() const override
+    {
+        return json_;
+    }
+
+    virtual void setByJson(const Json::Value &json) override
+    {
+        json_ = json;
+    }
+
+  private:
+    Json::Value json_;
+};
+
+static std::string capturePath(const std::string &name)
+{
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove(path);
+    return path.string();
+}
+
+static tl::elasticsearch::TrafficRecord capturedRecord(
+    const std::string &operation,
+    uint16_t status,
+    const std::string &responseBody)
+{
+    tl::elasticsearch::TrafficRecord record;
+    record.timestampUs = 1700000000000000;
+    record.latencyUs = 1500;
+    record.status = status;
+    record.method = "POST";
+    record.operation = operation;
+    record.index = "accounts";
+    record.path = "/accounts/_doc/_" + operation;
+    record.requestBody = R"({"query":{"match_all":{}}})";
+    record.responseBody = responseBody;
+    return record;
+}
+
+TEST(TrafficCaptureTest, RecordAndRead)
+{
+    using namespace tl::elasticsearch;
+    auto path = capturePath("es_capture_test.cap");
+    std::string large(300, 'x');
+    {
+        TrafficRecorder recorder(path);
+        recorder.write(capturedRecord("search", 200, "{}"));
+        recorder.write(capturedRecord("count", 0, ""));
+        EXPECT_EQ(2, recorder.written());
+    }
+    {
+        // appends, the header is written once
+        TrafficRecorder recorder(path);
+        recorder.write(capturedRecord("get", 404, large));
+    }
+
+    auto records = TrafficReader::readAll(path);
+    ASSERT_EQ(3, records.size());
+    EXPECT_EQ(1700000000000000, records[0].timestampUs);
+    EXPECT_EQ(1500, records[0].latencyUs);
+    EXPECT_EQ(200, records[0].status);
+    EXPECT_EQ("POST", records[0].method);
+    EXPECT_EQ("search", records[0].operation);
+    EXPECT_EQ("accounts", records[0].index);
+    EXPECT_EQ("/accounts/_doc/_search", records[0].path);
+    EXPECT_EQ(R"({"query":{"match_all":{}}})", records[0].requestBody);
+    EXPECT_EQ("{}", records[0].responseBody);
+    EXPECT_EQ(0, records[1].status);
+    EXPECT_EQ("", records[1].responseBody);
+    EXPECT_EQ(large, records[2].responseBody);
+
+    // a record cut by a crash is dropped, the ones before it are kept
+    auto encoded = TrafficRecorder::encode(capturedRecord("index", 201, "{}"));
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file.write(encoded.data(), encoded.size() / 2);
+    }
+    EXPECT_EQ(3, TrafficReader::readAll(path).size());
+    {
+        // the torn record is cut when the file is opened again
+        TrafficRecorder recorder(path);
+        recorder.write(capturedRecord("index", 201, "{}"));
+    }
+    records = TrafficReader::readAll(path);
+    ASSERT_EQ(4, records.size());
+    EXPECT_EQ("index", records[3].operation);
+    EXPECT_EQ(201, records[3].status);
+
+    // so is a header cut before its end
+    auto torn = capturePath("es_capture_torn.cap");
+    std::ofstream(torn, std::ios::binary) << "ESCAP";
+    {
+        TrafficRecorder recorder(torn);
+        recorder.write(capturedRecord("search", 200, "{}"));
+    }
+    EXPECT_EQ(1, TrafficReader::readAll(torn).size());
+    std::filesystem::remove(torn);
+
+    auto other = capturePath("es_capture_test.txt");
+    std::ofstream(other) << "not a capture";
+    EXPECT_THROW(TrafficReader reader(other), ElasticSearchException);
+    EXPECT_THROW(TrafficRecorder recorder(other), ElasticSearchException);
+    EXPECT_THROW(TrafficReader reader(capturePath("es_capture_missing.cap")),
+                 ElasticSearchException);
+    std::filesystem::remove(path);
+    std::filesystem::remove(other);
+}
+
+TEST(TrafficCaptureTest, Decode)
+{
+    using namespace tl::elasticsearch;
+    TrafficReplayer replayer({
+        capturedRecord("search",
+                       200,
+                       R"({"took": 3, "timed_out": false,
+                           "hits": {"total": 1, "max_score": 1.0, "hits": [
+                             {"_index": "accounts", "_type": "_doc",
+                              "_id": "1", "_score": 1.0,
+                              "_source": {"account_number": 1}}]}})"),
+        capturedRecord("count", 200, R"({"count": 1000})"),
+        capturedRecord("search",
+                       400,
+                       R"({"error": {"type": "parsing_exception"},
+                           "status": 400})"),
+        capturedRecord("get", 200, "not json"),
+        capturedRecord("search", 0, ""),
+        capturedRecord("cluster.health", 200, R"({"status": "green"})"),
+    });
+    EXPECT_EQ(6, replayer.records().size());
+    EXPECT_TRUE(TrafficReplayer::decode<CapturedDocument>(
+        replayer.records()[0]));
+    EXPECT_FALSE(TrafficReplayer::decode<CapturedDocument>(
+        replayer.records()[2]));
+    EXPECT_EQ(3, replayer.decode<CapturedDocument>());
+}